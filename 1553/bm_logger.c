@@ -4,215 +4,22 @@ void *bm = NULL;
 int bm_log_entry_cnt = 0;
 
 #ifdef COMPRESSED_LOGGING
-/* Compressed log */
-struct bm_cmp_log {
-	unsigned int *base;
-	unsigned int *head;
-	unsigned int *tail;
-	unsigned int *end;
-	uint64_t time;
-	uint64_t lastlogtime;
-};
-struct bm_cmp_log cmp_log;
-#define BM_CMP_LOG_SIZE 0x200000    /* 2Mb */
-#define BM_CMP_LOG_CNT  (BM_CMP_LOG_SIZE/4)
-
-int bm_log_copy(
-	unsigned int dst,
-	struct gr1553bm_entry *src,
-	int nentries,
-	void *data
-	);
-
-/* Add a number of words to "compressed" Log */
-void log_cmp_add(struct bm_cmp_log *log, unsigned int *words, int cnt)
-{
-	int i;
-
-	for (i=0; i<cnt; i++) {
-		*log->head = words[i];
-		log->head++;
-		if ( log->head >= log->end )
-			log->head = log->base;
-		if ( log->head == log->tail ) {
-			log->tail++;
-			if ( log->tail >= log->end )
-				log->tail = log->base;
-		}
-	}
-}
-
-int log_cmp_take(struct bm_cmp_log *log, unsigned int *words, int max)
-{
-	int i;
-
-	for (i=0; i<max; i++) {
-		if ( log->tail == log->head ) {
-			/* log empty */
-			break;
-		}
-		words[i] = *log->tail;
-		log->tail++;
-		if ( log->tail >= log->end )
-			log->tail = log->base;
-	}
-
-	return i;
-}
-
-/* Add an Control entry to log.
- *
- * CTRL is 29-bits
- */
-void log_cmp_add_ctrl(struct bm_cmp_log *log, int ctrl)
-{
-	unsigned int word = ctrl | 0xe0000000;
-	log_cmp_add(log, &word, 1);
-}
-
-int dummy(void)
-{
-	static int i=0;
-	return i++;
-}
-
-/* Copy Data To a larger software buffer
- *
- * dst       Argument not used
- * src       Source DMA buffer start
- * nentires  Must process the number of entries.
- */
-int bm_log_copy(
-	unsigned int dst,
-	struct gr1553bm_entry *src,
-	int nentries,
-	void *data
-	)
-{
-	unsigned int words[3];
-	int wc;
-	struct bm_cmp_log *log = data;
-	uint64_t currtime, logtime64, ll_time64, time64;
-	unsigned int time24, logtime24;
-	int cnt=0;
-
-	/* Sample Current Time */
-	gr1553bm_time(bm, &currtime);
-	time64 = currtime & ~0x00ffffff;
-	time24 = currtime &  0x00ffffff;
-
-	/* Get LastLog Time, but ignore lowest 13 bits */
-	ll_time64 = log->time & ~0x1fff;
-
-	/* We know that the current time must be 
-	 * more recent than the time in the logs
-	 * since the log length has been prepared
-	 * before calling gr1553bm_time() here.
-	 *
-	 * We also know that this function is
-	 * called so often that 24-bit time may
-	 * only have wrapped once against current
-	 * time sample.
-	 */
-
-	while ( nentries-- ) {
-		/* Compress One entry */
-
-		/*** Calculate Exact time of one LOG ENTRY ***/
-
-		logtime24 = src->time & 0x00ffffff;
-		/* Calculate Most significant bits in time */
-		if ( logtime24 < time24 ) {
-			/* No Wrap occurred */
-			logtime64 = time64;
-		} else {
-			/* Wrap occurred.  */
-			logtime64 = time64 - 0x1000000;
-		}
-		/* Set lowest 24-bits */
-		logtime64 |= logtime24;
-
-/* FOR DEBUGGING WHEN BUFFER HAS BEEN FULL. 
- *
- * WE SHOULD WRITE ERROR CONTROL WORD HERE.
+/* Compressed log, written by the generic Bus Monitor interface. The GR1553B
+ * back end compresses the BM DMA log in the driver's copy function.
  */
-		if ( log->lastlogtime > logtime64 ) {
-			/* Stop BM logging */
-			*(volatile unsigned int *)0x800005c4 = 0;
-			printf("LOG LAST TIME WAS PRIOR:\n");
-			printf("  Last: 0x%llx\n", log->lastlogtime);
-			printf("  Now:  0x%llx:\n", logtime64);
-			printf("  time64:  0x%llx:\n", time64);
-			printf("  time24:  0x%x:\n", time24);
-			printf("  currtime:  0x%llx:\n", currtime);
-			printf("  ll_time64:  0x%llx:\n", ll_time64);
-			printf("  cnt: %d\n", cnt);
-			printf("  words[i-4]: 0x%08x\n", (unsigned int)(src-2)->time);
-			printf("  words[i-3]: 0x%08x\n", (unsigned int)(src-2)->data);
-			printf("  words[i-2]: 0x%08x\n", (unsigned int)(src-1)->time);
-			printf("  words[i-1]: 0x%08x\n", (unsigned int)(src-1)->data);
-			printf("  words[i+0]: 0x%08x\n", (unsigned int)src->time);
-			printf("  words[i+1]: 0x%08x\n", (unsigned int)src->data);
-			dummy();
-			asm volatile("ta 0x1\n\t");
-		}
-		log->lastlogtime = logtime64;
-
-		/* Do we need to write down time in a longer format? We
-		 * Compare with the time of the last recoded entry.
-		 *
-		 * The extra 30 bits of time is written
-		 * if the 13-bit time is overflown since last
-		 * sample.
-		 */
-		if ( (logtime64 & ~0x1fff) > ll_time64 ) {
-			/* Write down long time before data entry 
-			 * The 2 MSB bits must be 0b10
-			 */
-			ll_time64 = logtime64 & ~0x1fff;
-
-			/* Get 30-bit MSB Time from 64-bit time */
-			words[0] = 0x80000000 | ((logtime64>>13) & 0x3fffffff);
-			wc = 1;
-		} else {
-			wc = 0;
-		}
-
-		if ( (src->data & (0x3<<17)) != 0 ) {
-			/* Error of some kind. Log error 
-			 * The 3 MSB bits must be 0b110
-			 */
-			words[wc] = 0xc0000000 | ((src->data >> 17) & 0x3);
-			wc++;
-		}
-		/* Log Transfer 
-		 * The MSB bit must be 0
-		 */
-		words[wc] =
-			((logtime64 & 0x1fff)<<18) |	/* 13-bit time */
-			((src->data & 0x80000)>>2) |	/* Bus bit */
-			(src->data & 0x1ffff);		/* DATA and WTP */
-		wc++;
-
-		/* Write Words to buffer */
-		log_cmp_add(log, &words[0], wc);
-
-		src++;
-		cnt++;
-	}
-
-	/* Save complete last log time */
-	log->time = logtime64;
-
-	return 0;
-}
+#include "bmon.c"
+#include "bmon_gr1553b.c"
 
+struct bmon *bm_mon = NULL;
+#define BM_CMP_LOG_SIZE 0x200000    /* 2Mb */
+#define BM_CMP_LOG_CNT  (BM_CMP_LOG_SIZE/4)
 #endif
 
 #ifdef ETH_SERVER
 int eth_setup(void);
 #endif
 
+#ifndef COMPRESSED_LOGGING
 struct gr1553bm_config bmcfg =
 {
 	.time_resolution = 0,	/* Highest time resoulution */
@@ -223,16 +30,12 @@ struct gr1553bm_config bmcfg =
 	.filt_mc = 0x7ffff,	/* Log all Mode codes */
 	.buffer_size = 16*1024,/* 16K buffer */
 	.buffer_custom = (void *)BM_LOG_BASE,	/* Let driver allocate dynamically or custom adr */
-#ifdef COMPRESSED_LOGGING
-	.copy_func = bm_log_copy, /* Custom Copying to compressed buffer */
-	.copy_func_arg = &cmp_log,
-#else
 	.copy_func = NULL,	/* Standard Copying */
 	.copy_func_arg = NULL,
-#endif
 	.dma_error_isr = NULL,	/* No custom DMA Error IRQ handling */
 	.dma_error_arg = NULL,
 };
+#endif
 
 /* Set up BM to log eveything */
 
@@ -240,6 +43,21 @@ int init_bm(void)
 {
 	int status;
 
+#ifdef COMPRESSED_LOGGING
+	struct bmon_gr1553b_cfg moncfg;
+
+	/* Aquire and configure BM device, log everything into compressed
+	 * log. A START control entry is added when logging starts.
+	 */
+	moncfg.minor = 0;
+	moncfg.buffer = (void *)BM_LOG_BASE;
+	bm_mon = bmon_open(&bmon_gr1553b_ops, &moncfg, BM_CMP_LOG_CNT);
+	if ( !bm_mon ) {
+		printf("Failed to open BM[%d]\n", 0);
+		return -1;
+	}
+	bm = bmon_gr1553b_dev(bm_mon);
+#else
 	/* Aquire BM device */
 	bm = gr1553bm_open(0);
 	if ( !bm ) {
@@ -247,27 +65,12 @@ int init_bm(void)
 		return -1;
 	}
 
-#ifdef COMPRESSED_LOGGING
-	cmp_log.base = (unsigned int *)malloc(BM_CMP_LOG_SIZE);
-	if ( cmp_log.base == NULL ) {
-		/* Failed to allocate log buffer */
-		return -2;
-	}
-	cmp_log.head = cmp_log.base;
-	cmp_log.tail = cmp_log.base;
-	cmp_log.end = cmp_log.base + BM_CMP_LOG_CNT;
-	cmp_log.time = 0;
-	cmp_log.lastlogtime = 0;
-
-	/* Add initialial entry in log (START) */
-	log_cmp_add_ctrl(&cmp_log, 0);
-#endif
-
 	/* Register standard IRQ handler when an error occur */
 	if ( gr1553bm_config(bm, &bmcfg) ) {
 		printf("Failed to configure BM driver\n");
 		return -3;
 	}
+#endif
 
 #ifdef ETH_SERVER
 	/* Set up and start Ethernet server */
@@ -287,29 +90,40 @@ int init_bm(void)
 #endif
 
 	/* Start BM Logging as configured */
+#ifdef COMPRESSED_LOGGING
+	status = bmon_start(bm_mon);
+#else
 	status = gr1553bm_start(bm);
+#endif
 	if ( status ) {
 		printf("Failed to start BM: %d\n", status);
 		return -4;
 	}
 
+	return 0;
+}
+
 #ifdef COMPRESSED_LOGGING
-	{
-		uint64_t time1553;
-		unsigned int words[2];
 
-		gr1553bm_time(bm, &time1553);
+/* Handle BM LOG (empty it into compressed log) */
+int bm_log(void)
+{
+	int tot;
 
-		/* Add initialial time entry in log */
-		words[0] = 0x80000000 | ((time1553>>13) & 0x3fffffff);
-		words[1] = (time1553 & 0x1fff) << 18; /* Empty Data */
-		log_cmp_add(&cmp_log, &words[0], 2);
+	tot = bmon_drain(bm_mon);
+	if ( tot < 0 ) {
+		printf("Failed to read BM log entries\n");
+		return -3;
 	}
-#endif
+
+	/* Update stats */
+	bm_log_entry_cnt += tot;
 
 	return 0;
 }
 
+#else
+
 /* Temporary buffer */
 struct gr1553bm_entry bm_log_entries[256];
 int nentries_log[5000] = {0,0};
@@ -335,14 +149,9 @@ int bm_log(void)
 		}
 		tot += max;
 
-#ifndef COMPRESSED_LOGGING
 		/* Handle Copied BM Log here. 
 		 */
-#else
-		 /* When doing custom copy, the copy function has 
-		  * already handled the data. Nothing to do.
-		  */
-#endif
+
 		/* Read as long as the BM driver fills our buffer */
 	} while ( max == 128 );
 
@@ -360,6 +169,8 @@ int bm_log(void)
 	return 0;
 }
 
+#endif
+
 #ifdef ETH_SERVER
 
 /* Ethernet TCP/IP Server Task */
@@ -0,0 +1,111 @@
+/* Generic 1553 Bus Monitor interface, see bmon.h */
+
+#include <stdlib.h>
+#include <string.h>
+#include "bmon.h"
+
+void bmon_log_ctrl(struct bmon *mon, int code, unsigned int value)
+{
+	if ( bm_ring_room(mon->ring, 1) )
+		bm_ring_ctrl(mon->ring, code, value);
+}
+
+void bmon_log_word(struct bmon *mon, uint64_t time, int bus, int err, unsigned int data)
+{
+	unsigned int words[3];
+	int wc;
+
+	if ( !bm_ring_room(mon->ring, 3) ) {
+		bm_ring_drop(mon->ring, 1);
+		return;
+	}
+
+	wc = bm_ring_time(mon->ring, time, words);
+	if ( err )
+		words[wc++] = 0xc0000000 | err;
+	words[wc++] = ((time & 0x1fff) << 18) | ((bus & 1) << 17) | (data & 0x1ffff);
+
+	bm_ring_add(mon->ring, words, wc);
+}
+
+int bmon_take(struct bmon *mon, unsigned int *words, int max)
+{
+	return bm_ring_take(mon->ring, words, max);
+}
+
+struct bmon *bmon_open(const struct bmon_ops *ops, void *arg, int ringsize)
+{
+	struct bmon *mon;
+
+	mon = calloc(1, sizeof(*mon));
+	if ( mon == NULL )
+		return NULL;
+	mon->buf = malloc(ringsize * sizeof(unsigned int));
+	if ( mon->buf == NULL ) {
+		free(mon);
+		return NULL;
+	}
+	mon->ring = &mon->own_ring;
+	mon->ops = ops;
+	mon->time_ns = 1000;
+
+	if ( ops->open(mon, arg) ) {
+		free(mon->buf);
+		free(mon);
+		return NULL;
+	}
+	bm_ring_init(mon->ring, mon->buf, ringsize);
+
+	return mon;
+}
+
+void bmon_close(struct bmon *mon)
+{
+	mon->ops->close(mon);
+	free(mon->buf);
+	free(mon);
+}
+
+int bmon_start(struct bmon *mon)
+{
+	bmon_log_ctrl(mon, BM_RING_CTRL_START, 0);
+	mon->ring->lltime_valid = 0;
+
+	return mon->ops->start(mon);
+}
+
+int bmon_stop(struct bmon *mon)
+{
+	return mon->ops->stop(mon);
+}
+
+int bmon_drain(struct bmon *mon)
+{
+	unsigned int before = mon->ring->entries + mon->ring->lost_tot;
+	unsigned int cnt;
+
+	if ( mon->ops->drain(mon) < 0 )
+		return -1;
+
+	cnt = mon->ring->entries + mon->ring->lost_tot - before;
+	mon->drains++;
+	if ( cnt > mon->drain_max )
+		mon->drain_max = cnt;
+
+	return cnt;
+}
+
+int bmon_time(struct bmon *mon, uint64_t *time)
+{
+	return mon->ops->time(mon, time);
+}
+
+void bmon_get_stats(struct bmon *mon, struct bmon_stats *stats)
+{
+	stats->entries = mon->ring->entries + mon->ring->lost_tot;
+	stats->words = mon->ring->words;
+	stats->errors = mon->ring->errors;
+	stats->lost = mon->ring->lost_tot;
+	stats->drains = mon->drains;
+	stats->drain_max = mon->drain_max;
+}
@@ -0,0 +1,96 @@
+/* Generic 1553 Bus Monitor interface
+ *
+ * One interface for all 1553 bus monitor sources, so that compression,
+ * TCP/IP streaming, persistence and analysis are written once:
+ *
+ *  bmon_gr1553b.c   GR1553B BM core (RTEMS, gr1553bm driver)
+ *  bmon_brm.c       B1553BRM core in BM mode (RTEMS, brm_lib.c)
+ *  bmon_sim.c       Simulated bus traffic (Linux)
+ *
+ * All back ends write the compressed BM log format of bm_logger.c into a
+ * ring, see ../bm_ring.h for the format. The ring is the same one brm_lib.c
+ * writes, the B1553BRM back end hands it to brmlib_bm_recv_batch().
+ *
+ * bmon_drain() must be called often enough for the hardware log not to
+ * overflow. It never blocks on the ring, if the ring is full entries are
+ * dropped and counted and a control word is logged when there is room.
+ * The B1553BRM back end instead leaves messages that do not fit in
+ * brm_lib's batch buffer until the next drain.
+ */
+
+#ifndef __BMON_H__
+#define __BMON_H__
+
+#include <stdint.h>
+#include "bm_ring.h"
+
+struct bmon;
+
+struct bmon_stats {
+	unsigned int entries;	/* Bus words logged, including lost */
+	unsigned int words;	/* Log words written to ring */
+	unsigned int errors;	/* Error words written to ring */
+	unsigned int lost;	/* Bus words lost, ring full */
+	unsigned int drains;	/* Number of bmon_drain() calls */
+	unsigned int drain_max;	/* Max bus words in one bmon_drain() */
+};
+
+/* Back end operations */
+struct bmon_ops {
+	char *name;
+	int (*open)(struct bmon *mon, void *arg);
+	int (*start)(struct bmon *mon);
+	int (*stop)(struct bmon *mon);
+	/* Move all bus words from hardware into the ring, return count */
+	int (*drain)(struct bmon *mon);
+	/* Current time in back end time units */
+	int (*time)(struct bmon *mon, uint64_t *time);
+	void (*close)(struct bmon *mon);
+};
+
+struct bmon {
+	const struct bmon_ops *ops;
+	void *priv;			/* Back end private */
+	unsigned int time_ns;		/* Length of one time unit [ns] */
+
+	/* Ring of compressed log words, one producer (bmon_drain) and one
+	 * consumer (bmon_take). Points to own_ring unless the back end's
+	 * open() points it to a ring of its own. The ring buffer is allocated
+	 * by bmon_open().
+	 */
+	struct bm_ring *ring;
+	struct bm_ring own_ring;
+	unsigned int *buf;
+
+	unsigned int drains;
+	unsigned int drain_max;
+};
+
+extern const struct bmon_ops bmon_gr1553b_ops;
+extern const struct bmon_ops bmon_brm_ops;
+extern const struct bmon_ops bmon_sim_ops;
+
+/* Open a bus monitor. 'arg' is back end specific, 'ringsize' is the size
+ * of the software ring in 32-bit words. Returns NULL on failure.
+ */
+struct bmon *bmon_open(const struct bmon_ops *ops, void *arg, int ringsize);
+void bmon_close(struct bmon *mon);
+int bmon_start(struct bmon *mon);
+int bmon_stop(struct bmon *mon);
+int bmon_drain(struct bmon *mon);
+int bmon_time(struct bmon *mon, uint64_t *time);
+void bmon_get_stats(struct bmon *mon, struct bmon_stats *stats);
+
+/* Take up to max log words from ring, returns number of words taken */
+int bmon_take(struct bmon *mon, unsigned int *words, int max);
+
+/* Used by back ends: log one bus word. 'err' is a non-zero error code
+ * (see bm_ring.h) if the word had an error, 'data' holds the word type in
+ * bit 16 (1=command/status) and the 16-bit bus word.
+ */
+void bmon_log_word(struct bmon *mon, uint64_t time, int bus, int err, unsigned int data);
+
+/* Used by back ends: add a control word */
+void bmon_log_ctrl(struct bmon *mon, int code, unsigned int value);
+
+#endif
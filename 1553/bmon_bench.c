@@ -0,0 +1,125 @@
+/* Linux benchmark of the generic Bus Monitor interface (bmon.c) using the
+ * simulated back end. The log is drained every millisecond, the log words
+ * are taken out of the ring and decoded to check that the time stamps are
+ * increasing and that no entries are lost.
+ *
+ * usage: bmon_bench [SECONDS] [MSGS_PER_SECOND] [ERR_INTERVAL]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "bmon.h"
+#include "bmon_sim.h"
+
+#define RING_SIZE	(256*1024)
+#define TAKE_MAX	4096
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Decoder state, same format as 1553/linux_client.c input */
+uint64_t dec_time;
+unsigned int dec_entries, dec_errors, dec_ctrl, dec_backwards;
+
+void decode(unsigned int *words, int cnt)
+{
+	unsigned int w;
+	uint64_t t;
+	int i;
+
+	for (i=0; i<cnt; i++) {
+		w = words[i];
+		if ( (w & 0x80000000) == 0 ) {
+			t = (dec_time & ~0x1fffULL) | ((w >> 18) & 0x1fff);
+			if ( t < dec_time )
+				dec_backwards++;
+			dec_time = t;
+			dec_entries++;
+		} else if ( (w & 0xc0000000) == 0x80000000 ) {
+			dec_time = (uint64_t)(w & 0x3fffffff) << 13;
+		} else if ( (w & 0xe0000000) == 0xc0000000 ) {
+			dec_errors++;
+		} else {
+			dec_ctrl++;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct bmon_sim_cfg cfg;
+	struct bmon_stats stats;
+	struct bmon *mon;
+	unsigned int *words;
+	double t, tend, tdrain, ttake;
+	int secs, cnt;
+
+	secs = 5;
+	cfg.msg_rate = 2000;
+	cfg.err_interval = 1000;
+	if ( argc > 1 )
+		secs = atoi(argv[1]);
+	if ( argc > 2 )
+		cfg.msg_rate = atoi(argv[2]);
+	if ( argc > 3 )
+		cfg.err_interval = atoi(argv[3]);
+
+	mon = bmon_open(&bmon_sim_ops, &cfg, RING_SIZE);
+	if ( mon == NULL ) {
+		printf("Failed to open %s bus monitor\n", bmon_sim_ops.name);
+		return -1;
+	}
+	words = malloc(TAKE_MAX * sizeof(unsigned int));
+
+	printf("%s: %u msgs/s for %d s, error every %u msgs\n",
+		mon->ops->name, cfg.msg_rate, secs, cfg.err_interval);
+
+	bmon_start(mon);
+	tdrain = ttake = 0;
+	tend = now() + secs;
+	while ( now() < tend ) {
+		usleep(1000);
+
+		t = now();
+		if ( bmon_drain(mon) < 0 ) {
+			printf("Drain failed\n");
+			return -1;
+		}
+		tdrain += now() - t;
+
+		t = now();
+		while ( (cnt = bmon_take(mon, words, TAKE_MAX)) > 0 )
+			decode(words, cnt);
+		ttake += now() - t;
+	}
+	bmon_stop(mon);
+
+	bmon_get_stats(mon, &stats);
+	printf("Entries:  %u (%.0f/s), log words %u (%.2f per entry)\n",
+		stats.entries, stats.entries / (double)secs, stats.words,
+		stats.entries ? stats.words / (double)stats.entries : 0);
+	printf("Errors:   %u, lost %u, drains %u, max %u entries per drain\n",
+		stats.errors, stats.lost, stats.drains, stats.drain_max);
+	printf("Drain:    %.1f ns/entry, take+decode %.1f ns/entry\n",
+		stats.entries ? tdrain * 1e9 / stats.entries : 0,
+		stats.entries ? ttake * 1e9 / stats.entries : 0);
+	printf("Decoded:  %u entries, %u errors, %u control, %u time backwards\n",
+		dec_entries, dec_errors, dec_ctrl, dec_backwards);
+
+	bmon_close(mon);
+	free(words);
+
+	if ( (dec_entries != stats.entries - stats.lost) || dec_backwards ) {
+		printf("VERIFICATION FAILED\n");
+		return -1;
+	}
+
+	return 0;
+}
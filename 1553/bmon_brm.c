@@ -0,0 +1,91 @@
+/* Bus Monitor back end for the B1553BRM core in BM mode, see bmon.h
+ *
+ * Uses brm_lib.c. 'arg' to bmon_open() is the device name. The bmon ring is
+ * the ring of brmlib_bm_recv_batch(), which converts the messages into bus
+ * words in the order they appeared on the bus. The 16-bit BRM time tag is
+ * extended to 64 bits, bmon_drain() must be called at least once per BRM
+ * timer wrap. The core has no readable current time, bmon_time() returns
+ * the time of the last message.
+ */
+
+#include <stdlib.h>
+#include "brm_lib.h"
+#include "bmon.h"
+
+struct bmon_brm {
+	brm_t chan;
+	struct brmlib_bm_ring log;
+};
+
+static int bmon_brm_open(struct bmon *mon, void *arg)
+{
+	struct bmon_brm *priv;
+
+	priv = calloc(1, sizeof(*priv));
+	if ( priv == NULL )
+		return -1;
+
+	priv->chan = brmlib_open((char *)arg);
+	if ( priv->chan == NULL ) {
+		free(priv);
+		return -1;
+	}
+	if ( brmlib_set_mode(priv->chan, BRM_MODE_BM) ) {
+		brmlib_close(priv->chan);
+		free(priv);
+		return -1;
+	}
+
+	mon->priv = priv;
+	mon->ring = &priv->log.ring;
+	mon->time_ns = 1000;
+
+	return 0;
+}
+
+static int bmon_brm_start(struct bmon *mon)
+{
+	/* The BRM logs as soon as BM mode is set */
+	return 0;
+}
+
+static int bmon_brm_stop(struct bmon *mon)
+{
+	return 0;
+}
+
+static int bmon_brm_drain(struct bmon *mon)
+{
+	struct bmon_brm *priv = mon->priv;
+	int pending;
+
+	/* Messages that do not fit in the ring stay in brm_lib's batch */
+	return brmlib_bm_recv_batch(priv->chan, &priv->log, 0, &pending);
+}
+
+static int bmon_brm_time(struct bmon *mon, uint64_t *time)
+{
+	struct bmon_brm *priv = mon->priv;
+
+	*time = priv->log.time;
+
+	return 0;
+}
+
+static void bmon_brm_close(struct bmon *mon)
+{
+	struct bmon_brm *priv = mon->priv;
+
+	brmlib_close(priv->chan);
+	free(priv);
+}
+
+const struct bmon_ops bmon_brm_ops = {
+	.name = "B1553BRM",
+	.open = bmon_brm_open,
+	.start = bmon_brm_start,
+	.stop = bmon_brm_stop,
+	.drain = bmon_brm_drain,
+	.time = bmon_brm_time,
+	.close = bmon_brm_close,
+};
@@ -0,0 +1,164 @@
+/* Bus Monitor back end for the GR1553B BM core, see bmon.h
+ *
+ * The gr1553bm driver calls the custom copy function for every chunk of
+ * the BM DMA log, the entries are compressed directly into the bmon ring
+ * without an intermediate copy. 'arg' to bmon_open() is a struct
+ * bmon_gr1553b_cfg pointer, or NULL for the first BM device and a driver
+ * allocated DMA log.
+ */
+
+#include <stdlib.h>
+#include <gr1553bm.h>
+#include "bmon.h"
+#include "bmon_gr1553b.h"
+
+struct bmon_gr1553b {
+	void *bm;
+	struct gr1553bm_config cfg;
+	struct gr1553bm_entry dummy[1];
+};
+
+static int bmon_gr1553b_copy(
+	unsigned int dst,
+	struct gr1553bm_entry *src,
+	int nentries,
+	void *data
+	)
+{
+	struct bmon *mon = data;
+	struct bmon_gr1553b *priv = mon->priv;
+	uint64_t currtime, time64, logtime64;
+	unsigned int time24, logtime24;
+
+	/* The 24-bit time of the entries can have wrapped at most once
+	 * against the current time, see bm_logger.c.
+	 */
+	gr1553bm_time(priv->bm, &currtime);
+	time64 = currtime & ~0x00ffffffULL;
+	time24 = currtime & 0x00ffffff;
+
+	while ( nentries-- ) {
+		logtime24 = src->time & 0x00ffffff;
+		if ( logtime24 < time24 )
+			logtime64 = time64 | logtime24;
+		else
+			logtime64 = (time64 - 0x1000000) | logtime24;
+
+		bmon_log_word(mon, logtime64,
+			(src->data >> 19) & 1,		/* Bus */
+			(src->data >> 17) & 0x3,	/* Error */
+			src->data & 0x1ffff);		/* WTP and DATA */
+		src++;
+	}
+
+	return 0;
+}
+
+static int bmon_gr1553b_open(struct bmon *mon, void *arg)
+{
+	struct bmon_gr1553b *priv;
+	struct bmon_gr1553b_cfg *cfg = arg;
+	int minor = cfg ? cfg->minor : 0;
+
+	priv = calloc(1, sizeof(*priv));
+	if ( priv == NULL )
+		return -1;
+
+	priv->bm = gr1553bm_open(minor);
+	if ( priv->bm == NULL ) {
+		free(priv);
+		return -1;
+	}
+
+	/* Log everything with highest time resolution (1us) */
+	priv->cfg.time_resolution = 0;
+	priv->cfg.time_ovf_irq = 1;
+	priv->cfg.filt_error_options = 0xe;
+	priv->cfg.filt_rtadr = 0xffffffff;
+	priv->cfg.filt_subadr = 0xffffffff;
+	priv->cfg.filt_mc = 0x7ffff;
+	priv->cfg.buffer_size = 16*1024;
+	priv->cfg.buffer_custom = cfg ? cfg->buffer : NULL;
+	priv->cfg.copy_func = bmon_gr1553b_copy;
+	priv->cfg.copy_func_arg = mon;
+	priv->cfg.dma_error_isr = NULL;
+	priv->cfg.dma_error_arg = NULL;
+	if ( gr1553bm_config(priv->bm, &priv->cfg) ) {
+		gr1553bm_close(priv->bm);
+		free(priv);
+		return -1;
+	}
+
+	mon->priv = priv;
+	mon->time_ns = 1000;
+
+	return 0;
+}
+
+void *bmon_gr1553b_dev(struct bmon *mon)
+{
+	struct bmon_gr1553b *priv = mon->priv;
+
+	return priv->bm;
+}
+
+static int bmon_gr1553b_start(struct bmon *mon)
+{
+	struct bmon_gr1553b *priv = mon->priv;
+
+	return gr1553bm_start(priv->bm);
+}
+
+static int bmon_gr1553b_stop(struct bmon *mon)
+{
+	struct bmon_gr1553b *priv = mon->priv;
+
+	gr1553bm_stop(priv->bm);
+
+	return 0;
+}
+
+static int bmon_gr1553b_drain(struct bmon *mon)
+{
+	struct bmon_gr1553b *priv = mon->priv;
+	int max, tot;
+
+	tot = 0;
+	do {
+		max = 128;
+		if ( gr1553bm_read(priv->bm, priv->dummy, &max) )
+			return -1;
+		tot += max;
+		/* Read as long as the BM driver fills our buffer */
+	} while ( max == 128 );
+
+	return tot;
+}
+
+static int bmon_gr1553b_time(struct bmon *mon, uint64_t *time)
+{
+	struct bmon_gr1553b *priv = mon->priv;
+
+	gr1553bm_time(priv->bm, time);
+
+	return 0;
+}
+
+static void bmon_gr1553b_close(struct bmon *mon)
+{
+	struct bmon_gr1553b *priv = mon->priv;
+
+	gr1553bm_stop(priv->bm);
+	gr1553bm_close(priv->bm);
+	free(priv);
+}
+
+const struct bmon_ops bmon_gr1553b_ops = {
+	.name = "GR1553B",
+	.open = bmon_gr1553b_open,
+	.start = bmon_gr1553b_start,
+	.stop = bmon_gr1553b_stop,
+	.drain = bmon_gr1553b_drain,
+	.time = bmon_gr1553b_time,
+	.close = bmon_gr1553b_close,
+};
@@ -0,0 +1,16 @@
+/* Bus Monitor back end for the GR1553B BM core, see bmon_gr1553b.c */
+
+#ifndef __BMON_GR1553B_H__
+#define __BMON_GR1553B_H__
+
+struct bmon;
+
+struct bmon_gr1553b_cfg {
+	int minor;		/* BM device index */
+	void *buffer;		/* BM DMA log buffer, NULL to let driver allocate */
+};
+
+/* gr1553bm driver handle of an open monitor, for gr1553bm_time() etc. */
+void *bmon_gr1553b_dev(struct bmon *mon);
+
+#endif
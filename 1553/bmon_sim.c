@@ -0,0 +1,166 @@
+/* Simulated Bus Monitor back end for Linux, see bmon.h
+ *
+ * Generates the traffic of the BC example (bc_list.c) towards RT5 at a
+ * configurable message rate, with optional error injection. Time is the
+ * Linux monotonic clock in microseconds since bmon_start(), each bus word
+ * takes 20us. A message never starts before the previous has ended, at
+ * rates above what the bus can carry (about 2000 messages/s for this
+ * traffic) time stamps run ahead of the clock. 'arg' to bmon_open() is a
+ * struct bmon_sim_cfg pointer, or NULL for the defaults.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "bmon.h"
+#include "bmon_sim.h"
+
+struct bmon_sim {
+	struct bmon_sim_cfg cfg;
+	uint64_t start;		/* Start time [us] */
+	uint64_t msgs;		/* Messages generated */
+	uint64_t bus_free;	/* End of last message [us] */
+	int started;
+};
+
+/* Transfers of bc_list.c: RT5 SA1 rx 1 word, SA2 tx 16 words,
+ * SA3 rx 32 words, SA3 tx 32 words.
+ */
+static const unsigned short bmon_sim_cmds[] = {
+	(5<<11) | (0<<10) | (1<<5) | 1,
+	(5<<11) | (1<<10) | (2<<5) | 16,
+	(5<<11) | (0<<10) | (3<<5) | 0,
+	(5<<11) | (1<<10) | (3<<5) | 0,
+};
+#define BMON_SIM_CMD_CNT (sizeof(bmon_sim_cmds)/sizeof(unsigned short))
+
+static uint64_t bmon_sim_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bmon_sim_msg(struct bmon *mon, struct bmon_sim *priv, uint64_t t)
+{
+	unsigned short cmd = bmon_sim_cmds[priv->msgs % BMON_SIM_CMD_CNT];
+	int i, wc, bus, err;
+
+	wc = cmd & 0x1f;
+	if ( wc == 0 )
+		wc = 32;
+	bus = (priv->msgs >> 8) & 1;
+	err = 0;
+	if ( priv->cfg.err_interval && ((priv->msgs % priv->cfg.err_interval) == 0) )
+		err = 1;
+
+	bmon_log_word(mon, t, bus, 0, 0x10000 | cmd);
+	t += 20;
+	if ( cmd & 0x0400 ) {
+		bmon_log_word(mon, t, bus, 0, 0x10000 | (5<<11));
+		t += 20;
+	}
+	for (i=0; i<wc; i++) {
+		bmon_log_word(mon, t, bus, (i == 0) ? err : 0,
+			(unsigned short)(priv->msgs + i));
+		t += 20;
+	}
+	if ( !(cmd & 0x0400) ) {
+		bmon_log_word(mon, t, bus, 0, 0x10000 | (5<<11));
+		t += 20;
+	}
+
+	priv->bus_free = t;
+	priv->msgs++;
+}
+
+static int bmon_sim_open(struct bmon *mon, void *arg)
+{
+	struct bmon_sim *priv;
+
+	priv = calloc(1, sizeof(*priv));
+	if ( priv == NULL )
+		return -1;
+	if ( arg ) {
+		priv->cfg = *(struct bmon_sim_cfg *)arg;
+	} else {
+		priv->cfg.msg_rate = 1000;
+		priv->cfg.err_interval = 0;
+	}
+	if ( priv->cfg.msg_rate == 0 )
+		priv->cfg.msg_rate = 1;
+
+	mon->priv = priv;
+	mon->time_ns = 1000;
+
+	return 0;
+}
+
+static int bmon_sim_start(struct bmon *mon)
+{
+	struct bmon_sim *priv = mon->priv;
+
+	priv->start = bmon_sim_now();
+	priv->msgs = 0;
+	priv->bus_free = 0;
+	priv->started = 1;
+
+	return 0;
+}
+
+static int bmon_sim_stop(struct bmon *mon)
+{
+	struct bmon_sim *priv = mon->priv;
+
+	priv->started = 0;
+
+	return 0;
+}
+
+/* Generate all messages that are due since last drain */
+static int bmon_sim_drain(struct bmon *mon)
+{
+	struct bmon_sim *priv = mon->priv;
+	uint64_t now, due, t;
+	int cnt = 0;
+
+	if ( !priv->started )
+		return 0;
+
+	now = bmon_sim_now() - priv->start;
+	due = now * priv->cfg.msg_rate / 1000000;
+	while ( priv->msgs < due ) {
+		/* A message can not start before the previous has ended */
+		t = priv->msgs * 1000000 / priv->cfg.msg_rate;
+		if ( t < priv->bus_free )
+			t = priv->bus_free;
+		bmon_sim_msg(mon, priv, t);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+static int bmon_sim_time(struct bmon *mon, uint64_t *time)
+{
+	struct bmon_sim *priv = mon->priv;
+
+	*time = bmon_sim_now() - priv->start;
+
+	return 0;
+}
+
+static void bmon_sim_close(struct bmon *mon)
+{
+	free(mon->priv);
+}
+
+const struct bmon_ops bmon_sim_ops = {
+	.name = "SIM",
+	.open = bmon_sim_open,
+	.start = bmon_sim_start,
+	.stop = bmon_sim_stop,
+	.drain = bmon_sim_drain,
+	.time = bmon_sim_time,
+	.close = bmon_sim_close,
+};
@@ -0,0 +1,11 @@
+/* Simulated Bus Monitor back end for Linux, see bmon_sim.c */
+
+#ifndef __BMON_SIM_H__
+#define __BMON_SIM_H__
+
+struct bmon_sim_cfg {
+	unsigned int msg_rate;		/* 1553 messages per second */
+	unsigned int err_interval;	/* Error every N messages, 0=never */
+};
+
+#endif
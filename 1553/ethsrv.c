@@ -12,8 +12,13 @@
 #include "ethsrv.h"
 #include "config_bm.h"
 
-/* Get LOG entries from Compressed LOG */
-extern int log_cmp_take(struct bm_cmp_log *log, unsigned int *words, int max);
+/* Compressed LOG, see bm_logger.c */
+extern struct bmon *bm_mon;
+
+#ifdef EVLOG_RING
+/* Get Event words from RT Event Log ring */
+extern int rt_evlog_take(struct rt_evlog *log, unsigned int *words, int max);
+#endif
 
 unsigned int debug_log[50000];
 unsigned int debug_index = 0;
@@ -39,7 +44,7 @@ int cmd_get_log(int s, struct cmd_get_log *arg)
 	resp.hdr.cmdno = arg->hdr.cmdno;
 	resp.devno = arg->devno;
 	resp.status = 0;
-	resp.log_cnt = log_cmp_take(&cmp_log, &resp.log[0], 250);
+	resp.log_cnt = bmon_take(bm_mon, &resp.log[0], 250);
 
 	debug_add(resp.log_cnt);
 
@@ -57,6 +62,36 @@ int cmd_get_log(int s, struct cmd_get_log *arg)
 	return 0;
 }
 
+#ifdef EVLOG_RING
+int cmd_get_evlog(int s, struct cmd_get_log *arg)
+{
+	static struct cmd_resp_get_log resp;
+	int length;
+
+	/* Only one device supported */
+	if ( arg->devno != 0 ) {
+		return -1;
+	}
+
+	/* Prepare Response */
+	resp.hdr.cmdno = arg->hdr.cmdno;
+	resp.devno = arg->devno;
+	resp.status = 0;
+	resp.log_cnt = rt_evlog_take(&rt_evlog, &resp.log[0], 250);
+
+	length = offsetof(struct cmd_resp_get_log, log) +
+		resp.log_cnt*sizeof(unsigned int);
+	resp.hdr.length = length - sizeof(struct cmd_hdr);
+
+	/* Send back result */
+	if ( write(s, &resp, length) != length ) {
+		return -1;
+	}
+
+	return 0;
+}
+#endif
+
 /* */
 int ssock = -1, sock = -1;
 
@@ -192,6 +227,14 @@ int server_loop(void)
 				break;
 			}
 
+#ifdef EVLOG_RING
+			case CMD_GET_EVLOG:
+			{
+				err = cmd_get_evlog(sock, (struct cmd_get_log *)hdr);
+				break;
+			}
+#endif
+
 			default:
 				err = 1;
 				break;
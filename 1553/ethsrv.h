@@ -5,6 +5,7 @@ enum {
 	CMD_STATUS = 1,
 	CMD_GET_INFO = 2,
 	CMD_GET_LOG = 3,
+	CMD_GET_EVLOG = 4,
 };
 
 struct cmd_hdr {
@@ -14,7 +15,11 @@ struct cmd_hdr {
 } __attribute__ ((packed));
 
 
-/* GET LOG ENTRIES FROM A SPECIFIC DEVICE */
+/* GET LOG ENTRIES FROM A SPECIFIC DEVICE
+ *
+ * CMD_GET_LOG returns compressed BM log words, CMD_GET_EVLOG returns raw
+ * RT event log words. Both use the same command and response layout.
+ */
 struct cmd_get_log {
 	struct cmd_hdr		hdr;
 	char			devno;
@@ -35,7 +40,7 @@ struct cmd_resp_get_log {
 	unsigned int		log[250];	/* Up to 250 entries */
 } __attribute__ ((packed));
 
-#define MAX_COMMAND_NUM CMD_GET_LOG
+#define MAX_COMMAND_NUM CMD_GET_EVLOG
 #define MAX_COMMAND_SIZE (sizeof(struct cmd_get_log)-sizeof(struct cmd_hdr))
 
 #endif
@@ -15,6 +15,7 @@
 #include <string.h>
 #include "ethsrv.h"
 #include "config_bm.h"
+#include "rt_evlog.h"
 
 #if (defined WIN32 || defined __MINGW32__)
 static int win32_initsocket = 0;
@@ -75,14 +76,14 @@ int client_connect(char *host, int port)
 	return sock;
 }
 
-int client_get_log(int sock, struct cmd_resp_get_log *resp)
+int client_get_log(int sock, int cmdno, struct cmd_resp_get_log *resp)
 {
 	int i, len;
 	struct cmd_get_log cmd;
 
-	/* Init GET-LOG command */
+	/* Init GET-LOG/GET-EVLOG command */
 	cmd.hdr.length = htons(1);
-	cmd.hdr.cmdno = CMD_GET_LOG;
+	cmd.hdr.cmdno = cmdno;
 	cmd.devno = 0;
 
 	/* Send Command */
@@ -124,15 +125,25 @@ int main(int argc, char *argv[])
 	char *tgtname, *filename;
 	int sock, err, i;
 	struct cmd_resp_get_log logresp;
+	struct rt_evlog_dec dec;
 	FILE *fp;
-	char buf[4096], *bufend;
-	int tot;
+	char buf[16384], *bufend;
+	int tot, cmdno;
+
+	/* -e: Get RT Event Log and decode it, instead of BM Log */
+	cmdno = CMD_GET_LOG;
+	if ( (argc == 4) && (strcmp(argv[1], "-e") == 0) ) {
+		cmdno = CMD_GET_EVLOG;
+		argc--;
+		argv++;
+	}
 
 	tgtname = argv[1];
 	filename = argv[2];
 
 	if ( (argc != 3) || !tgtname ) {
-		printf("usage: %s IPNUM_OF_RTEMS_TARGET FILENAME\n", argv[0]);
+		printf("usage: %s [-e] IPNUM_OF_RTEMS_TARGET FILENAME\n", argv[0]);
+		printf("  -e   Read and decode RT Event Log instead of BM Log\n");
 		return -1;
 	}
 	
@@ -154,10 +165,11 @@ int main(int argc, char *argv[])
 
 	printf("Connected to RTEMS Server, Starting logging\n");
 
+	rt_evlog_dec_init(&dec, 1);
 	tot = 0;
 	while ( 1 ) {
 		/* Get LOG entry */
-		err = client_get_log(sock, &logresp);
+		err = client_get_log(sock, cmdno, &logresp);
 		if ( err ) {
 			printf("### GET LOG FAILED: %d. Total: %d\n", err, tot);
 			exit(-1);
@@ -175,11 +187,14 @@ int main(int argc, char *argv[])
 		/* Convert to ascii */
 		bufend = &buf[0];
 		for ( i=0; i<logresp.log_cnt; i++) {
-			bufend += sprintf(bufend, "%08x\n", logresp.log[i]);
+			if ( cmdno == CMD_GET_EVLOG )
+				bufend += rt_evlog_decode(&dec, logresp.log[i], bufend);
+			else
+				bufend += sprintf(bufend, "%08x\n", logresp.log[i]);
 		}
 
 		/* Put LOG Entries to file */
-		fwrite(buf, (unsigned int)bufend-(unsigned int)buf, 1, fp);
+		fwrite(buf, bufend - buf, 1, fp);
 	}
 
 	close(sock);
@@ -0,0 +1,209 @@
+/* RT Event Log Ring
+ *
+ * The GR1553RT event log is a small DMA area that is read out with
+ * gr1553rt_evlog_read(). Decoding and printing every event is far too slow
+ * to be done live, instead the raw 32-bit event words are read directly
+ * into a larger "non-DMA" ring without any decoding. The ring is emptied by
+ * the Ethernet server (CMD_GET_EVLOG) and decoded on the Linux side by
+ * linux_client.c.
+ *
+ * The ring has one producer (the RT task) and one consumer (the ETH server
+ * task), the producer only moves head and the consumer only moves tail. When
+ * the ring is full new events are dropped and counted, a control entry with
+ * the number of lost events is inserted as soon as there is room again.
+ * The ring format is described in rt_evlog.h.
+ *
+ * The time spent in rt_evlog_fill() is accumulated, rt_evlog_stats_print()
+ * reports the cost per event.
+ */
+
+#include <gr1553rt.h>
+#include "rt_evlog.h"
+
+#define RT_EVLOG_SIZE		0x40000	/* 256kB */
+#define RT_EVLOG_CNT		(RT_EVLOG_SIZE/4)
+
+struct rt_evlog {
+	unsigned int *base;
+	unsigned int * volatile head;
+	unsigned int * volatile tail;
+	unsigned int *end;
+	unsigned int lost;	/* Events lost since last control entry */
+	unsigned int lost_tot;	/* Total number of lost events */
+	unsigned int cnt;	/* Total number of events read */
+	unsigned int fills;	/* Calls to rt_evlog_fill() */
+	unsigned long long fill_ns; /* Time spent in rt_evlog_fill() */
+};
+struct rt_evlog rt_evlog;
+
+/* Used to drain the driver's event log when the ring is full */
+#define RT_EVLOG_SCRATCH_CNT 64
+static unsigned int rt_evlog_scratch[RT_EVLOG_SCRATCH_CNT];
+
+/* Add a two word control entry to ring, caller must make sure there is
+ * room for both words.
+ */
+static void rt_evlog_add_ctrl(struct rt_evlog *log, int code, unsigned int value)
+{
+	unsigned int *head = log->head;
+	int i;
+
+	for (i=0; i<2; i++) {
+		*head = i ? value : RT_EVLOG_CTRL(code);
+		head++;
+		if ( head >= log->end )
+			head = log->base;
+	}
+	log->head = head;
+}
+
+/* Number of free words in ring, wrapped or not */
+static int rt_evlog_free(struct rt_evlog *log)
+{
+	unsigned int *head = log->head;
+	unsigned int *tail = log->tail;
+
+	if ( tail > head )
+		return tail - head - 1;
+	return (log->end - head) + (tail - log->base) - 1;
+}
+
+int rt_evlog_init(struct rt_evlog *log)
+{
+	log->base = (unsigned int *)malloc(RT_EVLOG_SIZE);
+	if ( log->base == NULL ) {
+		return -1;
+	}
+	log->head = log->base;
+	log->tail = log->base;
+	log->end = log->base + RT_EVLOG_CNT;
+	log->lost = 0;
+	log->lost_tot = 0;
+	log->cnt = 0;
+	log->fills = 0;
+	log->fill_ns = 0;
+
+	/* Add initial entry in log (START) */
+	rt_evlog_add_ctrl(log, RT_EVLOG_CTRL_START, 0);
+
+	return 0;
+}
+
+/* Number of contiguous free words after head. One word is always left
+ * unused to tell a full ring from an empty one.
+ */
+static int rt_evlog_space(struct rt_evlog *log)
+{
+	unsigned int *head = log->head;
+	unsigned int *tail = log->tail;
+	int space;
+
+	if ( tail > head ) {
+		space = tail - head - 1;
+	} else {
+		space = log->end - head;
+		if ( tail == log->base )
+			space--;
+	}
+
+	return space;
+}
+
+/* Move all events from the RT event log into the ring. The driver copies
+ * the event words directly into the ring, no decoding is done here.
+ *
+ * Returns number of events read from the driver or negative on failure.
+ */
+int rt_evlog_fill(struct rt_evlog *log, void *rt)
+{
+	struct timespec t0, t1;
+	unsigned int *head;
+	int space, cnt, tot;
+
+	rtems_clock_get_uptime(&t0);
+	tot = 0;
+	do {
+		space = rt_evlog_space(log);
+
+		/* Report lost events as soon as there is room for the
+		 * control entry, drop events until then.
+		 */
+		if ( log->lost > 0 ) {
+			if ( rt_evlog_free(log) >= 2 ) {
+				rt_evlog_add_ctrl(log, RT_EVLOG_CTRL_LOST, log->lost);
+				log->lost = 0;
+				space = rt_evlog_space(log);
+			} else {
+				space = 0;
+			}
+		}
+
+		if ( space < 1 ) {
+			/* Ring full. The driver's log must still be emptied,
+			 * otherwise it is overwritten by hardware.
+			 */
+			space = RT_EVLOG_SCRATCH_CNT;
+			cnt = gr1553rt_evlog_read(rt, rt_evlog_scratch, space);
+			if ( cnt < 0 )
+				return -1;
+			log->lost += cnt;
+			log->lost_tot += cnt;
+		} else {
+			head = log->head;
+			cnt = gr1553rt_evlog_read(rt, head, space);
+			if ( cnt < 0 )
+				return -1;
+			head += cnt;
+			if ( head >= log->end )
+				head = log->base;
+			log->head = head;
+		}
+		tot += cnt;
+
+		/* Read as long as the driver fills our buffer */
+	} while ( cnt == space );
+
+	log->cnt += tot;
+	rtems_clock_get_uptime(&t1);
+	log->fills++;
+	log->fill_ns += (t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+		t1.tv_nsec - t0.tv_nsec;
+
+	return tot;
+}
+
+/* Take up to max event words from ring */
+int rt_evlog_take(struct rt_evlog *log, unsigned int *words, int max)
+{
+	unsigned int *tail = log->tail;
+	unsigned int *head = log->head;
+	int i;
+
+	for (i=0; i<max; i++) {
+		if ( tail == head ) {
+			/* log empty */
+			break;
+		}
+		words[i] = *tail;
+		tail++;
+		if ( tail >= log->end )
+			tail = log->base;
+	}
+	log->tail = tail;
+
+	return i;
+}
+
+/* Print ring statistics and the average cost of moving one event into the
+ * ring. Not called from the RT loop, call it from the debugger or at exit.
+ */
+void rt_evlog_stats_print(struct rt_evlog *log)
+{
+	unsigned int ns_per_ev = 0;
+
+	if ( log->cnt > 0 )
+		ns_per_ev = log->fill_ns / log->cnt;
+	printf("RT Event Log: %u events, %u lost, %u fills, %llu us in fill, "
+		"%u ns/event\n", log->cnt, log->lost_tot, log->fills,
+		log->fill_ns / 1000, ns_per_ev);
+}
@@ -0,0 +1,46 @@
+
+#ifndef __RT_EVLOG_H__
+#define __RT_EVLOG_H__
+
+/* RT Event Log ring format, written by rt_evlog.c on the target and
+ * decoded by rt_evlog_decode.c on the target (EVLOG_PRINTOUT) and in
+ * linux_client.c.
+ *
+ * Event word format (GR1553RT event log):
+ *   31      IRQ
+ *   30..29  TYPE (0=TX, 1=RX, 2=MC)
+ *   28..24  SA/MC
+ *   23..10  TIME
+ *   9       BC (Broadcast)
+ *   8..3    SIZE
+ *   2..0    RESULT
+ *
+ * The hardware never reports more than 32 words in SIZE. A word with
+ * SIZE=63 marks a control entry of two words, the marker and a 32-bit
+ * value:
+ *   28..24  Control code (RT_EVLOG_CTRL_*)
+ *   8..3    63
+ * all other bits of the marker are zero.
+ */
+
+#define RT_EVLOG_CTRL_START	0	/* Logging started */
+#define RT_EVLOG_CTRL_LOST	1	/* Value is number of lost events */
+
+#define RT_EVLOG_CTRL_MASK	0x000001f8
+#define RT_EVLOG_CTRL(code)	(RT_EVLOG_CTRL_MASK | (((code) & 0x1f) << 24))
+#define RT_EVLOG_IS_CTRL(ev)	(((ev) & RT_EVLOG_CTRL_MASK) == RT_EVLOG_CTRL_MASK)
+
+/* Decoder state, a control entry may be split between two reads */
+struct rt_evlog_dec {
+	int ctrl;	/* Code of the marker seen last, -1 if none */
+	int raw;	/* Append the raw event word to every line */
+};
+
+void rt_evlog_dec_init(struct rt_evlog_dec *dec, int raw);
+
+/* Decode one ring word into a text line in buf. Returns the number of
+ * characters written, 0 for the marker of a control entry.
+ */
+int rt_evlog_decode(struct rt_evlog_dec *dec, unsigned int ev, char *buf);
+
+#endif
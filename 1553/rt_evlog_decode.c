@@ -0,0 +1,69 @@
+/* RT Event Log decoder, see rt_evlog.h for the format */
+
+#include <stdio.h>
+#include "rt_evlog.h"
+
+void rt_evlog_dec_init(struct rt_evlog_dec *dec, int raw)
+{
+	dec->ctrl = -1;
+	dec->raw = raw;
+}
+
+int rt_evlog_decode(struct rt_evlog_dec *dec, unsigned int ev, char *buf)
+{
+	int type, samc, time, bc, size, result, irq, code;
+	char *type_str, result_str[16], raw_str[16];
+
+	/* Second word of a control entry is the value */
+	if ( dec->ctrl >= 0 ) {
+		code = dec->ctrl;
+		dec->ctrl = -1;
+		switch ( code ) {
+			case RT_EVLOG_CTRL_START:
+				return sprintf(buf, "CTRL: START\n");
+			case RT_EVLOG_CTRL_LOST:
+				return sprintf(buf, "CTRL: LOST %u EVENTS\n", ev);
+			default:
+				return sprintf(buf, "CTRL: %02x %08x\n", code, ev);
+		}
+	}
+
+	if ( RT_EVLOG_IS_CTRL(ev) ) {
+		dec->ctrl = (ev >> 24) & 0x1f;
+		return 0;
+	}
+
+	irq = ev >> 31;
+	type = (ev >> 29) & 0x3;
+	samc = (ev >> 24) & 0x1f;
+	time = (ev >> 10) & 0x3fff;
+	bc = (ev >> 9) & 0x1;
+	size = (ev >> 3) & 0x3f;
+	result = ev & 0x7;
+
+	switch ( type ) {
+		case 0:
+			type_str = "TX";
+			break;
+		case 1:
+			type_str = "RX";
+			break;
+		case 2:
+			type_str = "MC";
+			break;
+		default:
+			type_str = "UNKNOWN";
+			break;
+	}
+
+	result_str[0] = '\0';
+	if ( result != 0 )
+		sprintf(result_str, " ERROR(%d)", result);
+	raw_str[0] = '\0';
+	if ( dec->raw )
+		sprintf(raw_str, " (%08x)", ev);
+
+	return sprintf(buf, "%04x EV: %s%02x: %s%slen=%d%s%s\n",
+		time, type_str, samc, irq ? "IRQ " : "", bc ? "BC " : "",
+		size, result_str, raw_str);
+}
@@ -155,7 +155,7 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 /* configuration information */
 #define CONFIGURE_APPLICATION_NEEDS_CONSOLE_DRIVER
 #define CONFIGURE_APPLICATION_NEEDS_CLOCK_DRIVER
-#define CONFIGURE_MAXIMUM_TASKS             8
+#define CONFIGURE_MAXIMUM_TASKS             9
 #define CONFIGURE_RTEMS_INIT_TASKS_TABLE
 #define CONFIGURE_EXTRA_TASK_STACKS         (64 * RTEMS_MINIMUM_STACK_SIZE)
 #define CONFIGURE_LIBIO_MAXIMUM_FILE_DESCRIPTORS 32
@@ -230,6 +230,7 @@ int init_bc_list(void);
 int init_bc(void);
 int init_bm(void);
 int bm_log(void);
+extern void *bm;
 
 int init_spwcuc(int tx, char *grspw_devname);
 void spwcuc_handling(void);
@@ -237,6 +238,8 @@ void spwcuc_handling(void);
 int init_ctm(int tx, int spw);
 void ctm_handling(void);
 
+#include "timemon.h"
+
 /* Ethernet Server functions */
 extern int server_init(char *host, int port);
 extern int server_wait_client(void);
@@ -282,6 +285,13 @@ rtems_task Init(
 		exit(0);
 	}
 
+#ifdef TIME_SYNC_MANAGEMENT
+	/* Monitor time sync against local time and 1553 BM time. BM time
+	 * is configured with highest resolution, 1us.
+	 */
+	timemon_init(bm, 1000);
+#endif
+
 #if defined(TIME_SYNC_MANAGEMENT) && (TIME_SYNC_METHOD == 1)
 #ifdef TIME_SYNC_MASTER
 	if ( (status=init_spwcuc(1, TIME_GRSPW_DEVNAME)) ) {
@@ -18,6 +18,7 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 #define CONFIGURE_APPLICATION_NEEDS_CONSOLE_DRIVER
 #define CONFIGURE_APPLICATION_NEEDS_CLOCK_DRIVER
 #define CONFIGURE_MAXIMUM_TASKS             8
+#define CONFIGURE_MAXIMUM_TIMERS            1
 #define CONFIGURE_RTEMS_INIT_TASKS_TABLE
 #define CONFIGURE_EXTRA_TASK_STACKS         (64 * RTEMS_MINIMUM_STACK_SIZE)
 #define CONFIGURE_LIBIO_MAXIMUM_FILE_DESCRIPTORS 32
@@ -65,6 +66,7 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* If Ethernet server enable networking */
 #ifdef ETH_SERVER
@@ -77,10 +79,13 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 
 #include "config.c"
 
-int init_rt_list(int *err);
+int rt_sa_build(int *err);
+void rt_sa_print(void);
 int init_rt(void);
 int rt_loop(void);
 
+extern rtems_id rt_task_id;
+
 int init_bm(void);
 int bm_log(void);
 
@@ -97,8 +102,15 @@ rtems_name taskEthname;
 /* GR1553RT device on an AMBA-over-PCI */
 /*#define AMBA_OVER_PCI*/
 
-/* Enable/Disable RT Event Log printout */
-#define EVLOG_PRINTOUT
+/* Enable/Disable RT Event Log ring. The raw event words are copied into a
+ * larger ring, which is made available to the Linux client over the TCP/IP
+ * server when ETH_SERVER is defined. See rt_evlog.c.
+ */
+#define EVLOG_RING
+/* Enable/Disable RT Event Log printout. Printing is too slow to keep up
+ * with a busy bus, it is only used when EVLOG_RING is not defined.
+ */
+/*#define EVLOG_PRINTOUT*/
 /* Enable/disable printout of the RAW EventLog value */
 /*#define EVLOG_PRINTOUT_RAW*/
 
@@ -110,15 +122,15 @@ rtems_name taskEthname;
    *   0x40000000 - 0x400003ff   (1kB)   Event Log
    *   0x40000400 - 0x400005ff   (512B)  Subaddress Table
    *   0x40000600 - 0x400045ff   (16kB)  Descriptors
-   *   0x40005000 - ...          (1kB)   RT Data Buffers
+   *   0x40005000 - 0x40005fff   (4kB)   RT Data Buffers
    *   0x40010000 - 0x4001ffff   (64Kb)  BM Log DMA-Buffer
    */
   #define EV_TABLE_BASE TRANSLATE(0x40000000)
   #define SA_TABLE_BASE TRANSLATE(0x40000400)
   #define BD_TABLE_BASE TRANSLATE(0x40000600)
   /* Data Buffer area accessed by RT */
-  #define RT_DATA_HW_ADR (struct rt_data_buffer *)0x40005000  /* The Address HW use */
-  #define RT_DATA_CPU_ADR (struct rt_data_buffer *)0xA0005000 /* The address the CPU use to access the RT data. This should be autodetected! */
+  #define RT_DATA_HW_ADR (uint16_t *)0x40005000  /* The Address HW use */
+  #define RT_DATA_CPU_ADR (uint16_t *)0xA0005000 /* The address the CPU use to access the RT data. This should be autodetected! */
 
   /* Bus Monitor (BM) LOGGING BASE ADDRESS : In SRAM of GR-RASTA-XXXX */
   #define BM_LOG_BASE (0x40010000 | 1)
@@ -129,7 +141,7 @@ rtems_name taskEthname;
   #define EV_TABLE_BASE NULL
   #define SA_TABLE_BASE NULL
   #define BD_TABLE_BASE NULL
-  #define RT_DATA_HW_ADR &RT_data
+  #define RT_DATA_HW_ADR &RT_data[0]
   #define RT_DATA_CPU_ADR RT_DATA_HW_ADR
   /* Dynamically allocate (BM) LOGGING BASE ADDRESS */
   #define BM_LOG_BASE NULL
@@ -147,6 +159,9 @@ rtems_task Init(
 	/* Print device topology */	
 	rtems_drvmgr_print_topo();
 
+	/* ISRs post events to this task, which executes the RT loop */
+	rtems_task_ident(RTEMS_SELF, RTEMS_SEARCH_LOCAL_NODE, &rt_task_id);
+
 	if ( init_rt() ) {
 		printf("Failed to initialize RT\n");
 		exit(0);
@@ -167,11 +182,13 @@ rtems_task Init(
 
 #include <gr1553rt.h>
 #include "pnp1553.h"
+#ifdef EVLOG_RING
+#include "rt_evlog.c"
+#endif
 
-void rt_sa3_rx_isr(struct gr1553rt_list *list, unsigned int ctrl,
-			int entry_next, void *data);
-void rt_sa3_tx_isr(struct gr1553rt_list *list, unsigned int ctrl,
+void rt_sa_isr(struct gr1553rt_list *list, unsigned int ctrl,
 			int entry_next, void *data);
+void rt_ev_post(rtems_event_set ev);
 void *rt;
 
 struct gr1553rt_cfg rtcfg =
@@ -197,227 +214,431 @@ struct gr1553rt_cfg rtcfg =
 };
 
 
-/* SUBADDRESS 1, BUS STATE BROADCASTED FROM BC:
- *  RX: WAIT/STARTUP/RUNNING/SHUTDOWN  (FROM BC)
- *  TX: DOWN/UP/DOWN              (RT INDICATE RUNNING STATUS TO BC)
+/* RT task events. The RT task blocks waiting for events posted from
+ * interrupt context, instead of polling every tick.
  */
-struct gr1553rt_list *sa1rx_list = NULL, *sa1tx_list = NULL;
-struct gr1553rt_list_cfg sa1_cfg = 
+#define RT_EV_SA1	RTEMS_EVENT_0	/* Bus status received from BC */
+#define RT_EV_SA3	RTEMS_EVENT_1	/* BC<->RT Data received */
+#define RT_EV_MC	RTEMS_EVENT_2	/* Mode Code received */
+#define RT_EV_BM	RTEMS_EVENT_3	/* BM Log above watermark */
+#define RT_EV_CNT	4
+#define RT_EV_ALL	(RT_EV_SA1|RT_EV_SA3|RT_EV_MC|RT_EV_BM)
+
+/* Plug&Play information the BC reads from SA2 */
+struct pnp1553info rt_pnp1553_info =
 {
-	.bd_cnt = 1,
+	.vendor = 0x0001,
+	.device = 0x0001,
+	.version = 0,
+	.class = 0,
+	.subadr_rx_avail = 0x0003,
+	.subadr_tx_avail = 0x0007,
+	.desc = "GAISLER RTEMS DEMO1",
 };
 
-/* SUBADDRESS 2, Plug&Play information:
- *  TX: VENDOR|DEVICE|VERSION|CLASS|STRING
- *  RX: NOTHING
- */
-struct gr1553rt_list *sa2tx_list = NULL;
-struct gr1553rt_list_cfg sa2_cfg = 
-{
-	.bd_cnt = 1,
-};
-
-
-/* SUBADDRESS 3, BC<->RT Data transfers. ~1kB/sec:
+/* RT SUBADDRESS CONFIGURATION
  *
- *  RX: BC Transfer Data in 64byte block.
- *  TX: Received BC data is copied here.
+ * One line per subaddress and direction, rt_sa_build() creates one list per
+ * line with BUFS descriptors linked as a circular ring:
+ *
+ *  SA     Subaddress 0..31
+ *  DIR    RT_SA_RX (BC->RT) or RT_SA_TX (RT->BC)
+ *  BUFS   Number of buffers (descriptors) in list, 0 means no list
+ *  WORDS  Size of each buffer in 16-bit words
+ *  IRQ    IRQ policy, generate IRQ every IRQ:th buffer, 0=no IRQ. BUFS must
+ *         be a multiple of IRQ.
+ *  LOOP   Loopback target, received data is copied to the TX list of this
+ *         subaddress from IRQ. The target must have the same BUFS and WORDS.
+ *  EVENT  RT task event posted from IRQ, 0=none
+ *  OPTS   SA table options, see HW manual for bit definitions. The options
+ *         of all lines of a subaddress are OR:ed together.
+ *  INIT   Initial content of first buffer, or NULL for zero
+ *
+ * Mode code:      all give IRQ and is logged.
+ *
+ * Non-mode codes: are not logged or IRQed by default, only when explicitly
+ *                 defined by descriptor config.
+ *
+ * Subaddresses not listed are disabled.
  */
-struct gr1553rt_list *sa3tx_list = NULL;
-struct gr1553rt_list *sa3rx_list = NULL;
+#define RT_SA_RX 0
+#define RT_SA_TX 1
+
+struct rt_sa_def {
+	unsigned char sa;
+	unsigned char tx;
+	unsigned char bufcnt;
+	unsigned char words;
+	unsigned char irq;
+	unsigned char loop_sa;
+	rtems_event_set ev;
+	unsigned int opts;
+	void *init;
+};
 
-struct gr1553rt_list_cfg sa3_cfg = 
+struct rt_sa_def rt_sa_table[] =
 {
-	.bd_cnt = 16, /* two per major frame */
+/*	 SA DIR       BUFS WORDS IRQ LOOP EVENT      OPTS     INIT */
+	{ 0, RT_SA_RX,   0,   0,   0,   0, 0,         0x00000, NULL},	/* Mode code - ignored */
+	{ 1, RT_SA_RX,   1,   1,   1,   0, RT_EV_SA1, 0x38181, NULL},	/* Bus state from BC: WAIT/STARTUP/RUNNING/SHUTDOWN */
+	{ 1, RT_SA_TX,   1,   1,   0,   0, 0,         0x38181, NULL},	/* RT status to BC: DOWN/UP/DOWN */
+	{ 2, RT_SA_TX,   1,  16,   0,   0, 0,         0x39090, &rt_pnp1553_info}, /* PnP: VENDOR|DEVICE|VERSION|CLASS... Limit to 32 byte */
+	{ 3, RT_SA_RX,  16,  32,   2,   3, RT_EV_SA3, 0x38080, NULL},	/* BC->RT 64byte Data transfers, two per major frame */
+	{ 3, RT_SA_TX,  16,  32,   0,   0, 0,         0x38080, NULL},	/* RT->BC received data copied back */
+	{31, RT_SA_RX,   0,   0,   0,   0, 0,         0x1e0e0, NULL},	/* Mode code - ignored */
 };
-
-
-int rxbuf_curr = 0;
-
-/* All RT Data buffers */
-struct rt_data_buffer {
-	/* Startup/Shutdown parameters the BC control */
-	unsigned short bus_status; /* Wait */
-	unsigned short rt_status; /* Down */
-
-	/* Information about RT device that BC read */
-	struct pnp1553info pnp1553_info;
-
-	/* Transfer buffers */
-	uint16_t rxbufs[16][32];
-	uint16_t txbufs[16][32];
+#define RT_SA_CNT (sizeof(rt_sa_table)/sizeof(struct rt_sa_def))
+
+/* Run-time state of one line in rt_sa_table */
+struct rt_sa {
+	struct rt_sa_def *def;
+	struct gr1553rt_list_cfg cfg;
+	struct gr1553rt_list *list;
+	uint16_t *bufs;		/* First buffer, CPU address */
+	uint16_t *bufs_hw;	/* First buffer, address used by RT hardware */
+	int next;		/* First buffer not yet handled by IRQ */
+	struct rt_sa *loop;	/* Loopback target */
+	int irqs;		/* Number of IRQs */
 };
+struct rt_sa rt_sas[RT_SA_CNT];
 
-/* Initial State of RT Data */
-struct rt_data_buffer RT_data_startup = 
-{
-	.bus_status = 0,
-	.rt_status = 0,
-	.pnp1553_info = 
-	{
-		.vendor = 0x0001,
-		.device = 0x0001,
-		.version = 0,
-		.class = 0,
-		.subadr_rx_avail = 0x0003,
-		.subadr_tx_avail = 0x0007,
-		.desc = "GAISLER RTEMS DEMO1",
-	},
-};
+/* All RT list descriptions are allocated from one arena, and all data buffers
+ * from the RT data area.
+ */
+#define RT_ALIGN(size, align) (((size) + (align) - 1) & ~((align) - 1))
+#define RT_LIST_SIZE(bdcnt) \
+	RT_ALIGN(sizeof(struct gr1553rt_list) + (bdcnt)*sizeof(unsigned short), 8)
+#define RT_DATA_SIZE 0x1000	/* 4kB */
 
 #ifndef AMBA_OVER_PCI
 	/* Data Buffers the RT Hardware Access */
-	struct rt_data_buffer RT_data;
+	uint16_t RT_data[RT_DATA_SIZE/2] __attribute__ ((aligned (16)));
 #endif
-/* Pointer to RT_Data structure. For AMBA-over-PCI the pRT_data pointer
- * should be automatically be calculated.
- */
-struct rt_data_buffer *pRT_data = RT_DATA_CPU_ADR;
-struct rt_data_buffer *pRT_data_hw = RT_DATA_HW_ADR;
+uint16_t *pRT_data = RT_DATA_CPU_ADR;
+uint16_t *pRT_data_hw = RT_DATA_HW_ADR;
+void *rt_list_arena = NULL;
+
+/* Buffers the RT application use */
+volatile uint16_t *rt_bus_status;	/* SA1 RX */
+volatile uint16_t *rt_status;		/* SA1 TX */
 
-int init_rt_list(int *err)
+struct rt_sa *rt_sa_find(int sa, int tx)
 {
 	int i;
-	int irq, next;
-
-	/*** SUBADDRESS 1 - BUS STATUS ***/
 
-	/* Make driver allocate list description */
-	sa1rx_list = NULL;
-	if ( (*err = gr1553rt_list_init(rt, &sa1rx_list, &sa1_cfg)) ) {
-		return -1;
+	for (i=0; i<RT_SA_CNT; i++) {
+		if ( (rt_sa_table[i].sa == sa) && (rt_sa_table[i].tx == tx) &&
+		     (rt_sa_table[i].bufcnt > 0) )
+			return &rt_sas[i];
 	}
-	sa1tx_list = NULL;
-	if ( (*err = gr1553rt_list_init(rt, &sa1tx_list, &sa1_cfg)) ) {
-		return -2;
+
+	return NULL;
+}
+
+/* Print RT memory map */
+void rt_sa_print(void)
+{
+	struct rt_sa *rtsa;
+	struct rt_sa_def *def;
+	int i, size;
+
+	printf("RT MEMORY MAP:\n");
+	printf(" SA DIR BUFS WORDS IRQ LOOP LIST       DATA (CPU)            DATA (HW)\n");
+	for (i=0; i<RT_SA_CNT; i++) {
+		rtsa = &rt_sas[i];
+		def = rtsa->def;
+		if ( def->bufcnt == 0 )
+			continue;
+		size = def->bufcnt * def->words * 2;
+		printf(" %2d %s %4d %5d %3d %4d %p %p-%p %p\n",
+			def->sa, def->tx ? "TX" : "RX", def->bufcnt,
+			def->words, def->irq, def->loop_sa, rtsa->list,
+			rtsa->bufs, (char *)rtsa->bufs + size - 1,
+			rtsa->bufs_hw);
 	}
-	/* Setup descriptors to receive STATUS WORD and transmit current
-	 * RT status.
-	 *
-	 * RX and TX: circular ring with one descriptor.
+}
+
+/* Set up lists, descriptors and data buffers of all subaddresses from
+ * rt_sa_table in a single pass.
+ */
+int rt_sa_build(int *err)
+{
+	struct rt_sa *rtsa, *loop;
+	struct rt_sa_def *def, *ldef;
+	unsigned int opts[32];
+	char *arena;
+	int i, j, arena_size, data_size, size, irq, next, ret;
+
+	/* Check the table and calculate arena and data area size. Everything
+	 * that can be checked is checked here, the lists can not be taken
+	 * back from the driver once they have been initialized.
 	 */
-	if ( (*err = gr1553rt_bd_init(sa1rx_list, 0, 0, &pRT_data_hw->bus_status, 0)) )
-		return -3;
-	if ( (*err = gr1553rt_bd_init(sa1tx_list, 0, 0, &pRT_data_hw->rt_status, 0)) )
-		return -4;
+	arena_size = 0;
+	data_size = 0;
+	for (i=0; i<RT_SA_CNT; i++) {
+		def = &rt_sa_table[i];
+		if ( def->bufcnt == 0 )
+			continue;
+		if ( (def->irq > 0) && (def->bufcnt % def->irq) )
+			return -1;
+		if ( def->loop_sa ) {
+			loop = rt_sa_find(def->loop_sa, RT_SA_TX);
+			ldef = loop ? &rt_sa_table[loop - rt_sas] : NULL;
+			if ( (ldef == NULL) || (ldef->bufcnt != def->bufcnt) ||
+			     (ldef->words != def->words) )
+				return -7;
+		}
+		arena_size += RT_LIST_SIZE(def->bufcnt);
+		data_size += RT_ALIGN(def->bufcnt * def->words * 2, 4);
+	}
+	if ( data_size > RT_DATA_SIZE )
+		return -2;
 
+	/* Bus state handshake buffers */
+	if ( !rt_sa_find(1, RT_SA_RX) || !rt_sa_find(1, RT_SA_TX) )
+		return -8;
 
-	/*** SUBADDRESS 2 - PnP READ ***/
+	rt_list_arena = arena = (char *)malloc(arena_size + 7);
+	if ( arena == NULL )
+		return -3;
+	arena = (char *)RT_ALIGN((unsigned int)arena, 8);
+	memset(arena, 0, arena_size);
+	memset(pRT_data, 0, RT_DATA_SIZE);
+
+	memset(opts, 0, sizeof(opts));
+	data_size = 0;
+	for (i=0; i<RT_SA_CNT; i++) {
+		rtsa = &rt_sas[i];
+		rtsa->def = def = &rt_sa_table[i];
+		opts[def->sa] |= def->opts;
+		if ( def->bufcnt == 0 )
+			continue;
+
+		/* Allocate list description and data buffers */
+		rtsa->cfg.bd_cnt = def->bufcnt;
+		rtsa->list = (struct gr1553rt_list *)arena;
+		arena += RT_LIST_SIZE(def->bufcnt);
+		rtsa->bufs = (uint16_t *)((char *)pRT_data + data_size);
+		rtsa->bufs_hw = (uint16_t *)((char *)pRT_data_hw + data_size);
+		size = def->bufcnt * def->words * 2;
+		data_size += RT_ALIGN(size, 4);
+		rtsa->next = 0;
+		rtsa->irqs = 0;
+
+		if ( def->init )
+			memcpy(rtsa->bufs, def->init, def->words * 2);
+
+		if ( (*err = gr1553rt_list_init(rt, &rtsa->list, &rtsa->cfg)) ) {
+			ret = -4;
+			goto fail;
+		}
 
-	sa2tx_list = NULL;
-	if ( (*err = gr1553rt_list_init(rt, &sa2tx_list, &sa2_cfg)) ) {
-		return -10;
-	}
-	if ( (*err = gr1553rt_bd_init(sa2tx_list, 0, 0, 
-	                         (uint16_t *)&pRT_data_hw->pnp1553_info, 0)) )
-		return -11;
+		if ( def->irq > 0 ) {
+			if ( gr1553rt_irq_sa(rt, def->sa, def->tx, rt_sa_isr, rtsa) ) {
+				ret = -5;
+				goto fail;
+			}
+		}
 
+		/* Circular ring of descriptors, IRQ on every IRQ:th buffer */
+		for (j=0; j<def->bufcnt; j++) {
+			next = j + 1;
+			if ( next == def->bufcnt )
+				next = 0;
 
-	/*** SUBADDRESS 3 - BC<->RT DATA Transfer ***/
+			irq = 0;
+			if ( (def->irq > 0) && ((j % def->irq) == (def->irq - 1)) )
+				irq = GR1553RT_BD_FLAGS_IRQEN;
 
-	sa3tx_list = NULL;
-	sa3rx_list = NULL;
-	if ( (*err = gr1553rt_list_init(rt, &sa3tx_list, &sa3_cfg)) ) {
-		return -20;
+			if ( (*err = gr1553rt_bd_init(rtsa->list, j, irq,
+			             &rtsa->bufs_hw[j * def->words], next)) ) {
+				ret = -6;
+				goto fail;
+			}
+		}
 	}
-	if ( (*err = gr1553rt_list_init(rt, &sa3rx_list, &sa3_cfg)) ) {
-		return -21;
+
+	/* Resolve loopback targets, checked above */
+	for (i=0; i<RT_SA_CNT; i++) {
+		rtsa = &rt_sas[i];
+		def = rtsa->def;
+		rtsa->loop = NULL;
+		if ( (def->bufcnt > 0) && (def->loop_sa > 0) )
+			rtsa->loop = rt_sa_find(def->loop_sa, RT_SA_TX);
 	}
-	/* Install IRQ handlers for RX/TX (only RX is used) */
-	if ( gr1553rt_irq_sa(rt, 3, 1, rt_sa3_tx_isr, rt) ) {
-		return -22;
+
+	/* Set up configuration options per RT sub-address and schedule
+	 * lists.
+	 */
+	for (i=0; i<32; i++)
+		gr1553rt_sa_setopts(rt, i, 0xffffffff, opts[i]);
+	for (i=0; i<RT_SA_CNT; i++) {
+		rtsa = &rt_sas[i];
+		if ( rtsa->list )
+			gr1553rt_sa_schedule(rt, rtsa->def->sa, rtsa->def->tx, rtsa->list);
 	}
-	if ( gr1553rt_irq_sa(rt, 3, 0, rt_sa3_rx_isr, rt) ) {
-		return -22;
+
+	rt_bus_status = rt_sa_find(1, RT_SA_RX)->bufs;
+	rt_status = rt_sa_find(1, RT_SA_TX)->bufs;
+
+	return 0;
+
+fail:
+	/* The driver failed. Nothing has been scheduled yet, but the lists
+	 * initialized so far are known to the driver, which has no call to
+	 * release them, so the arena is kept. The SA interrupt handlers are
+	 * removed so that rt_sa_isr() is never called for these lists.
+	 */
+	for (j=0; j<=i; j++) {
+		def = &rt_sa_table[j];
+		if ( (def->bufcnt > 0) && (def->irq > 0) )
+			gr1553rt_irq_sa(rt, def->sa, def->tx, NULL, NULL);
+		rt_sas[j].list = NULL;
 	}
-	/* Transmit And Receive list */
-	for ( i=0; i<16; i++) {
-		/* Next Descriptor, with wrap-around */
-		next = i + 1;
-		if ( next == 16 )
-			next = 0;
-
-		/* Enable RX IRQ when last transfer within an Major
-		 * frame is received. We have up 25ms to prepare
-		 * the data the BC will request.
-		 */
-		irq = 0;
-		if ( i & 1 )
-			irq = GR1553RT_BD_FLAGS_IRQEN;
+	return ret;
+}
 
-		if ( (*err = gr1553rt_bd_init(sa3tx_list, i, 0,
-                             &pRT_data_hw->txbufs[i][0], next)) ) {
-			return -30;	      
-		}
+/* Fallback timeout, the RT task polls everything when no event has been
+ * received within this number of ticks.
+ */
+#define RT_EV_TIMEOUT	10
 
-		if ( (*err = gr1553rt_bd_init(sa3rx_list, i, irq,
-                              &pRT_data_hw->rxbufs[i][0], next)) ) {
-			return -31;	      
-		}
+/* The BM driver has no watermark IRQ, a timer checks the number of BM log
+ * entries every tick from interrupt context and posts RT_EV_BM when one
+ * quarter of the 16kB (2048 entries) BM DMA buffer has been used.
+ */
+#define RT_BM_WATERMARK	512
+
+/* Latency histogram, ISR post to RT task wakeup. Bucket N counts latencies
+ * in the range [2^N, 2^(N+1)) us, bucket 0 also counts latencies below 1us.
+ */
+#define RT_LAT_BUCKETS	16
+
+struct rt_lat_hist {
+	unsigned int cnt;
+	unsigned int max;
+	unsigned int buckets[RT_LAT_BUCKETS];
+};
+
+/* One histogram per RT state (0=INIT, 1=COMMUNICATION) and event source */
+struct rt_lat_hist rt_lat[2][RT_EV_CNT];
+
+rtems_id rt_task_id = 0;
+rtems_id rt_bm_timer_id = 0;
+unsigned int rt_ev_stamp[RT_EV_CNT];	/* Time of first post, 0=not posted */
+unsigned int rt_ev_idle_wakeups = 0;	/* Wakeups due to timeout */
+
+/* Microsecond time stamp, wraps every 71 minutes */
+static inline unsigned int rt_time_us(void)
+{
+	struct timespec ts;
+
+	rtems_clock_get_uptime(&ts);
+
+	return ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static inline int rt_ev_index(rtems_event_set ev)
+{
+	switch ( ev ) {
+		case RT_EV_SA1: return 0;
+		case RT_EV_SA3: return 1;
+		case RT_EV_MC: return 2;
+		default:
+		case RT_EV_BM: return 3;
 	}
+}
 
-	return 0;
+/* Post an event to the RT task from interrupt context. Only the time of the
+ * first post is recorded until the RT task has handled the event.
+ */
+void rt_ev_post(rtems_event_set ev)
+{
+	unsigned int *stamp = &rt_ev_stamp[rt_ev_index(ev)];
+
+	if ( *stamp == 0 ) {
+		*stamp = rt_time_us() | 1;
+	}
+	if ( rt_task_id )
+		rtems_event_send(rt_task_id, ev);
 }
 
-struct rt_sas_config {
-	unsigned int mask;
-	unsigned int opts;
-	struct gr1553rt_list **rxlist;
-	struct gr1553rt_list **txlist;
-} rtsa_cfg[32] =
+/* Account ISR-to-task latency for all received events */
+void rt_ev_account(rtems_event_set events, int state)
 {
-/* SEE HW MANUAL FOR BIT DEFINITIONS 
- *
- * Mode code:      all give IRQ and is logged.
- *
- * Non-mode codes: are not logged or IRQed by default, only
- *                 when explicitly defined by descriptor config.
+	struct rt_lat_hist *hist;
+	rtems_interrupt_level level;
+	unsigned int now, stamp, lat;
+	int i, bucket;
+
+	now = rt_time_us();
+
+	for (i=0; i<RT_EV_CNT; i++) {
+		if ( (events & (RTEMS_EVENT_0 << i)) == 0 )
+			continue;
+
+		rtems_interrupt_disable(level);
+		stamp = rt_ev_stamp[i];
+		rt_ev_stamp[i] = 0;
+		rtems_interrupt_enable(level);
+		if ( stamp == 0 )
+			continue;
+
+		lat = now - stamp;
+		bucket = 0;
+		while ( (lat >> (bucket+1)) && (bucket < RT_LAT_BUCKETS-1) )
+			bucket++;
+
+		hist = &rt_lat[state][i];
+		hist->cnt++;
+		hist->buckets[bucket]++;
+		if ( lat > hist->max )
+			hist->max = lat;
+	}
+}
+
+/* Print Latency statistics. Not called from the RT loop since printing
+ * would perturb the measurement, call it from the debugger or at exit.
  */
-	/* 00 */ {0xffffffff, 0x00000},	/* Mode code - ignored */
-	/* 01 */ {0xffffffff, 0x38181, &sa1rx_list, &sa1tx_list}, /* Startup/shutdown sub address */
-	/* 02 */ {0xffffffff, 0x39090, NULL, &sa2tx_list}, /* PnP: VENDOR|DEVICE|VERSION|CLASS... Limit to 32 byte */
-	/* 03 */ {0xffffffff, 0x38080, &sa3rx_list, &sa3tx_list}, /* 64byte Data transfers */
-	/* 04 */ {0xffffffff, 0x00000},
-	/* 05 */ {0xffffffff, 0x00000},
-	/* 06 */ {0xffffffff, 0x00000},
-	/* 07 */ {0xffffffff, 0x00000},
-	/* 08 */ {0xffffffff, 0x00000},
-	/* 09 */ {0xffffffff, 0x00000},
-	/* 10 */ {0xffffffff, 0x00000},
-	/* 11 */ {0xffffffff, 0x00000},
-	/* 12 */ {0xffffffff, 0x00000},
-	/* 13 */ {0xffffffff, 0x00000},
-	/* 14 */ {0xffffffff, 0x00000},
-	/* 15 */ {0xffffffff, 0x00000},
-	/* 16 */ {0xffffffff, 0x00000},
-	/* 17 */ {0xffffffff, 0x00000},
-	/* 18 */ {0xffffffff, 0x00000},
-	/* 19 */ {0xffffffff, 0x00000},
-	/* 20 */ {0xffffffff, 0x00000},
-	/* 21 */ {0xffffffff, 0x00000},
-	/* 22 */ {0xffffffff, 0x00000},
-	/* 23 */ {0xffffffff, 0x00000},
-	/* 24 */ {0xffffffff, 0x00000},
-	/* 25 */ {0xffffffff, 0x00000},
-	/* 26 */ {0xffffffff, 0x00000},
-	/* 27 */ {0xffffffff, 0x00000},
-	/* 28 */ {0xffffffff, 0x00000},
-	/* 29 */ {0xffffffff, 0x00000},
-	/* 30 */ {0xffffffff, 0x00000},
-	/* 31 */ {0xffffffff, 0x1e0e0},	/* Mode code - ignored */
-};
+void rt_lat_print(void)
+{
+	static char *state_str[2] = {"INIT", "COM"};
+	static char *ev_str[RT_EV_CNT] = {"SA1", "SA3", "MC", "BM"};
+	struct rt_lat_hist *hist;
+	int state, i, j;
+
+	printf("RT ISR-to-task latency (us), idle wakeups: %d\n",
+		rt_ev_idle_wakeups);
+	for (state=0; state<2; state++) {
+		for (i=0; i<RT_EV_CNT; i++) {
+			hist = &rt_lat[state][i];
+			if ( hist->cnt == 0 )
+				continue;
+			printf(" %-4s %-3s cnt=%u max=%u\n", state_str[state],
+				ev_str[i], hist->cnt, hist->max);
+			for (j=0; j<RT_LAT_BUCKETS; j++) {
+				if ( hist->buckets[j] == 0 )
+					continue;
+				printf("   <%6u: %u\n", 2 << j, hist->buckets[j]);
+			}
+		}
+	}
+}
 
-void init_rt_sa(void)
+#include <gr1553bm.h>
+extern void *bm;
+
+/* Timer routine executed every tick, checks BM log watermark */
+rtems_timer_service_routine rt_bm_watermark(rtems_id timer, void *arg)
 {
-	int i;
+	int nentries;
 
-	for (i=0; i<32; i++) {
-		gr1553rt_sa_setopts(rt, i, rtsa_cfg[i].mask, rtsa_cfg[i].opts);
-		if ( rtsa_cfg[i].rxlist )
-			gr1553rt_sa_schedule(rt, i, 0, *rtsa_cfg[i].rxlist);
-		if ( rtsa_cfg[i].txlist )
-			gr1553rt_sa_schedule(rt, i, 1, *rtsa_cfg[i].txlist);
+	if ( bm && (gr1553bm_available(bm, &nentries) == 0) &&
+	     (nentries >= RT_BM_WATERMARK) ) {
+		rt_ev_post(RT_EV_BM);
 	}
+
+	rtems_timer_fire_after(timer, 1, rt_bm_watermark, arg);
 }
 
 int rt_irq_cnt=0;
@@ -426,12 +647,6 @@ unsigned int rt_isr(struct gr1553rt_list *list, int entry, void *data)
 {
 	rt_irq_cnt++;
 
-	if ( list == sa3rx_list ) {
-	
-	} else if ( list == sa3tx_list ) {
-	
-	}
-
 	/* Default action is to clear the DATA-VALID flag and
 	 * TIME, BC, SZ, RES
 	 */
@@ -447,18 +662,13 @@ void rt_err_isr(int err, void *data)
 /* Mode Code Received */
 void rt_mc_isr(int mcode, unsigned int entry, void *data)
 {
-	printk("MC%d IRQ: 0x%08x\n", mcode, entry);
+	rt_ev_post(RT_EV_MC);
 }
 
 int init_rt(void)
 {
 	int status, err;
 
-	/* Initialize default values of data buffers */
-	memcpy(pRT_data, &RT_data_startup, sizeof(struct rt_data_buffer));
-
-	rxbuf_curr = 0;
-
 	/* Print List:
 	 *   gr1553bc_show_list(list, 0);
 	 */
@@ -488,17 +698,23 @@ int init_rt(void)
 		return -1;
 	}
 
-	/* Set up lists and schedule them on respective RT subaddress.
-	 * Also, register custom IRQ handlers on some transfer
-	 * descriptors.
+	/* Set up lists and data buffers from rt_sa_table, schedule them on
+	 * respective RT subaddress. Also, register custom IRQ handlers on
+	 * some transfer descriptors.
 	 */
-	if ( (status=init_rt_list(&err)) != 0 ) {
+	err = 0;
+	if ( (status=rt_sa_build(&err)) != 0 ) {
 		printf("Failed to init lists: %d : %d\n", status, err);
 		return -1;
 	}
+	rt_sa_print();
 
-	/* Set up configuration options per RT sub-address */
-	init_rt_sa();
+#ifdef EVLOG_RING
+	if ( rt_evlog_init(&rt_evlog) ) {
+		printf("Failed to allocate RT event log ring\n");
+		return -1;
+	}
+#endif
 
 	/* Start communication */
 	status = gr1553rt_start(rt);
@@ -564,7 +780,7 @@ int rt_init_state(void)
 	case 0:	/* Wait for Startup Message */
 
 		/* Check if BC wants us to startup */
-		if ( (0x00ff & pRT_data->bus_status) > 0 ) {
+		if ( (0x00ff & *rt_bus_status) > 0 ) {
 
 			/* Try to startup RT */
 			if ( rt_startup() ) {
@@ -576,14 +792,14 @@ int rt_init_state(void)
 			init_state = 1;
 
 			/* Signal to BC we have started up */
-			pRT_data->rt_status = 1;
+			*rt_status = 1;
 		}
 		break;
 
 	case 1:
 		/* Check if BC say all RTs are started up and ready to go */
 
-		if ( (0x00ff & pRT_data->bus_status) > 1 ) {
+		if ( (0x00ff & *rt_bus_status) > 1 ) {
 			if ( rt_run() ) {
 				printf("RT Run mode failed\n");
 				return -1;
@@ -602,42 +818,24 @@ int rt_init_state(void)
  */
 void bc_rt_data_transfer(void)
 {
-#if 0
-	int curr;
-
-	/* Do nothing, our ISR handles data copying */
-
-	/* Get Received data by looking at the current descriptor address 
-	 *
-	 */
-	gr1553rt_indication(rt, 3, NULL, &curr);
-
-	/* Have we received more data? */
-	if ( curr == rxbuf_curr ) {
-		return;
-	}
-
-	while ( curr != rxbuf_curr ) {
-
-		/* Handle buffer 'rxbuf_curr' */
-		memcpy(pRT_data->txbufs[rxbuf_curr], pRT_data->rxbufs[rxbuf_curr], 64);
-
-		/* Next buffer will be */
-		rxbuf_curr++;
-		if ( rxbuf_curr >= 16 ) {
-			rxbuf_curr = 0;
-		}
-	}
-#endif
+	/* Do nothing, the SA3 loopback IRQ handles data copying */
 }
 
 #ifdef EVLOG_PRINTOUT
+#include "rt_evlog_decode.c"
+
 void rt_process_evlog(void)
 {
-	unsigned int events[64], ev;
-	int i, cnt, type, samc, bc, size, result, irq;
-	char *type_str, *bc_str, *result_str, *irq_str;
+	static struct rt_evlog_dec dec;
+	unsigned int events[64];
+	char line[80];
+	int i, cnt;
 
+#ifdef EVLOG_PRINTOUT_RAW
+	rt_evlog_dec_init(&dec, 1);
+#else
+	rt_evlog_dec_init(&dec, 0);
+#endif
 	do {
 		/* Get up to 64 events from Event log
 		 *
@@ -649,66 +847,21 @@ void rt_process_evlog(void)
 		if ( cnt < 1 )
 			break;
 
-		/* Process the entries */
+		/* Decode the entries the same way as linux_client */
 		for ( i=0; i<cnt; i++) {
-			ev = events[i];
-
-			/* Decode */
-			irq = ev >> 31;
-			type = (ev >> 29) & 0x3;
-			samc = (ev >> 24) & 0x1f;
-			bc =  (ev >> 9) & 0x1;
-			size = (ev >> 3) & 0x3f;
-			result =  ev & 0x7;
-
-			bc_str = "";
-			irq_str = "";
-			result_str = "";
-
-			if ( bc )
-				bc_str = "BC ";
-			if ( result != 0 )
-				result_str = " ERROR";
-			if ( irq )
-				irq_str = "IRQ ";
-
-			switch ( type ) {
-				case 0:
-					type_str = "TX";
-					break;
-
-				case 1:
-					type_str = "RX";
-					break;
-
-				case 2:
-					type_str = "MC";
-					break;
-
-				default:
-					type_str = "UNKNOWN";
-					break;
-			}
-#ifdef EVLOG_PRINTOUT_RAW
-			printf("EV: %s%02x: %s%slen=%d%s (%08x)\n",
-				type_str, samc, irq_str, bc_str, size,
-				result_str, ev);
-#else
-			printf("EV: %s%02x: %s%slen=%d%s\n",
-				type_str, samc, irq_str, bc_str, size,
-				result_str);
-#endif
+			if ( rt_evlog_decode(&dec, events[i], line) > 0 )
+				printf("%s", line);
 		}
 
 	} while ( cnt == 64 );
 }
 #endif
 
-int rt_debug_majfrm = 0;
-int rt_debug_blockno = 0;
-int rt_sa3_irqs = 0;
-
-void rt_sa3_rx_isr
+/* Subaddress IRQ, generated every IRQ:th buffer according to rt_sa_table.
+ * The buffers received since the last IRQ are copied to the loopback
+ * target, and the RT task is woken up.
+ */
+void rt_sa_isr
 	(
 	struct gr1553rt_list *list, 
 	unsigned int ctrl,
@@ -716,59 +869,66 @@ void rt_sa3_rx_isr
 	void *data
 	)
 {
-	static int last_entry = 0;
-
-	/* We have received two blocks of data: 128-bytes total, located
-	 * in our receive buffers: rxbufs[MAJOR_FRAME][block].
-	 *
-	 * Copy received data to transmit buffers
-	 */
-	int majfrm = last_entry / 2;
-	int blockno = last_entry & 1;
+	struct rt_sa *rtsa = data;
+	struct rt_sa_def *def = rtsa->def;
 	unsigned int status;
+	int first, cnt;
 
-	/* Re enable RX IRQ */
-	status = GR1553RT_BD_FLAGS_IRQEN;
-	gr1553rt_bd_update(sa3rx_list, last_entry+1, &status, NULL);
+	first = rtsa->next;
+	cnt = def->irq;
 
-	memcpy(&pRT_data->txbufs[last_entry+0][0], &pRT_data->rxbufs[last_entry+0][0], 64);
-	memcpy(&pRT_data->txbufs[last_entry+1][0], &pRT_data->rxbufs[last_entry+1][0], 64);
-
-	last_entry += 2;
-	if ( last_entry >= 16 )
-		last_entry = 0;
+	/* Re enable IRQ on the descriptor that generated it */
+	status = GR1553RT_BD_FLAGS_IRQEN;
+	gr1553rt_bd_update(list, first + cnt - 1, &status, NULL);
 
-	rt_debug_majfrm = majfrm;
-	rt_debug_blockno = blockno;
+	if ( rtsa->loop ) {
+		memcpy(&rtsa->loop->bufs[first * def->words],
+			&rtsa->bufs[first * def->words],
+			cnt * def->words * 2);
+	}
 
-	rt_sa3_irqs++;
-}
+	rtsa->next = first + cnt;
+	if ( rtsa->next >= def->bufcnt )
+		rtsa->next = 0;
+	rtsa->irqs++;
 
-/* Descriptors or SA-table do not have Interrupts enabled, so we will not
- * end up here.
- */
-void rt_sa3_tx_isr
-	(
-	struct gr1553rt_list *list, 
-	unsigned int ctrl,
-	int entry_next,
-	void *data
-	)
-{
+	/* Wake up RT task */
+	if ( def->ev )
+		rt_ev_post(def->ev);
 }
 
 int rt_loop(void)
 {
 	int status;
+	rtems_event_set events;
+	rtems_status_code sc;
 
 	state = 0;
 	init_state = 0;
 
+	/* Start BM watermark timer */
+	if ( rtems_timer_create(rtems_build_name('B', 'M', 'W', 'M'),
+	                        &rt_bm_timer_id) != RTEMS_SUCCESSFUL ) {
+		printf("Failed to create BM watermark timer\n");
+		return -4;
+	}
+	rtems_timer_fire_after(rt_bm_timer_id, 1, rt_bm_watermark, NULL);
+
+	/* Latency histogram can be inspected from the debugger */
+	printf("rt_lat = %p\n", &rt_lat[0][0]);
+
+	/* Handle everything once, the BC may already have sent bus status
+	 * before the loop was entered.
+	 */
+	events = RT_EV_ALL;
+
 	while ( 1 ) {
 		/* Answer BC's requests */
 		switch ( state ) {
 		default:
 		case 0: /* Initial State */
+			if ( (events & RT_EV_SA1) == 0 )
+				break;
 			status = rt_init_state();
 			if ( status < 0 ) {
 				return -1;
@@ -779,20 +939,42 @@ int rt_loop(void)
 			break;
 
 		case 1: /* Communication State */
+			if ( (events & (RT_EV_SA3|RT_EV_MC)) == 0 )
+				break;
 			bc_rt_data_transfer();
-#ifdef EVLOG_PRINTOUT
+#if defined(EVLOG_RING)
+			if ( rt_evlog_fill(&rt_evlog, rt) < 0 ) {
+				printf("RT Event Log failed\n");
+				return -3;
+			}
+#elif defined(EVLOG_PRINTOUT)
 			rt_process_evlog();
 #endif
 			break;
 		}
 
-		if ( bm_log() ) {
-			printf("BM Log failed\n");
-			return -2;
+		if ( events & RT_EV_BM ) {
+			if ( bm_log() ) {
+				printf("BM Log failed\n");
+				return -2;
+			}
+		}
+
+		/* Block until an ISR posts an event. On timeout everything
+		 * is handled as if all events were received.
+		 */
+		sc = rtems_event_receive(RT_EV_ALL, RTEMS_EVENT_ANY | RTEMS_WAIT,
+		                         RT_EV_TIMEOUT, &events);
+		if ( sc == RTEMS_TIMEOUT ) {
+			rt_ev_idle_wakeups++;
+			events = RT_EV_ALL;
+		} else if ( sc != RTEMS_SUCCESSFUL ) {
+			printf("RT event receive failed: %d\n", sc);
+			return -5;
 		}
 
-		/* Sleep 1 ticks */
-		rtems_task_wake_after(1);
+		/* Account ISR-to-task latency */
+		rt_ev_account(events, state);
 	}
 	return 0;
 }
@@ -5,58 +5,17 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include <rtems.h>
 
 #include <spwcuc.h>
 #include <grspw.h>
 
-/********************** SPWCUC ***********************/
-
-static unsigned char RMAP_CRCTable[256] = {
-    0x00, 0x91, 0xe3, 0x72, 0x07, 0x96, 0xe4, 0x75,
-    0x0e, 0x9f, 0xed, 0x7c, 0x09, 0x98, 0xea, 0x7b,
-    0x1c, 0x8d, 0xff, 0x6e, 0x1b, 0x8a, 0xf8, 0x69,
-    0x12, 0x83, 0xf1, 0x60, 0x15, 0x84, 0xf6, 0x67,
-    0x38, 0xa9, 0xdb, 0x4a, 0x3f, 0xae, 0xdc, 0x4d,
-    0x36, 0xa7, 0xd5, 0x44, 0x31, 0xa0, 0xd2, 0x43,
-    0x24, 0xb5, 0xc7, 0x56, 0x23, 0xb2, 0xc0, 0x51,
-    0x2a, 0xbb, 0xc9, 0x58, 0x2d, 0xbc, 0xce, 0x5f,
-    0x70, 0xe1, 0x93, 0x02, 0x77, 0xe6, 0x94, 0x05,
-    0x7e, 0xef, 0x9d, 0x0c, 0x79, 0xe8, 0x9a, 0x0b,
-    0x6c, 0xfd, 0x8f, 0x1e, 0x6b, 0xfa, 0x88, 0x19,
-    0x62, 0xf3, 0x81, 0x10, 0x65, 0xf4, 0x86, 0x17,
-    0x48, 0xd9, 0xab, 0x3a, 0x4f, 0xde, 0xac, 0x3d,
-    0x46, 0xd7, 0xa5, 0x34, 0x41, 0xd0, 0xa2, 0x33,
-    0x54, 0xc5, 0xb7, 0x26, 0x53, 0xc2, 0xb0, 0x21,
-    0x5a, 0xcb, 0xb9, 0x28, 0x5d, 0xcc, 0xbe, 0x2f,
-    0xe0, 0x71, 0x03, 0x92, 0xe7, 0x76, 0x04, 0x95,
-    0xee, 0x7f, 0x0d, 0x9c, 0xe9, 0x78, 0x0a, 0x9b,
-    0xfc, 0x6d, 0x1f, 0x8e, 0xfb, 0x6a, 0x18, 0x89,
-    0xf2, 0x63, 0x11, 0x80, 0xf5, 0x64, 0x16, 0x87,
-    0xd8, 0x49, 0x3b, 0xaa, 0xdf, 0x4e, 0x3c, 0xad,
-    0xd6, 0x47, 0x35, 0xa4, 0xd1, 0x40, 0x32, 0xa3,
-    0xc4, 0x55, 0x27, 0xb6, 0xc3, 0x52, 0x20, 0xb1,
-    0xca, 0x5b, 0x29, 0xb8, 0xcd, 0x5c, 0x2e, 0xbf,
-    0x90, 0x01, 0x73, 0xe2, 0x97, 0x06, 0x74, 0xe5,
-    0x9e, 0x0f, 0x7d, 0xec, 0x99, 0x08, 0x7a, 0xeb,
-    0x8c, 0x1d, 0x6f, 0xfe, 0x8b, 0x1a, 0x68, 0xf9,
-    0x82, 0x13, 0x61, 0xf0, 0x85, 0x14, 0x66, 0xf7,
-    0xa8, 0x39, 0x4b, 0xda, 0xaf, 0x3e, 0x4c, 0xdd,
-    0xa6, 0x37, 0x45, 0xd4, 0xa1, 0x30, 0x42, 0xd3,
-    0xb4, 0x25, 0x57, 0xc6, 0xb3, 0x22, 0x50, 0xc1,
-    0xba, 0x2b, 0x59, 0xc8, 0xbd, 0x2c, 0x5e, 0xcf,
-};
+#include "cuc.h"
+#include "timemon.h"
 
-static unsigned char calc_rmap_crc(unsigned char *data, unsigned int len)
-{
-    unsigned char crc = 0;
-    unsigned int i;
-    for (i = 0; i < len; i++) {
-        crc = RMAP_CRCTable[(crc ^ data[i]) & 0xff];
-    }
-    return crc;
-}
+/********************** SPWCUC ***********************/
 
 /* Create a SpaceWire CUCTP packet 
  *
@@ -81,41 +40,185 @@ void spwcuc_create_cuctp_packet(
 	unsigned char *cuctp_pkt_buf
 	)
 {
-	/* This routine assumes long long is 64 bits and big endian architecture */
-	unsigned long long et_next = spwcuc_get_next_et(spwcuc);
-	unsigned char *p_et = (unsigned char *) &et_next;
-
-	cuctp_pkt_buf[0] = dla;
-	cuctp_pkt_buf[1] = pid;
-	cuctp_pkt_buf[2] = 1<<7 | (tid&0x7)<<4 | 0xf; /* P-field default */
-	cuctp_pkt_buf[3] = (init&1)<<7;               /* P-field extended */
-	memcpy(&cuctp_pkt_buf[4], &p_et[1], 7);
-	cuctp_pkt_buf[11] = calc_rmap_crc(cuctp_pkt_buf, 11);
+	struct cuc_pfield pf;
+	struct cuc_time t;
+
+	/* SPWCUC default: 4 coarse and 3 fine octets, extended P-field */
+	pf.tid = tid;
+	pf.coarse = 4;
+	pf.fine = 3;
+	pf.ext = 1;
+	pf.init = init;
+	cuc_time_from_raw(&t, &pf, spwcuc_get_next_et(spwcuc));
+	cuctp_encode(dla, pid, &pf, &t, cuctp_pkt_buf, 12);
 }
 
 int time_tx = 0;
 int spwtx_fd = -1;
 int time_tx_first = 1; /* Send Init bit of TimePacket only first time */
-volatile int time_tick_tx_wrap = 0;
 
-unsigned char cuctp_pkt_buf0[12] = {0};
+/* CONFIG: Define TIME_PKT_LOG to print every sent Time-Packet. The sender
+ *         task only preformats the packet into a log ring, printing is done
+ *         later from spwcuc_handling() so that it does not delay sending.
+ *         Off by default, printing every packet costs more than sending it.
+ */
+/*#define TIME_PKT_LOG*/
+
+/* Time-Packets are prepared by the TICK_TX_WRAP IRQ handler and written to
+ * GRSPW by a high priority sender task woken directly from the IRQ handler.
+ * The IRQ handler prepares packet N into buffer N%TIME_PKT_BUF_CNT, the
+ * sender task always sends the latest prepared packet.
+ */
+#define TIME_PKT_TASK_PRIO	2
+#define TIME_PKT_EV_SEND	RTEMS_EVENT_0
+#define TIME_PKT_BUF_CNT	4
+#define TIME_PKT_LEN		12
+
+struct time_pkt {
+	unsigned char buf[TIME_PKT_LEN];
+	unsigned int irq_us;	/* Time of TICK_TX_WRAP IRQ */
+};
+
+struct time_pkt time_pkts[TIME_PKT_BUF_CNT];
+volatile unsigned int time_pkt_prepared = 0;	/* Written by IRQ only */
+unsigned int time_pkt_sent = 0;			/* Written by task only */
+unsigned int time_pkt_skipped = 0;		/* Not sent, newer available */
+unsigned int time_pkt_errors = 0;		/* write() failed */
+rtems_id time_pkt_tid = 0;
+
+/* IRQ-to-wire latency: from TICK_TX_WRAP IRQ until write() has handed the
+ * packet to the GRSPW driver.
+ */
+#define TIME_LAT_BUCKETS	8	/* <16,<32,<64,..,<1024,>=1024 us */
+struct time_lat {
+	unsigned int cnt;
+	unsigned int min;
+	unsigned int max;
+	unsigned int sum;
+	unsigned int hist[TIME_LAT_BUCKETS];
+} time_lat = {0, 0xffffffff, 0, 0, {0}};
+
+#ifdef TIME_PKT_LOG
+/* Log ring of preformatted packets, one producer (sender task) and one
+ * consumer (spwcuc_handling).
+ */
+#define TIME_LOG_CNT		16
+struct time_log_entry {
+	char hex[TIME_PKT_LEN*3+1];
+	unsigned int lat_us;
+};
+struct time_log_entry time_log[TIME_LOG_CNT];
+volatile unsigned int time_log_head = 0;
+volatile unsigned int time_log_tail = 0;
+unsigned int time_log_lost = 0;		/* Written by sender task only */
+unsigned int time_log_lost_seen = 0;	/* Written by consumer only */
+
+static void time_log_add(unsigned char *pkt, unsigned int lat_us)
+{
+	static const char hexdigits[] = "0123456789abcdef";
+	struct time_log_entry *e;
+	char *p;
+	int i;
+
+	if ( (time_log_head - time_log_tail) >= TIME_LOG_CNT ) {
+		time_log_lost++;
+		return;
+	}
+	e = &time_log[time_log_head % TIME_LOG_CNT];
+	p = e->hex;
+	for (i=0; i<TIME_PKT_LEN; i++) {
+		*p++ = hexdigits[pkt[i] >> 4];
+		*p++ = hexdigits[pkt[i] & 0xf];
+		*p++ = ' ';
+	}
+	*p = '\0';
+	e->lat_us = lat_us;
+	time_log_head++;
+}
+#endif
+
+static unsigned int time_uptime_us(void)
+{
+	struct timespec ts;
+
+	rtems_clock_get_uptime(&ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void time_lat_add(unsigned int lat)
+{
+	int i;
+
+	time_lat.cnt++;
+	time_lat.sum += lat;
+	if ( lat < time_lat.min )
+		time_lat.min = lat;
+	if ( lat > time_lat.max )
+		time_lat.max = lat;
+	for (i=0; i<TIME_LAT_BUCKETS-1; i++) {
+		if ( lat < (16U << i) )
+			break;
+	}
+	time_lat.hist[i]++;
+}
+
+/* High priority Time-Packet sender task, woken by the TICK_TX_WRAP IRQ */
+rtems_task time_pkt_task(rtems_task_argument ignored)
+{
+	rtems_event_set events;
+	struct time_pkt *pkt;
+	unsigned int prepared, lat;
+
+	while ( 1 ) {
+		rtems_event_receive(TIME_PKT_EV_SEND, RTEMS_WAIT | RTEMS_EVENT_ANY,
+			RTEMS_NO_TIMEOUT, &events);
+
+		prepared = time_pkt_prepared;
+		if ( prepared == time_pkt_sent )
+			continue;
+
+		/* Only the latest Time-Packet is of interest */
+		time_pkt_skipped += prepared - time_pkt_sent - 1;
+		pkt = &time_pkts[(prepared - 1) % TIME_PKT_BUF_CNT];
+
+		if ( write(spwtx_fd, pkt->buf, TIME_PKT_LEN) != TIME_PKT_LEN ) {
+			time_pkt_errors++;
+		} else {
+			lat = time_uptime_us() - pkt->irq_us;
+			time_lat_add(lat);
+#ifdef TIME_PKT_LOG
+			time_log_add(pkt->buf, lat);
+#endif
+		}
+		time_pkt_sent = prepared;
+	}
+}
 
 /* Custom Interrupt Function */
 void spwcuc_user_isr(unsigned int pimr, void *spwcuc)
 {
+	struct time_pkt *pkt;
+
 	/* Handle IRQ here */
 
-	if ( pimr & TICK_TX_WRAP_IRQ ) {
+	/* Timestamp TimeCode ticks for the time sync monitor */
+	if ( pimr & (time_tx ? TICK_TX_IRQ : TICK_RX_IRQ) )
+		timemon_sample(TIMEMON_SRC_SPWCUC);
+
+	if ( (pimr & TICK_TX_WRAP_IRQ) && time_pkt_tid ) {
 
 		/* Prepare CUC-TP Packet */
-		spwcuc_create_cuctp_packet(spwcuc,254,254,0x1,time_tx_first,cuctp_pkt_buf0);
+		pkt = &time_pkts[time_pkt_prepared % TIME_PKT_BUF_CNT];
+		pkt->irq_us = time_uptime_us();
+		spwcuc_create_cuctp_packet(spwcuc,254,254,0x1,time_tx_first,pkt->buf);
 
 		/* Only INIT flag first TimePacket */
 		if ( time_tx_first )
 			time_tx_first = 0;
 
-		/* Signal to task to send Time Packet */
-		time_tick_tx_wrap = 1;
+		/* Wake sender task to send Time Packet */
+		time_pkt_prepared++;
+		rtems_event_send(time_pkt_tid, TIME_PKT_EV_SEND);
 	}
 }
 
@@ -249,6 +352,24 @@ int init_spwcuc(int tx, char *grspw_devname)
 		return -2;
 	}
 
+	/* Create and start Time-Packet sender task before IRQs are enabled */
+	if ( tx ) {
+		if ( rtems_task_create(rtems_build_name('T', 'P', 'K', 'T'),
+		                       TIME_PKT_TASK_PRIO,
+		                       RTEMS_MINIMUM_STACK_SIZE * 4,
+		                       RTEMS_DEFAULT_MODES | RTEMS_PREEMPT,
+		                       RTEMS_DEFAULT_ATTRIBUTES,
+		                       &time_pkt_tid) != RTEMS_SUCCESSFUL ) {
+			printf("Failed to create Time-Packet task\n");
+			return -3;
+		}
+		if ( rtems_task_start(time_pkt_tid, time_pkt_task, 0) !=
+		     RTEMS_SUCCESSFUL ) {
+			printf("Failed to start Time-Packet task\n");
+			return -3;
+		}
+	}
+
 	/* Register Custom Interrupt handler */
 	spwcuc_int_register(cuc, spwcuc_user_isr, cuc);
 
@@ -268,26 +389,55 @@ int init_spwcuc(int tx, char *grspw_devname)
 	return 0;
 }
 
-/* Process stuff at a fixed time interval (10 times a second) */
+void time_lat_print(void)
+{
+	int i;
+
+	printf("TIME PKT: sent %u, skipped %u, errors %u\n",
+		time_pkt_sent, time_pkt_skipped, time_pkt_errors);
+	if ( time_lat.cnt == 0 )
+		return;
+	printf("TIME PKT: IRQ-to-wire latency min %u us, avg %u us, max %u us\n",
+		time_lat.min, time_lat.sum / time_lat.cnt, time_lat.max);
+	printf("TIME PKT: latency histogram:");
+	for (i=0; i<TIME_LAT_BUCKETS-1; i++)
+		printf(" <%u:%u", 16U << i, time_lat.hist[i]);
+	printf(" >=%u:%u\n", 16U << (TIME_LAT_BUCKETS-2), time_lat.hist[i]);
+}
+
+/* Process stuff at a fixed time interval (10 times a second). Time-Packets
+ * are sent by time_pkt_task(), only logging is done here.
+ */
+#define TIME_LAT_PRINT_INTERVAL 100
+int time_lat_print_cnt = 0;
+
 void spwcuc_handling(void)
 {
-	if ( time_tick_tx_wrap ) {
-		int i;
+#ifdef TIME_PKT_LOG
+	unsigned int lost;
+#endif
 
-		/* This will only happen when in TX - TimeMaster */
+	/* This will only happen when in TX - TimeMaster */
+	if ( time_pkt_tid == 0 )
+		return;
 
-		printf("PKT: ");
-		for (i=0; i<12; i++)
-			printf("%02x ", cuctp_pkt_buf0[i]);
-		printf("\n");
+#ifdef TIME_PKT_LOG
+	while ( time_log_tail != time_log_head ) {
+		struct time_log_entry *e = &time_log[time_log_tail % TIME_LOG_CNT];
 
-		/* Write prepared packet */		
-		write(spwtx_fd, &cuctp_pkt_buf0[0], 12);
+		printf("PKT: %s(%u us)\n", e->hex, e->lat_us);
+		time_log_tail++;
+	}
+	if ( time_log_lost != time_log_lost_seen ) {
+		lost = time_log_lost;
+		printf("PKT: %u log entries lost\n", lost - time_log_lost_seen);
+		time_log_lost_seen = lost;
+	}
+#endif
 
-		/* remember that we have already sent the latest 
-		 * TimePacket
-		 */
-		time_tick_tx_wrap = 0;
+	if ( ++time_lat_print_cnt >= TIME_LAT_PRINT_INTERVAL ) {
+		time_lat_print_cnt = 0;
+		time_lat_print();
 	}
 }
 
@@ -307,10 +457,14 @@ void grctm_user_isr(unsigned int pimr, void *data)
 	/* Handle IRQ HERE */
 
 	nrirq++;
-	if (pimr & PULSE0_IRQ)
+	if (pimr & PULSE0_IRQ) {
 		p0++;
-	if (pimr & PULSE1_IRQ)
+		timemon_sample(TIMEMON_SRC_PULSE0);
+	}
+	if (pimr & PULSE1_IRQ) {
 		p1++;
+		timemon_sample(TIMEMON_SRC_PULSE1);
+	}
 }
 
 int init_ctm(int tx, int spw)
@@ -362,12 +516,23 @@ int init_ctm(int tx, int spw)
 	return 0;
 }
 
+/* Print time sync monitor statistics every TIMEMON_PRINT_TICKS call */
+#define TIMEMON_PRINT_TICKS 500
+int timemon_print_cnt = 0;
+
 void ctm_handling(void)
 {
 	struct grctm_stats stats;
 
 	/*** DO SOMETHING? CALLED EVERY TICK ***/
 
+	/* Process pulses timestamped by interrupt handlers */
+	timemon_process();
+	if ( ++timemon_print_cnt >= TIMEMON_PRINT_TICKS ) {
+		timemon_print_cnt = 0;
+		timemon_print();
+	}
+
 	/* Get IRQ Statistics from driver */
 	grctm_get_stats(ctm, &stats);
 #if 0
@@ -0,0 +1,294 @@
+/* Time synchronization quality monitor
+ *
+ * Every SPWCUC tick and GRCTM pulse interrupt is timestamped against two
+ * time bases, the local time (RTEMS uptime) and the 1553 BM time. The
+ * interrupt handlers only store the raw time stamps in a small ring, the
+ * ring is processed from task context by timemon_process() where the
+ * following metrics are calculated for each pulse:
+ *
+ *  JITTER      Pulse period minus nominal period, local time [ns]
+ *  OFS_LOCAL   Pulse phase against local time. The time since the first
+ *              pulse minus the number of nominal periods [ns]
+ *  OFS_1553    As OFS_LOCAL but against 1553 BM time [ns]
+ *  DRIFT_LOCAL Rate error against local time, the slope of OFS_LOCAL over
+ *              the rolling window [ppb]
+ *  DRIFT_1553  Rate error against 1553 BM time [ppb]
+ *
+ * The last TIMEMON_WIN values of each metric are kept in a rolling window,
+ * min/max/percentiles are calculated on request. Missing pulses are detected
+ * from the period and counted, they do not disturb the offset.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <rtems.h>
+#include <gr1553bm.h>
+
+#include "timemon.h"
+#include "../mem_barrier.h"
+
+/* Number of samples that can be buffered between two timemon_process() */
+#define TIMEMON_RING_CNT	32
+
+struct timemon_sample {
+	int src;
+	uint64_t local;		/* Local time [ns] */
+	uint64_t t1553;		/* 1553 BM time [BM units] */
+};
+
+struct timemon_src {
+	unsigned int nominal;	/* Nominal period [ns] */
+	unsigned int pulses;	/* Pulses received */
+	unsigned int missed;	/* Pulses detected missing */
+	uint64_t pulse_no;	/* Nominal periods since first pulse */
+	uint64_t first_local;
+	uint64_t first_1553;
+	uint64_t last_local;
+
+	/* Rolling windows, all metrics are added at the same time */
+	int pos;		/* Next position to write */
+	int cnt;		/* Number of valid entries */
+	uint64_t win_time[TIMEMON_WIN];	/* Local time of each entry */
+	int32_t win[TIMEMON_METRIC_CNT][TIMEMON_WIN];
+};
+
+struct timemon {
+	void *bm;
+	unsigned int bm_tick_ns;
+	volatile unsigned int head;	/* Written by ISR only */
+	volatile unsigned int tail;	/* Written by task only */
+	unsigned int overrun;		/* Samples dropped, ring full */
+	struct timemon_sample ring[TIMEMON_RING_CNT];
+	struct timemon_src srcs[TIMEMON_SRC_CNT];
+};
+struct timemon timemon;
+
+static char *timemon_src_names[TIMEMON_SRC_CNT] = {
+	"SPWCUC", "PULSE0", "PULSE1"
+};
+
+static char *timemon_metric_names[TIMEMON_METRIC_CNT] = {
+	"JITTER[ns]", "OFS_LOCAL[ns]", "OFS_1553[ns]",
+	"DRIFT_LOCAL[ppb]", "DRIFT_1553[ppb]"
+};
+
+static int32_t timemon_clamp(int64_t value)
+{
+	if ( value > 0x7fffffff )
+		return 0x7fffffff;
+	if ( value < -0x7fffffff )
+		return -0x7fffffff;
+	return value;
+}
+
+void timemon_init(void *bm, unsigned int bm_tick_ns)
+{
+	memset(&timemon, 0, sizeof(timemon));
+	timemon.bm = bm;
+	timemon.bm_tick_ns = bm_tick_ns;
+}
+
+void timemon_nominal(int src, unsigned int period_ns)
+{
+	if ( (src >= 0) && (src < TIMEMON_SRC_CNT) )
+		timemon.srcs[src].nominal = period_ns;
+}
+
+void timemon_sample(int src)
+{
+	struct timemon_sample *s;
+	struct timespec ts;
+	uint64_t t1553 = 0;
+	unsigned int head;
+	rtems_interrupt_level level;
+
+	rtems_clock_get_uptime(&ts);
+	if ( timemon.bm )
+		gr1553bm_time(timemon.bm, &t1553);
+
+	/* Interrupts of different time cores may nest */
+	rtems_interrupt_disable(level);
+	head = timemon.head;
+	if ( (head - timemon.tail) >= TIMEMON_RING_CNT ) {
+		timemon.overrun++;
+	} else {
+		s = &timemon.ring[head % TIMEMON_RING_CNT];
+		s->src = src;
+		s->local = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+		s->t1553 = t1553;
+		MEM_BARRIER();
+		timemon.head = head + 1;
+	}
+	rtems_interrupt_enable(level);
+}
+
+/* Calculate metrics of one pulse and add them to the windows */
+static void timemon_add(struct timemon_src *src, uint64_t local, uint64_t t1553)
+{
+	int64_t period, elapsed, ofs_local, ofs_1553;
+	unsigned int n;
+	int old;
+
+	src->pulses++;
+	if ( src->pulses == 1 ) {
+		/* First pulse is the reference of all offsets */
+		src->first_local = local;
+		src->first_1553 = t1553;
+		src->last_local = local;
+		return;
+	}
+
+	period = local - src->last_local;
+	src->last_local = local;
+	if ( src->nominal == 0 ) {
+		src->nominal = ((period + 500) / 1000) * 1000;
+		if ( src->nominal == 0 )
+			return;
+	}
+
+	/* Number of nominal periods since last pulse */
+	n = (period + src->nominal / 2) / src->nominal;
+	if ( n == 0 )
+		n = 1;
+	src->missed += n - 1;
+	src->pulse_no += n;
+
+	ofs_local = (int64_t)(local - src->first_local) -
+	            (int64_t)(src->pulse_no * src->nominal);
+	ofs_1553 = (int64_t)((t1553 - src->first_1553) * timemon.bm_tick_ns) -
+	           (int64_t)(src->pulse_no * src->nominal);
+
+	/* Drift is the offset slope from the oldest entry in the window,
+	 * calculated before the oldest entry is overwritten.
+	 */
+	if ( src->cnt == 0 ) {
+		src->win[TIMEMON_DRIFT_LOCAL][src->pos] = 0;
+		src->win[TIMEMON_DRIFT_1553][src->pos] = 0;
+	} else {
+		if ( src->cnt < TIMEMON_WIN )
+			old = 0;
+		else
+			old = src->pos;
+		elapsed = local - src->win_time[old];
+		src->win[TIMEMON_DRIFT_LOCAL][src->pos] = timemon_clamp(
+			(ofs_local - src->win[TIMEMON_OFS_LOCAL][old]) *
+			1000000000LL / elapsed);
+		src->win[TIMEMON_DRIFT_1553][src->pos] = timemon_clamp(
+			(ofs_1553 - src->win[TIMEMON_OFS_1553][old]) *
+			1000000000LL / elapsed);
+	}
+
+	src->win[TIMEMON_JITTER][src->pos] =
+		timemon_clamp(period - (int64_t)n * src->nominal);
+	src->win[TIMEMON_OFS_LOCAL][src->pos] = timemon_clamp(ofs_local);
+	src->win[TIMEMON_OFS_1553][src->pos] = timemon_clamp(ofs_1553);
+	src->win_time[src->pos] = local;
+
+	src->pos++;
+	if ( src->pos >= TIMEMON_WIN )
+		src->pos = 0;
+	if ( src->cnt < TIMEMON_WIN )
+		src->cnt++;
+}
+
+int timemon_process(void)
+{
+	struct timemon_sample *s;
+	unsigned int tail;
+	int cnt = 0;
+
+	tail = timemon.tail;
+	while ( tail != timemon.head ) {
+		MEM_BARRIER();
+		s = &timemon.ring[tail % TIMEMON_RING_CNT];
+		if ( (s->src >= 0) && (s->src < TIMEMON_SRC_CNT) )
+			timemon_add(&timemon.srcs[s->src], s->local, s->t1553);
+		tail++;
+		MEM_BARRIER();
+		timemon.tail = tail;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+int timemon_get_stats(int src, int metric, struct timemon_stats *stats)
+{
+	struct timemon_src *s;
+	int32_t sorted[TIMEMON_WIN], v;
+	int i, j, cnt;
+
+	if ( (src < 0) || (src >= TIMEMON_SRC_CNT) ||
+	     (metric < 0) || (metric >= TIMEMON_METRIC_CNT) )
+		return -1;
+	s = &timemon.srcs[src];
+
+	cnt = s->cnt;
+	stats->cnt = cnt;
+	if ( cnt == 0 ) {
+		stats->min = stats->max = 0;
+		stats->p50 = stats->p90 = stats->p99 = 0;
+		return 0;
+	}
+
+	/* Insertion sort, the window is small */
+	for (i=0; i<cnt; i++) {
+		v = s->win[metric][i];
+		for (j=i; (j > 0) && (sorted[j-1] > v); j--)
+			sorted[j] = sorted[j-1];
+		sorted[j] = v;
+	}
+
+	stats->min = sorted[0];
+	stats->max = sorted[cnt-1];
+	stats->p50 = sorted[((cnt - 1) * 50) / 100];
+	stats->p90 = sorted[((cnt - 1) * 90) / 100];
+	stats->p99 = sorted[((cnt - 1) * 99) / 100];
+
+	return 0;
+}
+
+int timemon_get_src_stats(int src, struct timemon_src_stats *stats)
+{
+	struct timemon_src *s;
+
+	if ( (src < 0) || (src >= TIMEMON_SRC_CNT) )
+		return -1;
+	s = &timemon.srcs[src];
+
+	stats->nominal = s->nominal;
+	stats->pulses = s->pulses;
+	stats->missed = s->missed;
+	stats->overrun = timemon.overrun;
+
+	return 0;
+}
+
+void timemon_print(void)
+{
+	struct timemon_src_stats src_stats;
+	struct timemon_stats stats;
+	int src, metric;
+
+	for (src=0; src<TIMEMON_SRC_CNT; src++) {
+		if ( timemon.srcs[src].cnt == 0 )
+			continue;
+		timemon_get_src_stats(src, &src_stats);
+		printf("TIMEMON %s: pulses %u, missed %u, nominal %u ns, overrun %u\n",
+			timemon_src_names[src], src_stats.pulses, src_stats.missed,
+			src_stats.nominal, src_stats.overrun);
+		printf("  %-17s %11s %11s %11s %11s %11s\n",
+			"", "MIN", "P50", "P90", "P99", "MAX");
+		for (metric=0; metric<TIMEMON_METRIC_CNT; metric++) {
+			if ( (timemon.bm == NULL) &&
+			     ((metric == TIMEMON_OFS_1553) ||
+			      (metric == TIMEMON_DRIFT_1553)) )
+				continue;
+			timemon_get_stats(src, metric, &stats);
+			printf("  %-17s %11d %11d %11d %11d %11d\n",
+				timemon_metric_names[metric], (int)stats.min,
+				(int)stats.p50, (int)stats.p90, (int)stats.p99,
+				(int)stats.max);
+		}
+	}
+}
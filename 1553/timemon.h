@@ -0,0 +1,70 @@
+/* Time synchronization quality monitor, see timemon.c */
+
+#ifndef __TIMEMON_H__
+#define __TIMEMON_H__
+
+#include <stdint.h>
+
+/* Time sources sampled from interrupt handlers */
+#define TIMEMON_SRC_SPWCUC	0	/* SPWCUC TimeCode tick (TX or RX) */
+#define TIMEMON_SRC_PULSE0	1	/* GRCTM Pulse 0 */
+#define TIMEMON_SRC_PULSE1	2	/* GRCTM Pulse 1 */
+#define TIMEMON_SRC_CNT		3
+
+/* Metrics, one rolling window each per source */
+#define TIMEMON_JITTER		0	/* Period - nominal period [ns] */
+#define TIMEMON_OFS_LOCAL	1	/* Pulse phase against local time [ns] */
+#define TIMEMON_OFS_1553	2	/* Pulse phase against 1553 BM time [ns] */
+#define TIMEMON_DRIFT_LOCAL	3	/* Rate error against local time [ppb] */
+#define TIMEMON_DRIFT_1553	4	/* Rate error against 1553 BM time [ppb] */
+#define TIMEMON_METRIC_CNT	5
+
+/* Number of samples in each rolling window */
+#define TIMEMON_WIN		64
+
+struct timemon_stats {
+	int cnt;		/* Number of samples in window */
+	int32_t min;
+	int32_t max;
+	int32_t p50;
+	int32_t p90;
+	int32_t p99;
+};
+
+/* Pulse counters of one source */
+struct timemon_src_stats {
+	unsigned int nominal;	/* Nominal period [ns], 0 until known */
+	unsigned int pulses;	/* Pulses received */
+	unsigned int missed;	/* Pulses detected missing */
+	unsigned int overrun;	/* Samples of all sources dropped, ring full */
+};
+
+/* Set up monitor. bm is the GR1553B BM device used as second time
+ * reference, it may be NULL. bm_tick_ns is the length of one BM time unit,
+ * 1000 with the highest BM time resolution.
+ */
+void timemon_init(void *bm, unsigned int bm_tick_ns);
+
+/* Set nominal pulse period of a source. If not set the first measured
+ * period, rounded to whole microseconds, is used.
+ */
+void timemon_nominal(int src, unsigned int period_ns);
+
+/* Called from interrupt handlers. Timestamps one pulse/tick. */
+void timemon_sample(int src);
+
+/* Called from task context. Moves samples taken by the interrupt handlers
+ * into the rolling windows. Returns number of samples processed.
+ */
+int timemon_process(void);
+
+/* Get window statistics of one source and metric. Returns 0 on success. */
+int timemon_get_stats(int src, int metric, struct timemon_stats *stats);
+
+/* Get pulse counters of one source. Returns 0 on success. */
+int timemon_get_src_stats(int src, struct timemon_src_stats *stats);
+
+/* Print statistics of all sources that have samples */
+void timemon_print(void);
+
+#endif
@@ -0,0 +1,162 @@
+
+#ifndef __BM_RING_H__
+#define __BM_RING_H__
+
+/* Ring of compressed 1553 BM log words
+ *
+ * The word format is the compressed BM log of 1553/bm_logger.c, written
+ * by brm_lib.c for B1553BRM boards and by the 1553/bmon.c back ends:
+ *   0b10 + 30-bit time       Long time, time bits 42..13
+ *   0b110 + 29-bit error     Error word
+ *   0b111 + 29-bit control   Control word, code in bits 28..24 and a
+ *                            24-bit value
+ *   0b0 + 13-bit time + bus + word type + 16-bit data
+ *
+ * Error codes 1..3 are the GR1553B BM word error bits, BM_RING_ERR_MSG is
+ * a B1553BRM message error. A long time word is written before an entry
+ * whenever the 13-bit time has wrapped since the last one.
+ *
+ * The ring has one producer and one consumer, the producer only moves head
+ * and the consumer only moves tail. Producers that can not wait drop
+ * entries when the ring is full, a LOST control word is written as soon as
+ * there is room again. Portable, also used on Linux.
+ */
+
+#include <stdint.h>
+#include "mem_barrier.h"
+
+#define BM_RING_CTRL_START	0	/* Logging started */
+#define BM_RING_CTRL_LOST	1	/* Value is number of lost entries */
+
+#define BM_RING_ERR_MSG		4	/* Error code, B1553BRM message error */
+
+struct bm_ring {
+	unsigned int *base;
+	unsigned int * volatile head;	/* Moved by producer only */
+	unsigned int * volatile tail;	/* Moved by consumer only */
+	unsigned int *end;
+	uint64_t lltime;		/* Last long time written */
+	int lltime_valid;
+	unsigned int lost;		/* Lost since last LOST control word */
+
+	/* Statistics, updated by the producer */
+	unsigned int words;		/* Words written */
+	unsigned int entries;		/* Bus word entries written */
+	unsigned int errors;		/* Error words written */
+	unsigned int lost_tot;		/* Bus word entries lost, ring full */
+};
+
+/* Set up ring in user buffer of cnt words */
+static inline void bm_ring_init(struct bm_ring *ring, unsigned int *buf, int cnt)
+{
+	ring->base = buf;
+	ring->head = buf;
+	ring->tail = buf;
+	ring->end = buf + cnt;
+	ring->lltime_valid = 0;
+	ring->lost = 0;
+	ring->words = ring->entries = ring->errors = ring->lost_tot = 0;
+}
+
+/* Free words in ring, one word is always left unused */
+static inline int bm_ring_space(struct bm_ring *ring)
+{
+	int used = ring->head - ring->tail;
+
+	if ( used < 0 )
+		used += ring->end - ring->base;
+	return (ring->end - ring->base) - used - 1;
+}
+
+/* Add words, the caller has checked that there is room */
+static inline void bm_ring_add(struct bm_ring *ring, unsigned int *words, int cnt)
+{
+	unsigned int *head = ring->head;
+	int i;
+
+	for (i=0; i<cnt; i++) {
+		if ( (words[i] & 0x80000000) == 0 )
+			ring->entries++;
+		else if ( (words[i] & 0xe0000000) == 0xc0000000 )
+			ring->errors++;
+		*head = words[i];
+		head++;
+		if ( head >= ring->end )
+			head = ring->base;
+	}
+	MEM_BARRIER();
+	ring->head = head;
+	ring->words += cnt;
+}
+
+/* Take up to max words from ring, returns number of words taken */
+static inline int bm_ring_take(struct bm_ring *ring, unsigned int *words, int max)
+{
+	unsigned int *tail = ring->tail;
+	unsigned int *head = ring->head;
+	int i;
+
+	MEM_BARRIER();
+	for (i=0; i<max; i++) {
+		if ( tail == head )
+			break;
+		words[i] = *tail;
+		tail++;
+		if ( tail >= ring->end )
+			tail = ring->base;
+	}
+	MEM_BARRIER();
+	ring->tail = tail;
+
+	return i;
+}
+
+/* Long time word for 'time' into words[0] if the 13-bit time has wrapped
+ * since the last entry. Returns the number of words written, 0 or 1.
+ */
+static inline int bm_ring_time(struct bm_ring *ring, uint64_t time, unsigned int *words)
+{
+	if ( ring->lltime_valid && ((time & ~0x1fffULL) == ring->lltime) )
+		return 0;
+	ring->lltime = time & ~0x1fffULL;
+	ring->lltime_valid = 1;
+	words[0] = 0x80000000 | ((time >> 13) & 0x3fffffff);
+	return 1;
+}
+
+/* Control word, dropped silently if the ring is full */
+static inline void bm_ring_ctrl(struct bm_ring *ring, int code, unsigned int value)
+{
+	unsigned int word;
+
+	if ( bm_ring_space(ring) < 1 )
+		return;
+	word = 0xe0000000 | ((code & 0x1f) << 24) | (value & 0x00ffffff);
+	bm_ring_add(ring, &word, 1);
+}
+
+/* Check room for cnt words for a producer that drops entries. Lost entries
+ * are reported first, the long time is then written again. Returns
+ * non-zero if there is room, otherwise the caller must drop the entries
+ * with bm_ring_drop().
+ */
+static inline int bm_ring_room(struct bm_ring *ring, int cnt)
+{
+	if ( ring->lost > 0 ) {
+		if ( bm_ring_space(ring) < cnt + 1 )
+			return 0;
+		bm_ring_ctrl(ring, BM_RING_CTRL_LOST, ring->lost);
+		ring->lost = 0;
+		ring->lltime_valid = 0;
+	}
+
+	return bm_ring_space(ring) >= cnt;
+}
+
+static inline void bm_ring_drop(struct bm_ring *ring, int entries)
+{
+	ring->lost += entries;
+	ring->lost_tot += entries;
+}
+
+#endif
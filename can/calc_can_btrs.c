@@ -1,6 +1,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "can_timing.h"
 
 #define OCCAN_SPEED_1000K 1000000
 #define OCCAN_SPEED_800K  800000
@@ -12,326 +15,204 @@
 #define OCCAN_SPEED_25K   25000
 #define OCCAN_SPEED_10K   10000
 
-
-/*  register bit definitions */
-#define OCCAN_BUSTIM_SJW       0xc0
-#define OCCAN_BUSTIM_BRP       0x3f
-#define OCCAN_BUSTIM_SJW_BIT   6
-
-#define OCCAN_BUSTIM_SAM       0x80
-#define OCCAN_BUSTIM_TSEG2     0x70
-#define OCCAN_BUSTIM_TSEG2_BIT 4
-#define OCCAN_BUSTIM_TSEG1     0x0f
-
-#define MAX_TSEG1 15
-#define MAX_TSEG2 7
-
-typedef struct {
-	unsigned char btr0;
-	unsigned char btr1;
-} occan_speed_regs;
-
-struct grcan_timing {
-	unsigned char scaler;
-	unsigned char ps1;
-	unsigned char ps2;
-	unsigned int  rsj;
-	unsigned char bpr;
+unsigned int steplist[] = 
+{
+  OCCAN_SPEED_1000K,
+  OCCAN_SPEED_800K,
+  OCCAN_SPEED_500K,
+  OCCAN_SPEED_250K,
+  OCCAN_SPEED_125K,
+  OCCAN_SPEED_75K,
+  OCCAN_SPEED_50K,
+  OCCAN_SPEED_25K,
+  OCCAN_SPEED_10K,
+  0
 };
 
-/* This function calculates BTR0 BTR1 values for a given bitrate.
- * Heavily based on mgt_mscan_bitrate() from peak driver, which 
- * in turn is based on work by Arnaud Westenberg.
- *
- * Set communication parameters.
- * baud rate in Hz
- * input clock frequency of can core in Hz (system frequency)
- * sjw synchronization jump width (0-3) prescaled clock cycles
- * sampl_pt sample point in % (0-100) sets (TSEG1+2)/(TSEG1+TSEG2+3)
- *                                                               ratio
+/* Deployed CAN core frequencies, bitrates and sample points. All
+ * combinations are precomputed into can_timing_table.h (-t) and audited (-a).
  */
-int occan_calc_speedregs(unsigned int clock_hz, unsigned int rate, occan_speed_regs *result){
-	int best_error = 1000000000;
-	int error;
-	int best_tseg=0, best_brp=0, best_rate=0, brp=0;
-	int tseg=0, tseg1=0, tseg2=0;
-	int sjw = 0;
-	int clock = clock_hz / 2;
-	int sampl_pt = 80;
-
-	if ( (rate<5000) || (rate>1000000) ){
-		/* invalid speed mode */
-		return -1;
-	}
-	
-	/* find best match, return -2 if no good reg 
-	 * combination is available for this frequency */
-
-	/* some heuristic specials */
-	if (rate > ((1000000 + 500000) / 2))
-		sampl_pt = 75;
+unsigned int deploy_clocks[] = {
+  30000000,
+  40000000,
+  50000000,
+  60000000,
+  80000000,
+  0
+};
 
-	if (rate < ((12500 + 10000) / 2))
-		sampl_pt = 75;
+unsigned int deploy_rates[] = {
+  OCCAN_SPEED_1000K,
+  OCCAN_SPEED_500K,
+  OCCAN_SPEED_250K,
+  OCCAN_SPEED_125K,
+  OCCAN_SPEED_50K,
+  OCCAN_SPEED_25K,
+  0
+};
 
-	if (rate < ((100000 + 125000) / 2))
-		sjw = 1;
+unsigned int deploy_sampl_pts[] = {75, 80, 87, 0};
 
-	/* tseg even = round down, odd = round up */
-	for (tseg = (0 + 0 + 2) * 2;
-	     tseg <= (MAX_TSEG2 + MAX_TSEG1 + 2) * 2 + 1;
-	     tseg++)
-	{
-		brp = clock / ((1 + tseg / 2) * rate) + tseg % 2;
-		if ((brp == 0) || (brp > 64))
-			continue;
+/* Sample point and SJW heuristics of the previous solver, used when no
+ * sample point is given.
+ */
+void default_params(unsigned int rate, unsigned int *sampl_pt, unsigned int *sjw)
+{
+  *sampl_pt = 80;
+  *sjw = 1;
+  if ( (rate > ((1000000 + 500000) / 2)) || (rate < ((12500 + 10000) / 2)) )
+    *sampl_pt = 75;
+  if ( rate < ((100000 + 125000) / 2) )
+    *sjw = 2;
+}
 
-		error = rate - clock / (brp * (1 + tseg / 2));
-		if (error < 0)
-		{
-			error = -error;
-		}
+/* Default SJW for table entries */
+unsigned int table_sjw(unsigned int rate)
+{
+  unsigned int sampl_pt, sjw;
 
-		if (error <= best_error)
-		{
-			best_error = error;
-			best_tseg = tseg/2;
-			best_brp = brp-1;
-			best_rate = clock/(brp*(1+tseg/2));
-		}
-	}
+  default_params(rate, &sampl_pt, &sjw);
+  return sjw;
+}
 
-	if (best_error && (rate / best_error < 10))
-	{
-		return -2;
-	}else if ( !result )
-		return 0; /* nothing to store result in, but a valid bitrate can be calculated */
+void print_result(struct can_timing_result *res)
+{
+  printf("Baud:   %u\n", res->rate);
+  printf("Err:    %d ppm\n", res->err_ppm);
+  printf("Sampl:  %u.%u%% (%u tq/bit, tseg1 %u, tseg2 %u, sjw %u)\n",
+    res->sampl_pt/10, res->sampl_pt%10, res->nbt, res->tseg1, res->tseg2, res->sjw);
+  printf("OscTol: %u ppm\n", res->osc_tol_ppm);
+}
 
-	tseg2 = best_tseg - (sampl_pt * (best_tseg + 1)) / 100;
+void print_timing(struct can_timing_result *res)
+{
+  printf("BTR0: 0x%x\n", res->btr0);
+  printf("BTR1: 0x%x\n", res->btr1);
+  print_result(res);
+}
 
-	if (tseg2 < 0)
-	{
-		tseg2 = 0;
-	}
+void print_grtiming(struct can_timing_result *res)
+{
+  printf("SCALER: 0x%x\n", res->scaler);
+  printf("PS1:    0x%x\n", res->ps1);
+  printf("PS2:    0x%x\n", res->ps2);
+  printf("RSJ:    0x%x\n", res->rsj);
+  printf("BPR:    0x%x\n", res->bpr);
+  print_result(res);
+}
 
-	if (tseg2 > MAX_TSEG2)
-	{
-		tseg2 = MAX_TSEG2;
-	}
+typedef int (*solve_func_t)(unsigned int, unsigned int, unsigned int,
+  unsigned int, struct can_timing_result *);
 
-	tseg1 = best_tseg - tseg2 - 2;
+/* A configuration fails the audit when the bitrate error alone uses more
+ * than half of the oscillator tolerance the bit timing allows.
+ */
+int audit_fail(struct can_timing_result *res)
+{
+  int err = (res->err_ppm < 0) ? -res->err_ppm : res->err_ppm;
 
-	if (tseg1 > MAX_TSEG1)
-	{
-		tseg1 = MAX_TSEG1;
-		tseg2 = best_tseg - tseg1 - 2;
-	}
-/*
-	result->sjw = sjw;
-	result->brp = best_brp;
-	result->tseg1 = tseg1;
-	result->tseg2 = tseg2;
-*/
-	result->btr0 = (sjw<<OCCAN_BUSTIM_SJW_BIT) | (best_brp&OCCAN_BUSTIM_BRP);
-	result->btr1 = (0<<7) | (tseg2<<OCCAN_BUSTIM_TSEG2_BIT) | tseg1;
-	
-	return 0;
+  return (2 * err) > res->osc_tol_ppm;
 }
 
-#undef MIN_TSEG1
-#undef MIN_TSEG2
-#undef MAX_TSEG1
-#undef MAX_TSEG2
-
-#define MIN_TSEG1 1
-#define MIN_TSEG2 2
-#define MAX_TSEG1 14
-#define MAX_TSEG2 8
-
-int grcan_calc_timing(
-  unsigned int baud,          /* The requested BAUD to calculate timing for */
-  unsigned int core_hz,       /* Frequency in Hz of GRCAN Core */
-  unsigned int sampl_pt,
-  struct grcan_timing *timing /* result is placed here */
-  )
+/* Print a C table of all deployed configurations */
+void print_table(char *name, solve_func_t solve)
 {
-	int best_error = 1000000000;
-	int error;
-	int best_tseg=0, best_brp=0, best_rate=0, brp=0;
-	int tseg=0, tseg1=0, tseg2=0;
-	int sjw = 1;
-  
-  /* Default to 90% */
-  if ( (sampl_pt < 50) || (sampl_pt>99) ){
-    sampl_pt = 90;
+  struct can_timing_result r;
+  int c, s, i;
+
+  printf("static const struct can_timing_entry %s[] = {\n", name);
+  for (c=0; deploy_clocks[c]; c++) {
+    for (s=0; deploy_sampl_pts[s]; s++) {
+      for (i=0; deploy_rates[i]; i++) {
+        if ( solve(deploy_clocks[c], deploy_rates[i], deploy_sampl_pts[s],
+                   table_sjw(deploy_rates[i]), &r) )
+          continue;
+        printf("  {%u, %u, %u, {%u, %d, %u, %u, %u, %u, %u, %u, "
+               "0x%02x, 0x%02x, %u, %u, %u, %u, %u}},%s\n",
+          deploy_clocks[c], deploy_rates[i], deploy_sampl_pts[s],
+          r.rate, r.err_ppm, r.sampl_pt, r.osc_tol_ppm, r.nbt,
+          r.tseg1, r.tseg2, r.sjw, r.btr0, r.btr1,
+          r.scaler, r.ps1, r.ps2, r.rsj, r.bpr,
+          audit_fail(&r) ? " /* AUDIT: margin */" : "");
+      }
+    }
   }
+  printf("  {0}\n};\n\n");
+}
 
-	if ( (baud<5000) || (baud>1000000) ){
-		/* invalid speed mode */
-		return -1;
-	}
-	
-	/* find best match, return -2 if no good reg 
-	 * combination is available for this frequency
-   */
-
-	/* some heuristic specials */
-	if (baud > ((1000000 + 500000) / 2))
-		sampl_pt = 75;
-
-	if (baud < ((12500 + 10000) / 2))
-		sampl_pt = 75;
-
-	/* tseg even = round down, odd = round up */
-	for (tseg = (MIN_TSEG1 + MIN_TSEG2 + 2) * 2;
-	     tseg <= (MAX_TSEG2 + MAX_TSEG1 + 2) * 2 + 1;
-	     tseg++)
-	{
-		brp = core_hz / ((1 + tseg / 2) * baud) + tseg % 2;
-		if ((brp <= 0) || 
-        ( (brp > 256*1) && (brp <= 256*2) && (brp&0x1) ) ||
-        ( (brp > 256*2) && (brp <= 256*4) && (brp&0x3) ) ||
-        ( (brp > 256*4) && (brp <= 256*8) && (brp&0x7) ) ||
-        (brp > 256*8)
-        )
-			continue;
-
-		error = baud - core_hz / (brp * (1 + tseg / 2));
-		if (error < 0)
-		{
-			error = -error;
-		}
-
-		if (error <= best_error)
-		{
-			best_error = error;
-			best_tseg = tseg/2;
-			best_brp = brp-1;
-			best_rate = core_hz/(brp*(1+tseg/2));
-		}
-	}
-
-	if (best_error && (baud / best_error < 10))
-	{
-		return -2;
-	}else if ( !timing )
-		return 0; /* nothing to store result in, but a valid bitrate can be calculated */
-
-	tseg2 = best_tseg - (sampl_pt * (best_tseg + 1)) / 100;
-
-	if (tseg2 < MIN_TSEG2)
-	{
-		tseg2 = MIN_TSEG2;
-	}
-
-	if (tseg2 > MAX_TSEG2)
-	{
-		tseg2 = MAX_TSEG2;
-	}
+int gen_table(void)
+{
+  printf("/* CAN bit timing table, generated by \"calc_can_btrs -t\". Do not edit,\n");
+  printf(" * add clocks/sample points to calc_can_btrs.c and regenerate.\n");
+  printf(" *\n");
+  printf(" * Fields: clock_hz, rate, sampl_pt, {rate, err_ppm, sampl_pt[0.1%%],\n");
+  printf(" *   osc_tol_ppm, nbt, tseg1, tseg2, sjw, btr0, btr1, scaler, ps1, ps2,\n");
+  printf(" *   rsj, bpr}\n");
+  printf(" */\n\n");
+  printf("#ifndef __CAN_TIMING_TABLE_H__\n#define __CAN_TIMING_TABLE_H__\n\n");
+  printf("#include \"can_timing.h\"\n\n");
+  print_table("occan_timing_table", occan_timing_solve);
+  print_table("grcan_timing_table", grcan_timing_solve);
+  printf("#endif\n");
 
-	tseg1 = best_tseg - tseg2 - 2;
+  return 0;
+}
 
-	if (tseg1 > MAX_TSEG1)
-	{
-		tseg1 = MAX_TSEG1;
-		tseg2 = best_tseg - tseg1 - 2;
-	}
-  
-  /* Get scaler and BRP from pseudo BRP */
-  if ( best_brp <= 256 ){
-    timing->scaler = best_brp;
-    timing->bpr = 0;
-  }else if ( best_brp <= 256*2 ){
-    timing->scaler = ((best_brp+1)>>1) -1;
-    timing->bpr = 1;
-  }else if ( best_brp <= 256*4 ){
-    timing->scaler = ((best_brp+1)>>2) -1;
-    timing->bpr = 2;
-  }else{
-    timing->scaler = ((best_brp+1)>>3) -1;
-    timing->bpr = 3;
+/* Audit all deployed configurations, returns number of failures */
+int audit_core(char *core, solve_func_t solve)
+{
+  struct can_timing_result r;
+  int c, s, i, fails = 0;
+
+  for (c=0; deploy_clocks[c]; c++) {
+    for (s=0; deploy_sampl_pts[s]; s++) {
+      for (i=0; deploy_rates[i]; i++) {
+        if ( solve(deploy_clocks[c], deploy_rates[i], deploy_sampl_pts[s],
+                   table_sjw(deploy_rates[i]), &r) ) {
+          printf("%-6s %9u %8u %3u%%  no timing\n",
+            core, deploy_clocks[c], deploy_rates[i], deploy_sampl_pts[s]);
+          fails++;
+          continue;
+        }
+        printf("%-6s %9u %8u %3u%% %8d %3u.%u%% %3u %7u%s\n",
+          core, deploy_clocks[c], deploy_rates[i], deploy_sampl_pts[s],
+          r.err_ppm, r.sampl_pt/10, r.sampl_pt%10, r.nbt, r.osc_tol_ppm,
+          audit_fail(&r) ? "  FAIL" : "");
+        fails += audit_fail(&r);
+      }
+    }
   }
-  
-	timing->ps1    = tseg1+1;
-	timing->ps2    = tseg2;
-	timing->rsj    = sjw;
 
-	return 0;
+  return fails;
 }
 
-unsigned int steplist[] = 
+int audit(void)
 {
-  OCCAN_SPEED_1000K,
-  OCCAN_SPEED_800K,
-  OCCAN_SPEED_500K,
-  OCCAN_SPEED_250K,
-  OCCAN_SPEED_125K,
-  OCCAN_SPEED_75K,
-  OCCAN_SPEED_50K,
-  OCCAN_SPEED_25K,
-  OCCAN_SPEED_10K,
-  0
-};
+  int fails;
 
-void print_timing(unsigned int corefreq, unsigned int rate, occan_speed_regs *timing)
-{
-  unsigned int baud;
-  unsigned int sjw, brp, tseg1, tseg2;
-  double err;
-  
-  printf("BTR0: 0x%x\n",timing->btr0);
-  printf("BTR1: 0x%x\n",timing->btr1);
-  
-  
-  tseg1 = timing->btr1 & OCCAN_BUSTIM_TSEG1;
-  tseg2 = (timing->btr1>>OCCAN_BUSTIM_TSEG2_BIT) & 0x7;
-  brp   = timing->btr0 & OCCAN_BUSTIM_BRP;
-  sjw   = timing->btr0 >> OCCAN_BUSTIM_SJW_BIT;
-  printf("tseg1: %d, tseg2: %d, brp: %d, sjw: %d\n",tseg1,tseg2,brp,sjw);
-  
-  baud = corefreq / 2;
-  baud = baud / (brp+1);
-  baud = baud / (3+tseg1+tseg2);
-  
-  printf("Baud:   %d\n",baud);
-  printf("Sampl:  %d%%\n",(100*(1+tseg1))/(1+tseg1+tseg2));
-  err = baud;
-  err = err/rate;
-  err = err*100-100; /* to % */
-  printf("Err:    %f%%\n",err);
-}
-
-/* 60000000/(scaler+1)/(2^bpr)/(ps1+ps2+2) */
+  printf("%-6s %9s %8s %4s %8s %7s %3s %7s\n",
+    "CORE", "CLOCK", "RATE", "SP", "ERR[ppm]", "SP", "NBT", "TOL[ppm]");
+  fails = audit_core("OCCAN", occan_timing_solve);
+  fails += audit_core("GRCAN", grcan_timing_solve);
+  printf("%d configurations fail the margin audit\n", fails);
 
-void print_grtiming(unsigned int corefreq, unsigned int rate, struct grcan_timing *timing)
-{
-  unsigned int baud;
-  double err;
-  printf("SCALER: 0x%x\n",timing->scaler);
-  printf("PS1:    0x%x\n",timing->ps1);
-  printf("PS2:    0x%x\n",timing->ps2);
-  printf("RSJ:    0x%x\n",timing->rsj);
-  printf("BPR:    0x%x\n",timing->bpr);
-  
-  baud = corefreq/(timing->scaler+1);
-  baud = baud/(1<<timing->bpr);
-  baud = baud/(2+timing->ps1+timing->ps2);
-  printf("Baud:   %d\n",baud);
-  printf("Sampl:  %d%%\n",(100*(1+timing->ps1))/(2+timing->ps1+timing->ps2));
-  err = baud;
-  err = err/rate;
-  err = err*100-100; /* to % */
-  printf("Err:    %f%%\n",err);
+  return fails ? 1 : 0;
 }
 
 int main(int argc, char *argv[]){
-  unsigned int clock_hz=40000000;
+  unsigned int clock_hz=40000000, sampl_pt, sjw;
   int i,ret;
-  occan_speed_regs timing;
-  struct grcan_timing grtiming;
+  struct can_timing_result res;
   
+  if ( (argc == 2) && (strcmp(argv[1], "-t") == 0) )
+    return gen_table();
+  if ( (argc == 2) && (strcmp(argv[1], "-a") == 0) )
+    return audit();
+
   if ( argc > 2 ){
-    printf("usage: %s [can_core_clock_in_Hz]\n",argv[0]);
+    printf("usage: %s [-t | -a | can_core_clock_in_Hz]\n",argv[0]);
+    printf("  -t  print C table of deployed configurations\n");
+    printf("  -a  audit bitrate error and margins of deployed configurations\n");
     return 0;
   }
   if ( argc == 2 ){
@@ -343,10 +224,11 @@ int main(int argc, char *argv[]){
   printf("\n");
   i=0;
   while( steplist[i] != 0 ){
-    ret = occan_calc_speedregs(clock_hz,steplist[i],&timing);
+    default_params(steplist[i], &sampl_pt, &sjw);
+    ret = occan_timing_solve(clock_hz,steplist[i],sampl_pt,sjw,&res);
     if ( !ret ){
       printf("---------- %d bits/s ----------\n",steplist[i]);
-      print_timing(clock_hz,steplist[i],&timing);
+      print_timing(&res);
     }else{
       printf("Error getting OCCAN Baud rate for %d @ %dkHz\n",steplist[i],clock_hz/1000);
     }
@@ -359,10 +241,11 @@ int main(int argc, char *argv[]){
   
   i=0;
   while( steplist[i] != 0 ){
-    ret = grcan_calc_timing(steplist[i],clock_hz,80,&grtiming);
+    default_params(steplist[i], &sampl_pt, &sjw);
+    ret = grcan_timing_solve(clock_hz,steplist[i],sampl_pt,1,&res);
     if ( !ret ){
       printf("---------- %d bits/s ----------\n",steplist[i]);
-      print_grtiming(clock_hz,steplist[i],&grtiming);
+      print_grtiming(&res);
     }else{
       printf("Error getting GRCAN Baud rate for %d @ %dkHz\n",steplist[i],clock_hz/1000);
     }
@@ -0,0 +1,280 @@
+/* CAN bit timing solver for OC-CAN (SJA1000 compatible) and GRCAN
+ *
+ * Header only, used by the Linux tool calc_can_btrs and by target code.
+ * The solver searches the prescaler/time quanta combination closest to the
+ * requested bitrate. Among equally close combinations the one that gets
+ * closest to the requested sample point wins, then the one with the most
+ * time quanta per bit.
+ * Besides the register values it reports the real bitrate, the bitrate
+ * error and the oscillator tolerance allowed by the phase segments and
+ * SJW (CAN 2.0 conditions):
+ *
+ *   df <= min(PS1,PS2) / (2 * (13*NBT - PS2))
+ *   df <= SJW / (20 * NBT)
+ *
+ * Neither core has a separate propagation segment, TSEG1 is counted as
+ * PS1, so the tolerance is an upper bound when the bus needs a propagation
+ * delay compensation.
+ *
+ * Deployed configurations are precomputed by "calc_can_btrs -t" into
+ * can_timing_table.h, so that a re-init is a table lookup.
+ */
+
+#ifndef __CAN_TIMING_H__
+#define __CAN_TIMING_H__
+
+struct can_timing_result {
+	unsigned int rate;		/* Resulting bitrate [bit/s] */
+	int err_ppm;			/* Bitrate error [ppm] */
+	unsigned short sampl_pt;	/* Resulting sample point [0.1%] */
+	unsigned short osc_tol_ppm;	/* Allowed oscillator tolerance [ppm] */
+	unsigned short nbt;		/* Time quanta per bit */
+	unsigned char tseg1;		/* Time quanta before sample point, excl. SYNC */
+	unsigned char tseg2;		/* Time quanta after sample point */
+	unsigned char sjw;		/* Synchronization jump width [tq] */
+
+	/* OC-CAN registers */
+	unsigned char btr0;
+	unsigned char btr1;
+
+	/* GRCAN registers */
+	unsigned char scaler;
+	unsigned char ps1;
+	unsigned char ps2;
+	unsigned char rsj;
+	unsigned char bpr;
+};
+
+/* Fill in rate, error, sample point and tolerance from the segments */
+static inline void can_timing_eval(
+	unsigned int tq_hz,
+	unsigned int rate,
+	struct can_timing_result *res)
+{
+	unsigned int nbt = 1 + res->tseg1 + res->tseg2;
+	unsigned int ps, tol1, tol2;
+
+	res->nbt = nbt;
+	res->rate = tq_hz / nbt;
+	res->err_ppm = (int)(((long long)res->rate - rate) * 1000000 / rate);
+	res->sampl_pt = (1000 * (1 + res->tseg1)) / nbt;
+
+	ps = (res->tseg1 < res->tseg2) ? res->tseg1 : res->tseg2;
+	tol1 = (1000000ULL * ps) / (2 * (13 * nbt - res->tseg2));
+	tol2 = (1000000ULL * res->sjw) / (20 * nbt);
+	res->osc_tol_ppm = (tol1 < tol2) ? tol1 : tol2;
+}
+
+/* Split 'tseg' time quanta (excl. SYNC) at sample point [%] */
+static inline void can_timing_split(
+	int tseg,
+	unsigned int sampl_pt,
+	int min_tseg2,
+	int max_tseg1,
+	int max_tseg2,
+	int *tseg1,
+	int *tseg2)
+{
+	*tseg2 = (tseg + 1) - (sampl_pt * (tseg + 1)) / 100;
+	if ( *tseg2 < min_tseg2 )
+		*tseg2 = min_tseg2;
+	if ( *tseg2 > max_tseg2 )
+		*tseg2 = max_tseg2;
+	*tseg1 = tseg - *tseg2;
+	if ( *tseg1 > max_tseg1 ) {
+		*tseg1 = max_tseg1;
+		*tseg2 = tseg - *tseg1;
+	}
+}
+
+/* Deviation [0.1%] from requested sample point when 'tseg' time quanta
+ * (excl. SYNC) are split by can_timing_split().
+ */
+static inline int can_timing_sp_dev(
+	int tseg,
+	unsigned int sampl_pt,
+	int min_tseg2,
+	int max_tseg1,
+	int max_tseg2)
+{
+	int tseg1, tseg2, dev;
+
+	can_timing_split(tseg, sampl_pt, min_tseg2, max_tseg1, max_tseg2,
+		&tseg1, &tseg2);
+	dev = (1000 * (1 + tseg1)) / (tseg + 1) - 10 * (int)sampl_pt;
+
+	return (dev < 0) ? -dev : dev;
+}
+
+#define OCCAN_TIMING_MAX_TSEG1	16	/* TSEG1 register + 1 */
+#define OCCAN_TIMING_MAX_TSEG2	8	/* TSEG2 register + 1 */
+
+/* OC-CAN: bit time = (clock/2)/(BRP+1) * (3 + TSEG1 + TSEG2)
+ *
+ * sampl_pt  Sample point in percent
+ * sjw       Synchronization jump width in time quanta, 1..4
+ *
+ * Returns 0 on success, -1 on invalid rate, -2 if no combination is within
+ * 10% of the requested rate.
+ */
+static inline int occan_timing_solve(
+	unsigned int clock_hz,
+	unsigned int rate,
+	unsigned int sampl_pt,
+	unsigned int sjw,
+	struct can_timing_result *res)
+{
+	unsigned int clock = clock_hz / 2;
+	int best_error = 1000000000, best_dev = 0, best_tseg = 0, best_brp = 0;
+	int tseg, brp, error, dev, tseg1, tseg2;
+
+	if ( (rate < 5000) || (rate > 1000000) || (sjw < 1) || (sjw > 4) )
+		return -1;
+
+	/* tseg is 2*(time quanta per bit - 1), even = round down,
+	 * odd = round up the prescaler
+	 */
+	for (tseg = (1 + 1) * 2;
+	     tseg <= (OCCAN_TIMING_MAX_TSEG1 + OCCAN_TIMING_MAX_TSEG2) * 2 + 1;
+	     tseg++) {
+		brp = clock / ((1 + tseg / 2) * rate) + tseg % 2;
+		if ( (brp == 0) || (brp > 64) )
+			continue;
+		error = rate - clock / (brp * (1 + tseg / 2));
+		if ( error < 0 )
+			error = -error;
+		if ( error > best_error )
+			continue;
+		/* Same error: closest sample point, then most time quanta */
+		dev = can_timing_sp_dev(tseg / 2, sampl_pt, 1,
+			OCCAN_TIMING_MAX_TSEG1, OCCAN_TIMING_MAX_TSEG2);
+		if ( (error < best_error) || (dev <= best_dev) ) {
+			best_error = error;
+			best_dev = dev;
+			best_tseg = tseg / 2;
+			best_brp = brp;
+		}
+	}
+	if ( best_error && (rate / best_error < 10) )
+		return -2;
+
+	can_timing_split(best_tseg, sampl_pt, 1, OCCAN_TIMING_MAX_TSEG1,
+		OCCAN_TIMING_MAX_TSEG2, &tseg1, &tseg2);
+	if ( sjw > (unsigned int)tseg2 )
+		sjw = tseg2;
+
+	res->tseg1 = tseg1;
+	res->tseg2 = tseg2;
+	res->sjw = sjw;
+	res->btr0 = ((sjw - 1) << 6) | ((best_brp - 1) & 0x3f);
+	res->btr1 = ((tseg2 - 1) << 4) | (tseg1 - 1);
+	res->scaler = res->ps1 = res->ps2 = res->rsj = res->bpr = 0;
+	can_timing_eval(clock / best_brp, rate, res);
+
+	return 0;
+}
+
+#define GRCAN_TIMING_MIN_TSEG1	2	/* PS1 + 1 */
+#define GRCAN_TIMING_MAX_TSEG1	16
+#define GRCAN_TIMING_MIN_TSEG2	2	/* PS2 */
+#define GRCAN_TIMING_MAX_TSEG2	8
+
+/* GRCAN: bit time = clock/(SCALER+1)/2^BPR * (2 + PS1 + PS2)
+ *
+ * Same arguments and return values as occan_timing_solve().
+ */
+static inline int grcan_timing_solve(
+	unsigned int clock_hz,
+	unsigned int rate,
+	unsigned int sampl_pt,
+	unsigned int sjw,
+	struct can_timing_result *res)
+{
+	int best_error = 1000000000, best_dev = 0, best_tseg = 0, best_brp = 0;
+	int tseg, brp, error, dev, tseg1, tseg2;
+
+	if ( (rate < 5000) || (rate > 1000000) || (sjw < 1) || (sjw > 4) )
+		return -1;
+
+	for (tseg = (GRCAN_TIMING_MIN_TSEG1 + GRCAN_TIMING_MIN_TSEG2) * 2;
+	     tseg <= (GRCAN_TIMING_MAX_TSEG1 + GRCAN_TIMING_MAX_TSEG2) * 2 + 1;
+	     tseg++) {
+		brp = clock_hz / ((1 + tseg / 2) * rate) + tseg % 2;
+		/* Pseudo prescaler (SCALER+1)*2^BPR */
+		if ( (brp <= 0) ||
+		     ((brp > 256*1) && (brp <= 256*2) && (brp & 0x1)) ||
+		     ((brp > 256*2) && (brp <= 256*4) && (brp & 0x3)) ||
+		     ((brp > 256*4) && (brp <= 256*8) && (brp & 0x7)) ||
+		     (brp > 256*8) )
+			continue;
+		error = rate - clock_hz / (brp * (1 + tseg / 2));
+		if ( error < 0 )
+			error = -error;
+		if ( error > best_error )
+			continue;
+		dev = can_timing_sp_dev(tseg / 2, sampl_pt,
+			GRCAN_TIMING_MIN_TSEG2, GRCAN_TIMING_MAX_TSEG1,
+			GRCAN_TIMING_MAX_TSEG2);
+		if ( (error < best_error) || (dev <= best_dev) ) {
+			best_error = error;
+			best_dev = dev;
+			best_tseg = tseg / 2;
+			best_brp = brp;
+		}
+	}
+	if ( best_error && (rate / best_error < 10) )
+		return -2;
+
+	can_timing_split(best_tseg, sampl_pt, GRCAN_TIMING_MIN_TSEG2,
+		GRCAN_TIMING_MAX_TSEG1, GRCAN_TIMING_MAX_TSEG2, &tseg1, &tseg2);
+	if ( sjw > (unsigned int)tseg2 )
+		sjw = tseg2;
+
+	res->tseg1 = tseg1;
+	res->tseg2 = tseg2;
+	res->sjw = sjw;
+	if ( best_brp <= 256 ) {
+		res->scaler = best_brp - 1;
+		res->bpr = 0;
+	} else if ( best_brp <= 256*2 ) {
+		res->scaler = (best_brp >> 1) - 1;
+		res->bpr = 1;
+	} else if ( best_brp <= 256*4 ) {
+		res->scaler = (best_brp >> 2) - 1;
+		res->bpr = 2;
+	} else {
+		res->scaler = (best_brp >> 3) - 1;
+		res->bpr = 3;
+	}
+	res->ps1 = tseg1 - 1;
+	res->ps2 = tseg2;
+	res->rsj = sjw;
+	res->btr0 = res->btr1 = 0;
+	can_timing_eval(clock_hz / best_brp, rate, res);
+
+	return 0;
+}
+
+/* Precomputed configuration, see can_timing_table.h */
+struct can_timing_entry {
+	unsigned int clock_hz;
+	unsigned int rate;
+	unsigned char sampl_pt;		/* Requested sample point [%] */
+	struct can_timing_result res;
+};
+
+static inline const struct can_timing_result *can_timing_lookup(
+	const struct can_timing_entry *table,
+	unsigned int clock_hz,
+	unsigned int rate,
+	unsigned int sampl_pt)
+{
+	for (; table->clock_hz; table++) {
+		if ( (table->clock_hz == clock_hz) && (table->rate == rate) &&
+		     (table->sampl_pt == sampl_pt) )
+			return &table->res;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,202 @@
+/* CAN bit timing table, generated by "calc_can_btrs -t". Do not edit,
+ * add clocks/sample points to calc_can_btrs.c and regenerate.
+ *
+ * Fields: clock_hz, rate, sampl_pt, {rate, err_ppm, sampl_pt[0.1%],
+ *   osc_tol_ppm, nbt, tseg1, tseg2, sjw, btr0, btr1, scaler, ps1, ps2,
+ *   rsj, bpr}
+ */
+
+#ifndef __CAN_TIMING_TABLE_H__
+#define __CAN_TIMING_TABLE_H__
+
+#include "can_timing.h"
+
+static const struct can_timing_entry occan_timing_table[] = {
+  {30000000, 1000000, 75, {1000000, 0, 733, 3333, 15, 10, 4, 1, 0x00, 0x39, 0, 0, 0, 0, 0}},
+  {30000000, 500000, 75, {500000, 0, 733, 3333, 15, 10, 4, 1, 0x01, 0x39, 0, 0, 0, 0, 0}},
+  {30000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x02, 0x4d, 0, 0, 0, 0, 0}},
+  {30000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x05, 0x4d, 0, 0, 0, 0, 0}},
+  {30000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x4e, 0x4d, 0, 0, 0, 0, 0}},
+  {30000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x5d, 0x4d, 0, 0, 0, 0, 0}},
+  {30000000, 1000000, 80, {1000000, 0, 800, 3333, 15, 11, 3, 1, 0x00, 0x2a, 0, 0, 0, 0, 0}},
+  {30000000, 500000, 80, {500000, 0, 800, 3333, 15, 11, 3, 1, 0x01, 0x2a, 0, 0, 0, 0, 0}},
+  {30000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x02, 0x3e, 0, 0, 0, 0, 0}},
+  {30000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x05, 0x3e, 0, 0, 0, 0, 0}},
+  {30000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x4e, 0x3e, 0, 0, 0, 0, 0}},
+  {30000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x5d, 0x3e, 0, 0, 0, 0, 0}},
+  {30000000, 1000000, 87, {1000000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x1b, 0, 0, 0, 0, 0}},
+  {30000000, 500000, 87, {500000, 0, 866, 3333, 15, 12, 2, 1, 0x01, 0x1b, 0, 0, 0, 0, 0}},
+  {30000000, 250000, 87, {250000, 0, 866, 3333, 15, 12, 2, 1, 0x03, 0x1b, 0, 0, 0, 0, 0}},
+  {30000000, 125000, 87, {125000, 0, 866, 3333, 15, 12, 2, 1, 0x07, 0x1b, 0, 0, 0, 0, 0}},
+  {30000000, 50000, 87, {50000, 0, 866, 5181, 15, 12, 2, 2, 0x53, 0x1b, 0, 0, 0, 0, 0}},
+  {30000000, 25000, 87, {25000, 0, 866, 5181, 15, 12, 2, 2, 0x67, 0x1b, 0, 0, 0, 0, 0}},
+  {40000000, 1000000, 75, {1000000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x4d, 0, 0, 0, 0, 0}},
+  {40000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x01, 0x4d, 0, 0, 0, 0, 0}},
+  {40000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x03, 0x4d, 0, 0, 0, 0, 0}},
+  {40000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x07, 0x4d, 0, 0, 0, 0, 0}},
+  {40000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x53, 0x4d, 0, 0, 0, 0, 0}},
+  {40000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x67, 0x4d, 0, 0, 0, 0, 0}},
+  {40000000, 1000000, 80, {1000000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x3e, 0, 0, 0, 0, 0}},
+  {40000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x01, 0x3e, 0, 0, 0, 0, 0}},
+  {40000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x03, 0x3e, 0, 0, 0, 0, 0}},
+  {40000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x07, 0x3e, 0, 0, 0, 0, 0}},
+  {40000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x53, 0x3e, 0, 0, 0, 0, 0}},
+  {40000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x67, 0x3e, 0, 0, 0, 0, 0}},
+  {40000000, 1000000, 87, {1000000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x2f, 0, 0, 0, 0, 0}},
+  {40000000, 500000, 87, {500000, 0, 850, 2500, 20, 16, 3, 1, 0x01, 0x2f, 0, 0, 0, 0, 0}},
+  {40000000, 250000, 87, {250000, 0, 850, 2500, 20, 16, 3, 1, 0x03, 0x2f, 0, 0, 0, 0, 0}},
+  {40000000, 125000, 87, {125000, 0, 850, 2500, 20, 16, 3, 1, 0x07, 0x2f, 0, 0, 0, 0, 0}},
+  {40000000, 50000, 87, {50000, 0, 850, 5000, 20, 16, 3, 2, 0x53, 0x2f, 0, 0, 0, 0, 0}},
+  {40000000, 25000, 87, {25000, 0, 850, 5000, 20, 16, 3, 2, 0x67, 0x2f, 0, 0, 0, 0, 0}},
+  {50000000, 1000000, 75, {1000000, 0, 680, 2000, 25, 16, 8, 1, 0x00, 0x7f, 0, 0, 0, 0, 0}},
+  {50000000, 500000, 75, {500000, 0, 700, 5000, 10, 6, 3, 1, 0x04, 0x25, 0, 0, 0, 0, 0}},
+  {50000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x04, 0x4d, 0, 0, 0, 0, 0}},
+  {50000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x09, 0x4d, 0, 0, 0, 0, 0}},
+  {50000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x58, 0x4d, 0, 0, 0, 0, 0}},
+  {50000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x71, 0x4d, 0, 0, 0, 0, 0}},
+  {50000000, 1000000, 80, {1000000, 0, 800, 7812, 5, 3, 1, 1, 0x04, 0x02, 0, 0, 0, 0, 0}},
+  {50000000, 500000, 80, {500000, 0, 800, 5000, 10, 7, 2, 1, 0x04, 0x16, 0, 0, 0, 0, 0}},
+  {50000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x04, 0x3e, 0, 0, 0, 0, 0}},
+  {50000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x09, 0x3e, 0, 0, 0, 0, 0}},
+  {50000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x58, 0x3e, 0, 0, 0, 0, 0}},
+  {50000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x71, 0x3e, 0, 0, 0, 0, 0}},
+  {50000000, 1000000, 87, {1000000, 0, 800, 7812, 5, 3, 1, 1, 0x04, 0x02, 0, 0, 0, 0, 0}},
+  {50000000, 500000, 87, {500000, 0, 800, 5000, 10, 7, 2, 1, 0x04, 0x16, 0, 0, 0, 0, 0}},
+  {50000000, 250000, 87, {250000, 0, 850, 2500, 20, 16, 3, 1, 0x04, 0x2f, 0, 0, 0, 0, 0}},
+  {50000000, 125000, 87, {125000, 0, 850, 2500, 20, 16, 3, 1, 0x09, 0x2f, 0, 0, 0, 0, 0}},
+  {50000000, 50000, 87, {50000, 0, 850, 5000, 20, 16, 3, 2, 0x58, 0x2f, 0, 0, 0, 0, 0}},
+  {50000000, 25000, 87, {25000, 0, 850, 5000, 20, 16, 3, 2, 0x71, 0x2f, 0, 0, 0, 0, 0}},
+  {60000000, 1000000, 75, {1000000, 0, 733, 3333, 15, 10, 4, 1, 0x01, 0x39, 0, 0, 0, 0, 0}},
+  {60000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x02, 0x4d, 0, 0, 0, 0, 0}},
+  {60000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x05, 0x4d, 0, 0, 0, 0, 0}},
+  {60000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x0b, 0x4d, 0, 0, 0, 0, 0}},
+  {60000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x5d, 0x4d, 0, 0, 0, 0, 0}},
+  {60000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x7b, 0x4d, 0, 0, 0, 0, 0}},
+  {60000000, 1000000, 80, {1000000, 0, 800, 3333, 15, 11, 3, 1, 0x01, 0x2a, 0, 0, 0, 0, 0}},
+  {60000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x02, 0x3e, 0, 0, 0, 0, 0}},
+  {60000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x05, 0x3e, 0, 0, 0, 0, 0}},
+  {60000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x0b, 0x3e, 0, 0, 0, 0, 0}},
+  {60000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x5d, 0x3e, 0, 0, 0, 0, 0}},
+  {60000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x7b, 0x3e, 0, 0, 0, 0, 0}},
+  {60000000, 1000000, 87, {1000000, 0, 866, 3333, 15, 12, 2, 1, 0x01, 0x1b, 0, 0, 0, 0, 0}},
+  {60000000, 500000, 87, {500000, 0, 866, 3333, 15, 12, 2, 1, 0x03, 0x1b, 0, 0, 0, 0, 0}},
+  {60000000, 250000, 87, {250000, 0, 866, 3333, 15, 12, 2, 1, 0x07, 0x1b, 0, 0, 0, 0, 0}},
+  {60000000, 125000, 87, {125000, 0, 866, 3333, 15, 12, 2, 1, 0x0f, 0x1b, 0, 0, 0, 0, 0}},
+  {60000000, 50000, 87, {50000, 0, 866, 5181, 15, 12, 2, 2, 0x67, 0x1b, 0, 0, 0, 0, 0}},
+  {60000000, 25000, 87, {25000, 0, 850, 5000, 20, 16, 3, 2, 0x7b, 0x2f, 0, 0, 0, 0, 0}},
+  {80000000, 1000000, 75, {1000000, 0, 750, 2500, 20, 14, 5, 1, 0x01, 0x4d, 0, 0, 0, 0, 0}},
+  {80000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x03, 0x4d, 0, 0, 0, 0, 0}},
+  {80000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x07, 0x4d, 0, 0, 0, 0, 0}},
+  {80000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x0f, 0x4d, 0, 0, 0, 0, 0}},
+  {80000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x67, 0x4d, 0, 0, 0, 0, 0}},
+  {80000000, 25000, 75, {25000, 0, 680, 4000, 25, 16, 8, 2, 0x7f, 0x7f, 0, 0, 0, 0, 0}},
+  {80000000, 1000000, 80, {1000000, 0, 800, 2500, 20, 15, 4, 1, 0x01, 0x3e, 0, 0, 0, 0, 0}},
+  {80000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x03, 0x3e, 0, 0, 0, 0, 0}},
+  {80000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x07, 0x3e, 0, 0, 0, 0, 0}},
+  {80000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x0f, 0x3e, 0, 0, 0, 0, 0}},
+  {80000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x67, 0x3e, 0, 0, 0, 0, 0}},
+  {80000000, 25000, 80, {25000, 0, 680, 4000, 25, 16, 8, 2, 0x7f, 0x7f, 0, 0, 0, 0, 0}},
+  {80000000, 1000000, 87, {1000000, 0, 850, 2500, 20, 16, 3, 1, 0x01, 0x2f, 0, 0, 0, 0, 0}},
+  {80000000, 500000, 87, {500000, 0, 850, 2500, 20, 16, 3, 1, 0x03, 0x2f, 0, 0, 0, 0, 0}},
+  {80000000, 250000, 87, {250000, 0, 850, 2500, 20, 16, 3, 1, 0x07, 0x2f, 0, 0, 0, 0, 0}},
+  {80000000, 125000, 87, {125000, 0, 850, 2500, 20, 16, 3, 1, 0x0f, 0x2f, 0, 0, 0, 0, 0}},
+  {80000000, 50000, 87, {50000, 0, 850, 5000, 20, 16, 3, 2, 0x67, 0x2f, 0, 0, 0, 0, 0}},
+  {80000000, 25000, 87, {25000, 0, 680, 4000, 25, 16, 8, 2, 0x7f, 0x7f, 0, 0, 0, 0, 0}},
+  {0}
+};
+
+static const struct can_timing_entry grcan_timing_table[] = {
+  {30000000, 1000000, 75, {1000000, 0, 733, 3333, 15, 10, 4, 1, 0x00, 0x00, 1, 9, 4, 1, 0}},
+  {30000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 2, 13, 5, 1, 0}},
+  {30000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 5, 13, 5, 1, 0}},
+  {30000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 11, 13, 5, 1, 0}},
+  {30000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 29, 13, 5, 2, 0}},
+  {30000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 59, 13, 5, 2, 0}},
+  {30000000, 1000000, 80, {1000000, 0, 800, 3333, 15, 11, 3, 1, 0x00, 0x00, 1, 10, 3, 1, 0}},
+  {30000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 2, 14, 4, 1, 0}},
+  {30000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 5, 14, 4, 1, 0}},
+  {30000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 11, 14, 4, 1, 0}},
+  {30000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 29, 14, 4, 2, 0}},
+  {30000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 59, 14, 4, 2, 0}},
+  {30000000, 1000000, 87, {1000000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 1, 11, 2, 1, 0}},
+  {30000000, 500000, 87, {500000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 3, 11, 2, 1, 0}},
+  {30000000, 250000, 87, {250000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 7, 11, 2, 1, 0}},
+  {30000000, 125000, 87, {125000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 15, 11, 2, 1, 0}},
+  {30000000, 50000, 87, {50000, 0, 866, 5181, 15, 12, 2, 2, 0x00, 0x00, 39, 11, 2, 2, 0}},
+  {30000000, 25000, 87, {25000, 0, 866, 5181, 15, 12, 2, 2, 0x00, 0x00, 79, 11, 2, 2, 0}},
+  {40000000, 1000000, 75, {1000000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 1, 13, 5, 1, 0}},
+  {40000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 3, 13, 5, 1, 0}},
+  {40000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 7, 13, 5, 1, 0}},
+  {40000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 15, 13, 5, 1, 0}},
+  {40000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 39, 13, 5, 2, 0}},
+  {40000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 79, 13, 5, 2, 0}},
+  {40000000, 1000000, 80, {1000000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 1, 14, 4, 1, 0}},
+  {40000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 3, 14, 4, 1, 0}},
+  {40000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 7, 14, 4, 1, 0}},
+  {40000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 15, 14, 4, 1, 0}},
+  {40000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 39, 14, 4, 2, 0}},
+  {40000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 79, 14, 4, 2, 0}},
+  {40000000, 1000000, 87, {1000000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 1, 15, 3, 1, 0}},
+  {40000000, 500000, 87, {500000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 3, 15, 3, 1, 0}},
+  {40000000, 250000, 87, {250000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 7, 15, 3, 1, 0}},
+  {40000000, 125000, 87, {125000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 15, 15, 3, 1, 0}},
+  {40000000, 50000, 87, {50000, 0, 850, 5000, 20, 16, 3, 2, 0x00, 0x00, 39, 15, 3, 2, 0}},
+  {40000000, 25000, 87, {25000, 0, 850, 5000, 20, 16, 3, 2, 0x00, 0x00, 79, 15, 3, 2, 0}},
+  {50000000, 1000000, 75, {1000000, 0, 700, 5000, 10, 6, 3, 1, 0x00, 0x00, 4, 5, 3, 1, 0}},
+  {50000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 4, 13, 5, 1, 0}},
+  {50000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 9, 13, 5, 1, 0}},
+  {50000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 19, 13, 5, 1, 0}},
+  {50000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 49, 13, 5, 2, 0}},
+  {50000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 99, 13, 5, 2, 0}},
+  {50000000, 1000000, 80, {1000000, 0, 800, 5000, 10, 7, 2, 1, 0x00, 0x00, 4, 6, 2, 1, 0}},
+  {50000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 4, 14, 4, 1, 0}},
+  {50000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 9, 14, 4, 1, 0}},
+  {50000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 19, 14, 4, 1, 0}},
+  {50000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 49, 14, 4, 2, 0}},
+  {50000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 99, 14, 4, 2, 0}},
+  {50000000, 1000000, 87, {1000000, 0, 800, 5000, 10, 7, 2, 1, 0x00, 0x00, 4, 6, 2, 1, 0}},
+  {50000000, 500000, 87, {500000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 4, 15, 3, 1, 0}},
+  {50000000, 250000, 87, {250000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 9, 15, 3, 1, 0}},
+  {50000000, 125000, 87, {125000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 19, 15, 3, 1, 0}},
+  {50000000, 50000, 87, {50000, 0, 850, 5000, 20, 16, 3, 2, 0x00, 0x00, 49, 15, 3, 2, 0}},
+  {50000000, 25000, 87, {25000, 0, 850, 5000, 20, 16, 3, 2, 0x00, 0x00, 99, 15, 3, 2, 0}},
+  {60000000, 1000000, 75, {1000000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 2, 13, 5, 1, 0}},
+  {60000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 5, 13, 5, 1, 0}},
+  {60000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 11, 13, 5, 1, 0}},
+  {60000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 23, 13, 5, 1, 0}},
+  {60000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 59, 13, 5, 2, 0}},
+  {60000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 119, 13, 5, 2, 0}},
+  {60000000, 1000000, 80, {1000000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 2, 14, 4, 1, 0}},
+  {60000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 5, 14, 4, 1, 0}},
+  {60000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 11, 14, 4, 1, 0}},
+  {60000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 23, 14, 4, 1, 0}},
+  {60000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 59, 14, 4, 2, 0}},
+  {60000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 119, 14, 4, 2, 0}},
+  {60000000, 1000000, 87, {1000000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 3, 11, 2, 1, 0}},
+  {60000000, 500000, 87, {500000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 7, 11, 2, 1, 0}},
+  {60000000, 250000, 87, {250000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 15, 11, 2, 1, 0}},
+  {60000000, 125000, 87, {125000, 0, 866, 3333, 15, 12, 2, 1, 0x00, 0x00, 31, 11, 2, 1, 0}},
+  {60000000, 50000, 87, {50000, 0, 866, 5181, 15, 12, 2, 2, 0x00, 0x00, 79, 11, 2, 2, 0}},
+  {60000000, 25000, 87, {25000, 0, 866, 5181, 15, 12, 2, 2, 0x00, 0x00, 159, 11, 2, 2, 0}},
+  {80000000, 1000000, 75, {1000000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 3, 13, 5, 1, 0}},
+  {80000000, 500000, 75, {500000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 7, 13, 5, 1, 0}},
+  {80000000, 250000, 75, {250000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 15, 13, 5, 1, 0}},
+  {80000000, 125000, 75, {125000, 0, 750, 2500, 20, 14, 5, 1, 0x00, 0x00, 31, 13, 5, 1, 0}},
+  {80000000, 50000, 75, {50000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 79, 13, 5, 2, 0}},
+  {80000000, 25000, 75, {25000, 0, 750, 5000, 20, 14, 5, 2, 0x00, 0x00, 159, 13, 5, 2, 0}},
+  {80000000, 1000000, 80, {1000000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 3, 14, 4, 1, 0}},
+  {80000000, 500000, 80, {500000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 7, 14, 4, 1, 0}},
+  {80000000, 250000, 80, {250000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 15, 14, 4, 1, 0}},
+  {80000000, 125000, 80, {125000, 0, 800, 2500, 20, 15, 4, 1, 0x00, 0x00, 31, 14, 4, 1, 0}},
+  {80000000, 50000, 80, {50000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 79, 14, 4, 2, 0}},
+  {80000000, 25000, 80, {25000, 0, 800, 5000, 20, 15, 4, 2, 0x00, 0x00, 159, 14, 4, 2, 0}},
+  {80000000, 1000000, 87, {1000000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 3, 15, 3, 1, 0}},
+  {80000000, 500000, 87, {500000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 7, 15, 3, 1, 0}},
+  {80000000, 250000, 87, {250000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 15, 15, 3, 1, 0}},
+  {80000000, 125000, 87, {125000, 0, 850, 2500, 20, 16, 3, 1, 0x00, 0x00, 31, 15, 3, 1, 0}},
+  {80000000, 50000, 87, {50000, 0, 850, 5000, 20, 16, 3, 2, 0x00, 0x00, 79, 15, 3, 2, 0}},
+  {80000000, 25000, 87, {25000, 0, 850, 5000, 20, 16, 3, 2, 0x00, 0x00, 159, 15, 3, 2, 0}},
+  {0}
+};
+
+#endif
@@ -0,0 +1,238 @@
+/* Reader for CAN recordings made with occan_rec.c
+ *
+ * Prints the recorded messages in candump log format:
+ *   (1436509052.249713) can0 123#DEADBEEF
+ * The time is relative to the first message of the recording unless -a is
+ * given. Blocks are found by binary search on the start time (-t) and
+ * blocks that cannot contain the requested ID (-i) are skipped without
+ * decoding, using the ID map of every block.
+ *
+ * usage: canrec [-t START] [-T END] [-i ID[/MASK]] [-a] [-s] FILE
+ *   -t/-T  start/end time in seconds
+ *   -i     only messages with (id & MASK) == ID, MASK default all ones
+ *   -a     print absolute recorder time
+ *   -s     print summary only
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../occan_rec.h"
+
+unsigned char blk[CANREC_BLOCK_SIZE];
+
+struct blk_info {
+	unsigned int seq;
+	unsigned long long time;
+	unsigned int used;
+	unsigned int nrec;
+	unsigned int lost;
+	unsigned int idmap[2];
+};
+
+static unsigned int get_be16(unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static unsigned int get_be32(unsigned char *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int get_leb128(unsigned char **pp, unsigned char *end, unsigned int *v)
+{
+	unsigned char *p = *pp;
+	int shift = 0;
+
+	*v = 0;
+	do {
+		if ( p >= end )
+			return -1;
+		*v |= (*p & 0x7f) << shift;
+		shift += 7;
+	} while ( *p++ & 0x80 );
+	*pp = p;
+	return 0;
+}
+
+/* Read block number n, returns 0 on success */
+static int blk_read(FILE *f, long n, struct blk_info *bi)
+{
+	if ( fseek(f, n * CANREC_BLOCK_SIZE, SEEK_SET) ||
+	     (fread(blk, CANREC_BLOCK_SIZE, 1, f) != 1) )
+		return -1;
+	if ( get_be32(&blk[0]) != CANREC_MAGIC ) {
+		printf("Block %ld: bad magic\n", n);
+		return -1;
+	}
+	bi->seq = get_be32(&blk[4]);
+	bi->time = ((unsigned long long)get_be32(&blk[8]) << 32) | get_be32(&blk[12]);
+	bi->used = get_be16(&blk[16]);
+	bi->nrec = get_be16(&blk[18]);
+	bi->lost = get_be32(&blk[20]);
+	bi->idmap[0] = get_be32(&blk[24]);
+	bi->idmap[1] = get_be32(&blk[28]);
+	if ( (bi->used < CANREC_HDR_SIZE) || (bi->used > CANREC_BLOCK_SIZE) ) {
+		printf("Block %ld: bad length %u\n", n, bi->used);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct blk_info bi;
+	FILE *f;
+	long nblks, lo, hi, mid, n;
+	unsigned long long t0, t, start = 0, end = ~0ULL, bytes = 0, t_last = 0;
+	unsigned int id_want = 0, id_mask = 0, id, len, delta, r;
+	unsigned int msgs = 0, lost = 0, seq_lost = 0, next_seq = 0;
+	int opt, absolute = 0, summary = 0, ext, rtr, bit, i, first = 1, idlen;
+	unsigned char *p, *pend, *data, hdr;
+	char *slash;
+	double d;
+
+	while ( (opt = getopt(argc, argv, "t:T:i:as")) != -1 ) {
+		switch ( opt ) {
+		case 't':
+			d = atof(optarg);
+			start = d * 1000000;
+			break;
+		case 'T':
+			d = atof(optarg);
+			end = d * 1000000;
+			break;
+		case 'i':
+			id_want = strtoul(optarg, &slash, 16);
+			id_mask = 0x1fffffff;
+			if ( *slash == '/' )
+				id_mask = strtoul(slash + 1, NULL, 16);
+			break;
+		case 'a': absolute = 1; break;
+		case 's': summary = 1; break;
+		default:
+			goto usage;
+		}
+	}
+	if ( optind >= argc )
+		goto usage;
+
+	f = fopen(argv[optind], "rb");
+	if ( !f ) {
+		perror(argv[optind]);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	nblks = ftell(f) / CANREC_BLOCK_SIZE;
+	if ( (nblks < 1) || blk_read(f, 0, &bi) ) {
+		printf("No recording in %s\n", argv[optind]);
+		return 1;
+	}
+	t0 = bi.time;
+
+	/* First block that may hold messages at or after start: the last
+	 * block starting before start.
+	 */
+	lo = 0;
+	hi = nblks - 1;
+	while ( lo < hi ) {
+		mid = (lo + hi + 1) / 2;
+		if ( blk_read(f, mid, &bi) )
+			return 1;
+		if ( bi.time - t0 <= start )
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	for (n=lo; n<nblks; n++) {
+		if ( blk_read(f, n, &bi) )
+			return 1;
+		if ( bi.time - t0 > end )
+			break;
+		if ( !first && (bi.seq != next_seq) )
+			seq_lost += bi.seq - next_seq;
+		first = 0;
+		next_seq = bi.seq + 1;
+		lost += bi.lost;
+		bytes += bi.used;
+
+		/* An exact ID that is not in the ID map is not in the block */
+		if ( (id_mask == 0x1fffffff) && !summary ) {
+			bit = CANREC_IDMAP_BIT(id_want);
+			if ( !(bi.idmap[bit >> 5] & (0x80000000U >> (bit & 31))) ) {
+				msgs += bi.nrec;
+				continue;
+			}
+		}
+
+		t = bi.time;
+		id = 0;
+		p = &blk[CANREC_HDR_SIZE];
+		pend = &blk[bi.used];
+		for (r=0; (r < bi.nrec) && (p < pend); r++) {
+			hdr = *p++;
+			ext = (hdr & CANREC_HDR_EXT) != 0;
+			rtr = (hdr & CANREC_HDR_RTR) != 0;
+			len = hdr & CANREC_HDR_LEN;
+			/* Time delta, ID and data must all be inside the block */
+			idlen = (hdr & CANREC_HDR_SAMEID) ? 0 : (ext ? 4 : 2);
+			if ( get_leb128(&p, pend, &delta) ||
+			     (p + idlen + (rtr ? 0 : len) > pend) ) {
+				printf("Block %ld: truncated record %u\n", n, r);
+				break;
+			}
+			t += delta;
+			t_last = t;
+			if ( !(hdr & CANREC_HDR_SAMEID) ) {
+				if ( ext ) {
+					id = get_be32(p) & 0x1fffffff;
+					p += 4;
+				} else {
+					id = get_be16(p) & 0x7ff;
+					p += 2;
+				}
+			}
+			msgs++;
+			data = p;
+			if ( !rtr )
+				p += len;
+
+			if ( summary || ((id & id_mask) != id_want) ||
+			     (t - t0 < start) || (t - t0 > end) )
+				continue;
+
+			if ( absolute )
+				printf("(%llu.%06llu) can0 ", t / 1000000, t % 1000000);
+			else
+				printf("(%llu.%06llu) can0 ", (t - t0) / 1000000, (t - t0) % 1000000);
+			printf(ext ? "%08X#" : "%03X#", id);
+			if ( rtr ) {
+				printf("R\n");
+				continue;
+			}
+			for (i=0; i<len; i++)
+				printf("%02X", data[i]);
+			printf("\n");
+		}
+	}
+
+	if ( summary ) {
+		printf("%ld blocks, %u messages, %u lost in recorder, %u blocks lost\n",
+			nblks, msgs, lost, seq_lost);
+		printf("%.6f s recorded, %.1f bytes/message\n",
+			(t_last - t0) * 1e-6, msgs ? (double)bytes / msgs : 0.0);
+	} else if ( lost || seq_lost ) {
+		fprintf(stderr, "%u messages lost in recorder, %u blocks lost\n",
+			lost, seq_lost);
+	}
+	fclose(f);
+	return 0;
+
+usage:
+	printf("usage: %s [-t START] [-T END] [-i ID[/MASK]] [-a] [-s] FILE\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,719 @@
+/* Linux CAN bus simulator, see cansim.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "occan.h"
+#include "cansim.h"
+
+#define CANSIM_FD_BASE		0x1000	/* fd of /dev/occan0 */
+#define CANSIM_DEF_RXLEN	64
+#define CANSIM_DEF_TXLEN	64
+
+/* Error flag (6), error delimiter (8) and intermission (3) */
+#define CANSIM_ERR_FRAME_BITS	17
+
+struct cansim_node {
+	int bus;
+	int open;
+	int started;
+	int txblk;
+	int rxblk;
+	CANMsg *rx;
+	int rxlen, rx_tail, rx_cnt;
+	CANMsg *tx;
+	int txlen, tx_tail, tx_cnt;
+	struct occan_afilter filt;
+	occan_stats stats;
+	pthread_cond_t rx_cond;
+	pthread_cond_t tx_cond;
+};
+
+/* Every bus has its own thread and time, all share one lock */
+struct cansim_bus {
+	pthread_cond_t work;
+	pthread_t thread;
+	struct cansim_bus_stats stats;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	int run;
+	struct cansim_cfg cfg;
+	unsigned int bitrate;
+	unsigned int rnd;
+	struct timespec t0;
+	struct cansim_node nodes[CANSIM_NODES_MAX];
+	int nbuses;
+	struct cansim_bus buses[CANSIM_BUSES_MAX];
+} sim;
+
+static unsigned long long real_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec - sim.t0.tv_sec) * 1000000000ULL + ts.tv_nsec - sim.t0.tv_nsec;
+}
+
+/* Arbitration field in transmission order, MSB first. Same as the key of
+ * the priority TX queue (occan_txq.c), lowest key wins.
+ */
+static unsigned int arb_key(CANMsg *msg)
+{
+	if ( msg->extended ) {
+		return ((msg->id >> 18) << 21) | (1 << 20) | (1 << 19) |
+			((msg->id & 0x3ffff) << 1) | (msg->rtr ? 1 : 0);
+	}
+	return ((msg->id & 0x7ff) << 21) | (msg->rtr ? (1 << 20) : 0);
+}
+
+/* Bit writer with CRC-15 and stuff bit counting */
+struct bitgen {
+	unsigned short crc;
+	int bits;
+	int stuff;
+	int last;
+	int run;
+};
+
+static void bit_put(struct bitgen *g, int bit, int crc)
+{
+	int crcnxt;
+
+	if ( crc ) {
+		crcnxt = bit ^ ((g->crc >> 14) & 1);
+		g->crc = (g->crc << 1) & 0x7fff;
+		if ( crcnxt )
+			g->crc ^= 0x4599;
+	}
+
+	g->bits++;
+	if ( bit == g->last ) {
+		g->run++;
+		if ( g->run == 5 ) {
+			/* Stuff bit of opposite value starts a new run */
+			g->stuff++;
+			g->bits++;
+			g->last = !bit;
+			g->run = 1;
+		}
+	} else {
+		g->last = bit;
+		g->run = 1;
+	}
+}
+
+static void bits_put(struct bitgen *g, unsigned int val, int cnt)
+{
+	while ( cnt-- > 0 )
+		bit_put(g, (val >> cnt) & 1, 1);
+}
+
+int cansim_frame_bits(int extended, int rtr, unsigned int id,
+	int len, unsigned char *data, int *stuff_bits)
+{
+	struct bitgen g;
+	int i;
+
+	memset(&g, 0, sizeof(g));
+	g.last = -1;
+
+	bits_put(&g, 0, 1);			/* SOF */
+	if ( extended ) {
+		bits_put(&g, id >> 18, 11);
+		bits_put(&g, 3, 2);		/* SRR, IDE */
+		bits_put(&g, id & 0x3ffff, 18);
+		bits_put(&g, rtr ? 1 : 0, 1);
+		bits_put(&g, 0, 2);		/* r1, r0 */
+	} else {
+		bits_put(&g, id & 0x7ff, 11);
+		bits_put(&g, rtr ? 1 : 0, 1);
+		bits_put(&g, 0, 2);		/* IDE, r0 */
+	}
+	if ( len > 8 )
+		len = 8;
+	bits_put(&g, len, 4);
+	if ( !rtr ) {
+		for (i=0; i<len; i++)
+			bits_put(&g, data[i], 8);
+	}
+	/* CRC sequence is stuffed too, but not part of the CRC */
+	for (i=14; i>=0; i--)
+		bit_put(&g, (g.crc >> i) & 1, 0);
+
+	if ( stuff_bits )
+		*stuff_bits = g.stuff;
+
+	/* CRC delimiter, ACK slot+delimiter, EOF, intermission */
+	return g.bits + 1 + 2 + 7 + 3;
+}
+
+/* OC-CAN single filter mode, see occan_filter.c for the register layout.
+ * Dual filter mode is not simulated and accepts all.
+ */
+static int filter_pass(struct occan_afilter *f, CANMsg *msg)
+{
+	unsigned int code, mask, reg, used;
+	int i;
+
+	if ( !f->single_mode )
+		return 1;
+
+	code = mask = 0;
+	for (i=0; i<4; i++) {
+		code = (code << 8) | f->code[i];
+		mask = (mask << 8) | f->mask[i];
+	}
+	if ( msg->extended ) {
+		reg = (msg->id << 3) | (msg->rtr ? 0x4 : 0);
+		used = 0xfffffffc;
+	} else {
+		reg = (msg->id << 21) | (msg->rtr ? 0x00100000 : 0);
+		used = 0xfff00000;
+		if ( !msg->rtr && (msg->len > 0) ) {
+			reg |= msg->data[0] << 8;
+			used |= 0xff00;
+		}
+		if ( !msg->rtr && (msg->len > 1) ) {
+			reg |= msg->data[1];
+			used |= 0xff;
+		}
+	}
+
+	return ((reg ^ code) & ~mask & used) == 0;
+}
+
+static unsigned int sim_rand(void)
+{
+	sim.rnd = sim.rnd * 1103515245 + 12345;
+	return sim.rnd >> 8;
+}
+
+static void *bus_thread(void *arg)
+{
+	struct cansim_bus *bus = arg;
+	int busno = bus - sim.buses;
+	struct cansim_node *n, *win;
+	unsigned int key, win_key, diff;
+	unsigned long long frame_ns, now;
+	struct timespec ts;
+	CANMsg msg;
+	int i, bits, stuff, err, bitnum;
+
+	pthread_mutex_lock(&sim.lock);
+	while ( sim.run ) {
+		/* Arbitration between the oldest message of every node */
+		win = NULL;
+		win_key = 0;
+		for (i=0; i<sim.cfg.nodes; i++) {
+			n = &sim.nodes[i];
+			if ( (n->bus != busno) || !n->started || (n->tx_cnt == 0) )
+				continue;
+			key = arb_key(&n->tx[n->tx_tail]);
+			if ( !win || (key < win_key) ) {
+				win = n;
+				win_key = key;
+			}
+		}
+
+		if ( !win ) {
+			/* Bus idle, time passes in real time */
+			pthread_cond_wait(&bus->work, &sim.lock);
+			if ( !sim.cfg.fast ) {
+				now = real_ns();
+				if ( now > bus->stats.time_ns )
+					bus->stats.time_ns = now;
+			}
+			continue;
+		}
+
+		for (i=0; i<sim.cfg.nodes; i++) {
+			n = &sim.nodes[i];
+			if ( (n == win) || (n->bus != busno) || !n->started || (n->tx_cnt == 0) )
+				continue;
+			diff = arb_key(&n->tx[n->tx_tail]) ^ win_key;
+			for (bitnum=0; (bitnum < 31) && !(diff & (0x80000000 >> bitnum)); bitnum++)
+				;
+			n->stats.err_arb++;
+			n->stats.err_arb_bitnum[bitnum]++;
+			n->stats.ints++;
+			bus->stats.arb_losses++;
+		}
+
+		msg = win->tx[win->tx_tail];
+		bits = cansim_frame_bits(msg.extended, msg.rtr, msg.id, msg.len,
+			msg.data, &stuff);
+		err = sim.cfg.err_rate && ((sim_rand() % sim.cfg.err_rate) == 0);
+		if ( err ) {
+			/* Destroyed somewhere in the frame */
+			bits = (sim_rand() % (bits - 10)) + CANSIM_ERR_FRAME_BITS;
+		}
+		frame_ns = (bits * 1000000000ULL) / sim.bitrate;
+		bus->stats.time_ns += frame_ns;
+		bus->stats.busy_ns += frame_ns;
+		bus->stats.bits += bits;
+
+		if ( !sim.cfg.fast ) {
+			/* Absolute deadline so that sleep overshoot does not
+			 * add up.
+			 */
+			now = bus->stats.time_ns;
+			ts.tv_sec = sim.t0.tv_sec + now / 1000000000ULL;
+			ts.tv_nsec = sim.t0.tv_nsec + now % 1000000000ULL;
+			if ( ts.tv_nsec >= 1000000000 ) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			pthread_mutex_unlock(&sim.lock);
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+			pthread_mutex_lock(&sim.lock);
+		}
+
+		if ( err ) {
+			bus->stats.err_frames++;
+			win->stats.err_bus++;
+			win->stats.err_bus_tx++;
+			win->stats.err_bus_bit++;
+			win->stats.err_bus_segs[OCCAN_SEG_DFIELD]++;
+			win->stats.ints++;
+			for (i=0; i<sim.cfg.nodes; i++) {
+				n = &sim.nodes[i];
+				if ( (n == win) || (n->bus != busno) || !n->started )
+					continue;
+				n->stats.err_bus++;
+				n->stats.err_bus_rx++;
+				n->stats.err_bus_stuff++;
+				n->stats.err_bus_segs[OCCAN_SEG_DFIELD]++;
+				n->stats.ints++;
+			}
+			/* Message stays in TX buffer and is retransmitted */
+			continue;
+		}
+
+		/* Transmitter may have been stopped while frame was sent */
+		if ( win->started && (win->tx_cnt > 0) ) {
+			win->tx_tail = (win->tx_tail + 1) % win->txlen;
+			win->tx_cnt--;
+			win->stats.tx_msgs++;
+			win->stats.ints++;
+			pthread_cond_broadcast(&win->tx_cond);
+		}
+
+		for (i=0; i<sim.cfg.nodes; i++) {
+			n = &sim.nodes[i];
+			if ( (n == win) || (n->bus != busno) || !n->started ||
+			     !filter_pass(&n->filt, &msg) )
+				continue;
+			n->stats.ints++;
+			if ( n->rx_cnt >= n->rxlen ) {
+				n->stats.err_dovr++;
+				continue;
+			}
+			n->rx[(n->rx_tail + n->rx_cnt) % n->rxlen] = msg;
+			n->rx_cnt++;
+			n->stats.rx_msgs++;
+			pthread_cond_broadcast(&n->rx_cond);
+		}
+		bus->stats.frames++;
+		bus->stats.stuff_bits += stuff;
+	}
+	pthread_mutex_unlock(&sim.lock);
+
+	return NULL;
+}
+
+int cansim_init(struct cansim_cfg *cfg)
+{
+	int i;
+
+	if ( (cfg->nodes < 1) || (cfg->nodes > CANSIM_NODES_MAX) || (cfg->bitrate == 0) )
+		return -1;
+	for (i=0; i<cfg->nodes; i++) {
+		if ( cfg->bus[i] >= CANSIM_BUSES_MAX )
+			return -1;
+	}
+
+	memset(&sim, 0, sizeof(sim));
+	sim.cfg = *cfg;
+	sim.bitrate = cfg->bitrate;
+	sim.rnd = 1;
+	pthread_mutex_init(&sim.lock, NULL);
+	for (i=0; i<cfg->nodes; i++) {
+		sim.nodes[i].bus = cfg->bus[i];
+		if ( cfg->bus[i] >= sim.nbuses )
+			sim.nbuses = cfg->bus[i] + 1;
+		pthread_cond_init(&sim.nodes[i].rx_cond, NULL);
+		pthread_cond_init(&sim.nodes[i].tx_cond, NULL);
+	}
+	for (i=0; i<sim.nbuses; i++)
+		pthread_cond_init(&sim.buses[i].work, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &sim.t0);
+
+	sim.run = 1;
+	for (i=0; i<sim.nbuses; i++) {
+		if ( pthread_create(&sim.buses[i].thread, NULL, bus_thread, &sim.buses[i]) ) {
+			printf("cansim_init: failed to create bus thread\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void cansim_exit(void)
+{
+	int i;
+
+	pthread_mutex_lock(&sim.lock);
+	sim.run = 0;
+	for (i=0; i<sim.nbuses; i++)
+		pthread_cond_broadcast(&sim.buses[i].work);
+	pthread_mutex_unlock(&sim.lock);
+	for (i=0; i<sim.nbuses; i++)
+		pthread_join(sim.buses[i].thread, NULL);
+
+	for (i=0; i<sim.cfg.nodes; i++) {
+		free(sim.nodes[i].rx);
+		free(sim.nodes[i].tx);
+		sim.nodes[i].rx = sim.nodes[i].tx = NULL;
+	}
+}
+
+unsigned long long cansim_time_ns(void)
+{
+	return sim.buses[0].stats.time_ns;
+}
+
+void cansim_get_bus_stats(int bus, struct cansim_bus_stats *stats)
+{
+	pthread_mutex_lock(&sim.lock);
+	*stats = sim.buses[bus].stats;
+	pthread_mutex_unlock(&sim.lock);
+}
+
+void cansim_get_stats(struct cansim_bus_stats *stats)
+{
+	cansim_get_bus_stats(0, stats);
+}
+
+void cansim_stats_print(void)
+{
+	struct cansim_bus_stats st;
+	int i;
+
+	for (i=0; i<sim.nbuses; i++) {
+		cansim_get_bus_stats(i, &st);
+		printf("Bus%d: %u bit/s, %llu frames, %u error frames, %u arbitration losses\n",
+			i, sim.bitrate, st.frames, st.err_frames, st.arb_losses);
+		printf("      %llu bits (%llu stuff), load %.1f%% of %.3f s\n",
+			st.bits, st.stuff_bits,
+			st.time_ns ? (100.0 * st.busy_ns) / st.time_ns : 0.0,
+			st.time_ns * 1e-9);
+	}
+}
+
+static struct cansim_node *fd_node(int fd)
+{
+	int i = fd - CANSIM_FD_BASE;
+
+	if ( (i < 0) || (i >= sim.cfg.nodes) || !sim.nodes[i].open ) {
+		errno = EBADF;
+		return NULL;
+	}
+	return &sim.nodes[i];
+}
+
+static int set_buflen(struct cansim_node *n, int txlen, int rxlen)
+{
+	CANMsg *rx, *tx;
+
+	if ( (txlen < 1) || (rxlen < 1) )
+		return -1;
+	rx = malloc(sizeof(CANMsg) * rxlen);
+	tx = malloc(sizeof(CANMsg) * txlen);
+	if ( !rx || !tx ) {
+		free(rx);
+		free(tx);
+		return -1;
+	}
+	free(n->rx);
+	free(n->tx);
+	n->rx = rx;
+	n->tx = tx;
+	n->rxlen = rxlen;
+	n->txlen = txlen;
+	n->rx_tail = n->rx_cnt = 0;
+	n->tx_tail = n->tx_cnt = 0;
+	return 0;
+}
+
+int cansim_open(const char *name, int flags, ...)
+{
+	struct cansim_node *n;
+	int i;
+
+	if ( (strncmp(name, "/dev/occan", 10) != 0) ||
+	     ((i = atoi(name + 10)) < 0) || (i >= sim.cfg.nodes) ) {
+		errno = ENODEV;
+		return -1;
+	}
+	n = &sim.nodes[i];
+
+	pthread_mutex_lock(&sim.lock);
+	if ( n->open ) {
+		pthread_mutex_unlock(&sim.lock);
+		errno = EBUSY;
+		return -1;
+	}
+	if ( set_buflen(n, CANSIM_DEF_TXLEN, CANSIM_DEF_RXLEN) ) {
+		pthread_mutex_unlock(&sim.lock);
+		errno = ENOMEM;
+		return -1;
+	}
+	n->open = 1;
+	n->started = 0;
+	n->txblk = n->rxblk = 0;
+	memset(&n->stats, 0, sizeof(n->stats));
+	/* Accept all */
+	n->filt.single_mode = 1;
+	memset(n->filt.code, 0, 4);
+	memset(n->filt.mask, 0xff, 4);
+	pthread_mutex_unlock(&sim.lock);
+
+	return CANSIM_FD_BASE + i;
+}
+
+int cansim_close(int fd)
+{
+	struct cansim_node *n;
+
+	pthread_mutex_lock(&sim.lock);
+	n = fd_node(fd);
+	if ( n ) {
+		n->started = 0;
+		n->open = 0;
+		pthread_cond_broadcast(&n->rx_cond);
+		pthread_cond_broadcast(&n->tx_cond);
+	}
+	pthread_mutex_unlock(&sim.lock);
+
+	return n ? 0 : -1;
+}
+
+ssize_t cansim_read(int fd, void *buf, size_t count)
+{
+	struct cansim_node *n;
+	CANMsg *msgs = buf;
+	int max, cnt;
+
+	pthread_mutex_lock(&sim.lock);
+	n = fd_node(fd);
+	if ( !n )
+		goto fail;
+	max = count / sizeof(CANMsg);
+	if ( (max < 1) || (count % sizeof(CANMsg)) ) {
+		errno = EINVAL;
+		goto fail;
+	}
+	if ( !n->started ) {
+		errno = EBUSY;
+		goto fail;
+	}
+	while ( n->rx_cnt == 0 ) {
+		if ( !n->rxblk ) {
+			errno = ETIMEDOUT;
+			goto fail;
+		}
+		pthread_cond_wait(&n->rx_cond, &sim.lock);
+		if ( !n->started ) {
+			errno = EBUSY;
+			goto fail;
+		}
+	}
+	for (cnt=0; (cnt < max) && (n->rx_cnt > 0); cnt++) {
+		msgs[cnt] = n->rx[n->rx_tail];
+		n->rx_tail = (n->rx_tail + 1) % n->rxlen;
+		n->rx_cnt--;
+	}
+	pthread_mutex_unlock(&sim.lock);
+
+	return cnt * sizeof(CANMsg);
+
+fail:
+	pthread_mutex_unlock(&sim.lock);
+	return -1;
+}
+
+ssize_t cansim_write(int fd, const void *buf, size_t count)
+{
+	struct cansim_node *n;
+	const CANMsg *msgs = buf;
+	int max, cnt;
+
+	pthread_mutex_lock(&sim.lock);
+	n = fd_node(fd);
+	if ( !n )
+		goto fail;
+	max = count / sizeof(CANMsg);
+	if ( (max < 1) || (count % sizeof(CANMsg)) ) {
+		errno = EINVAL;
+		goto fail;
+	}
+	if ( !n->started ) {
+		errno = EBUSY;
+		goto fail;
+	}
+	while ( n->tx_cnt >= n->txlen ) {
+		if ( !n->txblk ) {
+			errno = ETIMEDOUT;
+			goto fail;
+		}
+		pthread_cond_wait(&n->tx_cond, &sim.lock);
+		if ( !n->started ) {
+			errno = EBUSY;
+			goto fail;
+		}
+	}
+	for (cnt=0; (cnt < max) && (n->tx_cnt < n->txlen); cnt++) {
+		n->tx[(n->tx_tail + n->tx_cnt) % n->txlen] = msgs[cnt];
+		n->tx_cnt++;
+	}
+	pthread_cond_signal(&sim.buses[n->bus].work);
+	pthread_mutex_unlock(&sim.lock);
+
+	return cnt * sizeof(CANMsg);
+
+fail:
+	pthread_mutex_unlock(&sim.lock);
+	return -1;
+}
+
+int cansim_ioctl(int fd, unsigned long cmd, ...)
+{
+	struct cansim_node *n;
+	unsigned int val = 0;
+	void *ptr = NULL;
+	va_list ap;
+	int ret = -1;
+
+	va_start(ap, cmd);
+	switch ( cmd ) {
+	case OCCAN_IOC_GET_STATS:
+	case OCCAN_IOC_GET_STATUS:
+	case OCCAN_IOC_SET_FILTER:
+	case OCCAN_IOC_GET_CONF:
+		ptr = va_arg(ap, void *);
+		break;
+	default:
+		val = va_arg(ap, unsigned int);
+		break;
+	}
+	va_end(ap);
+
+	pthread_mutex_lock(&sim.lock);
+	n = fd_node(fd);
+	if ( !n )
+		goto out;
+
+	switch ( cmd ) {
+	case OCCAN_IOC_START:
+		if ( n->started ) {
+			errno = EBUSY;
+			goto out;
+		}
+		n->started = 1;
+		pthread_cond_signal(&sim.buses[n->bus].work);
+		break;
+
+	case OCCAN_IOC_STOP:
+		if ( !n->started ) {
+			errno = EBUSY;
+			goto out;
+		}
+		n->started = 0;
+		n->tx_cnt = 0;
+		pthread_cond_broadcast(&n->rx_cond);
+		pthread_cond_broadcast(&n->tx_cond);
+		break;
+
+	case OCCAN_IOC_GET_STATS:
+		if ( !ptr ) {
+			errno = EINVAL;
+			goto out;
+		}
+		memcpy(ptr, &n->stats, sizeof(occan_stats));
+		break;
+
+	case OCCAN_IOC_GET_STATUS:
+		if ( !ptr ) {
+			errno = EINVAL;
+			goto out;
+		}
+		*(unsigned int *)ptr = 0;
+		break;
+
+	case OCCAN_IOC_SET_SPEED:
+		/* All nodes share the bus bitrate */
+		if ( n->started ) {
+			errno = EBUSY;
+			goto out;
+		}
+		if ( val == 0 ) {
+			errno = EINVAL;
+			goto out;
+		}
+		sim.bitrate = val;
+		break;
+
+	case OCCAN_IOC_SET_BTRS:
+		/* Accepted, the bus bitrate is not changed */
+		if ( n->started ) {
+			errno = EBUSY;
+			goto out;
+		}
+		break;
+
+	case OCCAN_IOC_SET_FILTER:
+		if ( n->started ) {
+			errno = EBUSY;
+			goto out;
+		}
+		if ( !ptr ) {
+			errno = EINVAL;
+			goto out;
+		}
+		memcpy(&n->filt, ptr, sizeof(struct occan_afilter));
+		break;
+
+	case OCCAN_IOC_SET_BLK_MODE:
+		n->rxblk = (val & OCCAN_BLK_MODE_RX) ? 1 : 0;
+		n->txblk = (val & OCCAN_BLK_MODE_TX) ? 1 : 0;
+		break;
+
+	case OCCAN_IOC_SET_BUFLEN:
+		if ( n->started ) {
+			errno = EBUSY;
+			goto out;
+		}
+		if ( set_buflen(n, val >> 16, val & 0xffff) ) {
+			errno = ENOMEM;
+			goto out;
+		}
+		break;
+
+	default:
+		errno = EINVAL;
+		goto out;
+	}
+	ret = 0;
+
+out:
+	pthread_mutex_unlock(&sim.lock);
+	return ret;
+}
@@ -0,0 +1,74 @@
+/* Linux CAN bus simulator
+ *
+ * Simulates CAN buses with a number of OC-CAN nodes. Every node behaves
+ * like the RTEMS OC-CAN driver seen through open/read/write/ioctl, so the
+ * real occan_lib.c runs unchanged on top of it (see occan.h). Application
+ * code for each node runs in its own thread.
+ *
+ * A bus thread arbitrates between the nodes' TX buffers by CAN ID, lowest
+ * arbitration field wins and the others count an arbitration loss at the
+ * first differing bit. The length of every frame is calculated bit by bit,
+ * including stuff bits and CRC, and the bus thread paces the frames in real
+ * time at the configured bitrate. Optionally frames are destroyed by error
+ * frames at random and retransmitted.
+ *
+ * Nodes are on bus 0 unless cansim_cfg.bus[] places them on another bus.
+ * Every bus has its own thread and simulated time, cansim_time_ns() and
+ * cansim_get_stats() refer to bus 0.
+ */
+
+#ifndef __CANSIM_H__
+#define __CANSIM_H__
+
+#include <sys/types.h>
+
+#define CANSIM_NODES_MAX	16
+#define CANSIM_BUSES_MAX	4
+
+struct cansim_cfg {
+	int nodes;		/* Number of nodes, /dev/occan0.. */
+	unsigned int bitrate;	/* Initial bitrate, changed by SET_SPEED */
+	unsigned int err_rate;	/* One error frame per err_rate frames, 0=off */
+	int fast;		/* Do not pace in real time, run bus flat out */
+	unsigned char bus[CANSIM_NODES_MAX];	/* Bus of each node, default 0 */
+};
+
+struct cansim_bus_stats {
+	unsigned long long frames;	/* Frames transmitted successfully */
+	unsigned long long bits;	/* Bus bits used, including errors */
+	unsigned long long stuff_bits;
+	unsigned int err_frames;
+	unsigned int arb_losses;
+	unsigned long long busy_ns;	/* Simulated bus time busy */
+	unsigned long long time_ns;	/* Simulated time since start */
+};
+
+/* Start simulator with one thread per bus, returns 0 on success */
+int cansim_init(struct cansim_cfg *cfg);
+
+/* Stop bus threads and free all nodes */
+void cansim_exit(void);
+
+/* Simulated bus time [ns] */
+unsigned long long cansim_time_ns(void);
+
+void cansim_get_stats(struct cansim_bus_stats *stats);
+
+void cansim_get_bus_stats(int bus, struct cansim_bus_stats *stats);
+
+void cansim_stats_print(void);
+
+/* Number of bits of a frame on the bus: stuffed SOF..CRC, CRC delimiter,
+ * ACK, EOF and intermission.
+ */
+int cansim_frame_bits(int extended, int rtr, unsigned int id,
+	int len, unsigned char *data, int *stuff_bits);
+
+/* Simulated driver entry points, see occan.h CANSIM_REDIRECT */
+int cansim_open(const char *name, int flags, ...);
+int cansim_close(int fd);
+ssize_t cansim_read(int fd, void *buf, size_t count);
+ssize_t cansim_write(int fd, const void *buf, size_t count);
+int cansim_ioctl(int fd, unsigned long cmd, ...);
+
+#endif
@@ -0,0 +1,988 @@
+/* CAN throughput and latency benchmarks on the Linux CAN bus simulator
+ *
+ * Every simulated node is driven through the real occan_lib.c, and the
+ * occan_lib extensions (software filter, lease receive, priority TX queue)
+ * run unchanged on top of it. Each test prints what the bus could carry in
+ * theory next to what the software achieved.
+ *
+ *  flood   node0 sends back-to-back, node1 receives with recv_multiple()
+ *  lease   as flood, node1 receives with the lease interface
+ *  filter  node1 sorts a mixed ID stream with the software filter
+ *  txq     node0 sends bulk and control traffic through the priority TX
+ *          queue, while node2 sends mid priority traffic
+ *  rec     node1 records a mixed ID stream with the recorder, a drain
+ *          task writes the blocks to cansim_rec.bin for canrec
+ *  gw      the gateway on node1 and node3 forwards part of node0's
+ *          traffic with rewritten IDs and a rate limit, node2 counts
+ *  isotp   node0 sends 4095 byte messages on two concurrent ISO-TP
+ *          sessions, node1 reassembles and verifies them
+ *  stats   node1's driver counters are sampled into the statistics ring
+ *          while another task queries rates, the estimated bus load is
+ *          compared with the simulator's and the ring dumped to
+ *          cansim_stats.bin for canstat
+ *
+ * usage: cansim_bench [-b BITRATE] [-s SECONDS] [-e ERR_RATE] [-f] [TEST..]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "occan.h"
+#include "cansim.h"
+#include "../occan_lib.h"
+#include "../occan_filter.h"
+#include "../occan_lease.h"
+#include "../occan_txq.h"
+#include "../occan_rec.h"
+#include "../canseq.h"
+#include "../occan_gw.h"
+#include "../occan_isotp.h"
+#include "../canstats.h"
+
+#define BATCH 32
+
+struct cansim_cfg cfg = {3, 1000000, 0, 0};
+int secs = 2;
+volatile int stop;
+
+/* Per receiver results */
+struct rx_result {
+	unsigned int msgs;
+	unsigned int lost;	/* Gaps in sequence numbers */
+	unsigned int reads;
+};
+
+/* Payload is a canseq sequence number and CRC */
+static void msg_init(CANMsg *msg, unsigned int id, unsigned int seq)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->id = id;
+	msg->len = 8;
+	canseq_make(seq, msg->data, 8);
+}
+
+static occan_t node_open(int node, int txblk, int rxblk, int txlen, int rxlen)
+{
+	char name[20];
+	occan_t chan;
+
+	sprintf(name, "/dev/occan%d", node);
+	chan = occanlib_open(name);
+	if ( !chan )
+		exit(1);
+	occanlib_set_speed(chan, cfg.bitrate);
+	occanlib_set_buf_length(chan, txlen, rxlen);
+	occanlib_set_blocking_mode(chan, txblk, rxblk);
+	return chan;
+}
+
+/*** flood sender, used by several tests ***/
+struct flood_arg {
+	occan_t chan;
+	unsigned int id;
+	unsigned int id_mod;	/* IDs id..id+id_mod-1, 0=single ID */
+	int batch;		/* Messages per burst, 0=BATCH */
+	int gap_us;		/* Pause between bursts, 0=back-to-back */
+	unsigned int sent;
+};
+
+static void *flood_task(void *arg)
+{
+	struct flood_arg *fa = arg;
+	CANMsg msgs[BATCH];
+	unsigned int seq = 0, id;
+	int i, left, ret, batch;
+
+	batch = fa->batch ? fa->batch : BATCH;
+	occanlib_start(fa->chan);
+	while ( !stop ) {
+		for (i=0; i<batch; i++) {
+			id = fa->id_mod ? fa->id + ((seq + i) % fa->id_mod) : fa->id;
+			msg_init(&msgs[i], id, seq + i);
+		}
+		left = batch;
+		while ( (left > 0) && !stop ) {
+			ret = occanlib_send_multiple(fa->chan, &msgs[batch-left], left);
+			if ( ret < 0 )
+				return NULL;
+			left -= ret;
+		}
+		seq += batch - left;
+		fa->sent = seq;
+		if ( fa->gap_us )
+			usleep(fa->gap_us);
+	}
+	return NULL;
+}
+
+struct rx_arg {
+	occan_t chan;
+	int lease;
+	canseq_t seq;
+	struct rx_result res;
+};
+
+static void *rx_task(void *arg)
+{
+	struct rx_arg *ra = arg;
+	CANMsg msgs[BATCH];
+	struct occan_lease_batch batch;
+	occan_lease_t ls = NULL;
+	struct canseq_stats st;
+	int i, cnt;
+
+	ra->seq = canseq_create();
+	if ( ra->lease )
+		ls = occanlib_lease_create(ra->chan, 256);
+	occanlib_start(ra->chan);
+	while ( 1 ) {
+		if ( ls ) {
+			cnt = occanlib_lease_recv(ls, &batch, 256);
+			if ( cnt < 0 )
+				break;
+			for (i=0; i<cnt; i++)
+				canseq_check(ra->seq, batch.msgs[i].data, batch.msgs[i].len);
+			occanlib_lease_release(ls, cnt);
+		} else {
+			cnt = occanlib_recv_multiple(ra->chan, msgs, BATCH);
+			if ( cnt < 0 )
+				break;
+			for (i=0; i<cnt; i++)
+				canseq_check(ra->seq, msgs[i].data, msgs[i].len);
+		}
+		ra->res.reads++;
+	}
+	if ( ls )
+		occanlib_lease_free(ls);
+	canseq_get_stats(ra->seq, &st);
+	ra->res.msgs = st.msgs;
+	ra->res.lost = st.lost + st.dups + st.late + st.crc_errs;
+	canseq_free(ra->seq);
+	return NULL;
+}
+
+/* Bus statistics, and frames/s the bus can carry with the average frame
+ * length seen
+ */
+static double report_bus(void)
+{
+	struct cansim_bus_stats st;
+	double bits;
+
+	cansim_get_stats(&st);
+	bits = st.frames ? (double)st.bits / st.frames : 0.0;
+	printf("  bus: %llu frames, %.1f bits/frame, %u error frames, "
+		"%u arbitration losses, load %.1f%%\n",
+		st.frames, bits, st.err_frames, st.arb_losses,
+		st.time_ns ? (100.0 * st.busy_ns) / st.time_ns : 0.0);
+	return bits ? cfg.bitrate / bits : 0.0;
+}
+
+/* Run flood test, receiving with read or lease */
+static int test_flood(int lease)
+{
+	struct flood_arg fa;
+	struct rx_arg ra;
+	pthread_t tx, rx;
+	occan_stats stats;
+	unsigned long long t0, t;
+	double max;
+
+	cansim_init(&cfg);
+	memset(&fa, 0, sizeof(fa));
+	memset(&ra, 0, sizeof(ra));
+	fa.chan = node_open(0, 1, 1, 64, 8);
+	fa.id = 0x123;
+	ra.chan = node_open(1, 1, 1, 8, 256);
+	ra.lease = lease;
+	stop = 0;
+
+	pthread_create(&rx, NULL, rx_task, &ra);
+	pthread_create(&tx, NULL, flood_task, &fa);
+	t0 = cansim_time_ns();
+	sleep(secs);
+	stop = 1;
+	pthread_join(tx, NULL);
+	t = cansim_time_ns() - t0;
+	occanlib_stop(ra.chan);
+	pthread_join(rx, NULL);
+	occanlib_get_stats(ra.chan, &stats);
+
+	max = report_bus();
+	printf("%s: %u msgs in %.3f s bus time: %.0f msgs/s (bus max %.0f), "
+		"%.0f msgs/s wall, lost %u, overruns %u, %u reads\n",
+		lease ? "lease" : "flood", ra.res.msgs, t * 1e-9,
+		ra.res.msgs / (t * 1e-9), max, (double)ra.res.msgs / secs,
+		ra.res.lost, stats.err_dovr, ra.res.reads);
+
+	occanlib_close(fa.chan);
+	occanlib_close(ra.chan);
+	cansim_exit();
+	return ra.res.lost != stats.err_dovr;
+}
+
+/*** filter test ***/
+struct filt_arg {
+	occan_t chan;
+	occan_filter_t flt;
+	int subs[2];
+	unsigned int taken[2];
+	unsigned int bad;
+};
+
+static void *filt_rx_task(void *arg)
+{
+	struct filt_arg *fa = arg;
+	CANMsg msgs[BATCH];
+	int i, j, cnt;
+
+	occanlib_start(fa->chan);
+	while ( occanlib_filter_recv(fa->flt, fa->chan) >= 0 ) {
+		for (j=0; j<2; j++) {
+			while ( (cnt = occanlib_filter_take(fa->flt, fa->subs[j], msgs, BATCH)) > 0 ) {
+				fa->taken[j] += cnt;
+				for (i=0; i<cnt; i++) {
+					/* sub0: 0x100..0x10f, sub1: 0x140 */
+					if ( (j == 0) && ((msgs[i].id & ~0xf) != 0x100) )
+						fa->bad++;
+					if ( (j == 1) && (msgs[i].id != 0x140) )
+						fa->bad++;
+				}
+			}
+		}
+	}
+	return NULL;
+}
+
+static int test_filter(void)
+{
+	struct flood_arg fa;
+	struct filt_arg fr;
+	struct occan_filter_stats fst;
+	struct occan_afilter af;
+	occan_stats stats;
+	pthread_t tx, rx;
+
+	cansim_init(&cfg);
+	memset(&fa, 0, sizeof(fa));
+	memset(&fr, 0, sizeof(fr));
+	fa.chan = node_open(0, 1, 1, 64, 8);
+	fa.id = 0x100;
+	fa.id_mod = 0x80;	/* IDs 0x100..0x17f */
+	fr.chan = node_open(1, 1, 1, 8, 256);
+	fr.flt = occanlib_filter_create(4);
+	fr.subs[0] = occanlib_filter_subscribe(fr.flt, 256, NULL, NULL);
+	fr.subs[1] = occanlib_filter_subscribe(fr.flt, 256, NULL, NULL);
+	occanlib_filter_add_std(fr.flt, fr.subs[0], 0x100, 0x10f);
+	occanlib_filter_add_std(fr.flt, fr.subs[1], 0x140, 0x140);
+	occanlib_filter_apply(fr.flt, fr.chan);
+	stop = 0;
+
+	pthread_create(&rx, NULL, filt_rx_task, &fr);
+	pthread_create(&tx, NULL, flood_task, &fa);
+	sleep(secs);
+	stop = 1;
+	pthread_join(tx, NULL);
+	occanlib_stop(fr.chan);
+	pthread_join(rx, NULL);
+
+	occanlib_get_stats(fr.chan, &stats);
+	occanlib_filter_get_stats(fr.flt, &fst);
+	occanlib_filter_hw(fr.flt, &af);
+	printf("filter: sent %u, HW passed %u (code 0x%02x%02x mask 0x%02x%02x), "
+		"SW rejected %u, sub0 %u, sub1 %u, misrouted %u\n",
+		fa.sent, stats.rx_msgs, af.code[0], af.code[1], af.mask[0], af.mask[1],
+		fst.rejected, fr.taken[0], fr.taken[1], fr.bad);
+	report_bus();
+
+	occanlib_filter_free(fr.flt);
+	occanlib_close(fa.chan);
+	occanlib_close(fr.chan);
+	cansim_exit();
+	return fr.bad != 0;
+}
+
+/*** priority TX queue test ***/
+occan_txq_t txq;
+
+/* TX task: blocking pump, one message per call so that a newly queued
+ * control message is next after the driver buffer.
+ */
+static void *txq_pump_task(void *arg)
+{
+	occan_t chan = arg;
+
+	occanlib_start(chan);
+	while ( !stop ) {
+		if ( occanlib_txq_count(txq) == 0 ) {
+			usleep(50);
+			continue;
+		}
+		if ( occanlib_txq_pump(txq) < 0 )
+			break;
+	}
+	return NULL;
+}
+
+static int test_txq(void)
+{
+	struct flood_arg fa;
+	struct rx_arg ra;
+	struct occan_txq_class_stats st;
+	pthread_t tx, rx, pump;
+	occan_t chan;
+	CANMsg bulk[16], ctrl;
+	int i, loops;
+
+	cansim_init(&cfg);
+	memset(&fa, 0, sizeof(fa));
+	memset(&ra, 0, sizeof(ra));
+	chan = node_open(0, 1, 0, OCCAN_TXQ_DRV_LEN, 8);
+	fa.chan = node_open(2, 1, 1, 64, 8);
+	fa.id = 0x300;
+	fa.batch = 4;
+	fa.gap_us = 1000;
+	ra.chan = node_open(1, 1, 1, 8, 256);
+	stop = 0;
+
+	txq = occanlib_txq_create(chan, 1024);
+	occanlib_txq_set_class(txq, 0, 0x0ff);
+	for (i=0; i<16; i++)
+		msg_init(&bulk[i], 0x600 + i, i);
+	msg_init(&ctrl, 0x010, 0);
+
+	pthread_create(&rx, NULL, rx_task, &ra);
+	pthread_create(&tx, NULL, flood_task, &fa);
+	pthread_create(&pump, NULL, txq_pump_task, chan);
+	for (loops=0; loops<secs*1000; loops++) {
+		occanlib_txq_put(txq, bulk, 4);
+		if ( (loops & 3) == 0 )
+			occanlib_txq_put(txq, &ctrl, 1);
+		usleep(1000);
+	}
+	stop = 1;
+	pthread_join(tx, NULL);
+	pthread_join(pump, NULL);
+	occanlib_stop(ra.chan);
+	pthread_join(rx, NULL);
+
+	printf("txq: control ID 0x010 every 4 ms and 4 bulk msgs/ms queued, "
+		"4 msgs/ms at ID 0x300 from another node\n");
+	occanlib_txq_stats_print(txq);
+	report_bus();
+
+	/* Control messages must never wait for the bulk backlog */
+	occanlib_txq_get_stats(txq, 0, &st);
+	occanlib_txq_free(txq);
+	occanlib_close(chan);
+	occanlib_close(fa.chan);
+	occanlib_close(ra.chan);
+	cansim_exit();
+	return st.dropped != 0;
+}
+
+/*** recorder test ***/
+#define REC_FILE "cansim_rec.bin"
+
+struct rec_arg {
+	occan_rec_t rec;
+	FILE *f;
+	unsigned int written;	/* Blocks written by drain task */
+	volatile int done;
+};
+
+/* Record everything, flush at least every 100 ms so that the drain task
+ * gets data also at low message rates.
+ */
+static void *rec_task(void *arg)
+{
+	struct rec_arg *ra = arg;
+	unsigned long long last = cansim_time_ns();
+
+	while ( occanlib_rec_poll(ra->rec) >= 0 ) {
+		if ( cansim_time_ns() - last > 100000000ULL ) {
+			occanlib_rec_flush(ra->rec);
+			last = cansim_time_ns();
+		}
+	}
+	occanlib_rec_flush(ra->rec);
+	ra->done = 1;
+	return NULL;
+}
+
+static void *drain_task(void *arg)
+{
+	struct rec_arg *ra = arg;
+	unsigned char *blk;
+
+	while ( 1 ) {
+		blk = occanlib_rec_peek(ra->rec);
+		if ( !blk ) {
+			if ( ra->done )
+				break;
+			usleep(1000);
+			continue;
+		}
+		if ( fwrite(blk, CANREC_BLOCK_SIZE, 1, ra->f) != 1 )
+			break;
+		occanlib_rec_release(ra->rec);
+		ra->written++;
+	}
+	return NULL;
+}
+
+/* Wait until the bus is idle and the recorder has read every received
+ * message. In fast mode the driver buffer is full when the flood stops,
+ * and occanlib_stop() would drop what is left in it.
+ */
+static void rec_settle(occan_t chan, occan_rec_t rec)
+{
+	struct occan_rec_stats st;
+	occan_stats stats;
+	unsigned int last = ~0U;
+	int i;
+
+	for (i=0; i<1000; i++) {
+		occanlib_get_stats(chan, &stats);
+		occanlib_rec_get_stats(rec, &st);
+		if ( (stats.rx_msgs == last) && (st.msgs + st.lost == stats.rx_msgs) )
+			return;
+		last = stats.rx_msgs;
+		usleep(1000);
+	}
+}
+
+static int test_rec(void)
+{
+	struct flood_arg fa;
+	struct rec_arg ra;
+	struct occan_rec_stats st;
+	occan_stats stats;
+	pthread_t tx, rx, drain;
+	occan_t chan;
+
+	cansim_init(&cfg);
+	memset(&fa, 0, sizeof(fa));
+	memset(&ra, 0, sizeof(ra));
+	fa.chan = node_open(0, 1, 1, 64, 8);
+	fa.id = 0x100;
+	fa.id_mod = 3;		/* Short runs of equal IDs are common */
+	chan = node_open(1, 1, 1, 8, 256);
+	ra.rec = occanlib_rec_create(chan, 64, 256);
+	ra.f = fopen(REC_FILE, "wb");
+	if ( !ra.rec || !ra.f )
+		return 1;
+	stop = 0;
+
+	occanlib_start(chan);
+	pthread_create(&rx, NULL, rec_task, &ra);
+	pthread_create(&drain, NULL, drain_task, &ra);
+	pthread_create(&tx, NULL, flood_task, &fa);
+	sleep(secs);
+	stop = 1;
+	pthread_join(tx, NULL);
+	rec_settle(chan, ra.rec);
+	occanlib_stop(chan);
+	pthread_join(rx, NULL);
+	pthread_join(drain, NULL);
+	fclose(ra.f);
+
+	occanlib_get_stats(chan, &stats);
+	occanlib_rec_get_stats(ra.rec, &st);
+	printf("rec: sent %u, received %u, recorded %u, lost %u, "
+		"%u blocks written to " REC_FILE ", %.1f bytes/msg\n",
+		fa.sent, stats.rx_msgs, st.msgs, st.lost, ra.written,
+		st.msgs ? (double)st.bytes / st.msgs : 0.0);
+	report_bus();
+
+	occanlib_rec_free(ra.rec);
+	occanlib_close(fa.chan);
+	occanlib_close(chan);
+	cansim_exit();
+	return (st.msgs + st.lost != stats.rx_msgs) || (ra.written != st.blocks);
+}
+
+/*** gateway test ***/
+occan_gw_t gw;
+
+static void *gw_task(void *arg)
+{
+	int ret;
+
+	while ( !stop ) {
+		ret = occanlib_gw_poll(gw);
+		if ( ret < 0 )
+			break;
+		if ( ret == 0 )
+			usleep(100);
+	}
+	return NULL;
+}
+
+struct gw_rx_arg {
+	occan_t chan;
+	unsigned int fwd0;	/* 0x500..0x50f, route 0 */
+	unsigned int fwd1;	/* 0x640, route 1 */
+	unsigned int same;	/* 0x110..0x11f, route 2 */
+};
+
+static void *gw_rx_task(void *arg)
+{
+	struct gw_rx_arg *ra = arg;
+	CANMsg msgs[BATCH];
+	int i, cnt;
+
+	occanlib_start(ra->chan);
+	while ( (cnt = occanlib_recv_multiple(ra->chan, msgs, BATCH)) >= 0 ) {
+		for (i=0; i<cnt; i++) {
+			if ( (msgs[i].id & ~0xf) == 0x500 )
+				ra->fwd0++;
+			else if ( msgs[i].id == 0x640 )
+				ra->fwd1++;
+			else if ( (msgs[i].id & ~0xf) == 0x110 )
+				ra->same++;
+		}
+	}
+	return NULL;
+}
+
+/* Gateway between two simulated buses: node0 floods bus 0, the gateway
+ * receives it on node1 and forwards to bus 1 through node3, where node2
+ * counts. Route 0 and 1 rewrite the ID, route 1 is rate limited and route
+ * 2 forwards unchanged straight from the lease ring.
+ */
+static int test_gw(void)
+{
+	struct cansim_cfg gw_cfg = cfg;
+	struct flood_arg fa;
+	struct gw_rx_arg ra;
+	struct occan_gw_route route;
+	struct occan_gw_route_stats st[3];
+	struct occan_gw_stats gst;
+	struct cansim_bus_stats bst;
+	pthread_t tx, rx, gwt;
+	occan_t c1, c3;
+	int i, fail = 0;
+
+	gw_cfg.nodes = 4;
+	gw_cfg.bus[2] = 1;
+	gw_cfg.bus[3] = 1;
+	cansim_init(&gw_cfg);
+	memset(&fa, 0, sizeof(fa));
+	memset(&ra, 0, sizeof(ra));
+	fa.chan = node_open(0, 1, 1, 64, 8);
+	fa.id = 0x100;
+	fa.id_mod = 0x80;
+	fa.batch = 8;
+	fa.gap_us = 2000;
+	ra.chan = node_open(2, 1, 1, 8, 256);
+	c1 = node_open(1, 0, 0, 32, 256);
+	c3 = node_open(3, 0, 0, 32, 256);
+	occanlib_start(c1);
+	occanlib_start(c3);
+
+	gw = occanlib_gw_create();
+	occanlib_gw_add_chan(gw, c1, 256);
+	occanlib_gw_add_chan(gw, c3, 256);
+	memset(&route, 0, sizeof(route));
+	route.in = 0;
+	route.id = 0x100;
+	route.mask = 0x7f0;
+	route.out = 0x2;
+	route.rw_mask = 0x700;
+	route.rw_id = 0x500;
+	occanlib_gw_add_route(gw, &route);
+	route.id = 0x140;
+	route.mask = 0x7ff;
+	route.out = 0x2;
+	route.rw_mask = 0x7ff;
+	route.rw_id = 0x640;
+	route.rate = 10;
+	route.burst = 4;
+	occanlib_gw_add_route(gw, &route);
+	route.id = 0x110;
+	route.mask = 0x7f0;
+	route.rw_mask = 0;
+	route.rate = 0;
+	occanlib_gw_add_route(gw, &route);
+	stop = 0;
+
+	pthread_create(&rx, NULL, gw_rx_task, &ra);
+	pthread_create(&gwt, NULL, gw_task, NULL);
+	pthread_create(&tx, NULL, flood_task, &fa);
+	sleep(secs);
+	stop = 1;
+	pthread_join(tx, NULL);
+	pthread_join(gwt, NULL);
+	usleep(10000);
+	occanlib_stop(ra.chan);
+	pthread_join(rx, NULL);
+
+	printf("gw: node0 sent %u, node2 got %u via route 0, %u via route 1, "
+		"%u via route 2\n", fa.sent, ra.fwd0, ra.fwd1, ra.same);
+	occanlib_gw_stats_print(gw);
+	report_bus();
+	cansim_get_bus_stats(1, &bst);
+	printf("  bus1: %llu frames, load %.1f%%\n", bst.frames,
+		bst.time_ns ? (100.0 * bst.busy_ns) / bst.time_ns : 0.0);
+
+	occanlib_gw_get_stats(gw, &gst);
+	for (i=0; i<3; i++) {
+		occanlib_gw_get_route_stats(gw, i, &st[i]);
+		if ( st[i].tx_drops )
+			fail = 1;
+	}
+	/* Rate limit of route 1 */
+	if ( st[1].sent > 10 * secs + 4 )
+		fail = 1;
+	if ( (ra.fwd0 != st[0].sent) || (ra.fwd1 != st[1].sent) ||
+	     (ra.same != st[2].sent) || (st[0].sent == 0) )
+		fail = 1;
+
+	occanlib_gw_free(gw);
+	occanlib_close(fa.chan);
+	occanlib_close(ra.chan);
+	occanlib_close(c1);
+	occanlib_close(c3);
+	cansim_exit();
+	return fail;
+}
+
+/*** ISO-TP transport test ***/
+#define TP_SESS 2
+#define TP_LEN OCCAN_ISOTP_LEN_MAX
+#define TP_BS 8
+
+volatile int tp_rx_stop;
+
+/* Payload of message n on session sess */
+static unsigned char tp_byte(int sess, unsigned int n, int i)
+{
+	return n * 31 + i + sess * 7;
+}
+
+struct tp_tx_arg {
+	occan_isotp_t tp;
+	unsigned char data[TP_SESS][TP_LEN];
+	unsigned int started[TP_SESS];
+	unsigned int errs;
+};
+
+static void *tp_tx_task(void *arg)
+{
+	struct tp_tx_arg *ta = arg;
+	int s, i, ret, busy = 1;
+
+	while ( !stop || busy ) {
+		busy = 0;
+		for (s=0; s<TP_SESS; s++) {
+			ret = occanlib_isotp_tx_status(ta->tp, s);
+			if ( ret == OCCAN_ISOTP_BUSY ) {
+				busy = 1;
+				continue;
+			}
+			if ( ret < 0 )
+				ta->errs++;
+			if ( stop )
+				continue;
+			for (i=0; i<TP_LEN; i++)
+				ta->data[s][i] = tp_byte(s, ta->started[s], i);
+			occanlib_isotp_send(ta->tp, s, ta->data[s], TP_LEN);
+			ta->started[s]++;
+			busy = 1;
+		}
+		ret = occanlib_isotp_poll(ta->tp);
+		if ( ret < 0 )
+			break;
+		if ( ret == 0 )
+			usleep(50);
+	}
+	return NULL;
+}
+
+struct tp_rx_arg {
+	occan_isotp_t tp;
+	unsigned int next[TP_SESS];	/* Expected message number */
+	unsigned int bad;
+};
+
+static void *tp_rx_task(void *arg)
+{
+	struct tp_rx_arg *ra = arg;
+	struct occan_isotp_msg msg;
+	int i, ret;
+
+	while ( !tp_rx_stop ) {
+		ret = occanlib_isotp_poll(ra->tp);
+		if ( ret < 0 )
+			break;
+		while ( occanlib_isotp_recv(ra->tp, &msg) ) {
+			for (i=0; i<msg.len; i++) {
+				if ( msg.data[i] != tp_byte(msg.sess, ra->next[msg.sess], i) )
+					break;
+			}
+			if ( (msg.len != TP_LEN) || (i < msg.len) )
+				ra->bad++;
+			ra->next[msg.sess]++;
+			occanlib_isotp_release(ra->tp, msg.data);
+		}
+		if ( ret == 0 )
+			usleep(50);
+	}
+	return NULL;
+}
+
+static int test_isotp(void)
+{
+	static struct tp_tx_arg ta;
+	struct tp_rx_arg ra;
+	struct occan_isotp_cfg tcfg;
+	struct occan_isotp_stats txst, rxst;
+	struct cansim_bus_stats bst;
+	occan_t c0, c1;
+	pthread_t tx, rx;
+	unsigned long long t0, t;
+	double max;
+	int s;
+
+	cansim_init(&cfg);
+	memset(&ta, 0, sizeof(ta));
+	memset(&ra, 0, sizeof(ra));
+	c0 = node_open(0, 0, 0, 32, 64);
+	c1 = node_open(1, 0, 0, 32, 64);
+	ta.tp = occanlib_isotp_create(c0, 2, 8);
+	ra.tp = occanlib_isotp_create(c1, 4, TP_LEN);
+	memset(&tcfg, 0, sizeof(tcfg));
+	for (s=0; s<TP_SESS; s++) {
+		/* Sender's frames win arbitration over flow control */
+		tcfg.tx_id = 0x7e0 + s;
+		tcfg.rx_id = 0x7e8 + s;
+		occanlib_isotp_add_session(ta.tp, &tcfg);
+		tcfg.tx_id = 0x7e8 + s;
+		tcfg.rx_id = 0x7e0 + s;
+		tcfg.bs = TP_BS;
+		occanlib_isotp_add_session(ra.tp, &tcfg);
+		tcfg.bs = 0;
+	}
+	occanlib_start(c0);
+	occanlib_start(c1);
+	stop = 0;
+	tp_rx_stop = 0;
+
+	pthread_create(&rx, NULL, tp_rx_task, &ra);
+	pthread_create(&tx, NULL, tp_tx_task, &ta);
+	t0 = cansim_time_ns();
+	sleep(secs);
+	stop = 1;
+	pthread_join(tx, NULL);
+	t = cansim_time_ns() - t0;
+	usleep(10000);
+	tp_rx_stop = 1;
+	pthread_join(rx, NULL);
+
+	max = report_bus();
+	cansim_get_stats(&bst);
+	occanlib_isotp_get_stats(ta.tp, &txst);
+	occanlib_isotp_get_stats(ra.tp, &rxst);
+	printf("isotp: %u msgs of %d bytes on %d sessions, block size %d, "
+		"%.0f bytes/s in %.3f s bus time (%.1f%% of bus max %.0f bytes/s)\n",
+		rxst.rx_msgs, TP_LEN, TP_SESS, TP_BS,
+		rxst.rx_bytes / (t * 1e-9), t * 1e-9,
+		max ? 100.0 * rxst.rx_bytes / (t * 1e-9) / (max * 8) : 0.0, max * 8);
+	printf("  sender ");
+	occanlib_isotp_stats_print(ta.tp);
+	printf("  receiver ");
+	occanlib_isotp_stats_print(ra.tp);
+	printf("  %u corrupt, %u transfer errors\n", ra.bad, ta.errs);
+
+	occanlib_isotp_free(ta.tp);
+	occanlib_isotp_free(ra.tp);
+	occanlib_close(c0);
+	occanlib_close(c1);
+	cansim_exit();
+	return ra.bad || ta.errs || (rxst.rx_msgs == 0) || (rxst.rx_msgs != txst.tx_msgs) ||
+		rxst.timeouts || rxst.seq_errs || rxst.overflows || rxst.unexpected;
+}
+
+/*** statistics test ***/
+#define STATS_SLOTS 128
+#define STATS_PERIOD_US 10000
+
+canstats_t cs;
+
+struct stats_arg {
+	occan_t chan;
+	struct rx_arg *ra;
+	unsigned int queries;
+	unsigned int bad;
+};
+
+/* Sampler, only copies counters. Samples are taken on the simulated bus
+ * time, which is not real time in fast mode.
+ */
+static void *stats_sample_task(void *arg)
+{
+	struct stats_arg *sa = arg;
+	struct canstats_cnt cnt;
+	occan_stats st;
+
+	memset(&cnt, 0, sizeof(cnt));
+	while ( !stop ) {
+		occanlib_get_stats(sa->chan, &st);
+		cnt.rx_msgs = st.rx_msgs;
+		cnt.tx_msgs = st.tx_msgs;
+		cnt.bus_errs = st.err_bus;
+		cnt.overruns = st.err_dovr;
+		cnt.passive = st.err_errp;
+		cnt.app[0] = sa->ra->res.reads;
+		canstats_sample_at(cs, &cnt, cansim_time_ns() / 1000);
+		usleep(STATS_PERIOD_US);
+	}
+	return NULL;
+}
+
+/* Reader racing the sampler, no frame is shorter than 44 bits */
+static void *stats_query_task(void *arg)
+{
+	struct stats_arg *sa = arg;
+	struct canstats_rates r;
+
+	while ( !stop ) {
+		if ( canstats_rates(cs, 100000, &r) == 0 ) {
+			sa->queries++;
+			if ( (r.span_us == 0) || (r.rx_rate > cfg.bitrate / 44) || (r.load > 1100) )
+				sa->bad++;
+		}
+		usleep(100);
+	}
+	return NULL;
+}
+
+static int test_stats(void)
+{
+	static unsigned char dump[CANSTATS_HDR_SIZE + STATS_SLOTS * 5 * (1 + CANSTATS_CNTS)];
+	struct flood_arg fa;
+	struct rx_arg ra;
+	struct stats_arg sa;
+	struct canstats_rates r;
+	struct cansim_bus_stats bst;
+	pthread_t tx, rx, smp, qry;
+	unsigned int sim_load;
+	int len, fail = 0;
+	FILE *f;
+
+	cansim_init(&cfg);
+	memset(&fa, 0, sizeof(fa));
+	memset(&ra, 0, sizeof(ra));
+	memset(&sa, 0, sizeof(sa));
+	fa.chan = node_open(0, 1, 1, 64, 8);
+	fa.id = 0x123;
+	ra.chan = node_open(1, 1, 1, 8, 256);
+	sa.chan = ra.chan;
+	sa.ra = &ra;
+	cs = canstats_create(STATS_SLOTS, cfg.bitrate, 0);
+	stop = 0;
+
+	pthread_create(&rx, NULL, rx_task, &ra);
+	pthread_create(&smp, NULL, stats_sample_task, &sa);
+	pthread_create(&qry, NULL, stats_query_task, &sa);
+	pthread_create(&tx, NULL, flood_task, &fa);
+	sleep(secs);
+	stop = 1;
+	pthread_join(tx, NULL);
+	pthread_join(smp, NULL);
+	pthread_join(qry, NULL);
+	cansim_get_stats(&bst);
+	occanlib_stop(ra.chan);
+	pthread_join(rx, NULL);
+
+	report_bus();
+	sim_load = bst.time_ns ? (1000 * bst.busy_ns) / bst.time_ns : 0;
+	if ( canstats_rates(cs, 1000000, &r) ) {
+		printf("stats: no rates\n");
+		fail = 1;
+	} else {
+		printf("stats: ");
+		canstats_rates_print(&r);
+		printf("  estimated load %u.%u%%, simulator %u.%u%%, %u queries, %u bad\n",
+			r.load / 10, r.load % 10, sim_load / 10, sim_load % 10, sa.queries, sa.bad);
+		if ( (r.load + 50 < sim_load) || (r.load > sim_load + 50) )
+			fail = 1;
+	}
+
+	len = canstats_dump(cs, dump, sizeof(dump));
+	printf("  dump %d bytes, %.1f bytes/snapshot\n", len,
+		(double)(len - CANSTATS_HDR_SIZE) / (STATS_SLOTS - 1));
+	f = fopen("cansim_stats.bin", "wb");
+	if ( f ) {
+		fwrite(dump, 1, len, f);
+		fclose(f);
+	}
+
+	canstats_free(cs);
+	occanlib_close(fa.chan);
+	occanlib_close(ra.chan);
+	cansim_exit();
+	return fail || sa.bad || (sa.queries == 0) || (len <= CANSTATS_HDR_SIZE);
+}
+
+struct test {
+	char *name;
+	int (*func)(void);
+};
+
+static int test_read(void) { return test_flood(0); }
+static int test_lease(void) { return test_flood(1); }
+
+struct test tests[] = {
+	{"flood", test_read},
+	{"lease", test_lease},
+	{"filter", test_filter},
+	{"txq", test_txq},
+	{"rec", test_rec},
+	{"gw", test_gw},
+	{"isotp", test_isotp},
+	{"stats", test_stats},
+	{NULL, NULL}
+};
+
+int main(int argc, char *argv[])
+{
+	int opt, i, j, fails = 0, ran = 0;
+
+	while ( (opt = getopt(argc, argv, "b:s:e:f")) != -1 ) {
+		switch ( opt ) {
+		case 'b': cfg.bitrate = strtoul(optarg, NULL, 0); break;
+		case 's': secs = atoi(optarg); break;
+		case 'e': cfg.err_rate = strtoul(optarg, NULL, 0); break;
+		case 'f': cfg.fast = 1; break;
+		default:
+			printf("usage: %s [-b BITRATE] [-s SECONDS] [-e ERR_RATE] [-f] [TEST..]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("CAN bus simulator: %u bit/s, %d s per test, error rate %u%s\n",
+		cfg.bitrate, secs, cfg.err_rate, cfg.fast ? ", not real time" : "");
+	for (i=0; tests[i].name; i++) {
+		if ( optind < argc ) {
+			for (j=optind; j<argc; j++) {
+				if ( strcmp(argv[j], tests[i].name) == 0 )
+					break;
+			}
+			if ( j == argc )
+				continue;
+		}
+		ran++;
+		if ( tests[i].func() ) {
+			printf("%s: FAILED\n", tests[i].name);
+			fails++;
+		}
+	}
+
+	printf("%d tests, %d failed\n", ran, fails);
+	return fails ? 1 : 0;
+}
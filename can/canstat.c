@@ -0,0 +1,138 @@
+/* Reader for CAN statistics dumps made with canstats_dump()
+ *
+ * Prints the rates between consecutive snapshots, one line per interval:
+ *   time [s], rx/s, tx/s, estimated bus load, bus errors/s, overruns/s,
+ *   error passive events, application counters/s
+ * With -n the rates are taken over N snapshots instead of one.
+ *
+ * usage: canstat [-n N] FILE
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../canstats.h"
+
+#define SNAPS_MAX 0xffff
+
+struct canstats_snap snaps[SNAPS_MAX];
+
+static unsigned int get_be32(unsigned char *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int get_leb128(unsigned char **pp, unsigned char *end, unsigned int *v)
+{
+	unsigned char *p = *pp;
+	int shift = 0;
+
+	*v = 0;
+	do {
+		if ( p >= end )
+			return -1;
+		*v |= (*p & 0x7f) << shift;
+		shift += 7;
+	} while ( *p++ & 0x80 );
+	*pp = p;
+	return 0;
+}
+
+static unsigned int per_s(unsigned int d, unsigned int span_us)
+{
+	return ((unsigned long long)d * 1000000) / span_us;
+}
+
+int main(int argc, char *argv[])
+{
+	static unsigned char buf[CANSTATS_HDR_SIZE + SNAPS_MAX * 5 * (1 + CANSTATS_CNTS)];
+	FILE *f;
+	unsigned char *p, *end;
+	unsigned int bitrate, frame_bits, cnt, t0, d, *v, span, frames;
+	unsigned long long avail;
+	struct canstats_snap *old, *new;
+	int opt, n = 1, i, k, len;
+
+	while ( (opt = getopt(argc, argv, "n:")) != -1 ) {
+		switch ( opt ) {
+		case 'n': n = atoi(optarg); break;
+		default:
+			goto usage;
+		}
+	}
+	if ( (optind >= argc) || (n < 1) )
+		goto usage;
+
+	f = fopen(argv[optind], "rb");
+	if ( !f ) {
+		perror(argv[optind]);
+		return 1;
+	}
+	len = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	if ( (len < CANSTATS_HDR_SIZE) || (get_be32(&buf[0]) != CANSTATS_MAGIC) ) {
+		printf("No statistics dump in %s\n", argv[optind]);
+		return 1;
+	}
+	bitrate = get_be32(&buf[4]);
+	frame_bits = get_be32(&buf[8]) >> 16;
+	cnt = get_be32(&buf[8]) & 0xffff;
+	t0 = get_be32(&buf[12]);
+
+	/* Undo the differences */
+	p = &buf[CANSTATS_HDR_SIZE];
+	end = &buf[len];
+	memset(snaps, 0, sizeof(snaps[0]));
+	snaps[0].time_us = t0;
+	for (i=0; i<cnt; i++) {
+		if ( i > 0 )
+			snaps[i] = snaps[i-1];
+		if ( get_leb128(&p, end, &d) )
+			break;
+		snaps[i].time_us += d;
+		v = (unsigned int *)&snaps[i].cnt;
+		for (k=0; k<CANSTATS_CNTS; k++) {
+			if ( get_leb128(&p, end, &d) )
+				break;
+			v[k] += d;
+		}
+		if ( k < CANSTATS_CNTS )
+			break;
+	}
+	if ( i < cnt ) {
+		printf("Dump truncated after %d of %u snapshots\n", i, cnt);
+		cnt = i;
+	}
+
+	printf("%u snapshots over %.3f s, %u bit/s, %u bits/frame, %.1f bytes/snapshot\n",
+		cnt, cnt ? (snaps[cnt-1].time_us - t0) * 1e-6 : 0.0, bitrate, frame_bits,
+		cnt ? (double)(len - CANSTATS_HDR_SIZE) / cnt : 0.0);
+	printf("     time      rx/s      tx/s   load  errors/s  overruns/s  passive  app/s\n");
+	for (i=n; i<cnt; i+=n) {
+		old = &snaps[i-n];
+		new = &snaps[i];
+		span = new->time_us - old->time_us;
+		if ( span == 0 )
+			span = 1;
+		frames = (new->cnt.rx_msgs - old->cnt.rx_msgs) + (new->cnt.tx_msgs - old->cnt.tx_msgs);
+		avail = ((unsigned long long)span * bitrate) / 1000000;
+		printf("%9.3f %9u %9u %5.1f%% %9u %11u %8u ",
+			(new->time_us - t0) * 1e-6,
+			per_s(new->cnt.rx_msgs - old->cnt.rx_msgs, span),
+			per_s(new->cnt.tx_msgs - old->cnt.tx_msgs, span),
+			avail ? (100.0 * frames * frame_bits) / avail : 0.0,
+			per_s(new->cnt.bus_errs - old->cnt.bus_errs, span),
+			per_s(new->cnt.overruns - old->cnt.overruns, span),
+			new->cnt.passive - old->cnt.passive);
+		for (k=0; k<CANSTATS_APP_CNTS; k++)
+			printf(" %u", per_s(new->cnt.app[k] - old->cnt.app[k], span));
+		printf("\n");
+	}
+	return 0;
+
+usage:
+	printf("usage: %s [-n N] FILE\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,118 @@
+/* OC-CAN driver interface for the Linux CAN bus simulator
+ *
+ * Stand-in for the RTEMS <occan.h> when occan_lib and the code on top of it
+ * is built for Linux against the simulator in cansim.c. Only the user
+ * interface of the driver is described here: the message and statistics
+ * structures and the ioctl commands used by occan_lib.c.
+ *
+ * When CANSIM_REDIRECT is defined the POSIX calls occan_lib.c makes on the
+ * driver (open, close, read, write, ioctl) are redirected to the simulated
+ * driver. occan_lib.c includes this file after all system headers, so only
+ * the calls are renamed and not the system prototypes.
+ */
+
+#ifndef __OCCAN_H__
+#define __OCCAN_H__
+
+typedef struct {
+	char extended;		/* Extended frame (29-bit ID) */
+	char rtr;		/* Remote frame */
+	char sshot;		/* Single shot */
+	unsigned char len;
+	unsigned char data[8];
+	unsigned int id;
+} CANMsg;
+
+/* Frame segment where a bus error occured (err_bus_segs index) */
+#define OCCAN_SEG_ID28		0x02
+#define OCCAN_SEG_ID20		0x06
+#define OCCAN_SEG_ID17		0x07
+#define OCCAN_SEG_ID12		0x0f
+#define OCCAN_SEG_ID4		0x0e
+#define OCCAN_SEG_START		0x03
+#define OCCAN_SEG_SRTR		0x04
+#define OCCAN_SEG_IDE		0x05
+#define OCCAN_SEG_RTR		0x0c
+#define OCCAN_SEG_RSV0		0x09
+#define OCCAN_SEG_RSV1		0x0d
+#define OCCAN_SEG_DLEN		0x0b
+#define OCCAN_SEG_DFIELD	0x0a
+#define OCCAN_SEG_CRC_SEQ	0x08
+#define OCCAN_SEG_CRC_DELIM	0x18
+#define OCCAN_SEG_ACK_SLOT	0x19
+#define OCCAN_SEG_ACK_DELIM	0x1b
+#define OCCAN_SEG_EOF		0x1a
+#define OCCAN_SEG_INTERMISSION	0x12
+#define OCCAN_SEG_ACT_ERR	0x11
+#define OCCAN_SEG_PASS_ERR	0x16
+#define OCCAN_SEG_DOMINANT	0x13
+#define OCCAN_SEG_EDELIM	0x17
+#define OCCAN_SEG_OVERLOAD	0x1c
+
+typedef struct {
+	/* tx/rx stats */
+	volatile unsigned int rx_msgs;
+	volatile unsigned int tx_msgs;
+
+	/* Error Interrupt counters */
+	volatile unsigned int err_warn;
+	volatile unsigned int err_dovr;
+	volatile unsigned int err_errp;
+	volatile unsigned int err_arb;
+	volatile unsigned int err_bus;
+
+	/* Arbitration lost per bit (ALC) */
+	volatile unsigned int err_arb_bitnum[32];
+
+	/* Bus error type (ERRCODE) */
+	volatile unsigned int err_bus_bit;
+	volatile unsigned int err_bus_form;
+	volatile unsigned int err_bus_stuff;
+	volatile unsigned int err_bus_other;
+
+	/* Bus error direction (ERRDIR) */
+	volatile unsigned int err_bus_rx;
+	volatile unsigned int err_bus_tx;
+
+	/* Bus error segment (ERRSEG) */
+	volatile unsigned int err_bus_segs[32];
+
+	/* total number of interrupts */
+	volatile unsigned int ints;
+
+	/* software monitoring hw errors */
+	volatile unsigned int tx_buf_error;
+} occan_stats;
+
+struct occan_afilter {
+	int single_mode;
+	unsigned char code[4];
+	unsigned char mask[4];
+};
+
+#define OCCAN_BLK_MODE_RX	0x1
+#define OCCAN_BLK_MODE_TX	0x2
+
+#define OCCAN_IOC_START		1
+#define OCCAN_IOC_STOP		2
+#define OCCAN_IOC_GET_CONF	3
+#define OCCAN_IOC_GET_STATS	4
+#define OCCAN_IOC_GET_STATUS	5
+#define OCCAN_IOC_SET_SPEED	6
+#define OCCAN_IOC_SPEED_AUTO	7
+#define OCCAN_IOC_SET_LINK	8
+#define OCCAN_IOC_SET_FILTER	9
+#define OCCAN_IOC_SET_BLK_MODE	10
+#define OCCAN_IOC_SET_BUFLEN	11
+#define OCCAN_IOC_SET_BTRS	12
+
+#ifdef CANSIM_REDIRECT
+#include "cansim.h"
+#define open	cansim_open
+#define close	cansim_close
+#define read	cansim_read
+#define write	cansim_write
+#define ioctl	cansim_ioctl
+#endif
+
+#endif
@@ -0,0 +1,175 @@
+/* CAN stream sequence checker, see canseq.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "canseq.h"
+
+#define SEQ_MASK 0xffffff
+
+/* next is the expected sequence number, bit n of seen is set if
+ * next-1-n has been received.
+ */
+struct canseq_s {
+	unsigned int next;
+	unsigned long long seen;
+	int synced;
+	struct canseq_stats stats;
+};
+
+static unsigned char crc8_table[256];
+static int crc8_init;
+
+static void canseq_crc_init(void)
+{
+	unsigned int i, j, crc;
+
+	for (i=0; i<256; i++) {
+		crc = i;
+		for (j=0; j<8; j++)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		crc8_table[i] = crc;
+	}
+	crc8_init = 1;
+}
+
+static unsigned char canseq_crc(unsigned char *data, int len)
+{
+	unsigned char crc = len;
+	int i;
+
+	for (i=0; i<len-1; i++)
+		crc = crc8_table[crc ^ data[i]];
+	return crc;
+}
+
+canseq_t canseq_create(void){
+	canseq_t chk;
+
+	if ( !crc8_init )
+		canseq_crc_init();
+	chk = calloc(1, sizeof(*chk));
+	return chk;
+}
+
+void canseq_free(canseq_t chk){
+	free(chk);
+}
+
+int canseq_make(unsigned int seq, unsigned char *data, int len){
+	int i;
+
+	if ( (len < CANSEQ_MIN_LEN) || (len > 8) )
+		return -1;
+	if ( !crc8_init )
+		canseq_crc_init();
+
+	data[0] = seq >> 16;
+	data[1] = seq >> 8;
+	data[2] = seq;
+	for (i=3; i<len-1; i++)
+		data[i] = seq * 0x9d + i;
+	data[len-1] = canseq_crc(data, len);
+	return len;
+}
+
+/* Loss burst histogram bucket: 1, 2, 3-4, 5-8, ... */
+static int burst_bucket(unsigned int n)
+{
+	int b = 0;
+
+	n--;
+	while ( n && (b < CANSEQ_HIST-1) ) {
+		n >>= 1;
+		b++;
+	}
+	return b;
+}
+
+int canseq_check(canseq_t chk, unsigned char *data, int len){
+	struct canseq_stats *st = &chk->stats;
+	unsigned int seq, bit;
+	int d;
+
+	st->msgs++;
+	if ( len < CANSEQ_MIN_LEN ) {
+		st->crc_errs++;
+		return CANSEQ_SHORT;
+	}
+	if ( data[len-1] != canseq_crc(data, len) ) {
+		st->crc_errs++;
+		return CANSEQ_CRC;
+	}
+	seq = CANSEQ_SEQ(data);
+
+	/* Nothing before the first message is missing */
+	if ( !chk->synced ) {
+		chk->synced = 1;
+		chk->seen = ~0ULL;
+		chk->next = (seq + 1) & SEQ_MASK;
+		return CANSEQ_OK;
+	}
+
+	/* Signed 24-bit distance from the expected sequence number */
+	d = (int)(((seq - chk->next) & SEQ_MASK) << 8) >> 8;
+
+	if ( d == 0 ) {
+		chk->seen = (chk->seen << 1) | 1;
+		chk->next = (seq + 1) & SEQ_MASK;
+		return CANSEQ_OK;
+	}
+
+	if ( (d > 0) && (d <= CANSEQ_JUMP_MAX) ) {
+		st->lost += d;
+		st->bursts++;
+		st->hist[burst_bucket(d)]++;
+		if ( d > st->max_burst )
+			st->max_burst = d;
+		chk->seen = (d + 1 < CANSEQ_WINDOW) ? (chk->seen << (d + 1)) | 1 : 1;
+		chk->next = (seq + 1) & SEQ_MASK;
+		return CANSEQ_GAP;
+	}
+
+	if ( (d < 0) && (-d <= CANSEQ_WINDOW) ) {
+		bit = -d - 1;
+		if ( chk->seen & (1ULL << bit) ) {
+			st->dups++;
+			return CANSEQ_DUP;
+		}
+		chk->seen |= 1ULL << bit;
+		st->late++;
+		st->lost--;
+		return CANSEQ_LATE;
+	}
+
+	/* Sender restarted, messages before it are not missing */
+	st->resyncs++;
+	chk->seen = ~0ULL;
+	chk->next = (seq + 1) & SEQ_MASK;
+	return CANSEQ_RESYNC;
+}
+
+void canseq_get_stats(canseq_t chk, struct canseq_stats *stats){
+	*stats = chk->stats;
+}
+
+void canseq_clr_stats(canseq_t chk){
+	memset(&chk->stats, 0, sizeof(chk->stats));
+}
+
+void canseq_stats_print(canseq_t chk){
+	struct canseq_stats st = chk->stats;
+	int i;
+
+	printf("SEQ: msgs %u, lost %u in %u bursts (max %u), dups %u, late %u, "
+		"resyncs %u, crc errors %u\n",
+		st.msgs, st.lost, st.bursts, st.max_burst, st.dups, st.late,
+		st.resyncs, st.crc_errs);
+	if ( st.bursts ) {
+		printf("  bursts 1/2/3-4/5-8/9-16/17-32/33-64/>64:");
+		for (i=0; i<CANSEQ_HIST; i++)
+			printf(" %u", st.hist[i]);
+		printf("\n");
+	}
+}
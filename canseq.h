@@ -0,0 +1,79 @@
+
+#ifndef __CANSEQ_H__
+#define __CANSEQ_H__
+
+/* CAN stream sequence checker for soak tests
+ *
+ * The sender puts a 24-bit sequence number and a CRC-8 into the payload of
+ * every message, the receiver checks each message in constant time against
+ * the expected sequence number and a bitmap of the last CANSEQ_WINDOW
+ * sequence numbers seen:
+ *
+ *  - ahead of expected: the messages in between are lost (a loss burst)
+ *  - behind expected, within the window and seen: duplicate
+ *  - behind expected, within the window and not seen: late (reordered), it
+ *    is no longer counted as lost
+ *  - further away: the sender restarted, the checker resynchronises on it
+ *
+ * Payload layout, len 4..8 bytes:
+ *   data[0..2]      sequence number, big-endian
+ *   data[3..len-2]  filler derived from the sequence number
+ *   data[len-1]     CRC-8 (poly 0x07) of data[0..len-2], initial value len
+ *
+ * The CAN ID is not covered so that loopback boards may rewrite it. The
+ * checker is driver independent and never prints, results are read with
+ * canseq_get_stats() or printed by canseq_stats_print() from another task.
+ */
+
+#define CANSEQ_MIN_LEN		4
+#define CANSEQ_WINDOW		64	/* Duplicate/reorder window */
+#define CANSEQ_JUMP_MAX		0x10000	/* Larger jumps forward restart */
+#define CANSEQ_HIST		8	/* Loss burst buckets: 1,2,3-4,..,33-64,>64 */
+
+/* Sequence number of a checker payload */
+#define CANSEQ_SEQ(data) \
+	(((data)[0] << 16) | ((data)[1] << 8) | (data)[2])
+
+/* canseq_check() results */
+#define CANSEQ_OK	0	/* Next in sequence */
+#define CANSEQ_GAP	1	/* Messages lost before this one */
+#define CANSEQ_DUP	2	/* Duplicate */
+#define CANSEQ_LATE	3	/* Reordered, arrived after later messages */
+#define CANSEQ_RESYNC	4	/* Sequence restarted */
+#define CANSEQ_CRC	-1	/* Corrupt payload, sequence state unchanged */
+#define CANSEQ_SHORT	-2	/* Payload too short */
+
+struct canseq_stats {
+	unsigned int msgs;	/* Messages checked */
+	unsigned int lost;	/* Missing, late arrivals subtracted */
+	unsigned int bursts;	/* Number of loss bursts */
+	unsigned int max_burst;	/* Longest loss burst */
+	unsigned int dups;
+	unsigned int late;
+	unsigned int resyncs;
+	unsigned int crc_errs;	/* Corrupt or short payloads */
+	unsigned int hist[CANSEQ_HIST];	/* Loss bursts by length */
+};
+
+typedef struct canseq_s *canseq_t;
+
+/* Create checker, it synchronises on the first message. NULL on failure */
+canseq_t canseq_create(void);
+
+void canseq_free(canseq_t chk);
+
+/* Fill data[0..len-1] with the payload of sequence number seq.
+ * Returns len or negative if len is out of range.
+ */
+int canseq_make(unsigned int seq, unsigned char *data, int len);
+
+/* Check one received payload, returns one of the CANSEQ_ results */
+int canseq_check(canseq_t chk, unsigned char *data, int len);
+
+void canseq_get_stats(canseq_t chk, struct canseq_stats *stats);
+
+void canseq_clr_stats(canseq_t chk);
+
+void canseq_stats_print(canseq_t chk);
+
+#endif
@@ -0,0 +1,237 @@
+/* Rate based CAN statistics, see canstats.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "canstats.h"
+#include "mem_barrier.h"
+
+#ifdef __rtems__
+#include <rtems.h>
+
+static unsigned int canstats_time_us(void)
+{
+	struct timespec ts;
+
+	rtems_clock_get_uptime(&ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+#else
+#include <time.h>
+
+static unsigned int canstats_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+#endif
+
+/* Snapshot n is in ring[n % slots] and is complete when cnt > n. While
+ * snapshot cnt is written the oldest slot is being overwritten, so readers
+ * use at most slots-1 snapshots and check afterwards that the writer has
+ * not moved on into the slots they copied.
+ */
+struct canstats_s {
+	int slots;
+	unsigned int bitrate;
+	unsigned int frame_bits;
+	volatile unsigned int cnt;	/* Snapshots taken */
+	struct canstats_snap *ring;
+};
+
+canstats_t canstats_create(int slots, unsigned int bitrate, unsigned int frame_bits){
+	canstats_t cs;
+
+	if ( (slots < 3) || (bitrate == 0) )
+		return NULL;
+
+	cs = calloc(1, sizeof(*cs));
+	if ( !cs )
+		return NULL;
+	cs->ring = malloc(slots * sizeof(struct canstats_snap));
+	if ( !cs->ring ) {
+		printf("canstats_create: failed to allocate %d snapshots\n", slots);
+		free(cs);
+		return NULL;
+	}
+	cs->slots = slots;
+	cs->bitrate = bitrate;
+	cs->frame_bits = frame_bits ? frame_bits : CANSTATS_FRAME_BITS;
+	return cs;
+}
+
+void canstats_free(canstats_t cs){
+	if ( !cs )
+		return;
+	free(cs->ring);
+	free(cs);
+}
+
+void canstats_sample(canstats_t cs, struct canstats_cnt *cnt){
+	canstats_sample_at(cs, cnt, canstats_time_us());
+}
+
+void canstats_sample_at(canstats_t cs, struct canstats_cnt *cnt, unsigned int time_us){
+	struct canstats_snap *snap = &cs->ring[cs->cnt % cs->slots];
+
+	snap->time_us = time_us;
+	snap->cnt = *cnt;
+	MEM_BARRIER();
+	cs->cnt++;
+}
+
+/* Snapshots readers may use when c have been taken */
+static int canstats_kept(canstats_t cs, unsigned int c)
+{
+	return (c < (unsigned int)cs->slots - 1) ? (int)c : cs->slots - 1;
+}
+
+/* Copy snapshot n, returns non-zero if the writer may have overwritten it */
+static int canstats_copy(canstats_t cs, unsigned int n, struct canstats_snap *snap)
+{
+	*snap = cs->ring[n % cs->slots];
+	MEM_BARRIER();
+	return (int)(cs->cnt - n) >= cs->slots;
+}
+
+int canstats_get(canstats_t cs, int age, struct canstats_snap *snap){
+	unsigned int c;
+
+	do {
+		c = cs->cnt;
+		MEM_BARRIER();
+		if ( (age < 0) || (age >= canstats_kept(cs, c)) )
+			return -1;
+	} while ( canstats_copy(cs, c - 1 - age, snap) );
+
+	return 0;
+}
+
+static unsigned int per_s(unsigned int d, unsigned int span_us)
+{
+	return ((unsigned long long)d * 1000000) / span_us;
+}
+
+int canstats_rates(canstats_t cs, unsigned int window_us, struct canstats_rates *rates){
+	struct canstats_snap new, old;
+	unsigned long long bits, avail;
+	unsigned int c, span;
+	int n, age, torn, i;
+
+	do {
+		c = cs->cnt;
+		MEM_BARRIER();
+		n = canstats_kept(cs, c);
+		if ( n < 2 )
+			return -1;
+		torn = canstats_copy(cs, c - 1, &new);
+		for (age=1; !torn && (age < n); age++) {
+			torn = canstats_copy(cs, c - 1 - age, &old);
+			if ( new.time_us - old.time_us >= window_us )
+				break;
+		}
+	} while ( torn );
+
+	span = new.time_us - old.time_us;
+	if ( span == 0 )
+		span = 1;
+	rates->span_us = span;
+	rates->rx_rate = per_s(new.cnt.rx_msgs - old.cnt.rx_msgs, span);
+	rates->tx_rate = per_s(new.cnt.tx_msgs - old.cnt.tx_msgs, span);
+	rates->err_rate = per_s(new.cnt.bus_errs - old.cnt.bus_errs, span);
+	rates->ovr_rate = per_s(new.cnt.overruns - old.cnt.overruns, span);
+	rates->passive = new.cnt.passive - old.cnt.passive;
+	for (i=0; i<CANSTATS_APP_CNTS; i++)
+		rates->app_rate[i] = per_s(new.cnt.app[i] - old.cnt.app[i], span);
+
+	/* Bits sent in span against bits the bus could carry */
+	bits = (unsigned long long)((new.cnt.rx_msgs - old.cnt.rx_msgs) +
+		(new.cnt.tx_msgs - old.cnt.tx_msgs)) * cs->frame_bits;
+	avail = ((unsigned long long)span * cs->bitrate) / 1000000;
+	rates->load = avail ? (bits * 1000) / avail : 0;
+
+	return 0;
+}
+
+static int put_leb128(unsigned char *p, unsigned int v)
+{
+	int n = 0;
+
+	do {
+		p[n] = v & 0x7f;
+		v >>= 7;
+		if ( v )
+			p[n] |= 0x80;
+		n++;
+	} while ( v );
+	return n;
+}
+
+static void put_be32(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+int canstats_dump(canstats_t cs, unsigned char *buf, int len){
+	struct canstats_snap snap, prev;
+	unsigned int c, first = 0, *v, *pv;
+	int n, age, k, pos, cnt, torn;
+
+	if ( len < CANSTATS_HDR_SIZE )
+		return -1;
+
+	do {
+		c = cs->cnt;
+		MEM_BARRIER();
+		n = canstats_kept(cs, c);
+		pos = CANSTATS_HDR_SIZE;
+		cnt = 0;
+		torn = 0;
+		memset(&prev, 0, sizeof(prev));
+		for (age=n-1; age>=0; age--) {
+			/* Room for the largest encoding of a snapshot */
+			if ( len - pos < 5 * (1 + CANSTATS_CNTS) )
+				break;
+			torn = canstats_copy(cs, c - 1 - age, &snap);
+			if ( torn )
+				break;
+			if ( cnt == 0 ) {
+				first = snap.time_us;
+				prev.time_us = first;
+			}
+			pos += put_leb128(&buf[pos], snap.time_us - prev.time_us);
+			v = (unsigned int *)&snap.cnt;
+			pv = (unsigned int *)&prev.cnt;
+			for (k=0; k<CANSTATS_CNTS; k++)
+				pos += put_leb128(&buf[pos], v[k] - pv[k]);
+			prev = snap;
+			cnt++;
+		}
+	} while ( torn );
+
+	put_be32(&buf[0], CANSTATS_MAGIC);
+	put_be32(&buf[4], cs->bitrate);
+	put_be32(&buf[8], (cs->frame_bits << 16) | cnt);
+	put_be32(&buf[12], first);
+	return pos;
+}
+
+void canstats_rates_print(struct canstats_rates *rates){
+	int i;
+
+	printf("CAN: rx %u/s, tx %u/s, load %u.%u%%, errors %u/s, overruns %u/s, "
+		"passive %u",
+		rates->rx_rate, rates->tx_rate, rates->load / 10, rates->load % 10,
+		rates->err_rate, rates->ovr_rate, rates->passive);
+	for (i=0; i<CANSTATS_APP_CNTS; i++) {
+		if ( rates->app_rate[i] )
+			printf(", app%d %u/s", i, rates->app_rate[i]);
+	}
+	printf(" (%u ms)\n", rates->span_us / 1000);
+}
@@ -0,0 +1,97 @@
+
+#ifndef __CANSTATS_H__
+#define __CANSTATS_H__
+
+/* Rate based CAN statistics
+ *
+ * Driver and application counters are sampled into a fixed ring of
+ * timestamped snapshots. Rates are calculated from two snapshots when they
+ * are asked for, so sampling is only a copy of a few counters and can be
+ * done from any task without printing. The sampler and any number of
+ * readers in other tasks share the ring without locking: a reader retries
+ * when a snapshot was written while it read.
+ *
+ * The counters are free running, whatever the driver provides is mapped
+ * to them by the caller (grcan_stats, occan_stats, application counts).
+ * The bus load is estimated from the messages received and sent times an
+ * average frame length, which assumes that the node receives all traffic
+ * on the bus.
+ *
+ * canstats_dump() writes the ring in a compact binary format for the host,
+ * can/canstat prints it:
+ *   header, 16 bytes big-endian:
+ *     magic 'CST1', bitrate, frame_bits (16 bits), snapshots (16 bits),
+ *     time of first snapshot [us]
+ *   per snapshot: time and counters as LEB128 coded differences to the
+ *     previous snapshot, absolute values for the first one
+ */
+
+#define CANSTATS_APP_CNTS	4
+#define CANSTATS_CNTS		(5 + CANSTATS_APP_CNTS)	/* Counters per snapshot */
+#define CANSTATS_FRAME_BITS	116	/* 8 byte standard frame, average stuffing */
+#define CANSTATS_MAGIC		0x43535431
+#define CANSTATS_HDR_SIZE	16
+
+/* Counters sampled, all free running */
+struct canstats_cnt {
+	unsigned int rx_msgs;
+	unsigned int tx_msgs;
+	unsigned int bus_errs;	/* Bus errors or failed transmissions */
+	unsigned int overruns;	/* Messages lost in receiver */
+	unsigned int passive;	/* Error passive events */
+	unsigned int app[CANSTATS_APP_CNTS];	/* Application counters */
+};
+
+struct canstats_snap {
+	unsigned int time_us;
+	struct canstats_cnt cnt;
+};
+
+/* Rates between two snapshots, per second unless noted */
+struct canstats_rates {
+	unsigned int span_us;	/* Time between the snapshots */
+	unsigned int rx_rate;
+	unsigned int tx_rate;
+	unsigned int load;	/* Estimated bus load [0.1%] */
+	unsigned int err_rate;
+	unsigned int ovr_rate;
+	unsigned int passive;	/* Error passive events in span */
+	unsigned int app_rate[CANSTATS_APP_CNTS];
+};
+
+typedef struct canstats_s *canstats_t;
+
+/* Create ring of 'slots' snapshots for a bus of the given bitrate, frame_bits
+ * is the average frame length incl. stuffing and intermission, 0 gives
+ * CANSTATS_FRAME_BITS. NULL on failure.
+ */
+canstats_t canstats_create(int slots, unsigned int bitrate, unsigned int frame_bits);
+
+void canstats_free(canstats_t cs);
+
+/* Take a snapshot of the counters now. One task samples. */
+void canstats_sample(canstats_t cs, struct canstats_cnt *cnt);
+
+/* Same with a caller time base [us], e.g. simulated bus time */
+void canstats_sample_at(canstats_t cs, struct canstats_cnt *cnt, unsigned int time_us);
+
+/* Snapshot 'age' samples before the newest one (age 0). Returns 0 or -1
+ * if there is no such snapshot.
+ */
+int canstats_get(canstats_t cs, int age, struct canstats_snap *snap);
+
+/* Rates between the newest snapshot and the newest one at least window_us
+ * older, or the oldest one kept. Returns 0 or -1 if there are less than
+ * two snapshots.
+ */
+int canstats_rates(canstats_t cs, unsigned int window_us, struct canstats_rates *rates);
+
+/* Write all kept snapshots, oldest first, as many as fit into len bytes.
+ * Returns number of bytes written or -1 if not even the header fits.
+ */
+int canstats_dump(canstats_t cs, unsigned char *buf, int len);
+
+/* Print rates on one line */
+void canstats_rates_print(struct canstats_rates *rates);
+
+#endif
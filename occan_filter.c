@@ -0,0 +1,406 @@
+/* Software CAN ID filter for occan_lib, see occan_filter.h
+ *
+ * Acceptance register layout of the OC-CAN core in single filter mode,
+ * code[0] is ACR0 (bits 31..24) and a set mask bit means "don't care":
+ *   Standard frame:  31..21 ID10..ID0, 20 RTR, 19..0 first two data bytes
+ *   Extended frame:  31..3  ID28..ID0, 2 RTR,  1..0 unused
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "occan_filter.h"
+#include "mem_barrier.h"
+
+#define EXT_KEY_VALID	0x80000000
+
+struct occan_filter_ext {
+	unsigned int key;	/* ID | EXT_KEY_VALID, 0 when free */
+	unsigned int subs;
+};
+
+struct occan_filter_range {
+	unsigned int first;
+	unsigned int last;
+	unsigned int subs;
+};
+
+struct occan_filter_sub {
+	CANMsg *buf;
+	unsigned int size;		/* qlen + 1 */
+	volatile unsigned int head;	/* Moved by dispatcher only */
+	volatile unsigned int tail;	/* Moved by consumer only */
+	occan_filter_notify_t notify;
+	void *arg;
+	struct occan_filter_sub_stats stats;
+};
+
+struct occan_filter_s {
+	unsigned int std[OCCAN_STD_ID_CNT];	/* Subscriber mask per ID */
+	struct occan_filter_ext *ext;
+	unsigned int ext_bits;			/* log2 of hash table size */
+	unsigned int ext_cnt;
+	unsigned int ext_max;
+	struct occan_filter_range ranges[OCCAN_FILTER_RANGES_MAX];
+	int range_cnt;
+	struct occan_filter_sub subs[OCCAN_FILTER_SUBS_MAX];
+	int sub_cnt;
+	CANMsg batch[OCCAN_FILTER_BATCH];
+	struct occan_filter_stats stats;
+};
+
+static inline unsigned int ext_hash(occan_filter_t flt, unsigned int id)
+{
+	return (id * 2654435761U) >> (32 - flt->ext_bits);
+}
+
+occan_filter_t occanlib_filter_create(int ext_ids){
+	occan_filter_t flt;
+	unsigned int bits;
+
+	if ( ext_ids < 0 )
+		return NULL;
+
+	flt = calloc(1, sizeof(*flt));
+	if ( !flt ){
+		printf("occanlib_filter_create: failed to allocate filter\n");
+		return NULL;
+	}
+
+	/* At most 50% load */
+	bits = 4;
+	while ( (1U << bits) < (unsigned int)ext_ids * 2 )
+		bits++;
+	flt->ext_bits = bits;
+	flt->ext_max = ext_ids;
+	flt->ext = calloc(1U << bits, sizeof(struct occan_filter_ext));
+	if ( !flt->ext ){
+		printf("occanlib_filter_create: failed to allocate hash table\n");
+		free(flt);
+		return NULL;
+	}
+
+	return flt;
+}
+
+void occanlib_filter_free(occan_filter_t flt){
+	int i;
+
+	if ( !flt )
+		return;
+	for (i=0; i<flt->sub_cnt; i++)
+		free(flt->subs[i].buf);
+	free(flt->ext);
+	free(flt);
+}
+
+int occanlib_filter_subscribe(occan_filter_t flt, int qlen,
+	occan_filter_notify_t notify, void *arg){
+	struct occan_filter_sub *sub;
+
+	if ( !flt || (qlen < 1) )
+		return -1;
+
+	if ( flt->sub_cnt >= OCCAN_FILTER_SUBS_MAX ){
+		printf("occanlib_filter_subscribe: too many subscribers\n");
+		return -2;
+	}
+
+	sub = &flt->subs[flt->sub_cnt];
+	sub->buf = malloc(sizeof(CANMsg) * (qlen + 1));
+	if ( !sub->buf ){
+		printf("occanlib_filter_subscribe: failed to allocate queue of %d\n", qlen);
+		return -3;
+	}
+	sub->size = qlen + 1;
+	sub->head = 0;
+	sub->tail = 0;
+	sub->notify = notify;
+	sub->arg = arg;
+	memset(&sub->stats, 0, sizeof(sub->stats));
+
+	return flt->sub_cnt++;
+}
+
+int occanlib_filter_add_std(occan_filter_t flt, int sub,
+	unsigned int first, unsigned int last){
+	unsigned int id;
+
+	if ( !flt || (sub < 0) || (sub >= flt->sub_cnt) ||
+	     (first > last) || (last >= OCCAN_STD_ID_CNT) )
+		return -1;
+
+	for (id=first; id<=last; id++)
+		flt->std[id] |= 1U << sub;
+
+	return 0;
+}
+
+int occanlib_filter_add_ext(occan_filter_t flt, int sub, unsigned int id){
+	struct occan_filter_ext *e;
+	unsigned int i, mask;
+
+	if ( !flt || (sub < 0) || (sub >= flt->sub_cnt) || (id > 0x1fffffff) )
+		return -1;
+
+	mask = (1U << flt->ext_bits) - 1;
+	i = ext_hash(flt, id);
+	while ( 1 ) {
+		e = &flt->ext[i];
+		if ( e->key == (id | EXT_KEY_VALID) ) {
+			e->subs |= 1U << sub;
+			return 0;
+		}
+		if ( e->key == 0 )
+			break;
+		i = (i + 1) & mask;
+	}
+
+	if ( flt->ext_cnt >= flt->ext_max ){
+		printf("occanlib_filter_add_ext: hash table full (%d IDs)\n", flt->ext_max);
+		return -2;
+	}
+	e->key = id | EXT_KEY_VALID;
+	e->subs = 1U << sub;
+	flt->ext_cnt++;
+
+	return 0;
+}
+
+int occanlib_filter_add_ext_range(occan_filter_t flt, int sub,
+	unsigned int first, unsigned int last){
+	struct occan_filter_range *r;
+
+	if ( !flt || (sub < 0) || (sub >= flt->sub_cnt) ||
+	     (first > last) || (last > 0x1fffffff) )
+		return -1;
+
+	if ( flt->range_cnt >= OCCAN_FILTER_RANGES_MAX ){
+		printf("occanlib_filter_add_ext_range: too many ranges\n");
+		return -2;
+	}
+	r = &flt->ranges[flt->range_cnt++];
+	r->first = first;
+	r->last = last;
+	r->subs = 1U << sub;
+
+	return 0;
+}
+
+unsigned int occanlib_filter_match(occan_filter_t flt, CANMsg *msg){
+	struct occan_filter_ext *e;
+	unsigned int i, mask, id, subs;
+
+	id = msg->id;
+	if ( !msg->extended )
+		return flt->std[id & (OCCAN_STD_ID_CNT-1)];
+
+	subs = 0;
+	mask = (1U << flt->ext_bits) - 1;
+	i = ext_hash(flt, id);
+	while ( (e = &flt->ext[i])->key ) {
+		if ( e->key == (id | EXT_KEY_VALID) ) {
+			subs = e->subs;
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+
+	for (i=0; i<flt->range_cnt; i++) {
+		if ( (id >= flt->ranges[i].first) && (id <= flt->ranges[i].last) )
+			subs |= flt->ranges[i].subs;
+	}
+
+	return subs;
+}
+
+/* Add all IDs first..last, placed at bit 'shift' of the acceptance register,
+ * to the accumulated AND/OR of all accepted register values. Bits below the
+ * ID are always "don't care".
+ */
+static void hw_acc(unsigned int *and_v, unsigned int *or_v,
+	unsigned int first, unsigned int last, int shift)
+{
+	unsigned int diff, var;
+
+	/* IDs in range share all bits above the highest differing bit */
+	diff = first ^ last;
+	var = 0;
+	while ( diff ) {
+		var = (var << 1) | 1;
+		diff >>= 1;
+	}
+
+	*and_v &= (first & ~var) << shift;
+	*or_v |= ((first | var) << shift) | ((1U << shift) - 1);
+}
+
+void occanlib_filter_hw(occan_filter_t flt, struct occan_afilter *afilt){
+	unsigned int and_v, or_v, mask, i;
+	int used = 0;
+
+	and_v = 0xffffffff;
+	or_v = 0;
+
+	for (i=0; i<OCCAN_STD_ID_CNT; i++) {
+		if ( flt->std[i] ) {
+			hw_acc(&and_v, &or_v, i, i, 21);
+			used = 1;
+		}
+	}
+	for (i=0; i<(1U << flt->ext_bits); i++) {
+		if ( flt->ext[i].key ) {
+			hw_acc(&and_v, &or_v, flt->ext[i].key & ~EXT_KEY_VALID,
+				flt->ext[i].key & ~EXT_KEY_VALID, 3);
+			used = 1;
+		}
+	}
+	for (i=0; i<flt->range_cnt; i++) {
+		hw_acc(&and_v, &or_v, flt->ranges[i].first, flt->ranges[i].last, 3);
+		used = 1;
+	}
+
+	if ( used ) {
+		/* Bits that differ between accepted values are "don't care" */
+		mask = and_v ^ or_v;
+	} else {
+		/* Nothing subscribed, accept all and let software reject */
+		and_v = 0;
+		mask = 0xffffffff;
+	}
+
+	afilt->single_mode = 1;
+	for (i=0; i<4; i++) {
+		afilt->code[i] = (and_v >> (24 - 8*i)) & 0xff;
+		afilt->mask[i] = (mask >> (24 - 8*i)) & 0xff;
+	}
+}
+
+int occanlib_filter_apply(occan_filter_t flt, occan_t chan){
+	struct occan_afilter afilt;
+
+	if ( !flt )
+		return -1;
+
+	occanlib_filter_hw(flt, &afilt);
+
+	return occanlib_set_filter(chan, &afilt);
+}
+
+int occanlib_filter_dispatch(occan_filter_t flt, CANMsg *msgs, int msgcnt){
+	struct occan_filter_sub *sub;
+	unsigned int subs, hit, head, next;
+	int i, j, accepted;
+
+	hit = 0;
+	accepted = 0;
+	for (i=0; i<msgcnt; i++) {
+		subs = occanlib_filter_match(flt, &msgs[i]);
+		if ( subs == 0 ) {
+			flt->stats.rejected++;
+			continue;
+		}
+		accepted++;
+		hit |= subs;
+
+		for (j=0; subs; j++, subs >>= 1) {
+			if ( (subs & 1) == 0 )
+				continue;
+			sub = &flt->subs[j];
+			head = sub->head;
+			next = head + 1;
+			if ( next >= sub->size )
+				next = 0;
+			if ( next == sub->tail ) {
+				sub->stats.dropped++;
+				continue;
+			}
+			sub->buf[head] = msgs[i];
+			MEM_BARRIER();
+			sub->head = next;
+			sub->stats.rx++;
+		}
+	}
+	flt->stats.rx += msgcnt;
+
+	/* Wake every consumer at most once per batch */
+	for (j=0; hit; j++, hit >>= 1) {
+		sub = &flt->subs[j];
+		if ( (hit & 1) && sub->notify ) {
+			sub->stats.notified++;
+			sub->notify(sub->arg);
+		}
+	}
+
+	return accepted;
+}
+
+int occanlib_filter_recv(occan_filter_t flt, occan_t chan){
+	int cnt;
+
+	if ( !flt )
+		return -1;
+
+	cnt = occanlib_recv_multiple(chan, flt->batch, OCCAN_FILTER_BATCH);
+	if ( cnt > 0 ) {
+		flt->stats.batches++;
+		occanlib_filter_dispatch(flt, flt->batch, cnt);
+	}
+
+	return cnt;
+}
+
+int occanlib_filter_take(occan_filter_t flt, int sub, CANMsg *msgs, int max){
+	struct occan_filter_sub *s;
+	unsigned int tail, head;
+	int i;
+
+	if ( !flt || (sub < 0) || (sub >= flt->sub_cnt) || !msgs )
+		return -1;
+
+	s = &flt->subs[sub];
+	tail = s->tail;
+	head = s->head;
+	MEM_BARRIER();
+	for (i=0; (i<max) && (tail != head); i++) {
+		msgs[i] = s->buf[tail];
+		tail++;
+		if ( tail >= s->size )
+			tail = 0;
+	}
+	MEM_BARRIER();
+	s->tail = tail;
+
+	return i;
+}
+
+void occanlib_filter_get_stats(occan_filter_t flt,
+	struct occan_filter_stats *stats){
+	*stats = flt->stats;
+}
+
+int occanlib_filter_get_sub_stats(occan_filter_t flt, int sub,
+	struct occan_filter_sub_stats *stats){
+	if ( !flt || (sub < 0) || (sub >= flt->sub_cnt) || !stats )
+		return -1;
+	*stats = flt->subs[sub].stats;
+	return 0;
+}
+
+void occanlib_filter_stats_print(occan_filter_t flt){
+	struct occan_afilter afilt;
+	int i;
+
+	occanlib_filter_hw(flt, &afilt);
+	printf("SW filter: rx %u, rejected %u, batches %u\n",
+		flt->stats.rx, flt->stats.rejected, flt->stats.batches);
+	printf("  HW code: 0x%02x%02x%02x%02x mask: 0x%02x%02x%02x%02x\n",
+		afilt.code[0], afilt.code[1], afilt.code[2], afilt.code[3],
+		afilt.mask[0], afilt.mask[1], afilt.mask[2], afilt.mask[3]);
+	for (i=0; i<flt->sub_cnt; i++) {
+		printf("  SUB%-2d rx %u, dropped %u, notified %u\n", i,
+			flt->subs[i].stats.rx, flt->subs[i].stats.dropped,
+			flt->subs[i].stats.notified);
+	}
+}
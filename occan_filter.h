@@ -0,0 +1,112 @@
+
+#ifndef __OCCAN_FILTER_H__
+#define __OCCAN_FILTER_H__
+
+/* Software CAN ID filter for occan_lib
+ *
+ * The OC-CAN core has a single acceptance code/mask pair which usually
+ * passes far more traffic than the application needs. The software filter
+ * stage classifies every received message against the exact ID sets of a
+ * number of subscribers and copies matching messages into the subscribers'
+ * receive queues:
+ *
+ *  - Standard (11-bit) IDs are looked up in a 2048 entry table holding one
+ *    subscriber bit mask per ID.
+ *  - Extended (29-bit) IDs are looked up in an open addressed hash table of
+ *    single IDs, then in a short list of ID ranges.
+ *
+ * From the same ID sets the tightest single acceptance code/mask superset is
+ * derived and can be loaded into the hardware with occanlib_filter_apply().
+ *
+ * The filter is fed by one task (occanlib_filter_recv() or
+ * occanlib_filter_dispatch()), every subscriber queue is emptied by one
+ * consumer task with occanlib_filter_take(). A subscriber may register a
+ * notify function which is called at most once per received batch, for
+ * example to send an RTEMS event to the consumer task.
+ */
+
+#include "occan_lib.h"
+
+#define OCCAN_FILTER_SUBS_MAX	32	/* One bit per subscriber in masks */
+#define OCCAN_FILTER_RANGES_MAX	16	/* Extended ID ranges */
+#define OCCAN_FILTER_BATCH	32	/* Messages read per driver call */
+
+#define OCCAN_STD_ID_CNT	2048
+
+struct occan_filter_stats {
+	unsigned int rx;	/* Messages classified */
+	unsigned int rejected;	/* Messages not matching any subscriber */
+	unsigned int batches;	/* Driver reads returning messages */
+};
+
+struct occan_filter_sub_stats {
+	unsigned int rx;	/* Messages put into queue */
+	unsigned int dropped;	/* Messages lost due to full queue */
+	unsigned int notified;	/* Number of notify calls */
+};
+
+typedef void (*occan_filter_notify_t)(void *arg);
+
+typedef struct occan_filter_s *occan_filter_t;
+
+/* Create software filter. ext_ids is the maximum number of single extended
+ * IDs that will be added, the hash table is sized for at most 50% load.
+ * Returns NULL on failure.
+ */
+occan_filter_t occanlib_filter_create(int ext_ids);
+
+void occanlib_filter_free(occan_filter_t flt);
+
+/* Add a subscriber with a receive queue of qlen messages. notify may be
+ * NULL. Returns subscriber number (0..31) or negative on failure.
+ */
+int occanlib_filter_subscribe(occan_filter_t flt, int qlen,
+	occan_filter_notify_t notify, void *arg);
+
+/* Add standard IDs first..last to subscriber */
+int occanlib_filter_add_std(occan_filter_t flt, int sub,
+	unsigned int first, unsigned int last);
+
+/* Add single extended ID to subscriber */
+int occanlib_filter_add_ext(occan_filter_t flt, int sub, unsigned int id);
+
+/* Add extended IDs first..last to subscriber */
+int occanlib_filter_add_ext_range(occan_filter_t flt, int sub,
+	unsigned int first, unsigned int last);
+
+/* Return the subscriber bit mask of a message, 0 if no subscriber */
+unsigned int occanlib_filter_match(occan_filter_t flt, CANMsg *msg);
+
+/* Calculate tightest single mode acceptance filter that passes all
+ * subscribed IDs, both standard and extended.
+ */
+void occanlib_filter_hw(occan_filter_t flt, struct occan_afilter *afilt);
+
+/* Load filter from occanlib_filter_hw() into the OC-CAN core, the channel
+ * must be stopped.
+ */
+int occanlib_filter_apply(occan_filter_t flt, occan_t chan);
+
+/* Classify msgcnt messages and copy them into the subscriber queues.
+ * Returns number of messages accepted by at least one subscriber.
+ */
+int occanlib_filter_dispatch(occan_filter_t flt, CANMsg *msgs, int msgcnt);
+
+/* Read one batch from the driver and dispatch it. Blocks when the channel is
+ * in blocking RX mode. Returns number of messages read or negative
+ * occanlib_recv_multiple() error code.
+ */
+int occanlib_filter_recv(occan_filter_t flt, occan_t chan);
+
+/* Take up to max messages from subscriber queue, never blocks */
+int occanlib_filter_take(occan_filter_t flt, int sub, CANMsg *msgs, int max);
+
+void occanlib_filter_get_stats(occan_filter_t flt,
+	struct occan_filter_stats *stats);
+
+int occanlib_filter_get_sub_stats(occan_filter_t flt, int sub,
+	struct occan_filter_sub_stats *stats);
+
+void occanlib_filter_stats_print(occan_filter_t flt);
+
+#endif
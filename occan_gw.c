@@ -0,0 +1,305 @@
+/* CAN gateway for occan_lib, see occan_gw.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "occan_gw.h"
+#include "occan_lease.h"
+
+#define GW_STD_IDS 2048
+
+#define TOKEN 1000000ULL	/* One message in rate limit tokens */
+
+struct gw_route {
+	struct occan_gw_route cfg;
+	unsigned long long tokens;	/* messages * TOKEN */
+	unsigned int last;		/* Time of last refill */
+	struct occan_gw_route_stats stats;
+};
+
+/* Messages of the current batch for one output channel. While they are
+ * unchanged and consecutive in the batch only the range is kept (start,
+ * cnt), otherwise they are copied to stage[], src[k] is the batch index
+ * of stage[k].
+ */
+struct gw_out {
+	int start;
+	int cnt;
+	int staged;
+	CANMsg stage[OCCAN_GW_BATCH];
+	unsigned char src[OCCAN_GW_BATCH];
+};
+
+struct occan_gw_s {
+	int nchans;
+	occan_t chans[OCCAN_GW_CHANS_MAX];
+	occan_lease_t ls[OCCAN_GW_CHANS_MAX];
+	unsigned char *std_route[OCCAN_GW_CHANS_MAX];	/* route+1, 0 = none */
+	int nroutes;
+	struct gw_route routes[OCCAN_GW_ROUTES_MAX];
+	struct gw_out out[OCCAN_GW_CHANS_MAX];
+	unsigned char route_of[OCCAN_GW_BATCH];		/* Route of batch msg */
+	struct occan_gw_stats stats;
+};
+
+occan_gw_t occanlib_gw_create(void){
+	return calloc(1, sizeof(struct occan_gw_s));
+}
+
+void occanlib_gw_free(occan_gw_t gw){
+	int i;
+
+	if ( !gw )
+		return;
+	for (i=0; i<gw->nchans; i++) {
+		occanlib_lease_free(gw->ls[i]);
+		free(gw->std_route[i]);
+	}
+	free(gw);
+}
+
+int occanlib_gw_add_chan(occan_gw_t gw, occan_t chan, int lease_slots){
+	int c;
+
+	if ( !gw || !chan || (gw->nchans >= OCCAN_GW_CHANS_MAX) )
+		return -1;
+
+	c = gw->nchans;
+	gw->ls[c] = occanlib_lease_create(chan, lease_slots);
+	gw->std_route[c] = calloc(GW_STD_IDS, 1);
+	if ( !gw->ls[c] || !gw->std_route[c] ) {
+		printf("occanlib_gw_add_chan: failed to allocate channel %d\n", c);
+		occanlib_lease_free(gw->ls[c]);
+		free(gw->std_route[c]);
+		return -1;
+	}
+	gw->chans[c] = chan;
+	gw->nchans++;
+
+	return c;
+}
+
+int occanlib_gw_add_route(occan_gw_t gw, struct occan_gw_route *route){
+	struct gw_route *rt;
+	unsigned char *tab;
+	unsigned int id;
+	int r;
+
+	if ( !gw || !route || (gw->nroutes >= OCCAN_GW_ROUTES_MAX) ||
+	     (route->in < 0) || (route->in >= gw->nchans) ||
+	     (route->out & ~((1U << gw->nchans) - 1)) )
+		return -1;
+
+	r = gw->nroutes++;
+	rt = &gw->routes[r];
+	memset(rt, 0, sizeof(*rt));
+	rt->cfg = *route;
+	if ( rt->cfg.burst < 1 )
+		rt->cfg.burst = 1;
+	rt->tokens = rt->cfg.burst * TOKEN;
+	rt->last = occanlib_time_us();
+
+	/* Standard IDs not taken by an earlier route */
+	if ( !route->extended ) {
+		tab = gw->std_route[route->in];
+		for (id=0; id<GW_STD_IDS; id++) {
+			if ( !tab[id] && ((id & route->mask) == route->id) )
+				tab[id] = r + 1;
+		}
+	}
+
+	return r;
+}
+
+/* Route index of message or -1 */
+static int gw_lookup(occan_gw_t gw, int in, CANMsg *msg)
+{
+	struct gw_route *rt;
+	int r;
+
+	if ( !msg->extended )
+		return (int)gw->std_route[in][msg->id & 0x7ff] - 1;
+
+	for (r=0; r<gw->nroutes; r++) {
+		rt = &gw->routes[r];
+		if ( (rt->cfg.in == in) && rt->cfg.extended &&
+		     ((msg->id & rt->cfg.mask) == rt->cfg.id) )
+			return r;
+	}
+	return -1;
+}
+
+/* Token bucket, returns non-zero if the message may pass */
+static int gw_rate_ok(struct gw_route *rt, unsigned int now)
+{
+	unsigned long long max;
+
+	if ( rt->cfg.rate == 0 )
+		return 1;
+
+	max = rt->cfg.burst * TOKEN;
+	rt->tokens += (unsigned long long)(now - rt->last) * rt->cfg.rate;
+	if ( rt->tokens > max )
+		rt->tokens = max;
+	rt->last = now;
+	if ( rt->tokens < TOKEN )
+		return 0;
+	rt->tokens -= TOKEN;
+	return 1;
+}
+
+static void gw_out_add(occan_gw_t gw, int o, struct occan_lease_batch *batch,
+	int i, struct gw_route *rt)
+{
+	struct gw_out *op = &gw->out[o];
+	CANMsg *msg;
+	int k;
+
+	if ( !op->staged ) {
+		if ( !rt->cfg.rw_mask && ((op->cnt == 0) || (op->start + op->cnt == i)) ) {
+			if ( op->cnt == 0 )
+				op->start = i;
+			op->cnt++;
+			return;
+		}
+		/* Not a plain range any more */
+		for (k=0; k<op->cnt; k++) {
+			op->stage[k] = batch->msgs[op->start + k];
+			op->src[k] = op->start + k;
+		}
+		gw->stats.copies += op->cnt;
+		op->staged = 1;
+	}
+
+	k = op->cnt++;
+	msg = &op->stage[k];
+	*msg = batch->msgs[i];
+	msg->id = (msg->id & ~rt->cfg.rw_mask) | (rt->cfg.rw_id & rt->cfg.rw_mask);
+	op->src[k] = i;
+	gw->stats.copies++;
+}
+
+static void gw_out_flush(occan_gw_t gw, int o, struct occan_lease_batch *batch)
+{
+	struct gw_out *op = &gw->out[o];
+	struct occan_gw_route_stats *st;
+	unsigned int now, lat;
+	int k, src, sent, b;
+
+	if ( op->staged )
+		sent = occanlib_send_multiple(gw->chans[o], op->stage, op->cnt);
+	else
+		sent = occanlib_send_multiple(gw->chans[o], &batch->msgs[op->start], op->cnt);
+	gw->stats.writes++;
+	if ( sent < 0 )
+		sent = 0;
+
+	now = occanlib_time_us();
+	for (k=0; k<op->cnt; k++) {
+		src = op->staged ? op->src[k] : op->start + k;
+		st = &gw->routes[gw->route_of[src]].stats;
+		if ( k >= sent ) {
+			st->tx_drops++;
+			continue;
+		}
+		st->sent++;
+		lat = now - batch->ts[src];
+		st->lat_sum += lat;
+		if ( lat > st->lat_max )
+			st->lat_max = lat;
+		for (b=0; (b < OCCAN_GW_HIST-1) && (lat >= (64U << b)); b++)
+			;
+		st->hist[b]++;
+	}
+	op->cnt = 0;
+	op->staged = 0;
+}
+
+static void gw_forward(occan_gw_t gw, int in, struct occan_lease_batch *batch)
+{
+	struct gw_route *rt;
+	unsigned int out;
+	int i, r, o;
+
+	for (i=0; i<batch->cnt; i++) {
+		r = gw_lookup(gw, in, &batch->msgs[i]);
+		if ( r < 0 ) {
+			gw->stats.unrouted++;
+			continue;
+		}
+		rt = &gw->routes[r];
+		rt->stats.matched++;
+		if ( !gw_rate_ok(rt, batch->ts[i]) ) {
+			rt->stats.rate_drops++;
+			continue;
+		}
+		gw->route_of[i] = r;
+		for (out=rt->cfg.out, o=0; out; out>>=1, o++) {
+			if ( out & 1 )
+				gw_out_add(gw, o, batch, i, rt);
+		}
+	}
+
+	for (o=0; o<gw->nchans; o++) {
+		if ( gw->out[o].cnt )
+			gw_out_flush(gw, o, batch);
+	}
+}
+
+int occanlib_gw_poll(occan_gw_t gw){
+	struct occan_lease_batch batch;
+	int c, cnt, total = 0;
+
+	if ( !gw )
+		return -1;
+
+	for (c=0; c<gw->nchans; c++) {
+		cnt = occanlib_lease_recv(gw->ls[c], &batch, OCCAN_GW_BATCH);
+		if ( cnt < 0 )
+			return cnt;
+		if ( cnt == 0 )
+			continue;
+		gw->stats.rx += cnt;
+		gw->stats.batches++;
+		gw_forward(gw, c, &batch);
+		occanlib_lease_release(gw->ls[c], cnt);
+		total += cnt;
+	}
+
+	return total;
+}
+
+void occanlib_gw_get_stats(occan_gw_t gw, struct occan_gw_stats *stats){
+	*stats = gw->stats;
+}
+
+int occanlib_gw_get_route_stats(occan_gw_t gw, int route, struct occan_gw_route_stats *stats){
+	if ( !gw || (route < 0) || (route >= gw->nroutes) )
+		return -1;
+	*stats = gw->routes[route].stats;
+	return 0;
+}
+
+void occanlib_gw_stats_print(occan_gw_t gw){
+	struct occan_gw_route_stats *st;
+	struct occan_gw_route *cfg;
+	int r, b;
+
+	printf("GW: rx %u, unrouted %u, batches %u, writes %u, copies %u\n",
+		gw->stats.rx, gw->stats.unrouted, gw->stats.batches,
+		gw->stats.writes, gw->stats.copies);
+	for (r=0; r<gw->nroutes; r++) {
+		cfg = &gw->routes[r].cfg;
+		st = &gw->routes[r].stats;
+		printf("  ROUTE%-2d %d:%s 0x%08x/0x%08x -> 0x%02x matched %u, sent %u, "
+			"rate drops %u, tx drops %u, lat avg %u us, max %u us\n",
+			r, cfg->in, cfg->extended ? "EXT" : "STD", cfg->id, cfg->mask,
+			cfg->out, st->matched, st->sent, st->rate_drops, st->tx_drops,
+			st->sent ? (unsigned int)(st->lat_sum / st->sent) : 0, st->lat_max);
+		printf("   ");
+		for (b=0; b<OCCAN_GW_HIST; b++)
+			printf(" %u", st->hist[b]);
+		printf("\n");
+	}
+}
@@ -0,0 +1,90 @@
+
+#ifndef __OCCAN_GW_H__
+#define __OCCAN_GW_H__
+
+/* CAN gateway for occan_lib
+ *
+ * Forwards messages between any number of OC-CAN channels from one task,
+ * according to a routing table. A route matches the messages received on
+ * one input channel whose ID masked equals a given ID, and sends them to a
+ * set of output channels, optionally with some ID bits replaced and with
+ * the rate limited by a token bucket. The first matching route is used,
+ * standard IDs are looked up in a table per input channel.
+ *
+ * Every input channel is received through a lease ring (occan_lease.c), so
+ * the driver reads straight into the ring. Messages forwarded unchanged
+ * and in sequence are written to the output driver directly from the
+ * ring, a message is copied to a staging buffer only when its ID is
+ * rewritten or when the output takes only some of the messages of a
+ * batch. Each output channel is written once per received batch.
+ *
+ * All channels are opened, configured and started by the caller, in
+ * non-blocking RX and TX mode. Messages the output driver does not accept
+ * are dropped and counted per route. The latency is measured from the
+ * driver read of the input to the write of the output.
+ */
+
+#include "occan_lib.h"
+
+#define OCCAN_GW_CHANS_MAX	8
+#define OCCAN_GW_ROUTES_MAX	32
+#define OCCAN_GW_BATCH		32	/* Messages per input per poll */
+#define OCCAN_GW_HIST		8	/* Latency buckets: <64us, <128us ... */
+
+struct occan_gw_route {
+	int in;			/* Input channel index */
+	int extended;		/* Match extended (1) or standard (0) frames */
+	unsigned int id;	/* Match when (msg.id & mask) == id */
+	unsigned int mask;
+	unsigned int out;	/* Output channel index bit mask */
+	unsigned int rw_mask;	/* ID bits replaced, 0 = no rewrite */
+	unsigned int rw_id;	/* New value of the replaced bits */
+	unsigned int rate;	/* Messages/s, 0 = unlimited */
+	unsigned int burst;	/* Messages passed at once after a pause */
+};
+
+struct occan_gw_route_stats {
+	unsigned int matched;	/* Messages received matching route */
+	unsigned int sent;	/* Messages written, per output channel */
+	unsigned int rate_drops;/* Dropped by rate limit */
+	unsigned int tx_drops;	/* Output driver buffer full */
+	unsigned int lat_max;		/* us */
+	unsigned long long lat_sum;	/* us */
+	unsigned int hist[OCCAN_GW_HIST];
+};
+
+struct occan_gw_stats {
+	unsigned int rx;	/* Messages received */
+	unsigned int unrouted;	/* Messages not matching any route */
+	unsigned int batches;	/* Received batches */
+	unsigned int writes;	/* Driver writes */
+	unsigned int copies;	/* Messages copied to staging buffers */
+};
+
+typedef struct occan_gw_s *occan_gw_t;
+
+occan_gw_t occanlib_gw_create(void);
+
+void occanlib_gw_free(occan_gw_t gw);
+
+/* Add a channel, received through a lease ring of lease_slots messages.
+ * Returns channel index or negative.
+ */
+int occanlib_gw_add_chan(occan_gw_t gw, occan_t chan, int lease_slots);
+
+/* Add route after the existing ones. Returns route index or negative */
+int occanlib_gw_add_route(occan_gw_t gw, struct occan_gw_route *route);
+
+/* Receive one batch from every input channel and forward it. Returns
+ * number of messages received or negative error. Call again directly when
+ * non-zero, otherwise after a pause.
+ */
+int occanlib_gw_poll(occan_gw_t gw);
+
+void occanlib_gw_get_stats(occan_gw_t gw, struct occan_gw_stats *stats);
+
+int occanlib_gw_get_route_stats(occan_gw_t gw, int route, struct occan_gw_route_stats *stats);
+
+void occanlib_gw_stats_print(occan_gw_t gw);
+
+#endif
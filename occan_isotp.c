@@ -0,0 +1,557 @@
+/* ISO 15765-2 style transport for occan_lib, see occan_isotp.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "occan_isotp.h"
+
+#define RX_BATCH 32
+#define TX_BATCH 16	/* Consecutive frames per driver write */
+
+#define PCI_SF 0
+#define PCI_FF 1
+#define PCI_CF 2
+#define PCI_FC 3
+
+#define FC_CTS 0
+#define FC_WAIT 1
+#define FC_OVFLW 2
+
+#define TX_IDLE 0
+#define TX_FIRST 1	/* Single or first frame not yet written */
+#define TX_WAIT_FC 2
+#define TX_CF 3		/* Writing consecutive frames */
+
+struct isotp_sess {
+	struct occan_isotp_cfg cfg;
+	unsigned char stmin;	/* cfg.stmin_us encoded for flow control */
+
+	/* Sender */
+	int tx_state;
+	int tx_status;		/* Result of last transfer */
+	unsigned char *tx_data;
+	int tx_len;
+	int tx_pos;
+	unsigned int tx_sn;
+	int tx_bs;		/* Block size of receiver, 0 = all */
+	int tx_block;		/* Frames left in block */
+	unsigned int tx_stmin;	/* us */
+	unsigned int tx_time;	/* Last frame written or flow control */
+	int tx_wft;
+
+	/* Receiver */
+	int rx_buf;		/* Pool buffer, -1 when not receiving */
+	int rx_len;
+	int rx_pos;
+	unsigned int rx_sn;
+	int rx_block;		/* Frames received in block */
+	unsigned int rx_time;	/* Last frame received */
+	int fc_pending;		/* Flow status + 1 to send, driver was full */
+};
+
+/* Completely received message waiting for occanlib_isotp_recv() */
+struct isotp_done {
+	short sess;
+	short buf;
+	int len;
+};
+
+struct occan_isotp_s {
+	occan_t chan;
+	int nsess;
+	struct isotp_sess sess[OCCAN_ISOTP_SESSIONS_MAX];
+	unsigned char *pool;
+	int buf_size;
+	int nbufs;
+	unsigned short *free;	/* Stack of free buffer indexes */
+	int nfree;
+	struct isotp_done *done;/* Ring of nbufs entries */
+	int done_head;
+	int done_cnt;
+	CANMsg rxmsgs[RX_BATCH];
+	CANMsg txmsgs[TX_BATCH];
+	struct occan_isotp_stats stats;
+};
+
+/* STmin: 0x00-0x7f milliseconds, 0xf1-0xf9 100-900 microseconds */
+static unsigned char stmin_encode(unsigned int us)
+{
+	unsigned int ms;
+
+	if ( us == 0 )
+		return 0;
+	if ( us <= 900 )
+		return 0xf0 + (us + 99) / 100;
+	ms = (us + 999) / 1000;
+	return (ms > 0x7f) ? 0x7f : ms;
+}
+
+static unsigned int stmin_decode(unsigned char v)
+{
+	if ( v <= 0x7f )
+		return v * 1000;
+	if ( (v >= 0xf1) && (v <= 0xf9) )
+		return (v - 0xf0) * 100;
+	/* Reserved values are taken as the longest time */
+	return 127000;
+}
+
+occan_isotp_t occanlib_isotp_create(occan_t chan, int bufs, int buf_size){
+	occan_isotp_t tp;
+	int i;
+
+	if ( !chan || (bufs < 1) || (bufs > 0xffff) ||
+	     (buf_size < 8) || (buf_size > OCCAN_ISOTP_LEN_MAX) )
+		return NULL;
+
+	tp = calloc(1, sizeof(*tp));
+	if ( !tp )
+		return NULL;
+	tp->pool = malloc(bufs * buf_size);
+	tp->free = malloc(bufs * sizeof(unsigned short));
+	tp->done = malloc(bufs * sizeof(struct isotp_done));
+	if ( !tp->pool || !tp->free || !tp->done ) {
+		printf("occanlib_isotp_create: failed to allocate %d buffers of %d bytes\n",
+			bufs, buf_size);
+		occanlib_isotp_free(tp);
+		return NULL;
+	}
+	tp->chan = chan;
+	tp->buf_size = buf_size;
+	tp->nbufs = bufs;
+	for (i=0; i<bufs; i++)
+		tp->free[i] = bufs - 1 - i;
+	tp->nfree = bufs;
+
+	return tp;
+}
+
+void occanlib_isotp_free(occan_isotp_t tp){
+	if ( !tp )
+		return;
+	free(tp->pool);
+	free(tp->free);
+	free(tp->done);
+	free(tp);
+}
+
+int occanlib_isotp_add_session(occan_isotp_t tp, struct occan_isotp_cfg *cfg){
+	struct isotp_sess *s;
+
+	if ( !tp || !cfg || (tp->nsess >= OCCAN_ISOTP_SESSIONS_MAX) ||
+	     (cfg->bs < 0) || (cfg->bs > 0xff) )
+		return -1;
+
+	s = &tp->sess[tp->nsess];
+	memset(s, 0, sizeof(*s));
+	s->cfg = *cfg;
+	s->stmin = stmin_encode(cfg->stmin_us);
+	s->rx_buf = -1;
+
+	return tp->nsess++;
+}
+
+static unsigned char *isotp_buf(occan_isotp_t tp, int b)
+{
+	return &tp->pool[b * tp->buf_size];
+}
+
+static void isotp_frame_init(struct isotp_sess *s, CANMsg *msg)
+{
+	msg->extended = s->cfg.extended;
+	msg->rtr = 0;
+	msg->sshot = 0;
+	msg->id = s->cfg.tx_id;
+	msg->len = 8;
+	memset(msg->data, OCCAN_ISOTP_PAD, 8);
+}
+
+/* Returns 1 when written, 0 when left pending or negative on error */
+static int isotp_send_fc(occan_isotp_t tp, struct isotp_sess *s, int status)
+{
+	CANMsg msg;
+	int ret;
+
+	isotp_frame_init(s, &msg);
+	msg.data[0] = (PCI_FC << 4) | status;
+	msg.data[1] = s->cfg.bs;
+	msg.data[2] = s->stmin;
+	ret = occanlib_send_multiple(tp->chan, &msg, 1);
+	if ( ret <= 0 ) {
+		s->fc_pending = status + 1;
+		return ret;
+	}
+	s->fc_pending = 0;
+	tp->stats.fc_tx++;
+	tp->stats.frames_tx++;
+	return 1;
+}
+
+static void isotp_rx_abort(occan_isotp_t tp, struct isotp_sess *s)
+{
+	if ( s->rx_buf < 0 )
+		return;
+	tp->free[tp->nfree++] = s->rx_buf;
+	s->rx_buf = -1;
+	s->fc_pending = 0;
+}
+
+static void isotp_rx_done(occan_isotp_t tp, struct isotp_sess *s, int b, int len)
+{
+	struct isotp_done *d;
+
+	d = &tp->done[(tp->done_head + tp->done_cnt) % tp->nbufs];
+	d->sess = s - tp->sess;
+	d->buf = b;
+	d->len = len;
+	tp->done_cnt++;
+	tp->stats.rx_msgs++;
+	tp->stats.rx_bytes += len;
+}
+
+static void isotp_tx_end(occan_isotp_t tp, struct isotp_sess *s, int status)
+{
+	s->tx_state = TX_IDLE;
+	s->tx_status = status;
+	if ( status == OCCAN_ISOTP_IDLE ) {
+		tp->stats.tx_msgs++;
+		tp->stats.tx_bytes += s->tx_len;
+	}
+}
+
+static struct isotp_sess *isotp_lookup(occan_isotp_t tp, CANMsg *msg)
+{
+	struct isotp_sess *s;
+	int i;
+
+	for (i=0; i<tp->nsess; i++) {
+		s = &tp->sess[i];
+		if ( (s->cfg.rx_id == msg->id) && (s->cfg.extended == msg->extended) )
+			return s;
+	}
+	return NULL;
+}
+
+/* Handle one received frame. Returns number of frames written (flow
+ * control) or negative driver error.
+ */
+static int isotp_rx_frame(occan_isotp_t tp, CANMsg *msg, unsigned int now)
+{
+	struct isotp_sess *s;
+	unsigned char pci;
+	int len, b;
+
+	s = isotp_lookup(tp, msg);
+	if ( !s || msg->rtr )
+		return 0;
+	tp->stats.frames_rx++;
+	if ( msg->len < 1 ) {
+		tp->stats.unexpected++;
+		return 0;
+	}
+	pci = msg->data[0];
+
+	switch ( pci >> 4 ) {
+	case PCI_SF:
+		len = pci & 0xf;
+		if ( (len == 0) || (len > msg->len - 1) ) {
+			tp->stats.unexpected++;
+			return 0;
+		}
+		if ( s->rx_buf >= 0 ) {
+			tp->stats.aborts++;
+			isotp_rx_abort(tp, s);
+		}
+		if ( tp->nfree == 0 ) {
+			tp->stats.overflows++;
+			return 0;
+		}
+		b = tp->free[--tp->nfree];
+		memcpy(isotp_buf(tp, b), &msg->data[1], len);
+		isotp_rx_done(tp, s, b, len);
+		return 0;
+
+	case PCI_FF:
+		len = ((pci & 0xf) << 8) | msg->data[1];
+		if ( (msg->len < 8) || (len < 8) ) {
+			tp->stats.unexpected++;
+			return 0;
+		}
+		if ( s->rx_buf >= 0 ) {
+			tp->stats.aborts++;
+			isotp_rx_abort(tp, s);
+		}
+		if ( (len > tp->buf_size) || (tp->nfree == 0) ) {
+			tp->stats.overflows++;
+			return isotp_send_fc(tp, s, FC_OVFLW);
+		}
+		s->rx_buf = tp->free[--tp->nfree];
+		memcpy(isotp_buf(tp, s->rx_buf), &msg->data[2], 6);
+		s->rx_len = len;
+		s->rx_pos = 6;
+		s->rx_sn = 1;
+		s->rx_block = 0;
+		s->rx_time = now;
+		return isotp_send_fc(tp, s, FC_CTS);
+
+	case PCI_CF:
+		if ( s->rx_buf < 0 ) {
+			tp->stats.unexpected++;
+			return 0;
+		}
+		if ( (pci & 0xf) != (s->rx_sn & 0xf) ) {
+			tp->stats.seq_errs++;
+			isotp_rx_abort(tp, s);
+			return 0;
+		}
+		len = s->rx_len - s->rx_pos;
+		if ( len > 7 )
+			len = 7;
+		if ( msg->len < len + 1 ) {
+			tp->stats.unexpected++;
+			isotp_rx_abort(tp, s);
+			return 0;
+		}
+		memcpy(isotp_buf(tp, s->rx_buf) + s->rx_pos, &msg->data[1], len);
+		s->rx_pos += len;
+		s->rx_sn++;
+		s->rx_time = now;
+		if ( s->rx_pos == s->rx_len ) {
+			isotp_rx_done(tp, s, s->rx_buf, s->rx_len);
+			s->rx_buf = -1;
+			return 0;
+		}
+		if ( s->cfg.bs && (++s->rx_block == s->cfg.bs) ) {
+			s->rx_block = 0;
+			return isotp_send_fc(tp, s, FC_CTS);
+		}
+		return 0;
+
+	case PCI_FC:
+		if ( (s->tx_state != TX_WAIT_FC) || (msg->len < 3) ) {
+			tp->stats.unexpected++;
+			return 0;
+		}
+		switch ( pci & 0xf ) {
+		case FC_CTS:
+			s->tx_bs = msg->data[1];
+			s->tx_block = s->tx_bs;
+			s->tx_stmin = stmin_decode(msg->data[2]);
+			/* First consecutive frame is not delayed */
+			s->tx_time = now - s->tx_stmin;
+			s->tx_state = TX_CF;
+			break;
+		case FC_WAIT:
+			tp->stats.fc_wait++;
+			if ( ++s->tx_wft > OCCAN_ISOTP_WFT_MAX ) {
+				tp->stats.timeouts++;
+				isotp_tx_end(tp, s, OCCAN_ISOTP_ETIMEOUT);
+			} else {
+				s->tx_time = now;
+			}
+			break;
+		case FC_OVFLW:
+			isotp_tx_end(tp, s, OCCAN_ISOTP_EOVFLW);
+			break;
+		default:
+			tp->stats.unexpected++;
+			break;
+		}
+		return 0;
+	}
+
+	tp->stats.unexpected++;
+	return 0;
+}
+
+/* Write the next frames of a session. Returns number of frames written or
+ * negative driver error.
+ */
+static int isotp_tx(occan_isotp_t tp, struct isotp_sess *s, unsigned int now)
+{
+	CANMsg *msg;
+	int ret, k, max, pos, cnt;
+	unsigned int sn;
+
+	switch ( s->tx_state ) {
+	case TX_FIRST:
+		msg = &tp->txmsgs[0];
+		isotp_frame_init(s, msg);
+		if ( s->tx_len <= 7 ) {
+			msg->data[0] = (PCI_SF << 4) | s->tx_len;
+			memcpy(&msg->data[1], s->tx_data, s->tx_len);
+		} else {
+			msg->data[0] = (PCI_FF << 4) | (s->tx_len >> 8);
+			msg->data[1] = s->tx_len & 0xff;
+			memcpy(&msg->data[2], s->tx_data, 6);
+		}
+		ret = occanlib_send_multiple(tp->chan, msg, 1);
+		if ( ret <= 0 )
+			break;
+		tp->stats.frames_tx++;
+		if ( s->tx_len <= 7 ) {
+			isotp_tx_end(tp, s, OCCAN_ISOTP_IDLE);
+		} else {
+			s->tx_pos = 6;
+			s->tx_sn = 1;
+			s->tx_wft = 0;
+			s->tx_time = now;
+			s->tx_state = TX_WAIT_FC;
+		}
+		return 1;
+
+	case TX_CF:
+		if ( now - s->tx_time < s->tx_stmin )
+			return 0;
+		max = s->tx_stmin ? 1 : TX_BATCH;
+		if ( s->tx_bs && (s->tx_block < max) )
+			max = s->tx_block;
+		pos = s->tx_pos;
+		sn = s->tx_sn;
+		for (k=0; (k < max) && (pos < s->tx_len); k++) {
+			msg = &tp->txmsgs[k];
+			isotp_frame_init(s, msg);
+			msg->data[0] = (PCI_CF << 4) | (sn++ & 0xf);
+			cnt = s->tx_len - pos;
+			if ( cnt > 7 )
+				cnt = 7;
+			memcpy(&msg->data[1], s->tx_data + pos, cnt);
+			pos += cnt;
+		}
+		ret = occanlib_send_multiple(tp->chan, tp->txmsgs, k);
+		if ( ret <= 0 )
+			break;
+		tp->stats.frames_tx += ret;
+		s->tx_pos += ret * 7;
+		s->tx_sn += ret;
+		s->tx_time = now;
+		if ( s->tx_pos >= s->tx_len ) {
+			s->tx_pos = s->tx_len;
+			isotp_tx_end(tp, s, OCCAN_ISOTP_IDLE);
+		} else if ( s->tx_bs && ((s->tx_block -= ret) == 0) ) {
+			s->tx_wft = 0;
+			s->tx_state = TX_WAIT_FC;
+		}
+		return ret;
+
+	default:
+		return 0;
+	}
+
+	if ( ret < 0 )
+		isotp_tx_end(tp, s, OCCAN_ISOTP_EDRV);
+	return ret;
+}
+
+static void isotp_timeouts(occan_isotp_t tp, struct isotp_sess *s, unsigned int now)
+{
+	if ( (s->tx_state == TX_WAIT_FC) && (now - s->tx_time > OCCAN_ISOTP_TIMEOUT_US) ) {
+		tp->stats.timeouts++;
+		isotp_tx_end(tp, s, OCCAN_ISOTP_ETIMEOUT);
+	}
+	if ( (s->rx_buf >= 0) && (now - s->rx_time > OCCAN_ISOTP_TIMEOUT_US) ) {
+		tp->stats.timeouts++;
+		isotp_rx_abort(tp, s);
+	}
+}
+
+int occanlib_isotp_send(occan_isotp_t tp, int sess, unsigned char *data, int len){
+	struct isotp_sess *s;
+
+	if ( !tp || (sess < 0) || (sess >= tp->nsess) || !data ||
+	     (len < 1) || (len > OCCAN_ISOTP_LEN_MAX) )
+		return -1;
+	s = &tp->sess[sess];
+	if ( s->tx_state != TX_IDLE )
+		return -1;
+
+	s->tx_data = data;
+	s->tx_len = len;
+	s->tx_pos = 0;
+	s->tx_status = OCCAN_ISOTP_BUSY;
+	s->tx_state = TX_FIRST;
+	return 0;
+}
+
+int occanlib_isotp_tx_status(occan_isotp_t tp, int sess){
+	if ( !tp || (sess < 0) || (sess >= tp->nsess) )
+		return -1;
+	return tp->sess[sess].tx_status;
+}
+
+int occanlib_isotp_poll(occan_isotp_t tp){
+	struct isotp_sess *s;
+	unsigned int now;
+	int i, cnt, ret, total;
+
+	if ( !tp )
+		return -1;
+
+	cnt = occanlib_recv_multiple(tp->chan, tp->rxmsgs, RX_BATCH);
+	if ( cnt < 0 )
+		return cnt;
+	total = cnt;
+	now = occanlib_time_us();
+	for (i=0; i<cnt; i++) {
+		ret = isotp_rx_frame(tp, &tp->rxmsgs[i], now);
+		if ( ret < 0 )
+			return ret;
+		total += ret;
+	}
+
+	for (i=0; i<tp->nsess; i++) {
+		s = &tp->sess[i];
+		if ( s->fc_pending ) {
+			ret = isotp_send_fc(tp, s, s->fc_pending - 1);
+			if ( ret < 0 )
+				return ret;
+			total += ret;
+		}
+		ret = isotp_tx(tp, s, now);
+		if ( ret < 0 )
+			return ret;
+		total += ret;
+		isotp_timeouts(tp, s, now);
+	}
+
+	return total;
+}
+
+int occanlib_isotp_recv(occan_isotp_t tp, struct occan_isotp_msg *msg){
+	struct isotp_done *d;
+
+	if ( !tp || !msg || (tp->done_cnt == 0) )
+		return 0;
+
+	d = &tp->done[tp->done_head];
+	msg->sess = d->sess;
+	msg->data = isotp_buf(tp, d->buf);
+	msg->len = d->len;
+	tp->done_head = (tp->done_head + 1) % tp->nbufs;
+	tp->done_cnt--;
+	return 1;
+}
+
+void occanlib_isotp_release(occan_isotp_t tp, unsigned char *data){
+	if ( !tp || !data )
+		return;
+	tp->free[tp->nfree++] = (data - tp->pool) / tp->buf_size;
+}
+
+void occanlib_isotp_get_stats(occan_isotp_t tp, struct occan_isotp_stats *stats){
+	*stats = tp->stats;
+}
+
+void occanlib_isotp_stats_print(occan_isotp_t tp){
+	struct occan_isotp_stats *st = &tp->stats;
+
+	printf("ISOTP: tx %u msgs %u bytes, rx %u msgs %u bytes, frames tx %u rx %u, "
+		"%d/%d buffers free\n",
+		st->tx_msgs, st->tx_bytes, st->rx_msgs, st->rx_bytes,
+		st->frames_tx, st->frames_rx, tp->nfree, tp->nbufs);
+	printf("  flow controls %u, waits %u, timeouts %u, sequence errors %u, "
+		"overflows %u, aborts %u, unexpected %u\n",
+		st->fc_tx, st->fc_wait, st->timeouts, st->seq_errs,
+		st->overflows, st->aborts, st->unexpected);
+}
@@ -0,0 +1,122 @@
+
+#ifndef __OCCAN_ISOTP_H__
+#define __OCCAN_ISOTP_H__
+
+/* ISO 15765-2 style transport for occan_lib
+ *
+ * Sends and receives messages of up to OCCAN_ISOTP_LEN_MAX bytes over one
+ * OC-CAN channel, segmented into CAN frames with normal addressing:
+ *
+ *   Single frame      0x0L  data[L]            L = 1..7
+ *   First frame       0x1H  LL  data[6]        length 0xHLL, 8..4095
+ *   Consecutive frame 0x2N  data[7]            N = sequence number mod 16
+ *   Flow control      0x3S  BS  STmin          S = 0 CTS, 1 WAIT, 2 OVFLW
+ *
+ * The receiver answers a first frame and every block of BS consecutive
+ * frames with a flow control frame, the sender waits for it and keeps at
+ * least STmin between consecutive frames. Frames are padded to 8 bytes.
+ *
+ * A session is a pair of CAN IDs, one for each direction, and may send and
+ * receive at the same time. Any number of sessions up to
+ * OCCAN_ISOTP_SESSIONS_MAX run concurrently on one channel. Received
+ * messages are reassembled into buffers from a pool allocated when the
+ * transport is created, no memory is allocated per message. A completed
+ * message is handed to the application with occanlib_isotp_recv() and its
+ * buffer returned with occanlib_isotp_release(). Sent data is not copied,
+ * it must stay valid until the transfer is done.
+ *
+ * The transport is used by one task, all frame handling is done by
+ * occanlib_isotp_poll() and the channel must be in non-blocking RX and TX
+ * mode. Consecutive frames are written in batches when STmin is zero.
+ * STmin is timed with occanlib_time_us() between polls, so its resolution
+ * is the poll period.
+ */
+
+#include "occan_lib.h"
+
+#define OCCAN_ISOTP_LEN_MAX		4095
+#define OCCAN_ISOTP_SESSIONS_MAX	16
+#define OCCAN_ISOTP_TIMEOUT_US		1000000	/* N_Bs and N_Cr */
+#define OCCAN_ISOTP_WFT_MAX		8	/* WAIT flow controls accepted */
+#define OCCAN_ISOTP_PAD			0xcc
+
+/* occanlib_isotp_tx_status() results */
+#define OCCAN_ISOTP_IDLE	0	/* Done, or nothing sent yet */
+#define OCCAN_ISOTP_BUSY	1	/* Transfer in progress */
+#define OCCAN_ISOTP_ETIMEOUT	-2	/* No flow control from receiver */
+#define OCCAN_ISOTP_EOVFLW	-3	/* Receiver has no room for message */
+#define OCCAN_ISOTP_EDRV	-4	/* Driver write failed */
+
+struct occan_isotp_cfg {
+	unsigned int tx_id;	/* ID of frames sent */
+	unsigned int rx_id;	/* ID of frames received */
+	int extended;		/* Extended IDs */
+	int bs;			/* Block size requested as receiver, 0 = all */
+	unsigned int stmin_us;	/* Separation time requested as receiver */
+};
+
+/* Received message, data is a pool buffer owned by the application until
+ * released.
+ */
+struct occan_isotp_msg {
+	int sess;
+	unsigned char *data;
+	int len;
+};
+
+struct occan_isotp_stats {
+	unsigned int tx_msgs;	/* Messages sent completely */
+	unsigned int tx_bytes;
+	unsigned int rx_msgs;	/* Messages received completely */
+	unsigned int rx_bytes;
+	unsigned int frames_tx;
+	unsigned int frames_rx;
+	unsigned int fc_tx;	/* Flow control frames sent */
+	unsigned int fc_wait;	/* WAIT flow controls received */
+	unsigned int timeouts;	/* Transfers aborted by N_Bs or N_Cr */
+	unsigned int seq_errs;	/* Receptions aborted by wrong sequence number */
+	unsigned int overflows;	/* Messages refused, no buffer or too long */
+	unsigned int aborts;	/* Receptions restarted by a new first frame */
+	unsigned int unexpected;/* Frames not fitting the session state */
+};
+
+typedef struct occan_isotp_s *occan_isotp_t;
+
+/* Create transport on an opened channel, with a pool of 'bufs' reassembly
+ * buffers of buf_size bytes (at most OCCAN_ISOTP_LEN_MAX).
+ */
+occan_isotp_t occanlib_isotp_create(occan_t chan, int bufs, int buf_size);
+
+void occanlib_isotp_free(occan_isotp_t tp);
+
+/* Add a session, returns session index or negative */
+int occanlib_isotp_add_session(occan_isotp_t tp, struct occan_isotp_cfg *cfg);
+
+/* Start sending len bytes on a session. Returns 0 when started, -1 on bad
+ * arguments or while the previous transfer of the session is busy.
+ */
+int occanlib_isotp_send(occan_isotp_t tp, int sess, unsigned char *data, int len);
+
+/* State of the last transfer started on a session, OCCAN_ISOTP_ results */
+int occanlib_isotp_tx_status(occan_isotp_t tp, int sess);
+
+/* Handle received frames, send pending frames and check timeouts. Returns
+ * number of frames received and sent or negative driver error. Call again
+ * directly when non-zero, otherwise after a pause no longer than the
+ * smallest STmin in use.
+ */
+int occanlib_isotp_poll(occan_isotp_t tp);
+
+/* Take the oldest completely received message, returns 1 if msg was filled
+ * and 0 if there is none.
+ */
+int occanlib_isotp_recv(occan_isotp_t tp, struct occan_isotp_msg *msg);
+
+/* Give back the buffer of a received message */
+void occanlib_isotp_release(occan_isotp_t tp, unsigned char *data);
+
+void occanlib_isotp_get_stats(occan_isotp_t tp, struct occan_isotp_stats *stats);
+
+void occanlib_isotp_stats_print(occan_isotp_t tp);
+
+#endif
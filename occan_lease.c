@@ -0,0 +1,131 @@
+/* Leased receive for occan_lib, see occan_lease.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "occan_lease.h"
+
+/* The counters are free running, the slot index is counter & (slots-1).
+ *   tail   oldest message not released
+ *   lease  oldest message not leased
+ *   head   next slot the driver reads into
+ */
+struct occan_lease_s {
+	occan_t chan;
+	CANMsg *msgs;
+	unsigned int *ts;
+	unsigned int slots;
+	unsigned int head;
+	unsigned int lease;
+	unsigned int tail;
+	struct occan_lease_stats stats;
+};
+
+unsigned int occanlib_lease_time(void){
+	return occanlib_time_us();
+}
+
+occan_lease_t occanlib_lease_create(occan_t chan, int slots){
+	occan_lease_t ls;
+	int n;
+
+	if ( !chan || (slots < 1) )
+		return NULL;
+
+	/* Power of two so that the counters may wrap */
+	for (n=1; n<slots; n<<=1)
+		;
+	slots = n;
+
+	ls = calloc(1, sizeof(*ls));
+	if ( !ls )
+		return NULL;
+	ls->msgs = malloc(sizeof(CANMsg) * slots);
+	ls->ts = malloc(sizeof(unsigned int) * slots);
+	if ( !ls->msgs || !ls->ts ){
+		printf("occanlib_lease_create: failed to allocate %d slots\n", slots);
+		occanlib_lease_free(ls);
+		return NULL;
+	}
+	ls->chan = chan;
+	ls->slots = slots;
+
+	return ls;
+}
+
+void occanlib_lease_free(occan_lease_t ls){
+	if ( !ls )
+		return;
+	free(ls->msgs);
+	free(ls->ts);
+	free(ls);
+}
+
+int occanlib_lease_fill(occan_lease_t ls){
+	unsigned int idx, room, now;
+	int cnt, i;
+
+	/* Free slots up to the end of the ring */
+	room = ls->slots - (ls->head - ls->tail);
+	if ( room == 0 ){
+		ls->stats.full++;
+		return 0;
+	}
+	idx = ls->head & (ls->slots - 1);
+	if ( idx + room > ls->slots )
+		room = ls->slots - idx;
+
+	cnt = occanlib_recv_multiple(ls->chan, &ls->msgs[idx], room);
+	if ( cnt <= 0 )
+		return cnt;
+
+	now = occanlib_lease_time();
+	for (i=0; i<cnt; i++)
+		ls->ts[idx + i] = now;
+	ls->head += cnt;
+	ls->stats.reads++;
+	ls->stats.msgs += cnt;
+
+	return cnt;
+}
+
+int occanlib_lease_recv(occan_lease_t ls, struct occan_lease_batch *batch, int max){
+	unsigned int idx, cnt;
+	int ret;
+
+	if ( !ls || !batch || (max < 0) )
+		return -1;
+
+	if ( ls->head == ls->lease ){
+		ret = occanlib_lease_fill(ls);
+		if ( ret < 0 )
+			return ret;
+	}
+
+	cnt = ls->head - ls->lease;
+	idx = ls->lease & (ls->slots - 1);
+	if ( idx + cnt > ls->slots )
+		cnt = ls->slots - idx;
+	if ( cnt > (unsigned int)max )
+		cnt = max;
+
+	batch->msgs = &ls->msgs[idx];
+	batch->ts = &ls->ts[idx];
+	batch->cnt = cnt;
+	ls->lease += cnt;
+
+	return cnt;
+}
+
+int occanlib_lease_release(occan_lease_t ls, int cnt){
+	if ( !ls || (cnt < 0) || ((unsigned int)cnt > ls->lease - ls->tail) )
+		return -1;
+
+	ls->tail += cnt;
+
+	return 0;
+}
+
+void occanlib_lease_get_stats(occan_lease_t ls, struct occan_lease_stats *stats){
+	*stats = ls->stats;
+}
@@ -0,0 +1,67 @@
+
+#ifndef __OCCAN_LEASE_H__
+#define __OCCAN_LEASE_H__
+
+/* Leased receive for occan_lib
+ *
+ * occanlib_recv_multiple() copies messages into a caller array, which the
+ * application then typically copies again into its own buffers. With the
+ * lease interface the driver reads directly into the slots of a ring owned
+ * by the library, and the application gets pointers into that ring. It
+ * processes the messages in place and releases them in one batch with
+ * occanlib_lease_release(). A slot is not reused until it is released.
+ *
+ * Every message gets a microsecond timestamp. The OC-CAN driver does not
+ * timestamp messages itself, so the time is taken when the driver read
+ * returns and is shared by all messages of that read. Small driver reads
+ * therefore give more precise timestamps.
+ *
+ * The ring is used by one task only.
+ */
+
+#include "occan_lib.h"
+
+typedef struct occan_lease_s *occan_lease_t;
+
+/* Messages leased to the application, ts[i] is the timestamp of msgs[i] */
+struct occan_lease_batch {
+	CANMsg *msgs;
+	unsigned int *ts;
+	int cnt;
+};
+
+struct occan_lease_stats {
+	unsigned int reads;	/* Driver reads returning messages */
+	unsigned int msgs;	/* Messages read */
+	unsigned int full;	/* Fills skipped because all slots were leased */
+};
+
+/* Create lease ring of at least 'slots' messages on an opened channel, the
+ * size is rounded up to a power of two.
+ */
+occan_lease_t occanlib_lease_create(occan_t chan, int slots);
+
+void occanlib_lease_free(occan_lease_t ls);
+
+/* Read from driver into the free slots. Blocks only when the channel is in
+ * blocking RX mode and no messages are available. Returns number of
+ * messages read or negative occanlib_recv_multiple() error code.
+ */
+int occanlib_lease_fill(occan_lease_t ls);
+
+/* Lease up to max received messages not yet leased, reading from the driver
+ * first if there are none. The leased messages are contiguous in memory,
+ * at the end of the ring the batch is split into two leases. Returns number
+ * of messages leased or negative on error.
+ */
+int occanlib_lease_recv(occan_lease_t ls, struct occan_lease_batch *batch, int max);
+
+/* Give back the 'cnt' oldest leased messages */
+int occanlib_lease_release(occan_lease_t ls, int cnt);
+
+/* Microsecond time base used for timestamps */
+unsigned int occanlib_lease_time(void);
+
+void occanlib_lease_get_stats(occan_lease_t ls, struct occan_lease_stats *stats);
+
+#endif
@@ -10,6 +10,7 @@
 
 #include <occan.h>
 #include "occan_lib.h"
+#include "can/can_timing_table.h"
 
 /* The rtems to errno table
  *
@@ -36,7 +37,7 @@ occan_t occanlib_open(char *name) {
 
 	fd = open(name, O_RDWR);
 	if ( fd >= 0 ){
-		printf("occanlib_open: allocating memory %d\n",sizeof(*ret));
+		printf("occanlib_open: allocating memory %d\n",(int)sizeof(*ret));
 		ret = calloc(sizeof(*ret),1);
 		ret->fd = fd;
 	}else{
@@ -140,8 +141,11 @@ int occanlib_recv_multiple(occan_t chan, CANMsg *msgs, int msgcnt){
 		}
 		
 		if ( errno == EBUSY ){
-			/* CAN must be started before receiving */
-			printf("occanlib_recv_multiple: CAN is not started\n");
+			/* CAN must be started before receiving. A read woken up
+			 * by occanlib_stop() is the normal way to end a receiver.
+			 */
+			if ( !chan->stopped )
+				printf("occanlib_recv_multiple: CAN is not started\n");
 			return -2;
 		}
 		
@@ -201,6 +205,26 @@ int occanlib_set_speed_auto(occan_t chan){
 	return -100;
 }
 
+/* Set bit timing from the precomputed table in can/can_timing_table.h,
+ * no timing is calculated at runtime. Fails with -3 if the combination
+ * of core frequency, bitrate and sample point is not in the table.
+ */
+int occanlib_set_speed_table(occan_t chan, unsigned int clock_hz, unsigned int speed, unsigned int sampl_pt){
+	const struct can_timing_result *res;
+	
+	if ( !chan )
+		return -1;
+	
+	res = can_timing_lookup(occan_timing_table, clock_hz, speed, sampl_pt);
+	if ( !res ){
+		printf("occanlib_set_speed_table: no timing for %d @ %dkHz, %d%%\n",
+			speed, clock_hz/1000, sampl_pt);
+		return -3;
+	}
+	
+	return occanlib_set_btrs(chan, res->btr0, res->btr1);
+}
+
 int occanlib_set_btrs(occan_t chan, unsigned char btr0, unsigned char btr1){
 	int ret;
 	unsigned int btr0btr1;
@@ -370,6 +394,7 @@ int occanlib_start(occan_t chan){
 		printf("occanlib_start: failed, errno: %d, ret: %d\n",errno,ret);
 		return -1;
 	}
+	chan->stopped = 0;
 	return 0;
 }
 
@@ -379,8 +404,11 @@ int occanlib_stop(occan_t chan){
 	if ( !chan )
 		return -1;
 	
+	/* Set before the driver wakes up blocked readers */
+	chan->stopped = 1;
 	ret = ioctl(chan->fd,OCCAN_IOC_STOP,0);
 	if ( ret < 0 ){
+		chan->stopped = 0;
 	
 		if ( errno == EBUSY ){
 			printf("occanlib_stop: not started\n");
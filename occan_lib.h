@@ -12,10 +12,34 @@ typedef struct {
 	int fd;
 	int txblk;
 	int rxblk;
+	int stopped;	/* Stopped by occanlib_stop() */
 } occan_s;
 
 typedef occan_s *occan_t;
 
+/* Microsecond time base shared by the occan_lib extensions, wraps after
+ * about 71 minutes so only differences are meaningful.
+ */
+#ifdef __rtems__
+#include <rtems.h>
+static inline unsigned int occanlib_time_us(void)
+{
+	struct timespec ts;
+
+	rtems_clock_get_uptime(&ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+#else
+#include <time.h>
+static inline unsigned int occanlib_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+#endif
+
 /* Open device driver named 'name'. 
  *  - /dev/occan0           (ON-CHIP BUS)
  *  - /dev/occan1           (ON-CHIP BUS)
@@ -45,6 +69,11 @@ int occanlib_set_speed_auto(occan_t chan);
 
 int occanlib_set_btrs(occan_t chan, unsigned char btr0, unsigned char btr1);
 
+/* Set BTR0/BTR1 from the generated timing table (can/can_timing_table.h)
+ * for the given core frequency, bitrate and sample point in percent.
+ */
+int occanlib_set_speed_table(occan_t chan, unsigned int clock_hz, unsigned int speed, unsigned int sampl_pt);
+
 int occanlib_set_buf_length(occan_t chan, unsigned short txlen, unsigned short rxlen);
 
 int occanlib_get_stats(occan_t chan, occan_stats *stats);
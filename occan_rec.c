@@ -0,0 +1,232 @@
+/* CAN message recorder for occan_lib, see occan_rec.h for the format */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "occan_rec.h"
+#include "occan_lease.h"
+#include "mem_barrier.h"
+
+/* head is the block being written, blocks tail..head-1 are committed and
+ * wait for the drain task. Both counters are free running.
+ */
+struct occan_rec_s {
+	occan_lease_t ls;
+	unsigned char *blocks;
+	unsigned int nblocks;
+	volatile unsigned int head;
+	volatile unsigned int tail;
+
+	/* Block being written, NULL when the ring is full */
+	unsigned char *cur;
+	unsigned int pos;
+	unsigned int nrec;
+	unsigned int idmap[2];
+	unsigned int last_id;	/* ID of previous record, ~0 = none */
+
+	unsigned int seq;
+	unsigned int lost_pending;	/* Lost since last block started */
+	unsigned int last_ts;		/* 32-bit time of previous message */
+	unsigned long long time;	/* 64-bit time of previous message */
+	int time_valid;
+
+	struct occan_rec_stats stats;
+};
+
+static void put_be16(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void put_be32(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+occan_rec_t occanlib_rec_create(occan_t chan, int nblocks, int lease_slots){
+	occan_rec_t rec;
+
+	if ( nblocks < 2 )
+		return NULL;
+
+	rec = calloc(1, sizeof(*rec));
+	if ( !rec )
+		return NULL;
+	rec->blocks = malloc(CANREC_BLOCK_SIZE * nblocks);
+	if ( !rec->blocks ){
+		printf("occanlib_rec_create: failed to allocate %d blocks\n", nblocks);
+		free(rec);
+		return NULL;
+	}
+	if ( chan ){
+		rec->ls = occanlib_lease_create(chan, lease_slots);
+		if ( !rec->ls ){
+			free(rec->blocks);
+			free(rec);
+			return NULL;
+		}
+	}
+	rec->nblocks = nblocks;
+
+	return rec;
+}
+
+void occanlib_rec_free(occan_rec_t rec){
+	if ( !rec )
+		return;
+	occanlib_lease_free(rec->ls);
+	free(rec->blocks);
+	free(rec);
+}
+
+/* Start a new block if there is room in the ring */
+static int rec_open(occan_rec_t rec)
+{
+	if ( rec->head - rec->tail >= rec->nblocks )
+		return -1;
+
+	rec->cur = &rec->blocks[(rec->head % rec->nblocks) * CANREC_BLOCK_SIZE];
+	rec->pos = CANREC_HDR_SIZE;
+	rec->nrec = 0;
+	rec->idmap[0] = rec->idmap[1] = 0;
+	rec->last_id = ~0;
+	return 0;
+}
+
+static void rec_commit(occan_rec_t rec)
+{
+	unsigned char *b = rec->cur;
+
+	/* Time of first record is written by rec_msg() */
+	put_be32(&b[0], CANREC_MAGIC);
+	put_be32(&b[4], rec->seq++);
+	put_be16(&b[16], rec->pos);
+	put_be16(&b[18], rec->nrec);
+	put_be32(&b[24], rec->idmap[0]);
+	put_be32(&b[28], rec->idmap[1]);
+
+	rec->stats.blocks++;
+	rec->stats.bytes += rec->pos;
+	rec->cur = NULL;
+	MEM_BARRIER();
+	rec->head++;
+}
+
+int occanlib_rec_msg(occan_rec_t rec, CANMsg *msg, unsigned int ts){
+	unsigned char *p;
+	unsigned int delta, id, bit, len;
+
+	if ( rec->time_valid ){
+		delta = ts - rec->last_ts;
+	}else{
+		rec->time = ts;
+		rec->time_valid = 1;
+		delta = 0;
+	}
+	rec->time += delta;
+	rec->last_ts = ts;
+
+	if ( rec->cur && (rec->pos + CANREC_REC_MAX > CANREC_BLOCK_SIZE) )
+		rec_commit(rec);
+	if ( !rec->cur ){
+		if ( rec_open(rec) ){
+			rec->lost_pending++;
+			rec->stats.lost++;
+			return -1;
+		}
+	}
+
+	p = rec->cur;
+	if ( rec->nrec == 0 ){
+		/* Block time and loss since last block */
+		put_be32(&p[8], rec->time >> 32);
+		put_be32(&p[12], rec->time);
+		put_be32(&p[20], rec->lost_pending);
+		rec->lost_pending = 0;
+		delta = 0;
+	}
+	p += rec->pos;
+
+	len = msg->len > 8 ? 8 : msg->len;
+	id = msg->extended ? (msg->id & 0x1fffffff) | 0x80000000 : msg->id & 0x7ff;
+	*p = len | (msg->extended ? CANREC_HDR_EXT : 0) | (msg->rtr ? CANREC_HDR_RTR : 0) |
+		(id == rec->last_id ? CANREC_HDR_SAMEID : 0);
+	p++;
+	do {
+		*p = delta & 0x7f;
+		delta >>= 7;
+		if ( delta )
+			*p |= 0x80;
+		p++;
+	} while ( delta );
+	if ( id != rec->last_id ){
+		if ( msg->extended ){
+			put_be32(p, id & 0x1fffffff);
+			p += 4;
+		}else{
+			put_be16(p, id);
+			p += 2;
+		}
+		rec->last_id = id;
+		bit = CANREC_IDMAP_BIT(id & 0x1fffffff);
+		rec->idmap[bit >> 5] |= 0x80000000U >> (bit & 31);
+	}
+	if ( !msg->rtr ){
+		memcpy(p, msg->data, len);
+		p += len;
+	}
+
+	rec->pos = p - rec->cur;
+	rec->nrec++;
+	rec->stats.msgs++;
+
+	return 0;
+}
+
+int occanlib_rec_poll(occan_rec_t rec){
+	struct occan_lease_batch batch;
+	int cnt, i;
+
+	if ( !rec || !rec->ls )
+		return -1;
+
+	cnt = occanlib_lease_recv(rec->ls, &batch, 0x7fffffff);
+	if ( cnt <= 0 )
+		return cnt;
+	for (i=0; i<cnt; i++)
+		occanlib_rec_msg(rec, &batch.msgs[i], batch.ts[i]);
+	occanlib_lease_release(rec->ls, cnt);
+
+	return cnt;
+}
+
+int occanlib_rec_flush(occan_rec_t rec){
+	if ( !rec )
+		return -1;
+	if ( rec->cur && (rec->nrec > 0) )
+		rec_commit(rec);
+	return 0;
+}
+
+unsigned char *occanlib_rec_peek(occan_rec_t rec){
+	if ( rec->tail == rec->head )
+		return NULL;
+	MEM_BARRIER();
+	return &rec->blocks[(rec->tail % rec->nblocks) * CANREC_BLOCK_SIZE];
+}
+
+void occanlib_rec_release(occan_rec_t rec){
+	if ( rec->tail != rec->head ) {
+		MEM_BARRIER();
+		rec->tail++;
+	}
+}
+
+void occanlib_rec_get_stats(occan_rec_t rec, struct occan_rec_stats *stats){
+	*stats = rec->stats;
+}
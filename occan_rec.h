@@ -0,0 +1,88 @@
+
+#ifndef __OCCAN_REC_H__
+#define __OCCAN_REC_H__
+
+/* CAN message recorder for occan_lib
+ *
+ * Received messages are encoded into fixed size blocks kept in a ring. A
+ * drain task takes full blocks from the ring and writes them to SD card,
+ * a TCP socket or similar, the recorder never waits for it. When the ring
+ * is full new messages are dropped and counted.
+ *
+ * Block format (all multi-byte fields big-endian):
+ *   0   magic "CANR"
+ *   4   block sequence number, a gap means lost blocks
+ *   8   absolute time of first record [us], 64-bit
+ *   16  bytes used including header
+ *   18  number of records
+ *   20  messages lost before this block
+ *   24  ID map: bit (id*0x9e3779b1)>>26 set for every ID in block
+ *   32  records
+ *
+ * Record format:
+ *   hdr    bit 7: 0 (1 reserved), bit 6: EXT, bit 5: RTR, bit 4: same ID as
+ *          previous record (ID omitted), bits 3..0: data length
+ *   delta  time since previous record [us], unsigned LEB128 (1-5 bytes),
+ *          the first record of a block has delta 0
+ *   id     2 bytes (STD) or 4 bytes (EXT), unless same ID
+ *   data   length bytes, none for RTR
+ *
+ * Every block is self contained, so a reader can binary search blocks by
+ * time and skip blocks by the ID map without decoding them.
+ */
+
+#include "occan_lib.h"
+
+#define CANREC_BLOCK_SIZE	4096
+#define CANREC_HDR_SIZE		32
+#define CANREC_MAGIC		0x43414e52	/* "CANR" */
+#define CANREC_REC_MAX		(1 + 5 + 4 + 8)
+
+#define CANREC_HDR_EXT		0x40
+#define CANREC_HDR_RTR		0x20
+#define CANREC_HDR_SAMEID	0x10
+#define CANREC_HDR_LEN		0x0f
+
+/* ID map bit of a CAN ID */
+#define CANREC_IDMAP_BIT(id)	(((unsigned int)(id) * 0x9e3779b1U) >> 26)
+
+struct occan_rec_stats {
+	unsigned int msgs;	/* Messages recorded */
+	unsigned int lost;	/* Messages dropped, ring full */
+	unsigned int blocks;	/* Blocks committed */
+	unsigned int bytes;	/* Record bytes committed */
+};
+
+typedef struct occan_rec_s *occan_rec_t;
+
+/* Create recorder with a ring of nblocks blocks, receiving from chan with a
+ * lease ring of lease_slots messages. chan may be NULL when messages are
+ * only fed with occanlib_rec_msg().
+ */
+occan_rec_t occanlib_rec_create(occan_t chan, int nblocks, int lease_slots);
+
+void occanlib_rec_free(occan_rec_t rec);
+
+/* Record one message received at time ts [us, occanlib_time_us()] */
+int occanlib_rec_msg(occan_rec_t rec, CANMsg *msg, unsigned int ts);
+
+/* Receive from the channel and record everything received. Blocks in
+ * blocking RX mode. Returns number of messages recorded or negative error.
+ */
+int occanlib_rec_poll(occan_rec_t rec);
+
+/* Commit the current block even if not full, so that the drain task gets
+ * the data. Call periodically on a quiet bus.
+ */
+int occanlib_rec_flush(occan_rec_t rec);
+
+/* Oldest committed block or NULL, the block stays valid until it is
+ * released with occanlib_rec_release(). Called by the drain task.
+ */
+unsigned char *occanlib_rec_peek(occan_rec_t rec);
+
+void occanlib_rec_release(occan_rec_t rec);
+
+void occanlib_rec_get_stats(occan_rec_t rec, struct occan_rec_stats *stats);
+
+#endif
@@ -0,0 +1,317 @@
+/* Priority ordered CAN transmit queue for occan_lib, see occan_txq.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __rtems__
+#include <rtems.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "occan_txq.h"
+
+struct occan_txq_node {
+	unsigned int key;	/* Arbitration key, lower wins */
+	unsigned int seq;	/* FIFO order between equal keys */
+	unsigned int t_put;	/* Time queued [us] */
+	CANMsg msg;
+};
+
+struct occan_txq_s {
+	occan_t chan;
+	struct occan_txq_node *nodes;
+	unsigned short *heap;	/* Node indexes, heap[0] highest priority */
+	unsigned short *free;	/* Stack of free node indexes */
+	int depth;
+	int cnt;		/* Messages in heap */
+	int nfree;		/* Free nodes, nodes being sent are neither */
+	unsigned int seq;
+	unsigned int class_max[OCCAN_TXQ_CLASSES];
+	struct occan_txq_class_stats stats[OCCAN_TXQ_CLASSES];
+#ifdef __rtems__
+	rtems_id lock;
+#else
+	pthread_mutex_t lock;
+#endif
+};
+
+#ifdef __rtems__
+#define TXQ_LOCK(q) rtems_semaphore_obtain((q)->lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT)
+#define TXQ_UNLOCK(q) rtems_semaphore_release((q)->lock)
+#else
+#define TXQ_LOCK(q) pthread_mutex_lock(&(q)->lock)
+#define TXQ_UNLOCK(q) pthread_mutex_unlock(&(q)->lock)
+#endif
+
+/* Bit order of the arbitration field on the bus:
+ *   Standard: ID10..0, RTR, IDE=0
+ *   Extended: ID28..18, SRR=1, IDE=1, ID17..0, RTR
+ * A dominant (0) bit wins, so the lowest key wins arbitration.
+ */
+static unsigned int txq_key(CANMsg *msg)
+{
+	if ( msg->extended ) {
+		return ((msg->id >> 18) << 21) | (1 << 20) | (1 << 19) |
+			((msg->id & 0x3ffff) << 1) | (msg->rtr ? 1 : 0);
+	}
+	return ((msg->id & 0x7ff) << 21) | (msg->rtr ? (1 << 20) : 0);
+}
+
+static inline int txq_before(struct occan_txq_node *a, struct occan_txq_node *b)
+{
+	if ( a->key != b->key )
+		return a->key < b->key;
+	return (int)(a->seq - b->seq) < 0;
+}
+
+static void txq_heap_up(occan_txq_t q, int i)
+{
+	unsigned short n = q->heap[i];
+	int parent;
+
+	while ( i > 0 ) {
+		parent = (i - 1) / 2;
+		if ( !txq_before(&q->nodes[n], &q->nodes[q->heap[parent]]) )
+			break;
+		q->heap[i] = q->heap[parent];
+		i = parent;
+	}
+	q->heap[i] = n;
+}
+
+static void txq_heap_down(occan_txq_t q, int i)
+{
+	unsigned short n = q->heap[i];
+	int child;
+
+	while ( (child = 2 * i + 1) < q->cnt ) {
+		if ( (child + 1 < q->cnt) &&
+		     txq_before(&q->nodes[q->heap[child+1]], &q->nodes[q->heap[child]]) )
+			child++;
+		if ( !txq_before(&q->nodes[q->heap[child]], &q->nodes[n]) )
+			break;
+		q->heap[i] = q->heap[child];
+		i = child;
+	}
+	q->heap[i] = n;
+}
+
+static int txq_class(occan_txq_t q, unsigned int key)
+{
+	unsigned int base = key >> 21;
+	int i;
+
+	for (i=0; i<OCCAN_TXQ_CLASSES-1; i++) {
+		if ( base <= q->class_max[i] )
+			break;
+	}
+	return i;
+}
+
+occan_txq_t occanlib_txq_create(occan_t chan, int depth){
+	occan_txq_t q;
+	int i;
+
+	if ( !chan || (depth < 1) || (depth > 0xffff) )
+		return NULL;
+
+	q = calloc(1, sizeof(*q));
+	if ( !q )
+		return NULL;
+	q->nodes = malloc(sizeof(struct occan_txq_node) * depth);
+	q->heap = malloc(sizeof(unsigned short) * depth);
+	q->free = malloc(sizeof(unsigned short) * depth);
+	if ( !q->nodes || !q->heap || !q->free ){
+		printf("occanlib_txq_create: failed to allocate queue of %d\n", depth);
+		goto fail;
+	}
+#ifdef __rtems__
+	if ( rtems_semaphore_create(rtems_build_name('C','T','X','Q'), 1,
+	     RTEMS_BINARY_SEMAPHORE | RTEMS_PRIORITY | RTEMS_INHERIT_PRIORITY,
+	     0, &q->lock) != RTEMS_SUCCESSFUL ){
+		printf("occanlib_txq_create: failed to create semaphore\n");
+		goto fail;
+	}
+#else
+	pthread_mutex_init(&q->lock, NULL);
+#endif
+	q->chan = chan;
+	q->depth = depth;
+	for (i=0; i<depth; i++)
+		q->free[i] = i;
+	q->nfree = depth;
+	for (i=0; i<OCCAN_TXQ_CLASSES; i++)
+		q->class_max[i] = 0x7ff;
+
+	return q;
+
+fail:
+	free(q->nodes);
+	free(q->heap);
+	free(q->free);
+	free(q);
+	return NULL;
+}
+
+void occanlib_txq_free(occan_txq_t q){
+	if ( !q )
+		return;
+#ifdef __rtems__
+	rtems_semaphore_delete(q->lock);
+#else
+	pthread_mutex_destroy(&q->lock);
+#endif
+	free(q->nodes);
+	free(q->heap);
+	free(q->free);
+	free(q);
+}
+
+int occanlib_txq_set_class(occan_txq_t q, int cls, unsigned int max_base_id){
+	if ( !q || (cls < 0) || (cls >= OCCAN_TXQ_CLASSES) || (max_base_id > 0x7ff) )
+		return -1;
+	q->class_max[cls] = max_base_id;
+	return 0;
+}
+
+/* Insert node, caller holds lock and has checked for room */
+static void txq_insert(occan_txq_t q, unsigned short n)
+{
+	q->heap[q->cnt] = n;
+	q->cnt++;
+	txq_heap_up(q, q->cnt - 1);
+}
+
+int occanlib_txq_put(occan_txq_t q, CANMsg *msgs, int msgcnt){
+	struct occan_txq_node *node;
+	unsigned int now;
+	unsigned short n;
+	int i;
+
+	if ( !q || !msgs || (msgcnt < 0) )
+		return -1;
+
+	now = occanlib_time_us();
+	TXQ_LOCK(q);
+	for (i=0; i<msgcnt; i++) {
+		if ( q->nfree == 0 ) {
+			/* Count the rest as dropped in their classes */
+			for (; i<msgcnt; i++)
+				q->stats[txq_class(q, txq_key(&msgs[i]))].dropped++;
+			break;
+		}
+		n = q->free[--q->nfree];
+		node = &q->nodes[n];
+		node->key = txq_key(&msgs[i]);
+		node->seq = q->seq++;
+		node->t_put = now;
+		node->msg = msgs[i];
+		txq_insert(q, n);
+	}
+	TXQ_UNLOCK(q);
+
+	return i;
+}
+
+static void txq_account(occan_txq_t q, struct occan_txq_node *node, unsigned int now)
+{
+	struct occan_txq_class_stats *st;
+	unsigned int lat, b;
+
+	st = &q->stats[txq_class(q, node->key)];
+	lat = now - node->t_put;
+	st->sent++;
+	st->lat_sum += lat;
+	if ( lat > st->lat_max )
+		st->lat_max = lat;
+	for (b=0; (b < OCCAN_TXQ_HIST-1) && (lat >= (64U << b)); b++)
+		;
+	st->hist[b]++;
+}
+
+int occanlib_txq_pump(occan_txq_t q){
+	struct occan_txq_node *node;
+	unsigned short n;
+	int sent, ret;
+
+	if ( !q )
+		return -1;
+
+	sent = 0;
+	while ( 1 ) {
+		/* Remove the highest priority message while sending, so that
+		 * put() may add new messages meanwhile.
+		 */
+		TXQ_LOCK(q);
+		if ( q->cnt == 0 ) {
+			TXQ_UNLOCK(q);
+			break;
+		}
+		n = q->heap[0];
+		q->cnt--;
+		if ( q->cnt > 0 ) {
+			q->heap[0] = q->heap[q->cnt];
+			txq_heap_down(q, 0);
+		}
+		TXQ_UNLOCK(q);
+
+		node = &q->nodes[n];
+		ret = occanlib_send(q->chan, &node->msg);
+
+		TXQ_LOCK(q);
+		if ( ret == 1 ) {
+			txq_account(q, node, occanlib_time_us());
+			q->free[q->nfree++] = n;
+		} else {
+			/* Driver full or error, message goes back with its
+			 * original sequence number and time.
+			 */
+			txq_insert(q, n);
+		}
+		TXQ_UNLOCK(q);
+
+		if ( ret < 0 )
+			return ret;
+		if ( ret == 0 )
+			break;
+		sent++;
+		if ( q->chan->txblk )
+			break;
+	}
+
+	return sent;
+}
+
+int occanlib_txq_count(occan_txq_t q){
+	return q->cnt;
+}
+
+int occanlib_txq_get_stats(occan_txq_t q, int cls, struct occan_txq_class_stats *stats){
+	if ( !q || (cls < 0) || (cls >= OCCAN_TXQ_CLASSES) || !stats )
+		return -1;
+	TXQ_LOCK(q);
+	*stats = q->stats[cls];
+	TXQ_UNLOCK(q);
+	return 0;
+}
+
+void occanlib_txq_stats_print(occan_txq_t q){
+	struct occan_txq_class_stats st;
+	int i, b;
+
+	printf("TXQ: %d queued\n", q->cnt);
+	for (i=0; i<OCCAN_TXQ_CLASSES; i++) {
+		occanlib_txq_get_stats(q, i, &st);
+		if ( (st.sent == 0) && (st.dropped == 0) )
+			continue;
+		printf("  CLASS%d (<=0x%03x) sent %u, dropped %u, lat avg %u us, max %u us\n",
+			i, q->class_max[i], st.sent, st.dropped,
+			st.sent ? (unsigned int)(st.lat_sum / st.sent) : 0, st.lat_max);
+		printf("   ");
+		for (b=0; b<OCCAN_TXQ_HIST; b++)
+			printf(" %u", st.hist[b]);
+		printf("\n");
+	}
+}
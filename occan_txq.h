@@ -0,0 +1,70 @@
+
+#ifndef __OCCAN_TXQ_H__
+#define __OCCAN_TXQ_H__
+
+/* Priority ordered CAN transmit queue for occan_lib
+ *
+ * occanlib_send_multiple() hands messages to the driver in FIFO order, so a
+ * burst of low priority bulk messages delays a high priority control
+ * message by the whole software queue depth. The transmit queue keeps all
+ * pending messages in a binary heap ordered like CAN bus arbitration:
+ * lower ID first, standard before extended frames with the same base ID,
+ * data before remote frames, and FIFO order between equal IDs.
+ *
+ * occanlib_txq_pump() hands only the highest priority messages to the
+ * driver. For the order to hold the driver TX buffer must be kept short,
+ * set it to OCCAN_TXQ_DRV_LEN messages with occanlib_set_buf_length().
+ *
+ * Any number of tasks may put messages into the queue, one task pumps it.
+ * The queueing latency from occanlib_txq_put() until the message is given
+ * to the driver is measured for up to OCCAN_TXQ_CLASSES priority classes.
+ */
+
+#include "occan_lib.h"
+
+#define OCCAN_TXQ_DRV_LEN	2
+#define OCCAN_TXQ_CLASSES	4
+#define OCCAN_TXQ_HIST		8	/* Latency buckets: <64us, <128us ... */
+
+typedef struct occan_txq_s *occan_txq_t;
+
+struct occan_txq_class_stats {
+	unsigned int sent;
+	unsigned int dropped;		/* Queue full */
+	unsigned int lat_max;		/* us */
+	unsigned long long lat_sum;	/* us */
+	unsigned int hist[OCCAN_TXQ_HIST];
+};
+
+/* Create queue of 'depth' messages on an opened, not started channel */
+occan_txq_t occanlib_txq_create(occan_t chan, int depth);
+
+void occanlib_txq_free(occan_txq_t q);
+
+/* Messages whose 11 most significant ID bits (the standard ID, or the base
+ * ID of an extended frame) are less or equal to max_base_id belong to class
+ * cls, unless they belong to a lower class. The last class takes all
+ * remaining messages.
+ */
+int occanlib_txq_set_class(occan_txq_t q, int cls, unsigned int max_base_id);
+
+/* Queue messages. Returns number queued, messages that do not fit are
+ * dropped and counted.
+ */
+int occanlib_txq_put(occan_txq_t q, CANMsg *msgs, int msgcnt);
+
+/* Give the highest priority messages to the driver. In non-blocking TX mode
+ * as many as the driver accepts are sent, in blocking TX mode one message is
+ * sent so that newly queued messages are taken into account. Returns number
+ * of messages sent or negative occanlib_send_multiple() error.
+ */
+int occanlib_txq_pump(occan_txq_t q);
+
+/* Number of messages queued */
+int occanlib_txq_count(occan_txq_t q);
+
+int occanlib_txq_get_stats(occan_txq_t q, int cls, struct occan_txq_class_stats *stats);
+
+void occanlib_txq_stats_print(occan_txq_t q);
+
+#endif
@@ -1,14 +1,16 @@
 #include <rtems.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <stdio.h>
 
 #include <b1553brm.h>
 #include "brm_lib.h"
 
-/* The stupid rtems name to errno table, in fact I hate it.... :)
+/* The rtems name to errno table
  *
 rtems_assoc_t errno_assoc[] = {
     { "OK",                 RTEMS_SUCCESSFUL,                0 },
@@ -25,13 +27,13 @@ rtems_assoc_t errno_assoc[] = {
 };
 */
 
-brm_t brmlib_open(char *driver_name){
+brm_t brmlib_open(char *devname){
 	int fd;
 	brm_t ret = NULL;
+
+	printf("brmlib_open: Opening driver %s\n", devname);
 	
-	printf("brmlib_open: Opening driver %s\n",driver_name);
-	
-	fd = open(driver_name,O_RDWR);
+	fd = open(devname, O_RDWR);
 	if ( fd >= 0 ){
 		printf("brmlib_open: allocating memory %d\n",sizeof(*ret));
 		ret = calloc(sizeof(*ret),1);
@@ -40,9 +42,9 @@ brm_t brmlib_open(char *driver_name){
 		ret->mode = BRM_MODE_RT;
 	}else{
 		if ( errno == ENODEV ){
-			printf("brmlib_open: driver %s doesn't exist\n",driver_name);
+			printf("brmlib_open: %s doesn't exist\n", devname);
 		}else if ( errno == EBUSY ){
-			printf("brmlib_open: channel already taken\n");
+			printf("brmlib_open: %s already taken\n", devname);
 		}else{
 			printf("brmlib_open: errno: %d, ret: %d\n",errno,fd);
 		}
@@ -55,6 +57,8 @@ void brmlib_close(brm_t chan){
 	if ( !chan || (chan->fd<0) )
 		return;
 	close(chan->fd);
+	if ( chan->bm_batch )
+		free(chan->bm_batch);
 	free(chan);
 }
 
@@ -151,6 +155,136 @@ int brmlib_bm_recv(brm_t chan, struct bm_msg *msg){
 	return brmlib_bm_recv_multiple(chan,msg,1);
 }
 
+/* B1553BRM BM Message Information Word bits */
+#define BRMLIB_MIW_ERR		(1<<7)	/* Message error */
+#define BRMLIB_MIW_BUS		(1<<8)	/* Received on bus B */
+#define BRMLIB_MIW_RTRT		(1<<9)	/* RT-to-RT transfer */
+
+void brmlib_bm_ring_init(struct brmlib_bm_ring *ring, unsigned int *buf, int cnt){
+	memset(ring, 0, sizeof(*ring));
+	bm_ring_init(&ring->ring, buf, cnt);
+}
+
+/* Number of data words following a command word */
+static int brmlib_bm_datacnt(unsigned short cw){
+	int sa = (cw >> 5) & 0x1f;
+	int wc = cw & 0x1f;
+
+	if ( (sa == 0) || (sa == 31) ){
+		/* Mode code, data word only for codes 16..31 */
+		return (wc & 0x10) ? 1 : 0;
+	}
+	return (wc == 0) ? 32 : wc;
+}
+
+int brmlib_bm_msg_to_log(struct brmlib_bm_ring *ring, struct bm_msg *msg, unsigned int *words){
+	unsigned int hdr;
+	int i, wc, cnt;
+
+	/* Extend 16-bit time tag */
+	if ( ring->time_valid ){
+		ring->time += (unsigned short)(msg->time - ring->time16);
+	}else{
+		ring->time = msg->time;
+		ring->time_valid = 1;
+	}
+	ring->time16 = msg->time;
+	ring->msgs++;
+
+	wc = bm_ring_time(&ring->ring, ring->time, words);
+	if ( msg->miw & BRMLIB_MIW_ERR ){
+		words[wc++] = 0xc0000000 | BM_RING_ERR_MSG;
+	}
+
+	/* 13-bit time and bus, bit 16 set for command/status words */
+	hdr = ((ring->time & 0x1fff) << 18) | ((msg->miw & BRMLIB_MIW_BUS) ? (1<<17) : 0);
+
+	words[wc++] = hdr | 0x10000 | msg->cw1;
+	if ( msg->cw1 & 0x0400 ){
+		/* RT to BC: command, status, data */
+		cnt = brmlib_bm_datacnt(msg->cw1);
+		words[wc++] = hdr | 0x10000 | msg->sw1;
+		for (i=0; i<cnt; i++)
+			words[wc++] = hdr | msg->data[i];
+	}else if ( msg->miw & BRMLIB_MIW_RTRT ){
+		/* RT to RT: rx command, tx command, tx status, data, rx status */
+		cnt = brmlib_bm_datacnt(msg->cw2);
+		words[wc++] = hdr | 0x10000 | msg->cw2;
+		words[wc++] = hdr | 0x10000 | msg->sw2;
+		for (i=0; i<cnt; i++)
+			words[wc++] = hdr | msg->data[i];
+		words[wc++] = hdr | 0x10000 | msg->sw1;
+	}else{
+		/* BC to RT: command, data, status */
+		cnt = brmlib_bm_datacnt(msg->cw1);
+		for (i=0; i<cnt; i++)
+			words[wc++] = hdr | msg->data[i];
+		words[wc++] = hdr | 0x10000 | msg->sw1;
+	}
+
+	return wc;
+}
+
+int brmlib_bm_recv_batch(brm_t chan, struct brmlib_bm_ring *ring, int timeout, int *pending){
+	unsigned int words[BRMLIB_BM_LOG_MAX];
+	int cnt, tot, ticks, wc;
+
+	if ( !chan || !ring || (chan->mode!=BRM_MODE_BM) )
+		return -1;
+
+	if ( !chan->bm_batch ){
+		chan->bm_batch = malloc(BRMLIB_BM_BATCH * sizeof(struct bm_msg));
+		if ( !chan->bm_batch )
+			return -1;
+		chan->bm_batch_cnt = 0;
+		chan->bm_batch_pos = 0;
+	}
+
+	/* Timeout is implemented by polling, the driver must not block */
+	if ( chan->rxblk && brmlib_set_rxblock(chan,0) )
+		return -1;
+
+	tot = 0;
+	ticks = 0;
+	while ( 1 ){
+		if ( chan->bm_batch_pos >= chan->bm_batch_cnt ){
+			/* Batch empty, read next from driver */
+			cnt = brmlib_recv_multiple(chan,(void *)chan->bm_batch,BRMLIB_BM_BATCH);
+			if ( cnt < 0 )
+				return -1;
+			chan->bm_batch_cnt = cnt;
+			chan->bm_batch_pos = 0;
+			if ( cnt == 0 ){
+				if ( (tot > 0) || (ticks >= timeout) )
+					break;
+				rtems_task_wake_after(1);
+				ticks++;
+				continue;
+			}
+		}
+
+		/* Convert messages until ring is full */
+		while ( chan->bm_batch_pos < chan->bm_batch_cnt ){
+			if ( bm_ring_space(&ring->ring) < BRMLIB_BM_LOG_MAX )
+				goto out;
+			wc = brmlib_bm_msg_to_log(ring,&chan->bm_batch[chan->bm_batch_pos],words);
+			bm_ring_add(&ring->ring,words,wc);
+			chan->bm_batch_pos++;
+			tot++;
+		}
+
+		/* A batch that was not full means driver is empty */
+		if ( chan->bm_batch_cnt < BRMLIB_BM_BATCH )
+			break;
+	}
+
+out:
+	if ( pending )
+		*pending = chan->bm_batch_cnt - chan->bm_batch_pos;
+
+	return tot;
+}
+
 
 int brmlib_set_mode(brm_t chan, unsigned int mode){
 	int ret;
@@ -11,7 +11,9 @@
 #include <sched.h>
 #include <ctype.h>
 #include <rtems/bspIo.h>
+#include <stdint.h>
 #include <b1553brm.h>
+#include "bm_ring.h"
 
 typedef struct {
 	int fd;
@@ -19,6 +21,9 @@ typedef struct {
 	int txblk;
 	int rxblk;
 	int broadcast;
+	struct bm_msg *bm_batch;	/* Batched BM receive buffer */
+	int bm_batch_cnt;
+	int bm_batch_pos;
 } brm_s;
 
 typedef brm_s *brm_t;
@@ -26,7 +31,7 @@ typedef brm_s *brm_t;
 /* 
  * return file descriptor 
  */
-brm_t brmlib_open(char *driver_name);
+brm_t brmlib_open(char *devname);
 
 void brmlib_close(brm_t chan);
 
@@ -43,6 +48,44 @@ int brmlib_bm_recv_multiple(brm_t chan, struct bm_msg *msgs, int msgcnt);
 
 int brmlib_bm_recv(brm_t chan, struct bm_msg *msg);
 
+/* Batched BM receive into a ring of compressed BM log words.
+ *
+ * The ring and its word format are described in bm_ring.h, it is the
+ * same as the GR1553B compressed BM log in 1553/bm_logger.c so that
+ * B1553BRM boards can feed the same capture and streaming pipeline.
+ * Message errors are logged with error code BM_RING_ERR_MSG. The words
+ * are taken out with bm_ring_take(&ring->ring, ...).
+ *
+ * All words of one message get the time of the message. The 16-bit BRM
+ * time tag is extended to 64 bits, so the ring must be filled at least
+ * once per BRM timer wrap.
+ */
+#define BRMLIB_BM_BATCH		32	/* Messages read from driver per read() */
+#define BRMLIB_BM_LOG_MAX	40	/* Max words produced from one message */
+
+struct brmlib_bm_ring {
+	struct bm_ring ring;		/* Compressed log words */
+	uint64_t time;			/* 64-bit time of last message */
+	unsigned short time16;		/* BRM time tag of last message */
+	int time_valid;
+	unsigned int msgs;		/* Total number of messages */
+};
+
+/* Set up ring in user buffer of cnt words */
+void brmlib_bm_ring_init(struct brmlib_bm_ring *ring, unsigned int *buf, int cnt);
+
+/* Convert one BM message to compressed log words, returns number of words */
+int brmlib_bm_msg_to_log(struct brmlib_bm_ring *ring, struct bm_msg *msg, unsigned int *words);
+
+/* Read all BM messages from driver into the ring. Waits up to 'timeout'
+ * ticks for the first message, the driver is put into non-blocking RX mode.
+ * Messages that did not fit into the ring are kept and written first on
+ * the next call, their number is stored in *pending (may be NULL).
+ *
+ * Returns number of messages written to ring, or negative on error.
+ */
+int brmlib_bm_recv_batch(brm_t chan, struct brmlib_bm_ring *ring, int timeout, int *pending);
+
 /* start execute a command list */
 int brmlib_bc_dolist(brm_t chan, struct bc_msg *msgs);
 
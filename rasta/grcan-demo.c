@@ -18,9 +18,19 @@
 #include <sys/ioctl.h>
 
 #include <grcan.h>
+#include "canseq.h"
+#include "../can/can_timing_table.h"
+
+/* 250k @ 30MHz, timing from ../can/can_timing_table.h */
+#define GRCAN_BITRATE 250000
+#define GRCAN_CLOCK_HZ 30000000
+#define GRCAN_SAMPL_PT 80
 
 #undef CANRX_ONLY
 
+/* Check sequence numbers of the messages looped back */
+#define RX_VERIFY
+
 rtems_task can_task1(rtems_task_argument argument);
 rtems_task can_task2(rtems_task_argument argument);
 
@@ -29,9 +39,11 @@ static rtems_name tnames[2];     /* array of task names */
 
 int canfd;
 char tmpbuf[256];
+static canseq_t rxseq;
 
 void print_msg(int i, CANMsg *msg);
 void init_send_messages(void);
+void fill_send_messages(CANMsg *txmsgs, int cnt, unsigned int seq);
 void inloop_init(void);
 
 /* ========================================================= 
@@ -50,6 +62,7 @@ int can_init(void)
 {
   struct grcan_timing timing;
 	struct grcan_selection selection;
+  const struct can_timing_result *res;
   rtems_status_code status;
   int i;
   
@@ -61,6 +74,10 @@ int can_init(void)
 
   inloop_init();
 
+  rxseq = canseq_create();
+  if ( !rxseq )
+    return -1;
+
   status = rtems_task_create(
     tnames[0], 1, RTEMS_MINIMUM_STACK_SIZE * 4,
     RTEMS_DEFAULT_MODES | RTEMS_TIMESLICE,
@@ -82,12 +99,17 @@ int can_init(void)
 				
   /* Start GRCAN driver */
 
-  /* 250k @ 30MHz */
-  timing.scaler = 3;
-  timing.ps1 = 8;
-  timing.ps2 = 5;
-  timing.rsj = 1;
-  timing.bpr = 1;
+  res = can_timing_lookup(grcan_timing_table, GRCAN_CLOCK_HZ, GRCAN_BITRATE, GRCAN_SAMPL_PT);
+  if ( !res ){
+    printf("No GRCAN timing for %d @ %dkHz, %d%%\n",
+      GRCAN_BITRATE, GRCAN_CLOCK_HZ/1000, GRCAN_SAMPL_PT);
+    return -1;
+  }
+  timing.scaler = res->scaler;
+  timing.ps1 = res->ps1;
+  timing.ps2 = res->ps2;
+  timing.rsj = res->rsj;
+  timing.bpr = res->bpr;
 	
 	selection.selection = 0;
 	selection.enable0 = 0;
@@ -233,33 +255,17 @@ void init_send_messages(void)
 	msgs[7].data[6] = 'r';
 }
 
-int verify_msg(CANMsg *msg, int index)
+/* Messages cycle through the ID, type and length of msgs[0..3], the
+ * payload is the canseq sequence number and CRC.
+ */
+void fill_send_messages(CANMsg *txmsgs, int cnt, unsigned int seq)
 {
   int i;
-  CANMsg *src = &msgs[index];
-  
-  if ( msg->extended != src->extended ){
-    return -1;
-  }
 
-  if ( msg->rtr != src->rtr ){
-    return -2;
-  }  
-  
-  /* inverted bit 0 in ID */
-  if ( msg->id != (src->id-1) ){
-    /*printf("Expected 0x%x but got 0x%x\n",src->id-1,msg->id);*/
-    return -3;
-  }
-  
-  if ( msg->len != src->len ){
-    return -4;
+  for(i=0; i<cnt; i++){
+    txmsgs[i] = msgs[(seq + i) & 3];
+    canseq_make(seq + i, txmsgs[i].data, txmsgs[i].len);
   }
-  for(i=0; i<msg->len; i++){
-    if ( msg->data[i] != src->data[i] ) 
-      return -5-i;
-  }
-  return 0;
 }
 
 
@@ -309,7 +315,7 @@ void wait_for_inloop(void){
 }
 
 volatile int rxpkts=0,txpkts=0;
-static volatile int rx_syncs=0,rx_errors=0;
+static volatile int rx_errors=0; /* Wrong ID for sequence number */
 
 /* RX Task */
 rtems_task can_task1(
@@ -319,7 +325,8 @@ rtems_task can_task1(
   CANMsg rxmsgs[10];
   int cnt;
 #ifdef RX_VERIFY
-  int i,j,index=0,error,e;
+  int i;
+  unsigned int seq;
 #endif
 
 #ifdef RX_ONLY  
@@ -335,27 +342,12 @@ rtems_task can_task1(
 #ifdef RX_VERIFY
 /*    printf("Got %d messages\n",cnt/sizeof(CANMsg));*/
     for(i=0; i<(cnt/sizeof(CANMsg)); i++){
-      error = verify_msg(&rxmsgs[i],index);
-      if ( error ){
-        /*printf("Message rx error: %d\n",error);
-        print_msg(0,&rxmsgs[i]);*/
-        /* Try to sync if one has been lost */
-        e=0;
-        for(j=0; j<4; j++){
-          if ( !verify_msg(&rxmsgs[i],j) ){
-            /*printf("Synced from message %d to %d\n",index,j);*/
-            rx_syncs++;
-            index = j;
-            e=1;
-            break;
-          }
-        }
-        if ( e!=1 )
-          rx_errors++;
-      }
-      index++;
-      if ( index > 3 )
-        index = 0;
+      if ( canseq_check(rxseq,rxmsgs[i].data,rxmsgs[i].len) < 0 )
+        continue;
+      /* Loopback board decrements the ID */
+      seq = CANSEQ_SEQ(rxmsgs[i].data);
+      if ( rxmsgs[i].id != (msgs[seq & 3].id-1) )
+        rx_errors++;
     }
 #endif
     
@@ -378,7 +370,9 @@ rtems_task can_task2(
         rtems_task_argument unused
 ) 
 {  
-  int cnt,ofs;
+  int cnt;
+  CANMsg txmsgs[4];
+  unsigned int txseq;
   
 	
 	printf("************** MESSAGES THAT WILL BE TRANSMITTED *************\n");
@@ -392,7 +386,7 @@ rtems_task can_task2(
 	printf("******************* Start of transmission ********************\n");
 	
   txpkts=0;
-  ofs=0;
+  txseq=0;
   while(1){
     /* Not more than 114 messages may be out 
      * since we only have a receivfe buffer of 124 messages 
@@ -409,12 +403,11 @@ rtems_task can_task2(
       break;
     }
 */
-    cnt=write(canfd,&msgs[ofs],4*sizeof(CANMsg));
+    fill_send_messages(txmsgs,4,txseq);
+    cnt=write(canfd,txmsgs,4*sizeof(CANMsg));
     if ( cnt > 0 ){
       txpkts += cnt/sizeof(CANMsg);      
-      ofs+=cnt/sizeof(CANMsg);
-      if ( ofs > 3 )  
-        ofs-=4;
+      txseq += cnt/sizeof(CANMsg);
     }else
       sched_yield();
 
@@ -527,7 +520,7 @@ void can_print_stats(void)
   
   if ( cnt++ >= 10 ){
     cnt=0;
-    printf("CAN RXSYNCS:  %d\n",rx_syncs);
+    canseq_stats_print(rxseq);
     if ( rx_errors > 0)
       printf("CAN RXERRORS: %d\n",rx_errors);
   }
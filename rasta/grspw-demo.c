@@ -20,6 +20,8 @@
 #include <ambapp.h>
 #include <grspw.h>
 
+#include "spw_demux.h"
+
 #define NODE_ADR_RX 10
 #define NODE_ADR_TX 22
 
@@ -101,10 +103,10 @@ int spw_init(void)
 
   IOCTL(fd1,SPACEWIRE_IOCTRL_SET_COREFREQ,30000); /* make driver calculate timings from 30MHz spacewire clock */
   IOCTL(fd1,SPACEWIRE_IOCTRL_SET_NODEADDR,NODE_ADR_RX);
-  IOCTL(fd1,SPACEWIRE_IOCTRL_SET_RXBLOCK,1);
+  IOCTL(fd1,SPACEWIRE_IOCTRL_SET_RXBLOCK,0); /* polled by spw_link_fd() */
   IOCTL(fd1,SPACEWIRE_IOCTRL_SET_TXBLOCK,0);
   IOCTL(fd1,SPACEWIRE_IOCTRL_SET_TXBLOCK_ON_FULL,1);
-  IOCTL(fd1,SPACEWIRE_IOCTRL_SET_RM_PROT_ID,1); /* remove protocol id */
+  IOCTL(fd1,SPACEWIRE_IOCTRL_SET_RM_PROT_ID,0); /* keep address and protocol id for the demux */
 /*  IOCTL(fd1,SPACEWIRE_IOCTRL_SET_CLKDIV,0);*/
 
 
@@ -132,6 +134,9 @@ void spw_start(void)
 /*#define TEST_BIG_CHUNK*/
 #define RXPKT_BUF 5
 #define PKTSIZE 1000
+#define PKT_PROTID 50
+#define RX_POOL_PKTS 16
+#define RX_POSTED 8
 struct packet_hdr {
 	unsigned char addr;
 	unsigned char protid;
@@ -164,7 +169,7 @@ int tx_bytes=0;
 int tx_pkts=0;
 
 /* RX Task */
-static unsigned char rxpkt[PKTSIZE*RXPKT_BUF];
+static spw_demux_t rx_dmx;
 static struct packet_hdr txpkts[1];
 
 void init_pkt(struct packet_hdr *p){
@@ -172,7 +177,7 @@ void init_pkt(struct packet_hdr *p){
   unsigned char j=0;
   
   p->addr = NODE_ADR_RX;
-  p->protid = 50;
+  p->protid = PKT_PROTID;
   p->dummy = 0x01;
   p->channel = 0x01;
   for(i=0; i<PKTSIZE; i++){
@@ -219,56 +224,68 @@ rtems_task spw_task1(
 	}
 }
 
-/* TX Task */
+/* RX Task, packets of task1 are picked out by address and protocol id
+ * with the demux of spw_demux.c, anything else received is dropped and
+ * counted there.
+ */
 rtems_task spw_task2(
         rtems_task_argument unused
 ) 
 {
-  int len;
+  spw_pool_t pool;
+  spw_link_t link;
+  struct spw_list pkts;
+  struct spw_pkt *pkt;
+  struct packet_hdr *rxpkt;
+  int q;
   int cnt=0;
   int j;
   unsigned char i=0;
   unsigned int tot=0;
-  int pktofs=0;
 
   printf("SpaceWire RX Task started\n");
-  #if 1
-  while(1){
-    /*memset(&rxpkt,0,sizeof(rxpkt));*/
-    
-    if ( (len=read(fd1,&rxpkt[0],PKTSIZE*RXPKT_BUF)) < 1 ){
-      printf("Failed read: len: %d, errno: %d (%d)\n",len,errno,cnt);
-      break;
-    }
-    
-    /* skip first 2bytes (vchan and dummy) */
-    if ( (rxpkt[0]==1) && (rxpkt[1]==1) ){
-      j=2; /* strip virtual channel protocol, non-ssspw device */
-    }else{
-      j=0; /* hardware uses virtual channel protocol, hw already stripped it */
-    }
-    
-    for(; j<len; j++){
-      
-      if ( (rxpkt[j] != i) ){
-        printf("Data differ at %d, expected 0x%x got 0x%x (%d)\n",tot,i,rxpkt[j],pktofs);
-        i=rxpkt[j];
-        rx_errors++;
+
+  pool = spw_pool_create(RX_POOL_PKTS, sizeof(struct packet_hdr));
+  link = pool ? spw_link_fd(fd1) : NULL;
+  rx_dmx = link ? spw_demux_create(link, pool, RX_POSTED) : NULL;
+  q = rx_dmx ? spw_demux_queue(rx_dmx, RX_POOL_PKTS - RX_POSTED, 0, NULL, NULL) : -1;
+  if ( (q < 0) || spw_demux_add(rx_dmx, PKT_PROTID, NODE_ADR_RX, NODE_ADR_RX, q) ){
+    printf("Failed to set up SpaceWire RX demux\n");
+  }else{
+    spw_list_init(&pkts);
+    while(1){
+      spw_demux_recv(rx_dmx);
+      if ( spw_demux_take(rx_dmx, q, &pkts, RXPKT_BUF) == 0 ){
+        sched_yield();
+        continue;
       }
-      i++;
-      tot++;
-      pktofs++;
-      if ( pktofs >= PKTSIZE ){
-        pktofs=0;
+
+      while ( (pkt = spw_list_take(&pkts)) ){
+        /* The whole header is kept, the data always starts after it */
+        rxpkt = pkt->data;
+        if ( pkt->dlen != sizeof(struct packet_hdr) ){
+          printf("Packet length %d, expected %d (%d)\n",
+            pkt->dlen,(int)sizeof(struct packet_hdr),cnt);
+          rx_errors++;
+        }else{
+          for(j=0; j<PKTSIZE; j++){
+            if ( (rxpkt->data[j] != i) ){
+              printf("Data differ at %d, expected 0x%x got 0x%x (%d)\n",tot,i,rxpkt->data[j],j);
+              i=rxpkt->data[j];
+              rx_errors++;
+            }
+            i++;
+            tot++;
+          }
+        }
+        rx_bytes+=pkt->dlen;
+        rx_pkts++;
+        cnt++;
+        spw_pool_put(pkt);
       }
+      sched_yield();
     }
-    
-    rx_bytes+=len;
-    rx_pkts++;
-    sched_yield();
-    cnt++;
   }
-  #endif
 	while(1) {
 		printf("SPW Task2: Sleeping\n");
 		sleep(1);
@@ -277,6 +294,8 @@ rtems_task spw_task2(
 
 void spw_print_stats(void){
   printf("SPW RX: bytes: %d, times: %d, data errors: %d\n",rx_bytes,rx_pkts,rx_errors);
+  if ( rx_dmx )
+    spw_demux_stats_print(rx_dmx);
 /*  rtems_task_wake_after(4);*/
     sched_yield();
   printf("SPW TX: bytes: %d, packets: %d\n",tx_bytes,tx_pkts);
@@ -0,0 +1,26 @@
+
+#ifndef __MEM_BARRIER_H__
+#define __MEM_BARRIER_H__
+
+/* Barrier between the writes of a single producer and the reads of its
+ * consumer, for the lock free rings that hand slots over by index:
+ *
+ *   canstats.c          sample ring
+ *   occan_filter.c      subscriber rings
+ *   occan_rec.c         recording blocks
+ *   bm_ring.h           1553 BM log ring, also the copy in rasta/
+ *   1553/timemon.c      time pulse samples
+ *   spw/spw_demux.c     protocol queues
+ *   spw/spw_capture.c   capture ring
+ *
+ * The slot is written or read before the barrier and the index after it.
+ * LEON is uniprocessor, on RTEMS only the compiler may reorder. The Linux
+ * host builds may run producer and consumer on different CPUs.
+ */
+#ifdef __rtems__
+#define MEM_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define MEM_BARRIER() __sync_synchronize()
+#endif
+
+#endif
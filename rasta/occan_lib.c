@@ -10,6 +10,7 @@
 
 #include <occan.h>
 #include "occan_lib.h"
+#include "../can/can_timing_table.h"
 
 /* The rtems to errno table
  *
@@ -209,6 +210,26 @@ int occanlib_set_speed_auto(occan_t chan){
 	return -100;
 }
 
+/* Set bit timing from the precomputed table in can/can_timing_table.h,
+ * no timing is calculated at runtime. Fails with -3 if the combination
+ * of core frequency, bitrate and sample point is not in the table.
+ */
+int occanlib_set_speed_table(occan_t chan, unsigned int clock_hz, unsigned int speed, unsigned int sampl_pt){
+	const struct can_timing_result *res;
+	
+	if ( !chan )
+		return -1;
+	
+	res = can_timing_lookup(occan_timing_table, clock_hz, speed, sampl_pt);
+	if ( !res ){
+		printf("occanlib_set_speed_table: no timing for %d @ %dkHz, %d%%\n",
+			speed, clock_hz/1000, sampl_pt);
+		return -3;
+	}
+	
+	return occanlib_set_btrs(chan, res->btr0, res->btr1);
+}
+
 int occanlib_set_btrs(occan_t chan, unsigned char btr0, unsigned char btr1){
 	int ret;
 	unsigned int btr0btr1;
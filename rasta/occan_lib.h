@@ -40,6 +40,11 @@ int occanlib_set_speed_auto(occan_t chan);
 
 int occanlib_set_btrs(occan_t chan, unsigned char btr0, unsigned char btr1);
 
+/* Set BTR0/BTR1 from the generated timing table (can/can_timing_table.h)
+ * for the given core frequency, bitrate and sample point in percent.
+ */
+int occanlib_set_speed_table(occan_t chan, unsigned int clock_hz, unsigned int speed, unsigned int sampl_pt);
+
 int occanlib_set_buf_length(occan_t chan, unsigned short txlen, unsigned short rxlen);
 
 int occanlib_get_stats(occan_t chan, occan_stats *stats);
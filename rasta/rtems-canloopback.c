@@ -55,17 +55,10 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 //#define TASK_RX
 //#define TASK_TX
 
-/* 250kbit/s @ 40MHz */
-
-#define BTR0 0x3
-#define BTR1 0x7a
-
-
-/* 138.88bits/s @ 40MHz */
-/*#define BTR0 0x07
-#define BTR1 0x69
-*/
+/* 250kbit/s @ 40MHz, BTR0/BTR1 from ../can/can_timing_table.h */
 #define SPEED_250K 250000
+#define OCCAN_CLOCK_HZ 40000000
+#define OCCAN_SAMPL_PT 80
 #undef OCCAN_USE_SPEED
 #undef VT100_DEV
 #define UPDATE_DELAY 2
@@ -260,11 +253,11 @@ rtems_task loopback_task(
 #ifdef OCCAN_USE_SPEED
 	occanlib_set_speed(chan,SPEED_250K);
 #else
-	occanlib_set_btrs(chan,BTR0,BTR1);
+	occanlib_set_speed_table(chan,OCCAN_CLOCK_HZ,SPEED_250K,OCCAN_SAMPL_PT);
 #endif
 	
 	printf("Task%d: Setting buf len: Rx: %d, Tx: %d\n",minor,CANTSK_RX_LEN,CANTSK_TX_LEN); 
-	occanlib_set_buf_length(chan,CANTSK_RX_LEN,CANTSK_TX_LEN);
+	occanlib_set_buf_length(chan,CANTSK_TX_LEN,CANTSK_RX_LEN);
 	
 	/* total blocking mode */
 	printf("Task%d: Setting Rx and Tx blocking mode\n",minor); 
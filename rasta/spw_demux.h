@@ -0,0 +1,116 @@
+
+#ifndef __SPW_DEMUX_H__
+#define __SPW_DEMUX_H__
+
+/* SpaceWire receive demultiplexer
+ *
+ * Received packets are classified by protocol ID and logical address, the
+ * first two bytes of the packet, and put into bounded per-protocol queues.
+ * Only the packet descriptor is queued, the payload stays in the pool
+ * buffer it was received into until the consumer puts it back.
+ *
+ * Rules map a protocol ID and a range of logical addresses to a queue, the
+ * first matching rule added wins. Packets matching no rule go to the
+ * default queue if one is set, otherwise they are dropped.
+ *
+ * Each queue is emptied by its own consumer task with spw_demux_take().
+ * One task feeds all queues with spw_demux_recv() or spw_demux_dispatch().
+ * A queue may register a notify function, for example to send an RTEMS
+ * event to the consumer task. It is called at most once per dispatched
+ * batch after the batch, or at once for SPW_DEMUX_URGENT queues. Give
+ * time packets an urgent queue and a consumer task of higher priority than
+ * the dispatcher: they are then handled before the rest of the batch is
+ * classified and never wait behind bulk traffic.
+ *
+ * A full queue drops the new packet and returns its buffer to the pool,
+ * so a slow consumer holds at most its queue depth of buffers. A pool of
+ * at least the sum of all depths plus the receive buffers posted keeps
+ * the receiver supplied whatever the consumers do.
+ */
+
+#include "spw_pkt.h"
+#include "spw_link.h"
+
+#define SPW_DEMUX_QUEUES_MAX	8
+#define SPW_DEMUX_RULES_MAX	32
+
+/* Protocol IDs assigned by ECSS-E-ST-50-51C */
+#define SPW_PID_EXTENDED	0x00
+#define SPW_PID_RMAP		0x01
+#define SPW_PID_CCSDS		0x02	/* CCSDS Packet Transfer Protocol */
+#define SPW_PID_GOES_R		0x03
+#define SPW_PID_STUP		0x04	/* Serial Transfer Universal Protocol */
+#define SPW_PID_CUCTP		0xfe	/* Default of the SPWCUC core, see 1553/time.c */
+
+/* Queue flags */
+#define SPW_DEMUX_URGENT	0x1	/* Notify per packet, not per batch */
+
+struct spw_demux_stats {
+	unsigned int rx;	/* Packets classified */
+	unsigned int unmatched;	/* Dropped, no rule and no default queue */
+	unsigned int bad;	/* Dropped, shorter than 2 bytes, EEP or truncated */
+	unsigned int batches;	/* Link reads returning packets */
+};
+
+struct spw_demux_queue_stats {
+	unsigned int rx;	/* Packets queued */
+	unsigned int dropped;	/* Packets lost due to full queue */
+	unsigned int notified;	/* Number of notify calls */
+	unsigned int max_fill;	/* Most packets queued at once */
+};
+
+typedef void (*spw_demux_notify_t)(void *arg);
+
+typedef struct spw_demux_s *spw_demux_t;
+
+/* Create demultiplexer for packets received on link into buffers of pool,
+ * rx_posted buffers are kept at the receiver. Returns NULL on failure.
+ */
+spw_demux_t spw_demux_create(spw_link_t link, spw_pool_t pool, int rx_posted);
+
+/* Free demultiplexer, packets still queued are returned to their pools.
+ * Buffers posted at the receiver stay with the link.
+ */
+void spw_demux_free(spw_demux_t dmx);
+
+/* Add a queue of depth packets, notify may be NULL. Returns queue number or
+ * negative on failure.
+ */
+int spw_demux_queue(spw_demux_t dmx, int depth, int flags,
+	spw_demux_notify_t notify, void *arg);
+
+/* Route packets of protocol ID pid to logical addresses addr_first..
+ * addr_last to queue q. Returns 0 or negative on failure.
+ */
+int spw_demux_add(spw_demux_t dmx, int pid, int addr_first, int addr_last, int q);
+
+/* Queue of packets matching no rule, -1 drops them */
+int spw_demux_set_default(spw_demux_t dmx, int q);
+
+/* Queue of a packet, -1 if it would be dropped */
+int spw_demux_match(spw_demux_t dmx, struct spw_pkt *pkt);
+
+/* Classify received packets into the queues, pkts is empty afterwards.
+ * Returns number of packets queued.
+ */
+int spw_demux_dispatch(spw_demux_t dmx, struct spw_list *pkts);
+
+/* Keep buffers posted at the receiver, read received packets from the
+ * link and dispatch them. Never blocks. Returns number of packets
+ * received or negative on link errors.
+ */
+int spw_demux_recv(spw_demux_t dmx);
+
+/* Take up to max packets from queue q, appended to pkts. Never blocks.
+ * The packets belong to the caller who puts them back into the pool.
+ */
+int spw_demux_take(spw_demux_t dmx, int q, struct spw_list *pkts, int max);
+
+void spw_demux_get_stats(spw_demux_t dmx, struct spw_demux_stats *stats);
+
+int spw_demux_get_queue_stats(spw_demux_t dmx, int q,
+	struct spw_demux_queue_stats *stats);
+
+void spw_demux_stats_print(spw_demux_t dmx);
+
+#endif
@@ -0,0 +1,136 @@
+
+#ifndef __SPW_LINK_H__
+#define __SPW_LINK_H__
+
+/* Zero-copy SpaceWire packet transfer
+ *
+ * A link is one DMA channel of a SpaceWire interface. Packets are handed
+ * to it in lists and handed back when done, the same way descriptors are
+ * handed to and from the DMA rings of the hardware:
+ *
+ *   TX:  spw_link_send()     packets to be sent, hdr/hlen and data/dlen
+ *        spw_link_reclaim()  packets sent, SPW_TXPKT_TX set or LINKERR
+ *   RX:  spw_link_prepare()  empty buffers, dlen is the buffer size
+ *        spw_link_recv()     packets received into those buffers, dlen is
+ *                            the length and SPW_RXPKT_ flags the status
+ *
+ * The data is never copied by the link layer. Whether it is copied below
+ * depends on the backend:
+ *
+ *   spw_link_loop()   Two links connected back to back in memory, for
+ *                     host tests and benchmarks. The wire is a copy from
+ *                     the sent buffer into a prepared buffer, as the DMA
+ *                     engines of two connected cores would do.
+ *   spw_link_grspw()  RTEMS GRSPW packet driver (grspw_pkt.h), the lists
+ *                     go to the DMA rings as they are, see spw_link_grspw.c
+ *   spw_link_fd()     RTEMS GRSPW character driver (grspw.h). That driver
+ *                     copies between its own DMA buffers and the packets
+ *                     on write()/read(), so only the application copy is
+ *                     avoided.
+ *   spw_link_sock()   Linux TCP socket to another process, for example
+ *                     the node emulator spwnode.c.
+ *
+ * None of the calls block. send and prepare take as many packets as the
+ * rings have room for and leave the rest in the list given, the caller
+ * tries again later. A link may be used by one TX task and one RX task at
+ * the same time.
+ */
+
+#include "spw_pkt.h"
+
+struct spw_link_stats {
+	unsigned int tx_pkts;	/* Packets sent and reclaimed */
+	unsigned int tx_bytes;
+	unsigned int tx_errs;	/* Packets reclaimed with SPW_TXPKT_LINKERR */
+	unsigned int rx_pkts;	/* Packets received */
+	unsigned int rx_bytes;
+	unsigned int rx_eep;	/* Received with SPW_RXPKT_EEP */
+	unsigned int rx_trunk;	/* Received with SPW_RXPKT_TRUNK */
+};
+
+typedef struct spw_link_s *spw_link_t;
+
+/* Backend interface, every function handles a list and returns the number
+ * of packets moved or negative on driver errors.
+ */
+struct spw_link_ops {
+	int (*send)(void *priv, struct spw_list *pkts);
+	int (*reclaim)(void *priv, struct spw_list *pkts);
+	int (*prepare)(void *priv, struct spw_list *pkts);
+	int (*recv)(void *priv, struct spw_list *pkts);
+	void (*close)(void *priv);
+};
+
+struct spw_link_s {
+	const struct spw_link_ops *ops;
+	void *priv;
+	struct spw_link_stats stats;
+};
+
+/* Create a link for a backend, used by the backends */
+spw_link_t spw_link_create(const struct spw_link_ops *ops, void *priv);
+
+/* Two links connected to each other, each with room for 'depth' packets in
+ * its TX and RX rings. Returns 0 or -1.
+ */
+int spw_link_loop(int depth, spw_link_t *a, spw_link_t *b);
+
+#ifdef __rtems__
+/* GRSPW packet driver DMA channel, from grspw_dma_open(). The channel must
+ * be started by the caller.
+ */
+spw_link_t spw_link_grspw(void *dma_chan);
+
+/* Opened GRSPW character device, in non-blocking RX and TX mode */
+spw_link_t spw_link_fd(int fd);
+#endif
+
+#ifndef __rtems__
+/* Linux: connected stream socket to another process, which stands for a
+ * node at the other end of the cable, see spw_link_sock.c. Up to depth
+ * packets are queued in each direction. The socket is not closed with the
+ * link, packets still queued are put back into their pools.
+ */
+spw_link_t spw_link_sock(int fd, int depth);
+
+/* Wait until the socket of a spw_link_sock() link has data to read, or
+ * room to write when packets are queued, or timeout_us passed. Returns
+ * negative when the connection is lost.
+ */
+int spw_link_sock_wait(spw_link_t link, unsigned int timeout_us);
+
+/* Connected sockets for spw_link_sock(), -1 on failure */
+int spw_sock_connect(const char *host, int port);
+int spw_sock_listen(int port);
+int spw_sock_accept(int listen_fd);
+#endif
+
+/* Close link, packets still in the rings are lost */
+void spw_link_close(spw_link_t link);
+
+/* Queue packets for sending, returns number of packets taken from the head
+ * of pkts or negative.
+ */
+int spw_link_send(spw_link_t link, struct spw_list *pkts);
+
+/* Append packets that are done sending to pkts, returns their number */
+int spw_link_reclaim(spw_link_t link, struct spw_list *pkts);
+
+/* Give empty buffers to the receiver, returns number of packets taken */
+int spw_link_prepare(spw_link_t link, struct spw_list *pkts);
+
+/* Keep 'want' empty buffers from pool at the receiver. *posted counts the
+ * buffers given and not yet received, the caller subtracts what
+ * spw_link_recv() returns. Buffers the receiver has no room for go back
+ * to the pool. Returns the number of buffers given or negative.
+ */
+int spw_link_refill(spw_link_t link, spw_pool_t pool, int *posted, int want);
+
+/* Append received packets to pkts, returns their number */
+int spw_link_recv(spw_link_t link, struct spw_list *pkts);
+
+void spw_link_get_stats(spw_link_t link, struct spw_link_stats *stats);
+
+void spw_link_stats_print(spw_link_t link);
+
+#endif
@@ -0,0 +1,218 @@
+/* RTEMS GRSPW backends of spw_link, see spw_link.h
+ *
+ * spw_link_grspw() needs the GRSPW packet driver (grspw_pkt.h) and is only
+ * built with SPW_GRSPW_PKT defined. spw_link_fd() works with the GRSPW
+ * character driver (grspw.h) of RTEMS-4.10.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <rtems.h>
+
+#include "spw_link.h"
+
+#ifdef SPW_GRSPW_PKT
+#include <grspw_pkt.h>
+
+/* The lists are handed over as they are, struct spw_pkt starts with the
+ * fields of struct grspw_pkt.
+ */
+#define SPW_PKT_SAME(field) \
+	(offsetof(struct spw_pkt, field) == offsetof(struct grspw_pkt, field))
+typedef char spw_pkt_layout_check[(SPW_PKT_SAME(next) && SPW_PKT_SAME(pkt_id) &&
+	SPW_PKT_SAME(flags) && SPW_PKT_SAME(hlen) && SPW_PKT_SAME(dlen) &&
+	SPW_PKT_SAME(data) && SPW_PKT_SAME(hdr)) ? 1 : -1];
+
+static void dma_to_list(struct grspw_list *lst, int cnt, struct spw_list *pkts)
+{
+	pkts->head = (struct spw_pkt *)lst->head;
+	pkts->tail = (struct spw_pkt *)lst->tail;
+	pkts->cnt = cnt;
+	if ( pkts->tail )
+		pkts->tail->next = NULL;
+}
+
+static int dma_send(void *priv, struct spw_list *pkts)
+{
+	struct grspw_list lst;
+	int n = pkts->cnt;
+
+	/* The driver queues what does not fit into the descriptor ring */
+	lst.head = (struct grspw_pkt *)pkts->head;
+	lst.tail = (struct grspw_pkt *)pkts->tail;
+	if ( grspw_dma_tx_send(priv, 0, &lst, n) )
+		return -1;
+	spw_list_init(pkts);
+	return n;
+}
+
+static int dma_reclaim(void *priv, struct spw_list *pkts)
+{
+	struct grspw_list lst;
+	int cnt = -1;
+
+	lst.head = lst.tail = NULL;
+	if ( grspw_dma_tx_reclaim(priv, 0, &lst, &cnt) )
+		return -1;
+	dma_to_list(&lst, cnt, pkts);
+	return cnt;
+}
+
+static int dma_prepare(void *priv, struct spw_list *pkts)
+{
+	struct grspw_list lst;
+	int n = pkts->cnt;
+
+	lst.head = (struct grspw_pkt *)pkts->head;
+	lst.tail = (struct grspw_pkt *)pkts->tail;
+	if ( grspw_dma_rx_prepare(priv, 0, &lst, n) )
+		return -1;
+	spw_list_init(pkts);
+	return n;
+}
+
+static int dma_recv(void *priv, struct spw_list *pkts)
+{
+	struct grspw_list lst;
+	struct spw_pkt *pkt;
+	unsigned int now;
+	int cnt = -1;
+
+	lst.head = lst.tail = NULL;
+	if ( grspw_dma_rx_recv(priv, 0, &lst, &cnt) )
+		return -1;
+	dma_to_list(&lst, cnt, pkts);
+	now = spw_time_us();
+	for (pkt=pkts->head; pkt; pkt=pkt->next)
+		pkt->ts = now;
+	return cnt;
+}
+
+static const struct spw_link_ops dma_ops = {
+	dma_send, dma_reclaim, dma_prepare, dma_recv, NULL
+};
+
+spw_link_t spw_link_grspw(void *dma_chan){
+	return spw_link_create(&dma_ops, dma_chan);
+}
+#endif
+
+/*** Character driver ***/
+
+#include <grspw.h>
+
+/* write() and read() return at once in non-blocking mode, a packet is
+ * done when the driver has copied it. txdone is only used by the TX task
+ * and rxfree only by the RX task.
+ */
+struct fd_link {
+	int fd;
+	struct spw_list txdone;
+	struct spw_list rxfree;
+};
+
+static int fd_send(void *priv, struct spw_list *pkts)
+{
+	struct fd_link *fl = priv;
+	spw_ioctl_pkt_send snd;
+	struct spw_pkt *pkt;
+	int n = 0, ret;
+
+	while ( (pkt = pkts->head) ) {
+		errno = 0;
+		if ( pkt->hlen ) {
+			memset(&snd, 0, sizeof(snd));
+			snd.hlen = pkt->hlen;
+			snd.hdr = pkt->hdr;
+			snd.dlen = pkt->dlen;
+			snd.data = pkt->data;
+#ifdef GRSPW_PKTSEND_OPTION_HDR_CRC
+			if ( pkt->flags & SPW_TXPKT_HCRC )
+				snd.options |= GRSPW_PKTSEND_OPTION_HDR_CRC;
+			if ( pkt->flags & SPW_TXPKT_DCRC )
+				snd.options |= GRSPW_PKTSEND_OPTION_DATA_CRC;
+#endif
+			ret = ioctl(fl->fd, SPACEWIRE_IOCTRL_SEND, &snd);
+			if ( ret == 0 )
+				ret = snd.sent;
+		} else {
+			ret = write(fl->fd, pkt->data, pkt->dlen);
+		}
+		if ( (ret <= 0) && (errno == EBUSY) )
+			break;	/* Driver buffers full */
+
+		spw_list_take(pkts);
+		pkt->flags &= ~(SPW_TXPKT_TX | SPW_TXPKT_LINKERR);
+		pkt->flags |= (ret > 0) ? SPW_TXPKT_TX : SPW_TXPKT_LINKERR;
+		spw_list_add(&fl->txdone, pkt);
+		n++;
+	}
+	return n;
+}
+
+static int fd_reclaim(void *priv, struct spw_list *pkts)
+{
+	struct fd_link *fl = priv;
+	int n = fl->txdone.cnt;
+
+	spw_list_join(pkts, &fl->txdone);
+	return n;
+}
+
+static int fd_prepare(void *priv, struct spw_list *pkts)
+{
+	struct fd_link *fl = priv;
+	int n = pkts->cnt;
+
+	spw_list_join(&fl->rxfree, pkts);
+	return n;
+}
+
+static int fd_recv(void *priv, struct spw_list *pkts)
+{
+	struct fd_link *fl = priv;
+	struct spw_pkt *pkt;
+	int n = 0, len;
+
+	while ( (pkt = fl->rxfree.head) ) {
+		len = read(fl->fd, pkt->data, pkt->dlen);
+		if ( len <= 0 )
+			break;
+		spw_list_take(&fl->rxfree);
+		pkt->dlen = len;
+		pkt->flags = SPW_RXPKT_RX;
+		pkt->ts = spw_time_us();
+		spw_list_add(pkts, pkt);
+		n++;
+	}
+	return n;
+}
+
+static void fd_close(void *priv)
+{
+	free(priv);
+}
+
+static const struct spw_link_ops fd_ops = {
+	fd_send, fd_reclaim, fd_prepare, fd_recv, fd_close
+};
+
+spw_link_t spw_link_fd(int fd){
+	struct fd_link *fl;
+	spw_link_t link;
+
+	fl = calloc(1, sizeof(*fl));
+	if ( !fl )
+		return NULL;
+	fl->fd = fd;
+	spw_list_init(&fl->txdone);
+	spw_list_init(&fl->rxfree);
+	link = spw_link_create(&fd_ops, fl);
+	if ( !link )
+		free(fl);
+	return link;
+}
@@ -12,7 +12,14 @@
  * message must be unmodified.
  *
  * The RX task may indicate dropped messages if the external
- * board doesn't send back all sent messages in time.
+ * board doesn't send back all sent messages in time. Every message
+ * carries a sequence number and CRC (canseq.c), so lost, duplicated
+ * and reordered messages are detected without a table lookup.
+ *
+ * A low priority status task samples the driver and application
+ * counters into a ring of snapshots (canstats.c) and prints rates
+ * calculated from them, so monitoring does not take CPU from the
+ * CAN tasks.
  * 
  * Gaisler Research 2007,
  * Daniel Hellstrm
@@ -77,6 +84,9 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 #include "config.c"
 
 #include <grcan.h>
+#include "canseq.h"
+#include "canstats.h"
+#include "can/can_timing_table.h"
 
 /* Select CAN core to be used in sample application.
  *  - /dev/grcan0              (First ON-CHIP core)
@@ -120,8 +130,22 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
  * #define RX_MESSAGES_CHANGED_DATA
  */
 
-/* Define this to get more statistics printed to console */
-#undef PRINT_MORE_STATS
+/* Bitrate, core frequency and sample point [%] of the timing taken from
+ * can/can_timing_table.h in can_init(). The bitrate is also used for the
+ * bus load.
+ */
+#define GRCAN_BITRATE 250000
+#define GRCAN_CLOCK_HZ 40000000
+#define GRCAN_SAMPL_PT 80
+
+/* Statistics are sampled every STATS_SAMPLE_MS and rates over the last
+ * STATS_PRINT_SAMPLES samples printed. With STATS_PATH the snapshot ring
+ * is dumped to a file after every print, read it with can/canstat.
+ */
+#define STATS_SLOTS 64
+#define STATS_SAMPLE_MS 100
+#define STATS_PRINT_SAMPLES 20
+/*#define STATS_PATH "/mnt/sd/canstats.bin"*/
 
 /* CAN Channel select */
 int can_chan_sel = 0xA; /* Default to channel A */
@@ -140,6 +164,7 @@ rtems_task status_task1(rtems_task_argument argument);
 /* CAN routines */
 int can_init(void);
 void can_start(void);
+void can_sample_stats(void);
 void can_print_stats(void);
 
 int status_init(void);
@@ -182,22 +207,28 @@ rtems_task Init(
 rtems_id   tstatus;        /* array of task ids */
 rtems_name tstatusname;     /* array of task names */
 
+/* Snapshots of the CAN statistics */
+canstats_t canstats;
+
 int status_init(void)
 {
   rtems_status_code status;
   
   tstatusname = rtems_build_name( 'S', 'T', 'S', '0');
   
-  /* Create a status printing task with the highest 
-   * priority, this may result in CAN messages may be 
-   * dropped. The CAN bus has no flow control stopping 
-   * when receiver is full. ==> packets may be dropped
-   * when CAN receive task doesn't get enough CPU. It
-   * is helped by makeing sleep calls and increasing the
-   * receive CAN buffer size.
+  canstats = canstats_create(STATS_SLOTS, GRCAN_BITRATE, 0);
+  if ( !canstats )
+    return -1;
+  
+  /* Create the status task with lower priority than the
+   * CAN tasks. The CAN bus has no flow control stopping 
+   * when receiver is full, so a status task preempting
+   * the receive task with console output would drop
+   * packets. Sampling the counters is only a copy, the
+   * console output is one line every few seconds.
    */
   status = rtems_task_create(
-    tstatusname, 2, RTEMS_MINIMUM_STACK_SIZE * 4,
+    tstatusname, 10, RTEMS_MINIMUM_STACK_SIZE * 4,
     RTEMS_DEFAULT_MODES | RTEMS_PREEMPT,
     RTEMS_DEFAULT_ATTRIBUTES, &tstatus
     );
@@ -222,12 +253,20 @@ rtems_task status_task1(
         rtems_task_argument unused
 ) 
 {
+  rtems_interval ticks;
+  int i;
+  
+  ticks = (rtems_clock_get_ticks_per_second() * STATS_SAMPLE_MS) / 1000;
+  if ( ticks == 0 )
+    ticks = 1;
+  
   while(1){
-    /* print stats */
-    
+    /* Sample often, print seldom */
+    for(i=0; i<STATS_PRINT_SAMPLES; i++){
+      can_sample_stats();
+      rtems_task_wake_after(ticks);
+    }
     can_print_stats();
-    sleep(2);
-
   }
 }
 
@@ -242,6 +281,9 @@ static rtems_name tnames[2];     /* array of task names */
 /* File descriptors of /dev/grcan0 */
 int canfd;
 
+/* Sequence checker of received messages */
+static canseq_t rxseq;
+
 /* Print one CAN message to terminal */
 void print_msg(int i, CANMsg *msg);
 
@@ -250,10 +292,8 @@ void print_msg(int i, CANMsg *msg);
  */
 void init_send_messages(void);
 
-/* Verify content of CAN message 'msg' against msgs[index].
- * Returns what went wrong.
- */
-int verify_msg(CANMsg *msg, int index);
+/* Build the next 'cnt' messages to be sent, see fill_send_messages() */
+void fill_send_messages(CANMsg *txmsgs, int cnt, unsigned int seq);
 
 /* ========================================================= 
    initialisation */
@@ -270,6 +310,7 @@ int can_init(void)
 {
   struct grcan_timing timing;
 	struct grcan_selection selection;
+  const struct can_timing_result *res;
   rtems_status_code status;
   int i;
 
@@ -296,6 +337,12 @@ int can_init(void)
     );
 #endif
 
+#if !defined(CANTX_ONLY)
+  rxseq = canseq_create();
+  if ( !rxseq )
+    return -1;
+#endif
+
   /* Open GRCAN driver */
   canfd = open(GRCAN_DEVICE_NAME, O_RDWR);
   if ( canfd < 0 ){
@@ -305,21 +352,18 @@ int can_init(void)
 
   /* Start GRCAN driver */
 
-  /* Set baud rate: 250k @ 30MHz */
-#if 0
-  timing.scaler = 3;
-  timing.ps1 = 8;
-  timing.ps2 = 5;
-  timing.rsj = 1;
-  timing.bpr = 1;
-#endif
-	
-	/* Set baud rate: 250k @ 40MHz */
-	timing.scaler = 7;
-	timing.ps1 = 0xf;
-	timing.ps2 = 0x3;
-	timing.rsj = 0x1;
-	timing.bpr = 0;
+  /* Set baud rate from the precomputed timing table */
+  res = can_timing_lookup(grcan_timing_table, GRCAN_CLOCK_HZ, GRCAN_BITRATE, GRCAN_SAMPL_PT);
+  if ( !res ){
+    printf("No GRCAN timing for %d @ %dkHz, %d%%\n",
+      GRCAN_BITRATE, GRCAN_CLOCK_HZ/1000, GRCAN_SAMPL_PT);
+    return -1;
+  }
+  timing.scaler = res->scaler;
+  timing.ps1 = res->ps1;
+  timing.ps2 = res->ps2;
+  timing.rsj = res->rsj;
+  timing.bpr = res->bpr;
 	
   /* Select CAN channel */
 	if ( can_chan_sel == 0xa ){
@@ -486,48 +530,29 @@ void init_send_messages(void)
 	msgs[7].data[6] = 'r';
 }
 
-/* Verify content of a CAN message */
-int verify_msg(CANMsg *msg, int index)
+/* Messages cycle through the ID, type and length of msgs[0..3], the
+ * payload is the canseq sequence number and CRC.
+ */
+void fill_send_messages(CANMsg *txmsgs, int cnt, unsigned int seq)
 {
   int i;
-  CANMsg *src = &msgs[index];
-  
-  if ( (msg->extended && !src->extended) || (!msg->extended && src->extended) ){
-    printf("Expected %d but got %d\n",src->extended,msg->extended);
-		return -1;
+
+  for(i=0; i<cnt; i++){
+    txmsgs[i] = msgs[(seq + i) & 3];
+    canseq_make(seq + i, txmsgs[i].data, txmsgs[i].len);
   }
+}
 
-  if ( msg->rtr != src->rtr ){
-    return -2;
-  }  
-  
 #ifdef RX_MESSAGES_CHANGED_ID
-  /* Decremented the ID once */
-  if ( msg->id != (src->id-1) ){
+/* Decremented the ID once */
+#define RX_ID_DELTA (-1)
 #else
-  if ( msg->id != src->id ){
+#define RX_ID_DELTA 0
 #endif
-    printf("Expected 0x%x but got 0x%x\n",src->id,msg->id);
-    return -3;
-  }
-  
-  if ( msg->len != src->len ){
-    return -4;
-  }
-  for(i=0; i<msg->len; i++){
-#ifdef RX_MESSAGES_CHANGED_DATA
-    if ( msg->data[i] != (src->data[i]+1) )
-#else
-    if ( msg->data[i] != src->data[i] ) 
-#endif
-      return -5-i;
-  }
-  return 0;
-}
 
 /* Staticstics */
 static volatile int rxpkts=0, txpkts=0;
-static volatile int rx_syncs=0,rx_errors=0;
+static volatile int rx_errors=0; /* Wrong ID for sequence number */
 
 /* RX Task */
 rtems_task can_task1(
@@ -535,10 +560,18 @@ rtems_task can_task1(
 ) 
 {
   CANMsg rxmsgs[10];
-  int i,j,cnt,index=0,error,e;
+  int i,cnt;
+  unsigned int seq;
+#ifdef RX_MESSAGES_CHANGED_DATA
+  int j;
+#endif
 
-  int wcnt,ofs;
+  int wcnt;
   int last;
+#ifdef ONE_TASK
+  CANMsg txmsgs[4];
+  unsigned int txseq=0;
+#endif
 	
 #if defined(CANRX_ONLY) || defined(ONE_TASK)
 	printf("Initing messages\n");
@@ -561,7 +594,6 @@ rtems_task can_task1(
 #endif
 
   last=0;  
-  ofs=0;
   wcnt=0;
 
   while(1){
@@ -574,12 +606,11 @@ rtems_task can_task1(
        *
        * TX is blocking and waiting to complete.
        */
-      wcnt=write(canfd,&msgs[ofs],4*sizeof(CANMsg));
+      fill_send_messages(txmsgs,4,txseq);
+      wcnt=write(canfd,txmsgs,4*sizeof(CANMsg));
       if ( wcnt > 0 ){
         txpkts += wcnt/sizeof(CANMsg);      
-        ofs+=wcnt/sizeof(CANMsg);
-        if ( ofs > 3 )  
-          ofs-=4;
+        txseq += wcnt/sizeof(CANMsg);
       }else
         sched_yield();
 
@@ -607,39 +638,20 @@ rtems_task can_task1(
     
 /*    printf("Got %d messages\n",cnt/sizeof(CANMsg));*/
 
-    /* For every message received we compare the content against 
-     * expected content.
-     *
-     * If a message have been dropped we synchronize with the
-     * message stream to avoid getting multiple errors from one
-     * dropped message.
-     *
+    /* Every message is checked against the sequence number expected,
+     * lost, duplicated and reordered messages are counted by the
+     * checker and printed by the status task, never from here.
      */
     for(i=0; i<(cnt/sizeof(CANMsg)); i++){
-      error = verify_msg(&rxmsgs[i],index);
-      if ( error ){
-        printf("Message rx error: %d, index: %d\n",error,index);
-        
-        /* Print message */
-        print_msg(0,&rxmsgs[i]);
-
-        /* Try to sync if one has been lost */
-        e=0;
-        for(j=0; j<4; j++){
-          if ( !verify_msg(&rxmsgs[i],j) ){
-            printf("Synced from message %d to %d\n",index,j);
-            rx_syncs++;
-            index = j;
-            e=1;
-            break;
-          }
-        }
-        if ( e!=1 )
-          rx_errors++;
-      }
-      index++;
-      if ( index > 3 )
-        index = 0;
+#ifdef RX_MESSAGES_CHANGED_DATA
+      for(j=0; j<rxmsgs[i].len; j++)
+        rxmsgs[i].data[j]--;
+#endif
+      if ( canseq_check(rxseq,rxmsgs[i].data,rxmsgs[i].len) < 0 )
+        continue;
+      seq = CANSEQ_SEQ(rxmsgs[i].data);
+      if ( rxmsgs[i].id != msgs[seq & 3].id + RX_ID_DELTA )
+        rx_errors++;
     }
   }
   
@@ -656,8 +668,10 @@ rtems_task can_task2(
         rtems_task_argument unused
 ) 
 {  
-  int cnt,ofs;
+  int cnt;
   int last;
+  CANMsg txmsgs[4];
+  unsigned int txseq;
   
 	/* Print messages that we be sent to console */
 	printf("************** MESSAGES THAT WILL BE TRANSMITTED *************\n");
@@ -672,20 +686,19 @@ rtems_task can_task2(
 	
   last=0;
   txpkts=0;
-  ofs=0;
+  txseq=0;
   while(1){
 
   	/* Blocking transmit request. Returns when all messages
      * requested has been scheduled for transmission (not actually
      * sent, but taken care of by driver).
      */
-    cnt=write(canfd,&msgs[ofs],4*sizeof(CANMsg));
+    fill_send_messages(txmsgs,4,txseq);
+    cnt=write(canfd,txmsgs,4*sizeof(CANMsg));
     if ( cnt > 0 ){
       /* Increment statistics */
       txpkts += cnt/sizeof(CANMsg);      
-      ofs+=cnt/sizeof(CANMsg);
-      if ( ofs > 3 )  
-        ofs-=4;
+      txseq += cnt/sizeof(CANMsg);
     }else{
       sched_yield();
       printf("TX CAN TASK: write failed: %d (%s)\n",errno,strerror(errno));
@@ -759,43 +772,57 @@ void print_msg(int i, CANMsg *msg){
 	}
 }
 
-/* Print statistics gathered by RX and TX tasks, also
- * print statistics from driver.
+/* Sample statistics gathered by RX and TX tasks and by the
+ * driver. The application counters are:
+ *   app0  messages with wrong ID for their sequence number
+ *   app1  GRCAN interrupts
+ *   app2  GRCAN AHB errors
  */
-void can_print_stats(void)
+void can_sample_stats(void)
 {
   struct grcan_stats stats;
-  static int cnt=0;
+  static struct canstats_cnt cnt;
   
-  /* Get stats from GRCAn driver to print */
+  /* Keep the last driver values if the driver can not be read */
   if ( ioctl(canfd,GRCAN_IOC_GET_STATS,&stats) == 0 ) {
-    /* Got stats from driver */
-    
-#ifdef PRINT_MORE_STATS
-    /* Print extra stats */
-    printf("CAN PASSV:   %d\n",stats.passive_cnt);
-    rtems_task_wake_after(4);
-    printf("CAN OVERRUN: %d\n",stats.overrun_cnt);
-    rtems_task_wake_after(4);
-    printf("CAN TXLOSS:  %d\n",stats.txloss_cnt);
-    rtems_task_wake_after(4);
-#endif
-    if ( stats.ahberr_cnt )
-      printf("CAN AHB:     %d\n",stats.ahberr_cnt);
-    printf("CAN INTS:     %d\n",stats.ints);
-    rtems_task_wake_after(4);
+    cnt.bus_errs = stats.txloss_cnt;
+    cnt.overruns = stats.overrun_cnt;
+    cnt.passive = stats.passive_cnt;
+    cnt.app[1] = stats.ints;
+    cnt.app[2] = stats.ahberr_cnt;
   }
-  printf("CAN RXPKTS:   %d\n",rxpkts);
-  rtems_task_wake_after(4);
+  cnt.rx_msgs = rxpkts;
+  cnt.tx_msgs = txpkts;
+  cnt.app[0] = rx_errors;
+  canstats_sample(canstats, &cnt);
+}
+
+/* Print rates over the last STATS_PRINT_SAMPLES samples */
+void can_print_stats(void)
+{
+  struct canstats_rates rates;
+  static int cnt=0;
+#ifdef STATS_PATH
+  static unsigned char dump[CANSTATS_HDR_SIZE + STATS_SLOTS * 5 * (1 + CANSTATS_CNTS)];
+  FILE *f;
+  int len;
+#endif
   
-  /* Print only number of RX syncs every tenth time */
-  if ( cnt++ >= 10 ){
+  if ( canstats_rates(canstats, STATS_PRINT_SAMPLES * STATS_SAMPLE_MS * 1000, &rates) == 0 )
+    canstats_rates_print(&rates);
+  
+  /* Print sequence check results only every tenth time */
+  if ( (cnt++ >= 10) && rxseq ){
     cnt=0;
-    printf("CAN RXSYNCS:  %d\n",rx_syncs);
-    if ( rx_errors > 0)
-      printf("CAN RXERRORS: %d\n",rx_errors);
+    canseq_stats_print(rxseq);
   }
   
-  printf("CAN TXPKTS:   %d\n",txpkts);
-  rtems_task_wake_after(4);
+#ifdef STATS_PATH
+  len = canstats_dump(canstats, dump, sizeof(dump));
+  f = fopen(STATS_PATH, "wb");
+  if ( f ){
+    fwrite(dump, 1, len, f);
+    fclose(f);
+  }
+#endif
 }
@@ -51,6 +51,7 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -58,14 +59,37 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 
 #include <occan.h>
 #include "occan_lib.h"
+#ifdef SW_FILTER
+#include "occan_filter.h"
+#endif
+#ifdef RX_BENCH
+#include "occan_lease.h"
+#endif
+#ifdef TX_PRIO
+#include "occan_txq.h"
+#endif
+#ifdef CAN_REC
+#include "occan_rec.h"
+#endif
+#ifdef CAN_GW
+#include "occan_gw.h"
+#endif
+#ifdef CAN_ISOTP
+#include "occan_isotp.h"
+#endif
 
 
 /* Include driver configurations and system initialization */
 #include "config.c"
 
 
-#define BTR0 0x27	
-#define BTR1 0x3e
+/* Bitrate of the tasks that do not use occanlib_set_speed(), the BTRs
+ * are taken from can/can_timing_table.h. 25kbit/s @ 40MHz is what the
+ * fixed BTR0=0x27, BTR1=0x3e gave.
+ */
+#define OCCAN_BTR_RATE 25000
+#define OCCAN_CLOCK_HZ 40000000
+#define OCCAN_SAMPL_PT 80
 #define DO_FILTER_TEST	
 
 //#undef MULTI_BOARD
@@ -134,6 +158,13 @@ rtems_task Init(
 
 void task1_afilter_test(occan_t chan);
 void task2_afilter_test(occan_t chan);
+void task1_rx_bench(occan_t chan);
+void task1_txq_test(occan_t chan);
+void task2_rx_bench(occan_t chan);
+void task2_rec(occan_t chan);
+void task2_gw(occan_t chan);
+void task1_isotp(occan_t chan);
+void task2_isotp(occan_t chan);
 
 #define SPEED_250K 250000
 
@@ -172,6 +203,20 @@ rtems_task task1(
 	task1_afilter_test(chan);
 	
 	occanlib_stop(chan);
+#endif
+#ifdef RX_BENCH
+	task1_rx_bench(chan);
+	
+	occanlib_stop(chan);
+#endif
+#ifdef TX_PRIO
+	task1_txq_test(chan);
+	
+	occanlib_stop(chan);
+#endif
+#ifdef CAN_ISOTP
+	/* Uploads until reset */
+	task1_isotp(chan);
 #endif
 	/* before starting set up 
 	 *   Speed
@@ -182,10 +227,10 @@ rtems_task task1(
 	
 	printf("Task1: Setting speed\n"); 
 	//occanlib_set_speed(chan,SPEED_250K);
-        occanlib_set_btrs(chan,BTR0,BTR1);
+        occanlib_set_speed_table(chan,OCCAN_CLOCK_HZ,OCCAN_BTR_RATE,OCCAN_SAMPL_PT);
 	
 	printf("Task1: Setting buf len\n"); 
-	occanlib_set_buf_length(chan,TSK1_RX_LEN,TSK1_TX_LEN);
+	occanlib_set_buf_length(chan,TSK1_TX_LEN,TSK1_RX_LEN);
 	
 	/* total blocking mode */
 	printf("Task1: Setting blk mode\n"); 
@@ -303,7 +348,12 @@ rtems_task task2(
 	occan_t chan;
 	CANMsg msgs[3];
 	int i,cnt,msgcnt;
+#ifdef SW_FILTER
+	occan_filter_t flt;
+	int sub_std, sub_gaisler, loops = 0;
+#else
 	struct occan_afilter afilt;
+#endif
 	
 	printf("Starting task 2\n");
 	
@@ -319,6 +369,23 @@ rtems_task task2(
 	task2_afilter_test(chan);
 	
 	occanlib_stop(chan);
+#endif
+#ifdef RX_BENCH
+	task2_rx_bench(chan);
+	
+	occanlib_stop(chan);
+#endif
+#ifdef CAN_REC
+	/* Records until reset */
+	task2_rec(chan);
+#endif
+#ifdef CAN_GW
+	/* Forwards until reset */
+	task2_gw(chan);
+#endif
+#ifdef CAN_ISOTP
+	/* Receives until reset */
+	task2_isotp(chan);
 #endif
 	/* before starting set up 
 	 *   Speed
@@ -329,15 +396,27 @@ rtems_task task2(
 	
 	printf("Task2: Setting speed\n"); 
 	//occanlib_set_speed(chan,SPEED_250K);
-	occanlib_set_btrs(chan,BTR0,BTR1);
+	occanlib_set_speed_table(chan,OCCAN_CLOCK_HZ,OCCAN_BTR_RATE,OCCAN_SAMPL_PT);
   
 	printf("Task2: Setting buf len\n"); 
-	occanlib_set_buf_length(chan,TSK2_RX_LEN,TSK2_TX_LEN);
+	occanlib_set_buf_length(chan,TSK2_TX_LEN,TSK2_RX_LEN);
 	
 	/* total blocking mode */
 	printf("Task2: Setting blk mode\n"); 
 	occanlib_set_blocking_mode(chan,0,1);
 	
+#ifdef SW_FILTER
+	/* Subscriber 0 takes the STD messages, subscriber 1 the GAISLER EXT
+	 * messages. Other EXT messages are filtered out in software, the
+	 * hardware filter is derived from the subscribed IDs.
+	 */
+	flt = occanlib_filter_create(8);
+	sub_std = occanlib_filter_subscribe(flt, 16, NULL, NULL);
+	sub_gaisler = occanlib_filter_subscribe(flt, 16, NULL, NULL);
+	occanlib_filter_add_std(flt, sub_std, 10, 10+240);
+	occanlib_filter_add_ext_range(flt, sub_gaisler, ID_GAISLER+10, ID_GAISLER+10+240);
+	occanlib_filter_apply(flt, chan);
+#else
 	/* Set filter to accept all */
 	afilt.single_mode = 1;
 	afilt.code[0] = 0x00;
@@ -349,6 +428,7 @@ rtems_task task2(
 	afilt.mask[2] = 0xff;
 	afilt.mask[3] = 0xff;
 	occanlib_set_filter(chan,&afilt);
+#endif
 	
 	/* Start link */
 	printf("Task2: Starting\n"); 
@@ -356,6 +436,27 @@ rtems_task task2(
 	
 	msgcnt=0;
 	printf("Task2: Entering rx loop\n");
+#ifdef SW_FILTER
+	while(2){
+		/* blocking read, messages are sorted into the subscriber queues */
+		if ( occanlib_filter_recv(flt, chan) < 0 ){
+			printf("Task2: Experienced RX error\n");
+			continue;
+		}
+		while ( (cnt = occanlib_filter_take(flt, sub_std, msgs, 3)) > 0 ){
+			for(i=0; i<cnt; i++)
+				print_msg(msgcnt++,&msgs[i]);
+		}
+		while ( (cnt = occanlib_filter_take(flt, sub_gaisler, msgs, 3)) > 0 ){
+			printf("----- GAISLER MESSAGE -----\n");
+			for(i=0; i<cnt; i++)
+				print_msg(msgcnt++,&msgs[i]);
+			printf("---------------------------\n");
+		}
+		if ( (++loops & 0x3f) == 0 )
+			occanlib_filter_stats_print(flt);
+	}
+#else
 	while(2){
 		/* blocking read */
 		cnt = occanlib_recv_multiple(chan,msgs,3);
@@ -379,6 +480,7 @@ rtems_task task2(
 			sleep(1);
 		}
 	}
+#endif
 }
 
 #ifdef DO_FILTER_TEST	
@@ -396,7 +498,7 @@ void task1_afilter_test(occan_t chan){
 	occanlib_set_blocking_mode(chan,1,1);
 	
 	printf("Task1: Setting buf len\n"); 
-	occanlib_set_buf_length(chan,TSK1_RX_LEN,TSK1_TX_LEN);
+	occanlib_set_buf_length(chan,TSK1_TX_LEN,TSK1_RX_LEN);
 	
 	/* Build messages */
 	for(i=0; i<16; i++){
@@ -447,7 +549,7 @@ void task2_afilter_test(occan_t chan){
 	occanlib_set_blocking_mode(chan,0,0);
 	
 	printf("Task2: Setting buf len\n"); 
-	occanlib_set_buf_length(chan,TSK1_RX_LEN,TSK1_TX_LEN);
+	occanlib_set_buf_length(chan,TSK1_TX_LEN,TSK1_RX_LEN);
 	
 	/* Set up filter so that odd messages is filtered out 
 	 * It can be done with a single filter.
@@ -508,3 +610,472 @@ void task2_afilter_test(occan_t chan){
 	
 }
 #endif
+
+#ifdef RX_BENCH
+/************* receive path benchmark *************
+ *
+ * Task1 floods the bus with back-to-back messages while task2 receives
+ * them, first with occanlib_recv_multiple() into a local array followed
+ * by a copy into an application buffer (as the demos do), then with the
+ * leased receive where messages are processed in place in the lease ring.
+ * Both paths take at most BENCH_BATCH messages per driver read, the lease
+ * ring has BENCH_BATCH slots, so the only difference is the copy. Both RX
+ * loops are non-blocking and only the time spent in calls that returned
+ * messages is counted as CPU time.
+ */
+#define BENCH_SECS 10
+#define BENCH_RX_LEN 256
+#define BENCH_TX_LEN 256
+#define BENCH_BATCH 32
+
+unsigned int bench_sum;
+
+void task1_rx_bench(occan_t chan){
+	CANMsg msgs[BENCH_BATCH];
+	int i, sent;
+	unsigned int end;
+	
+	occanlib_set_speed(chan,SPEED_250K);
+	occanlib_set_blocking_mode(chan,1,0);
+	occanlib_set_buf_length(chan,BENCH_TX_LEN,TSK1_RX_LEN);
+	
+	for(i=0; i<BENCH_BATCH; i++){
+		msgs[i].extended = 0;
+		msgs[i].rtr = 0;
+		msgs[i].sshot = 0;
+		msgs[i].id = 0x100 + i;
+		msgs[i].len = 8;
+		memset(msgs[i].data, i, 8);
+	}
+	
+	occanlib_start(chan);
+	
+	/* Flood until both receive phases are over */
+	end = occanlib_lease_time() + (2 * BENCH_SECS + 2) * 1000000;
+	while ( (int)(end - occanlib_lease_time()) > 0 ){
+		sent = occanlib_send_multiple(chan,msgs,BENCH_BATCH);
+		if ( sent < 0 ){
+			printf("Task1: bench TX error\n");
+			break;
+		}
+	}
+}
+
+static void rx_bench_report(char *name, unsigned int cnt, unsigned int busy_us, unsigned int reads){
+	printf("Task2: %-6s %7u msgs %6u msgs/s %4u.%02u us/msg %5u reads\n",
+		name, cnt, cnt / BENCH_SECS,
+		cnt ? busy_us / cnt : 0, cnt ? ((busy_us * 100) / cnt) % 100 : 0,
+		reads);
+}
+
+void task2_rx_bench(occan_t chan){
+	CANMsg msgs[BENCH_BATCH];
+	CANMsg app[BENCH_BATCH];
+	struct occan_lease_batch batch;
+	struct occan_lease_stats stats;
+	occan_lease_t ls;
+	unsigned int t0, t1, end, cnt, busy, reads;
+	int n, i, j;
+	
+	occanlib_set_speed(chan,SPEED_250K);
+	occanlib_set_blocking_mode(chan,0,0);
+	occanlib_set_buf_length(chan,TSK2_TX_LEN,BENCH_RX_LEN);
+	occanlib_start(chan);
+	
+	/* read() path: driver -> msgs[] -> application buffer */
+	cnt = busy = reads = 0;
+	end = occanlib_lease_time() + BENCH_SECS * 1000000;
+	while ( (int)(end - (t0 = occanlib_lease_time())) > 0 ){
+		n = occanlib_recv_multiple(chan,msgs,BENCH_BATCH);
+		if ( n <= 0 )
+			continue;
+		for(i=0; i<n; i++){
+			app[i] = msgs[i];
+			for(j=0; j<app[i].len; j++)
+				bench_sum += app[i].data[j];
+		}
+		t1 = occanlib_lease_time();
+		busy += t1 - t0;
+		cnt += n;
+		reads++;
+	}
+	rx_bench_report("read", cnt, busy, reads);
+	
+	/* leased path: driver -> lease ring, processed in place */
+	ls = occanlib_lease_create(chan,BENCH_BATCH);
+	if ( !ls )
+		return;
+	cnt = busy = 0;
+	end = occanlib_lease_time() + BENCH_SECS * 1000000;
+	while ( (int)(end - (t0 = occanlib_lease_time())) > 0 ){
+		n = occanlib_lease_recv(ls,&batch,BENCH_BATCH);
+		if ( n <= 0 )
+			continue;
+		for(i=0; i<n; i++){
+			for(j=0; j<batch.msgs[i].len; j++)
+				bench_sum += batch.msgs[i].data[j];
+		}
+		occanlib_lease_release(ls,n);
+		t1 = occanlib_lease_time();
+		busy += t1 - t0;
+		cnt += n;
+	}
+	occanlib_lease_get_stats(ls,&stats);
+	rx_bench_report("lease", cnt, busy, stats.reads);
+	occanlib_lease_free(ls);
+}
+#endif
+
+#ifdef CAN_REC
+/************* CAN recorder *************
+ *
+ * Task2 records everything received into a ring of blocks, a drain task
+ * with lower priority writes full blocks to REC_PATH. Without REC_PATH
+ * the blocks are only counted, which shows the recorder CPU load alone.
+ * The recording is read on the host with can/canrec.
+ */
+#define REC_BLOCKS 32
+#define REC_RX_LEN 512
+/*#define REC_PATH "/mnt/sd/can.rec"*/
+
+occan_rec_t rec;
+
+rtems_task rec_drain_task(rtems_task_argument unused){
+	unsigned char *blk;
+	unsigned int written = 0;
+	struct occan_rec_stats stats;
+#ifdef REC_PATH
+	FILE *f;
+	
+	f = fopen(REC_PATH, "wb");
+	if ( !f ){
+		printf("Drain: failed to open %s\n", REC_PATH);
+		rtems_task_delete(RTEMS_SELF);
+	}
+#endif
+	
+	while(1){
+		blk = occanlib_rec_peek(rec);
+		if ( !blk ){
+			rtems_task_wake_after(1);
+			continue;
+		}
+#ifdef REC_PATH
+		if ( fwrite(blk, CANREC_BLOCK_SIZE, 1, f) != 1 ){
+			printf("Drain: write failed\n");
+			fclose(f);
+			rtems_task_delete(RTEMS_SELF);
+		}
+		fflush(f);
+#endif
+		occanlib_rec_release(rec);
+		if ( (++written & 0xff) == 0 ){
+			occanlib_rec_get_stats(rec, &stats);
+			printf("Drain: %u blocks, %u msgs recorded, %u lost, %u bytes/msg\n",
+				written, stats.msgs, stats.lost,
+				stats.msgs ? stats.bytes / stats.msgs : 0);
+		}
+	}
+}
+
+void task2_rec(occan_t chan){
+	rtems_id id;
+	unsigned int last;
+	
+	occanlib_set_speed_table(chan,OCCAN_CLOCK_HZ,OCCAN_BTR_RATE,OCCAN_SAMPL_PT);
+	occanlib_set_buf_length(chan,TSK2_TX_LEN,REC_RX_LEN);
+	occanlib_set_blocking_mode(chan,0,1);
+	
+	rec = occanlib_rec_create(chan, REC_BLOCKS, REC_RX_LEN);
+	if ( !rec ){
+		printf("Task2: failed to create recorder\n");
+		return;
+	}
+	
+	rtems_task_create(rtems_build_name('D', 'R', 'N', ' '), 10,
+		RTEMS_MINIMUM_STACK_SIZE * 2, RTEMS_DEFAULT_MODES,
+		RTEMS_DEFAULT_ATTRIBUTES, &id);
+	rtems_task_start(id, rec_drain_task, 0);
+	
+	occanlib_start(chan);
+	printf("Task2: Recording\n");
+	
+	/* Blocking receive, a quiet bus flushes on the next message after
+	 * one second at the latest.
+	 */
+	last = occanlib_time_us();
+	while(1){
+		if ( occanlib_rec_poll(rec) < 0 ){
+			printf("Task2: Experienced RX error\n");
+			continue;
+		}
+		if ( occanlib_time_us() - last > 1000000 ){
+			occanlib_rec_flush(rec);
+			last = occanlib_time_us();
+		}
+	}
+}
+#endif
+
+#ifdef CAN_GW
+/************* CAN gateway *************
+ *
+ * Task2 bridges two CAN segments, OCCAN_DEVICE_RX_NAME and GW_DEVICE_NAME,
+ * from one task:
+ *  - segment A IDs 0x000-0x0ff are forwarded to segment B unchanged
+ *  - segment A IDs 0x100-0x1ff are forwarded to B as 0x500-0x5ff
+ *  - segment B ID 0x640 is forwarded back to A, at most 10 msgs/s
+ * Everything else stays on its segment. Statistics are printed every 10s.
+ */
+#define GW_DEVICE_NAME "/dev/occan1"
+#define GW_RX_LEN 256
+#define GW_TX_LEN 64
+#define GW_LEASE_SLOTS 256
+
+void task2_gw(occan_t chan){
+	occan_t chans[2];
+	occan_gw_t gw;
+	struct occan_gw_route route;
+	unsigned int last;
+	int i, ret;
+	
+	chans[0] = chan;
+	chans[1] = occanlib_open(GW_DEVICE_NAME);
+	if ( !chans[1] ){
+		printf("Task2: failed to open %s\n", GW_DEVICE_NAME);
+		return;
+	}
+	
+	gw = occanlib_gw_create();
+	if ( !gw ){
+		printf("Task2: failed to create gateway\n");
+		return;
+	}
+	for (i=0; i<2; i++){
+		occanlib_set_speed_table(chans[i],OCCAN_CLOCK_HZ,OCCAN_BTR_RATE,OCCAN_SAMPL_PT);
+		occanlib_set_buf_length(chans[i],GW_TX_LEN,GW_RX_LEN);
+		occanlib_set_blocking_mode(chans[i],0,0);
+		if ( occanlib_gw_add_chan(gw, chans[i], GW_LEASE_SLOTS) < 0 )
+			return;
+	}
+	
+	memset(&route,0,sizeof(route));
+	route.in = 0;
+	route.id = 0x000;
+	route.mask = 0x700;
+	route.out = 1<<1;
+	occanlib_gw_add_route(gw, &route);
+	
+	route.id = 0x100;
+	route.rw_mask = 0x700;
+	route.rw_id = 0x500;
+	occanlib_gw_add_route(gw, &route);
+	
+	route.in = 1;
+	route.id = 0x640;
+	route.mask = 0x7ff;
+	route.out = 1<<0;
+	route.rw_mask = 0;
+	route.rate = 10;
+	route.burst = 2;
+	occanlib_gw_add_route(gw, &route);
+	
+	for (i=0; i<2; i++)
+		occanlib_start(chans[i]);
+	printf("Task2: Forwarding\n");
+	
+	/* Poll again at once while messages arrive, sleep one tick when
+	 * all channels are idle.
+	 */
+	last = occanlib_time_us();
+	while(1){
+		ret = occanlib_gw_poll(gw);
+		if ( ret < 0 ){
+			printf("Task2: Experienced RX error\n");
+			rtems_task_wake_after(1);
+		}else if ( ret == 0 ){
+			rtems_task_wake_after(1);
+		}
+		if ( occanlib_time_us() - last > 10000000 ){
+			occanlib_gw_stats_print(gw);
+			last = occanlib_time_us();
+		}
+	}
+}
+#endif
+
+#ifdef CAN_ISOTP
+/************* ISO-TP upload *************
+ *
+ * Task1 uploads a table of ISOTP_LEN bytes over and over with the ISO-TP
+ * transport, task2 reassembles and verifies it. Task2 requests blocks of
+ * ISOTP_BS frames with ISOTP_STMIN_US between them. Both tasks print the
+ * transport statistics every 10s.
+ */
+#define ISOTP_LEN OCCAN_ISOTP_LEN_MAX
+#define ISOTP_BS 8
+#define ISOTP_STMIN_US 0
+#define ISOTP_TX_ID 0x7e0
+#define ISOTP_RX_ID 0x7e8
+
+unsigned char isotp_table[ISOTP_LEN];
+
+static unsigned char isotp_byte(unsigned int n, int i){
+	return n * 31 + i;
+}
+
+static occan_isotp_t isotp_init(occan_t chan, int bufs, unsigned int tx_id, unsigned int rx_id, int bs){
+	occan_isotp_t tp;
+	struct occan_isotp_cfg tcfg;
+	
+	occanlib_set_speed(chan,SPEED_250K);
+	occanlib_set_buf_length(chan,64,64);
+	occanlib_set_blocking_mode(chan,0,0);
+	
+	tp = occanlib_isotp_create(chan, bufs, ISOTP_LEN);
+	if ( !tp ){
+		printf("Failed to create ISO-TP transport\n");
+		return NULL;
+	}
+	memset(&tcfg,0,sizeof(tcfg));
+	tcfg.tx_id = tx_id;
+	tcfg.rx_id = rx_id;
+	tcfg.bs = bs;
+	tcfg.stmin_us = ISOTP_STMIN_US;
+	occanlib_isotp_add_session(tp, &tcfg);
+	
+	occanlib_start(chan);
+	return tp;
+}
+
+void task1_isotp(occan_t chan){
+	occan_isotp_t tp;
+	unsigned int n = 0, last, t0;
+	int i, ret;
+	
+	tp = isotp_init(chan, 1, ISOTP_TX_ID, ISOTP_RX_ID, 0);
+	if ( !tp )
+		return;
+	
+	last = t0 = occanlib_time_us();
+	while(1){
+		ret = occanlib_isotp_tx_status(tp, 0);
+		if ( ret != OCCAN_ISOTP_BUSY ){
+			if ( ret < 0 )
+				printf("Task1: upload %u failed: %d\n", n, ret);
+			for(i=0; i<ISOTP_LEN; i++)
+				isotp_table[i] = isotp_byte(n, i);
+			occanlib_isotp_send(tp, 0, isotp_table, ISOTP_LEN);
+			n++;
+		}
+		if ( occanlib_isotp_poll(tp) <= 0 )
+			rtems_task_wake_after(1);
+		if ( occanlib_time_us() - last > 10000000 ){
+			last = occanlib_time_us();
+			printf("Task1: %u uploads started in %u s\n", n, (last - t0) / 1000000);
+			occanlib_isotp_stats_print(tp);
+		}
+	}
+}
+
+void task2_isotp(occan_t chan){
+	occan_isotp_t tp;
+	struct occan_isotp_msg msg;
+	struct occan_isotp_stats st;
+	unsigned int n = 0, bad = 0, last, t0;
+	int i, ret;
+	
+	tp = isotp_init(chan, 2, ISOTP_RX_ID, ISOTP_TX_ID, ISOTP_BS);
+	if ( !tp )
+		return;
+	
+	last = t0 = occanlib_time_us();
+	while(1){
+		ret = occanlib_isotp_poll(tp);
+		while ( occanlib_isotp_recv(tp, &msg) ){
+			for(i=0; i<msg.len; i++){
+				if ( msg.data[i] != isotp_byte(n, i) )
+					break;
+			}
+			if ( (msg.len != ISOTP_LEN) || (i < msg.len) )
+				bad++;
+			n++;
+			occanlib_isotp_release(tp, msg.data);
+		}
+		if ( ret <= 0 )
+			rtems_task_wake_after(1);
+		if ( occanlib_time_us() - last > 10000000 ){
+			last = occanlib_time_us();
+			occanlib_isotp_get_stats(tp, &st);
+			printf("Task2: %u tables received, %u bad, %u bytes/s\n", n, bad,
+				st.rx_bytes / ((last - t0) / 1000000));
+			occanlib_isotp_stats_print(tp);
+		}
+	}
+}
+#endif
+
+#ifdef TX_PRIO
+/************* priority transmit queue test *************
+ *
+ * Every tick a burst of 16 low priority bulk messages is queued, and every
+ * fourth tick one high priority control message. The bus can not keep up
+ * with the bulk traffic, still the control messages are sent after at
+ * most the driver TX buffer (OCCAN_TXQ_DRV_LEN messages).
+ */
+void task1_txq_test(occan_t chan){
+	occan_txq_t q;
+	CANMsg bulk[16], ctrl;
+	int i, loops;
+	
+	occanlib_set_speed(chan,SPEED_250K);
+	occanlib_set_blocking_mode(chan,0,0);
+	occanlib_set_buf_length(chan,OCCAN_TXQ_DRV_LEN,TSK1_RX_LEN);
+	
+	q = occanlib_txq_create(chan,256);
+	if ( !q )
+		return;
+	/* Class 0 is control traffic, the rest is bulk */
+	occanlib_txq_set_class(q,0,0x0ff);
+	
+	for(i=0; i<16; i++){
+		bulk[i].extended = 0;
+		bulk[i].rtr = 0;
+		bulk[i].sshot = 0;
+		bulk[i].id = 0x600 + i;
+		bulk[i].len = 8;
+		memset(bulk[i].data, i, 8);
+	}
+	ctrl.extended = 0;
+	ctrl.rtr = 0;
+	ctrl.sshot = 0;
+	ctrl.id = 0x010;
+	ctrl.len = 2;
+	ctrl.data[0] = 0xc0;
+	ctrl.data[1] = 0x01;
+	
+	occanlib_start(chan);
+	
+	for(loops=0; loops<1000; loops++){
+		occanlib_txq_put(q,bulk,16);
+		if ( (loops & 3) == 0 )
+			occanlib_txq_put(q,&ctrl,1);
+		if ( occanlib_txq_pump(q) < 0 ){
+			printf("Task1: TXQ send error\n");
+			break;
+		}
+		rtems_task_wake_after(1);
+	}
+	
+	/* Drain */
+	while ( occanlib_txq_count(q) > 0 ){
+		if ( occanlib_txq_pump(q) < 0 )
+			break;
+		rtems_task_wake_after(1);
+	}
+	
+	printf("---------------- Task1: TXQ latency --------------\n");
+	occanlib_txq_stats_print(q);
+	occanlib_txq_free(q);
+}
+#endif
@@ -2,6 +2,29 @@
  * When using two boards define MULTI_BOARD and 
  * one of TASK_RX or TASK_TX.
  *
+ * With SPW_POOL the tasks stream packets from a buffer pool through the
+ * zero-copy interface in spw/spw_link.h and the receiver prints the
+ * throughput. SPW_POOL_COPY adds the application copies of the classic
+ * write()/read() path for comparison.
+ *
+ * With SPW_BENCH task1 runs the benchmark of spw/spw_bench.h against
+ * task2: packet size sweep, round trip latency and CPU utilisation of both
+ * sides, printed as comma separated tables.
+ *
+ * With SPW_DEMUX task1 sends bulk data mixed with time, RMAP and CCSDS
+ * packets. task2 classifies them with spw/spw_demux.h into one queue per
+ * protocol, each emptied by its own consumer task. The time consumer has
+ * the highest priority and reports how long time packets were queued.
+ *
+ * With SPW_RMAP task2 enables the RMAP target of the second core and task1
+ * writes and reads back its memory with spw/rmap.h, one to 32 commands in
+ * flight, and prints the throughput of each.
+ *
+ * With SPW_CAPTURE task2 sniffs the second core: every packet received is
+ * copied into the capture ring of spw/spw_capture.h and served to a host
+ * over TCP/IP by spw/capsrv.c, where spw/spwcap writes a pcap file.
+ * task1 sends packets of all lengths.
+ *
  * The main SpaceWire example for oe board is rtems-spacewire.
  *
  * Gaisler Research 2007,
@@ -18,9 +41,16 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 #define CONFIGURE_APPLICATION_NEEDS_NULL_DRIVER 1
 #define CONFIGURE_APPLICATION_NEEDS_CLOCK_DRIVER
 
+#ifdef SPW_CAPTURE
+/* Network tasks and the capture server */
+#define CONFIGURE_MAXIMUM_TASKS             16
+#define CONFIGURE_MAXIMUM_SEMAPHORES        20
+#define CONFIGURE_EXTRA_TASK_STACKS         (3 * RTEMS_MINIMUM_STACK_SIZE + 32 * 1024)
+#else
 #define CONFIGURE_MAXIMUM_TASKS             8
-#define CONFIGURE_RTEMS_INIT_TASKS_TABLE
 #define CONFIGURE_EXTRA_TASK_STACKS         (3 * RTEMS_MINIMUM_STACK_SIZE)
+#endif
+#define CONFIGURE_RTEMS_INIT_TASKS_TABLE
 #define CONFIGURE_LIBIO_MAXIMUM_FILE_DESCRIPTORS 32
 #define CONFIGURE_INIT_TASK_PRIORITY	100
 #define CONFIGURE_MAXIMUM_DRIVERS 16
@@ -55,6 +85,9 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 #endif
 
 #define CONFIGURE_DRIVER_AMBAPP_GAISLER_GRSPW   /* GRSPW Driver */
+#ifdef SPW_CAPTURE
+#define CONFIGURE_DRIVER_AMBAPP_GAISLER_GRETH   /* Network for the capture server */
+#endif
 
 #include <drvmgr/drvmgr_confdefs.h>
 
@@ -66,12 +99,41 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef SPW_CAPTURE
+#include <rtems/rtems_bsdnet.h>
+#define ENABLE_NETWORK
+#else
 #undef ENABLE_NETWORK
+#endif
 /* Include driver configurations and system initialization */
 #include "config.c"
 
 #include <grspw.h>
 
+#if defined(SPW_POOL) || defined(SPW_BENCH) || defined(SPW_DEMUX) || defined(SPW_RMAP) || \
+    defined(SPW_CAPTURE)
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include "spw/spw_pkt.h"
+#include "spw/spw_link.h"
+#endif
+#ifdef SPW_BENCH
+#include "spw/spw_bench.h"
+#endif
+#ifdef SPW_DEMUX
+#include "spw/spw_demux.h"
+#include "spw/cuc.h"
+#endif
+#ifdef SPW_RMAP
+#include "spw/rmap.h"
+#endif
+#ifdef SPW_CAPTURE
+#include "spw/spw_capture.h"
+#include "spw/capsrv.h"
+#endif
+
 /* Select GRSPW core to be used in sample application. 
  *  - /dev/grspw0              (First ON-CHIP core)
  *  - /dev/grspw1              (Second ON-CHIP core)
@@ -87,6 +149,7 @@ rtems_task Init( rtems_task_argument argument);	/* forward declaration needed */
 
 rtems_task task1(rtems_task_argument argument);
 rtems_task task2(rtems_task_argument argument);
+int spw_pool_setup(void);
 
 void print_config(spw_config *cnf);
 void print_statistics(spw_stats *stats);
@@ -133,6 +196,11 @@ rtems_task Init(
                 RTEMS_DEFAULT_ATTRIBUTES, &Task_id[2]
                 );
 
+#if defined(SPW_POOL) || defined(SPW_BENCH) || defined(SPW_DEMUX) || defined(SPW_RMAP) || \
+    defined(SPW_CAPTURE)
+        if ( spw_pool_setup() )
+                exit(0);
+#endif
 #ifdef TASK_TX       
         status = rtems_task_start(Task_id[1], task1, 1);
 #endif
@@ -150,7 +218,8 @@ static char tx_hpkt[256];
 #define NODE_ADR_TX 1
 #define NODE_ADR_RX 2
 
-#ifdef TASK_TX
+#if defined(TASK_TX) && !defined(SPW_POOL) && !defined(SPW_BENCH) && !defined(SPW_DEMUX) && \
+    !defined(SPW_RMAP) && !defined(SPW_CAPTURE)
 /* =========================================================  
    sender task */
 rtems_task task1(
@@ -284,7 +353,8 @@ rtems_task task1(
 #endif
 
 
-#ifdef TASK_RX
+#if defined(TASK_RX) && !defined(SPW_POOL) && !defined(SPW_BENCH) && !defined(SPW_DEMUX) && \
+    !defined(SPW_RMAP) && !defined(SPW_CAPTURE)
 /* ========================================================= 
    receiver task */
 
@@ -403,6 +473,754 @@ rtems_task task2(
 
 #endif
 
+#if defined(SPW_POOL) || defined(SPW_BENCH) || defined(SPW_DEMUX) || defined(SPW_RMAP) || \
+    defined(SPW_CAPTURE)
+/* ========================================================= 
+   packet pool and links of the zero-copy tests */
+
+#define POOL_PKTS	128	/* Buffers shared by both tasks */
+#define POOL_PKT_SIZE	1024
+#define POOL_BATCH	16	/* Packets built per send */
+#define POOL_RX_POSTED	64	/* Buffers given to the receiver */
+
+static spw_pool_t pool;
+#ifdef SPW_POOL_COPY
+static unsigned char rx_copy[POOL_PKT_SIZE];
+#endif
+
+int spw_pool_setup(void)
+{
+	pool = spw_pool_create(POOL_PKTS, POOL_PKT_SIZE);
+	if ( !pool ) {
+		printf("Failed to create packet pool\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* Open device in non-blocking mode and bring the link up */
+static spw_link_t spw_pool_open(char *name, int nodeaddr, int flags)
+{
+	spw_link_t link;
+	int fd;
+
+	fd = open(name, flags);
+	if ( fd < 0 ) {
+		printf("Failed to open %s (%d)\n", name, errno);
+		return NULL;
+	}
+	if ( (ioctl(fd, SPACEWIRE_IOCTRL_SET_NODEADDR, nodeaddr) == -1) ||
+	     (ioctl(fd, SPACEWIRE_IOCTRL_SET_RXBLOCK, 0) == -1) ||
+	     (ioctl(fd, SPACEWIRE_IOCTRL_SET_TXBLOCK, 0) == -1) ||
+	     (ioctl(fd, SPACEWIRE_IOCTRL_SET_TXBLOCK_ON_FULL, 0) == -1) ) {
+		printf("ioctl failed on %s (%d)\n", name, errno);
+		close(fd);
+		return NULL;
+	}
+	while ( ioctl(fd, SPACEWIRE_IOCTRL_START, 0) == -1 )
+		sched_yield();
+	link = spw_link_fd(fd);
+	if ( !link )
+		close(fd);
+	return link;
+}
+#endif
+
+#ifdef SPW_POOL
+/* ========================================================= 
+   zero-copy throughput test */
+
+#ifdef TASK_TX
+/* Sender: packets are built in pool buffers and go back to the pool when
+ * the link is done with them.
+ */
+rtems_task task1(
+        rtems_task_argument unused
+) 
+{
+	spw_link_t link;
+	struct spw_list txl, done;
+	struct spw_pkt *pkt;
+	unsigned char *p;
+	unsigned int seq = 0;
+
+	link = spw_pool_open(GRSPW_DEVICE_NAME1, NODE_ADR_TX, O_RDWR);
+	if ( !link )
+		exit(0);
+	printf("Streaming %d byte packets from " GRSPW_DEVICE_NAME1 "\n", POOL_PKT_SIZE);
+
+	spw_list_init(&txl);
+	spw_list_init(&done);
+	while ( 1 ) {
+		if ( txl.cnt == 0 ) {
+			spw_pool_get_list(pool, &txl, POOL_BATCH);
+			for (pkt=txl.head; pkt; pkt=pkt->next) {
+#ifdef SPW_POOL_COPY
+				p = (unsigned char *)tx_pkt;
+#else
+				p = pkt->data;
+#endif
+				p[0] = NODE_ADR_RX;
+				p[1] = 0xf0;	/* Protocol ID, not assigned */
+				p[2] = seq >> 24;
+				p[3] = seq >> 16;
+				p[4] = seq >> 8;
+				p[5] = seq;
+#ifdef SPW_POOL_COPY
+				memcpy(pkt->data, tx_pkt, POOL_PKT_SIZE);
+#endif
+				pkt->dlen = POOL_PKT_SIZE;
+				seq++;
+			}
+		}
+		if ( spw_link_send(link, &txl) < 0 ) {
+			printf("Send failed\n");
+			exit(0);
+		}
+		spw_link_reclaim(link, &done);
+		spw_pool_put_list(&done);
+		if ( txl.cnt )
+			sched_yield();	/* Driver full */
+	}
+}
+#endif
+
+#ifdef TASK_RX
+/* Receiver: checks the sequence numbers where the packets were received
+ * and prints the rate every second.
+ */
+rtems_task task2(
+        rtems_task_argument unused
+) 
+{
+	spw_link_t link;
+	struct spw_list rxl;
+	struct spw_pkt *pkt;
+	unsigned char *p;
+	unsigned int seq = 0, pkts = 0, bytes = 0, lost = 0, t0, t, got;
+	int posted = 0, n, secs = 0;
+
+	link = spw_pool_open(GRSPW_DEVICE_NAME2, NODE_ADR_RX, O_RDONLY);
+	if ( !link )
+		exit(0);
+
+	spw_list_init(&rxl);
+	t0 = spw_time_us();
+	while ( 1 ) {
+		spw_link_refill(link, pool, &posted, POOL_RX_POSTED);
+
+		n = spw_link_recv(link, &rxl);
+		if ( n <= 0 ) {
+			sched_yield();
+		} else {
+			posted -= n;
+			for (pkt=rxl.head; pkt; pkt=pkt->next) {
+#ifdef SPW_POOL_COPY
+				memcpy(rx_copy, pkt->data, pkt->dlen);
+				p = rx_copy;
+#else
+				p = pkt->data;
+#endif
+				if ( pkt->dlen < 6 )
+					continue;
+				got = (p[2] << 24) | (p[3] << 16) | (p[4] << 8) | p[5];
+				if ( got != seq )
+					lost += got - seq;
+				seq = got + 1;
+				pkts++;
+				bytes += pkt->dlen;
+			}
+			spw_pool_put_list(&rxl);
+		}
+
+		t = spw_time_us();
+		if ( t - t0 >= 1000000 ) {
+			printf("RX: %u pkts/s, %u.%03u MB/s, %u lost\n",
+				(unsigned int)(((unsigned long long)pkts * 1000000) / (t - t0)),
+				(unsigned int)(bytes / (t - t0)),
+				(unsigned int)((((unsigned long long)bytes * 1000) / (t - t0)) % 1000),
+				lost);
+			pkts = bytes = lost = 0;
+			t0 = t;
+			if ( ++secs % 10 == 0 ) {
+				spw_link_stats_print(link);
+				spw_pool_stats_print(pool);
+			}
+		}
+	}
+}
+#endif
+#endif
+
+#ifdef SPW_BENCH
+/* ========================================================= 
+   benchmark, the character driver receives at most 1024 bytes by default */
+
+#ifdef TASK_TX
+rtems_task task1(
+        rtems_task_argument unused
+) 
+{
+	static const int sizes[] = {16, 64, 256, 1024};
+	struct spw_bench_cfg cfg;
+	struct spw_bench_res res;
+	spw_link_t link;
+	int i;
+
+	link = spw_pool_open(GRSPW_DEVICE_NAME1, NODE_ADR_TX, O_RDWR);
+	if ( !link )
+		exit(0);
+
+	spw_bench_default_cfg(&cfg);
+	cfg.dst_addr = NODE_ADR_RX;
+	cfg.nsizes = sizeof(sizes) / sizeof(sizes[0]);
+	for (i=0; i<cfg.nsizes; i++)
+		cfg.sizes[i] = sizes[i];
+	printf("Benchmark " GRSPW_DEVICE_NAME1 " -> " GRSPW_DEVICE_NAME2 "\n");
+	if ( spw_bench_run(link, pool, &cfg, &res) )
+		printf("Benchmark incomplete\n");
+	spw_bench_print(&res);
+	spw_link_stats_print(link);
+	spw_pool_stats_print(pool);
+	exit(0);
+}
+#endif
+
+#ifdef TASK_RX
+/* Target, serves benchmark runs until idle for a minute */
+rtems_task task2(
+        rtems_task_argument unused
+) 
+{
+	spw_link_t link;
+
+	link = spw_pool_open(GRSPW_DEVICE_NAME2, NODE_ADR_RX, O_RDWR);
+	if ( !link )
+		exit(0);
+	while ( spw_bench_target(link, pool, NODE_ADR_TX, 60000000) == 0 )
+		printf("Benchmark target: run done\n");
+	printf("Benchmark target: idle, stopping\n");
+	spw_link_stats_print(link);
+	rtems_task_delete(RTEMS_SELF);
+}
+#endif
+#endif
+
+#ifdef SPW_DEMUX
+/* =========================================================
+   protocol demultiplexer test */
+
+#define DEMUX_PRIO	10	/* Sender and dispatcher */
+#define DEMUX_PRIO_TIME	5	/* Time consumer, before the dispatcher */
+#define DEMUX_PRIO_CONS	8	/* Bulk and RMAP/CCSDS consumers */
+#define DEMUX_RX_POSTED	32
+#define DEMUX_TIME_MS	10	/* Time packet period */
+#define DEMUX_OTHER_MS	100	/* RMAP and CCSDS packet period */
+#define DEMUX_BULK_PID	0xf0	/* Not assigned */
+
+#ifdef TASK_TX
+static void demux_add_pkt(struct spw_list *l, unsigned char pid, int len)
+{
+	struct spw_pkt *pkt;
+	unsigned char *p;
+
+	pkt = spw_pool_get(pool);
+	if ( !pkt )
+		return;
+	p = pkt->data;
+	memset(p, 0, len);
+	p[0] = NODE_ADR_RX;
+	p[1] = pid;
+	pkt->dlen = len;
+	spw_list_add(l, pkt);
+}
+
+/* Sender: bulk packets as fast as the link takes them, a time packet
+ * every DEMUX_TIME_MS and an RMAP and a CCSDS packet every DEMUX_OTHER_MS.
+ */
+rtems_task task1(
+        rtems_task_argument unused
+)
+{
+	spw_link_t link;
+	struct spw_list txl, done;
+	struct spw_pkt *pkt;
+	struct cuc_pfield pf;
+	struct cuc_time t;
+	unsigned int now, next_time, next_other;
+	rtems_task_priority old;
+
+	rtems_task_set_priority(RTEMS_SELF, DEMUX_PRIO, &old);
+	link = spw_pool_open(GRSPW_DEVICE_NAME1, NODE_ADR_TX, O_RDWR);
+	if ( !link )
+		exit(0);
+	printf("Sending mixed traffic from " GRSPW_DEVICE_NAME1 "\n");
+
+	memset(&pf, 0, sizeof(pf));
+	pf.tid = 1;
+	pf.coarse = 4;
+	pf.fine = 2;
+	spw_list_init(&txl);
+	spw_list_init(&done);
+	next_time = next_other = spw_time_us();
+	while ( 1 ) {
+		now = spw_time_us();
+		if ( (int)(now - next_time) >= 0 ) {
+			next_time += DEMUX_TIME_MS * 1000;
+			pkt = spw_pool_get(pool);
+			if ( pkt ) {
+				t.coarse = now / 1000000;
+				t.fine = (uint64_t)(now % 1000000) * 65536 / 1000000;
+				pkt->dlen = cuctp_encode(NODE_ADR_RX, SPW_PID_CUCTP, &pf, &t,
+							pkt->data, POOL_PKT_SIZE);
+				spw_list_add(&txl, pkt);
+			}
+		}
+		if ( (int)(now - next_other) >= 0 ) {
+			next_other += DEMUX_OTHER_MS * 1000;
+			demux_add_pkt(&txl, SPW_PID_RMAP, 16);
+			demux_add_pkt(&txl, SPW_PID_CCSDS, 64);
+		}
+		if ( txl.cnt == 0 ) {
+			while ( txl.cnt < POOL_BATCH )
+				demux_add_pkt(&txl, DEMUX_BULK_PID, POOL_PKT_SIZE);
+		}
+		if ( spw_link_send(link, &txl) < 0 ) {
+			printf("Send failed\n");
+			exit(0);
+		}
+		spw_link_reclaim(link, &done);
+		spw_pool_put_list(&done);
+		if ( txl.cnt )
+			sched_yield();	/* Driver full */
+	}
+}
+#endif
+
+#ifdef TASK_RX
+static spw_demux_t dmx;
+static int bulk_q, time_q, rmap_q, ccsds_q;
+static rtems_id time_tid, bulk_tid, other_tid;
+static volatile unsigned int time_cnt, time_bad, time_max_us;
+static volatile unsigned int bulk_cnt, rmap_cnt, ccsds_cnt;
+
+/* Queue notify, wakes the consumer task given as argument */
+static void demux_notify(void *arg)
+{
+	rtems_event_send(*(rtems_id *)arg, RTEMS_EVENT_0);
+}
+
+static void demux_wait(void)
+{
+	rtems_event_set events;
+
+	rtems_event_receive(RTEMS_EVENT_0, RTEMS_WAIT | RTEMS_EVENT_ANY,
+		RTEMS_NO_TIMEOUT, &events);
+}
+
+/* Time consumer, decodes time packets and tracks the longest queueing */
+static rtems_task demux_time_task(rtems_task_argument unused)
+{
+	struct spw_list l;
+	struct spw_pkt *pkt;
+	struct cuc_pfield pf;
+	struct cuc_time t;
+	unsigned int us;
+
+	spw_list_init(&l);
+	while ( 1 ) {
+		demux_wait();
+		while ( spw_demux_take(dmx, time_q, &l, 8) > 0 ) {
+			for (pkt=l.head; pkt; pkt=pkt->next) {
+				us = spw_time_us() - pkt->ts;
+				if ( cuctp_decode(pkt->data, pkt->dlen, NULL, NULL, &pf, &t) < 0 )
+					time_bad++;
+				else
+					time_cnt++;
+				if ( us > time_max_us )
+					time_max_us = us;
+			}
+			spw_pool_put_list(&l);
+		}
+	}
+}
+
+static rtems_task demux_bulk_task(rtems_task_argument unused)
+{
+	struct spw_list l;
+
+	spw_list_init(&l);
+	while ( 1 ) {
+		demux_wait();
+		while ( spw_demux_take(dmx, bulk_q, &l, POOL_BATCH) > 0 ) {
+			bulk_cnt += l.cnt;
+			spw_pool_put_list(&l);
+		}
+	}
+}
+
+/* RMAP and CCSDS share one consumer, each has its own queue */
+static rtems_task demux_other_task(rtems_task_argument unused)
+{
+	struct spw_list l;
+
+	spw_list_init(&l);
+	while ( 1 ) {
+		demux_wait();
+		while ( spw_demux_take(dmx, rmap_q, &l, 8) > 0 ) {
+			rmap_cnt += l.cnt;
+			spw_pool_put_list(&l);
+		}
+		while ( spw_demux_take(dmx, ccsds_q, &l, 8) > 0 ) {
+			ccsds_cnt += l.cnt;
+			spw_pool_put_list(&l);
+		}
+	}
+}
+
+static int demux_task_start(char *name, rtems_task_priority prio,
+	rtems_task_entry entry, rtems_id *tid)
+{
+	rtems_status_code status;
+
+	status = rtems_task_create(
+		rtems_build_name(name[0], name[1], name[2], name[3]), prio,
+		RTEMS_MINIMUM_STACK_SIZE, RTEMS_DEFAULT_MODES,
+		RTEMS_DEFAULT_ATTRIBUTES, tid);
+	if ( status == RTEMS_SUCCESSFUL )
+		status = rtems_task_start(*tid, entry, 0);
+	if ( status != RTEMS_SUCCESSFUL ) {
+		printf("Failed to start task %s (%d)\n", name, status);
+		return -1;
+	}
+	return 0;
+}
+
+/* Dispatcher: feeds the queues and prints what each consumer got */
+rtems_task task2(
+        rtems_task_argument unused
+)
+{
+	spw_link_t link;
+	rtems_task_priority old;
+	unsigned int t0, t;
+	int secs = 0;
+
+	rtems_task_set_priority(RTEMS_SELF, DEMUX_PRIO, &old);
+	link = spw_pool_open(GRSPW_DEVICE_NAME2, NODE_ADR_RX, O_RDWR);
+	if ( !link )
+		exit(0);
+	dmx = spw_demux_create(link, pool, DEMUX_RX_POSTED);
+	if ( !dmx )
+		exit(0);
+	time_q = spw_demux_queue(dmx, 8, SPW_DEMUX_URGENT, demux_notify, &time_tid);
+	bulk_q = spw_demux_queue(dmx, 32, 0, demux_notify, &bulk_tid);
+	rmap_q = spw_demux_queue(dmx, 8, 0, demux_notify, &other_tid);
+	ccsds_q = spw_demux_queue(dmx, 8, 0, demux_notify, &other_tid);
+	spw_demux_add(dmx, SPW_PID_CUCTP, NODE_ADR_RX, NODE_ADR_RX, time_q);
+	spw_demux_add(dmx, SPW_PID_RMAP, 0, 255, rmap_q);
+	spw_demux_add(dmx, SPW_PID_CCSDS, 0, 255, ccsds_q);
+	spw_demux_add(dmx, DEMUX_BULK_PID, NODE_ADR_RX, NODE_ADR_RX, bulk_q);
+	if ( demux_task_start("TIME", DEMUX_PRIO_TIME, demux_time_task, &time_tid) ||
+	     demux_task_start("BULK", DEMUX_PRIO_CONS, demux_bulk_task, &bulk_tid) ||
+	     demux_task_start("PROT", DEMUX_PRIO_CONS, demux_other_task, &other_tid) )
+		exit(0);
+
+	t0 = spw_time_us();
+	while ( 1 ) {
+		if ( spw_demux_recv(dmx) <= 0 )
+			sched_yield();
+
+		t = spw_time_us();
+		if ( t - t0 >= 1000000 ) {
+			printf("RX: bulk %u, time %u (%u bad, max %u us queued), "
+				"RMAP %u, CCSDS %u\n", bulk_cnt, time_cnt, time_bad,
+				time_max_us, rmap_cnt, ccsds_cnt);
+			bulk_cnt = time_cnt = rmap_cnt = ccsds_cnt = 0;
+			time_max_us = 0;
+			t0 = t;
+			if ( ++secs % 10 == 0 ) {
+				spw_demux_stats_print(dmx);
+				spw_link_stats_print(link);
+				spw_pool_stats_print(pool);
+			}
+		}
+	}
+}
+#endif
+#endif
+
+#ifdef SPW_RMAP
+/* =========================================================
+   pipelined RMAP test against the RMAP target of the GRSPW core */
+
+/* Memory written and read back, on the AMBA bus of the target core. The
+ * SRAM of the GR-RASTA-IO is used, adjust to free memory of the board.
+ */
+#define RMAP_MEM_ADDR	0x40080000
+#define RMAP_MEM_SIZE	(64 * 1024)
+#define RMAP_CHUNK	256
+#define RMAP_KEY	0x20
+#define RMAP_CNT	(RMAP_MEM_SIZE / RMAP_CHUNK)
+#define RMAP_WINDOW_MAX	32
+
+#ifdef TASK_TX
+static unsigned char rmap_wr[RMAP_MEM_SIZE];
+static unsigned char rmap_rd[RMAP_MEM_SIZE];
+static struct rmap_req rmap_reqs[RMAP_CNT];
+
+static void rmap_setup_reqs(int write, unsigned char *buf)
+{
+	int i;
+
+	memset(rmap_reqs, 0, sizeof(rmap_reqs));
+	for (i=0; i<RMAP_CNT; i++) {
+		rmap_reqs[i].dst_addr = NODE_ADR_RX;
+		rmap_reqs[i].key = RMAP_KEY;
+		rmap_reqs[i].write = write;
+		rmap_reqs[i].flags = RMAP_INS_INC;
+		rmap_reqs[i].addr = RMAP_MEM_ADDR + i * RMAP_CHUNK;
+		rmap_reqs[i].len = RMAP_CHUNK;
+		rmap_reqs[i].buf = buf + i * RMAP_CHUNK;
+	}
+}
+
+/* Initiator: writes and reads back the target memory with more and more
+ * commands in flight.
+ */
+rtems_task task1(
+        rtems_task_argument unused
+)
+{
+	static const int windows[] = {1, 2, 4, 8, 16, RMAP_WINDOW_MAX};
+	struct rmap_cfg cfg;
+	spw_link_t link;
+	rmap_t rmap;
+	unsigned int t0, t_wr, t_rd;
+	int i, j, fail;
+
+	rtems_task_wake_after(rtems_clock_get_ticks_per_second());	/* task2 sets up the target */
+	link = spw_pool_open(GRSPW_DEVICE_NAME1, NODE_ADR_TX, O_RDWR);
+	if ( !link )
+		exit(0);
+	for (i=0; i<RMAP_MEM_SIZE; i++)
+		rmap_wr[i] = i * 7 + (i >> 8);
+
+	printf("RMAP %d KiB at 0x%08x in %d byte commands\n",
+		RMAP_MEM_SIZE / 1024, RMAP_MEM_ADDR, RMAP_CHUNK);
+	/* One initiator for all windows, its receive buffers stay posted */
+	rmap_default_cfg(&cfg);
+	cfg.src_addr = NODE_ADR_TX;
+	cfg.max_outstanding = RMAP_WINDOW_MAX;
+	rmap = rmap_create(link, pool, &cfg);
+	if ( !rmap )
+		exit(0);
+
+	printf("window  write kB/s  read kB/s  failed  wrong\n");
+	for (i=0; i<(int)(sizeof(windows)/sizeof(windows[0])); i++) {
+		rmap_set_window(rmap, windows[i]);
+		memset(rmap_rd, 0, sizeof(rmap_rd));
+
+		rmap_setup_reqs(1, rmap_wr);
+		t0 = spw_time_us();
+		fail = rmap_transfer(rmap, rmap_reqs, RMAP_CNT);
+		t_wr = spw_time_us() - t0;
+
+		rmap_setup_reqs(0, rmap_rd);
+		t0 = spw_time_us();
+		fail += rmap_transfer(rmap, rmap_reqs, RMAP_CNT);
+		t_rd = spw_time_us() - t0;
+
+		j = memcmp(rmap_wr, rmap_rd, RMAP_MEM_SIZE) ? 1 : 0;
+		printf("%6d %11u %10u %7d %6d\n", windows[i],
+			(unsigned int)(((unsigned long long)RMAP_MEM_SIZE * 1000) / t_wr),
+			(unsigned int)(((unsigned long long)RMAP_MEM_SIZE * 1000) / t_rd),
+			fail, j);
+	}
+	rmap_stats_print(rmap);
+	rmap_free(rmap);
+	spw_link_stats_print(link);
+	spw_pool_stats_print(pool);
+	exit(0);
+}
+#endif
+
+#ifdef TASK_RX
+/* Target: enables the RMAP target of the core, the hardware answers */
+rtems_task task2(
+        rtems_task_argument unused
+)
+{
+	spw_config cnf;
+	int fd;
+
+	fd = open(GRSPW_DEVICE_NAME2, O_RDWR);
+	if ( fd < 0 ) {
+		printf("Failed to open " GRSPW_DEVICE_NAME2 " (%d)\n", errno);
+		exit(0);
+	}
+	if ( (ioctl(fd, SPACEWIRE_IOCTRL_GET_CONFIG, &cnf) == -1) || !cnf.is_rmap ) {
+		printf(GRSPW_DEVICE_NAME2 " has no RMAP target\n");
+		exit(0);
+	}
+	if ( (ioctl(fd, SPACEWIRE_IOCTRL_SET_NODEADDR, NODE_ADR_RX) == -1) ||
+	     (ioctl(fd, SPACEWIRE_IOCTRL_SET_DESTKEY, RMAP_KEY) == -1) ||
+	     (ioctl(fd, SPACEWIRE_IOCTRL_SET_RMAPEN, 1) == -1) ) {
+		printf("ioctl failed on " GRSPW_DEVICE_NAME2 " (%d)\n", errno);
+		exit(0);
+	}
+	while ( ioctl(fd, SPACEWIRE_IOCTRL_START, 0) == -1 )
+		sched_yield();
+	printf("RMAP target " GRSPW_DEVICE_NAME2 " address %d key 0x%02x\n",
+		NODE_ADR_RX, RMAP_KEY);
+	rtems_task_delete(RTEMS_SELF);
+}
+#endif
+#endif
+
+#ifdef SPW_CAPTURE
+/* =========================================================
+   capture of received packets to a host over TCP/IP */
+
+#define CAP_PRIO_SNIFF	110	/* Below the network tasks at 100 */
+#define CAP_PRIO_SERVER	115
+#define CAP_PRIO_TX	120
+#define CAP_RING_SIZE	(256 * 1024)
+#define CAP_SNAPLEN	256
+#define CAP_RX_POSTED	64
+#define CAP_LINK	1	/* Records of GRSPW_DEVICE_NAME2 */
+#define CAP_STATS_SEC	5
+#define CAP_PID		0xf0	/* Not assigned */
+
+#ifdef TASK_TX
+/* Sender: packets of all lengths as fast as the link takes them, the
+ * third byte counts them.
+ */
+rtems_task task1(
+        rtems_task_argument unused
+)
+{
+	spw_link_t link;
+	struct spw_list txl, done;
+	struct spw_pkt *pkt;
+	unsigned char *p;
+	unsigned int seq = 0;
+	rtems_task_priority old;
+
+	rtems_task_set_priority(RTEMS_SELF, CAP_PRIO_TX, &old);
+	link = spw_pool_open(GRSPW_DEVICE_NAME1, NODE_ADR_TX, O_RDWR);
+	if ( !link )
+		exit(0);
+	printf("Sending from " GRSPW_DEVICE_NAME1 "\n");
+
+	spw_list_init(&txl);
+	spw_list_init(&done);
+	while ( 1 ) {
+		while ( (txl.cnt < POOL_BATCH) && (pkt = spw_pool_get(pool)) ) {
+			p = pkt->data;
+			pkt->dlen = 3 + (seq * 37) % (POOL_PKT_SIZE - 2);
+			p[0] = NODE_ADR_RX;
+			p[1] = CAP_PID;
+			p[2] = seq++;
+			spw_list_add(&txl, pkt);
+		}
+		if ( spw_link_send(link, &txl) < 0 ) {
+			printf("Send failed\n");
+			exit(0);
+		}
+		spw_link_reclaim(link, &done);
+		spw_pool_put_list(&done);
+		if ( txl.cnt )
+			sched_yield();	/* Driver full */
+	}
+}
+#endif
+
+#ifdef TASK_RX
+static spw_capture_t capture;
+static rtems_id cap_server_id;
+
+/* Capture server, one host client at a time, see spw/spwcap.c */
+static rtems_task cap_server(
+        rtems_task_argument unused
+)
+{
+	while ( capsrv_wait_client() == 0 ) {
+		printf("CAP: client connected\n");
+		capsrv_loop();
+		printf("CAP: client disconnected\n");
+	}
+	capsrv_stop();
+	exit(0);
+}
+
+/* Sniffer: copies every packet received on the second core into the
+ * capture ring and gives the buffer back to the receiver. At most
+ * CAP_SNAPLEN bytes are copied and a packet that does not fit into the
+ * ring is dropped, so the link never waits for the network.
+ */
+rtems_task task2(
+        rtems_task_argument unused
+)
+{
+	spw_link_t link;
+	struct spw_list l;
+	struct spw_capture_stats cs;
+	unsigned int received = 0, next_stats;
+	int n, posted = 0;
+	rtems_task_priority old;
+	rtems_status_code status;
+
+	rtems_task_set_priority(RTEMS_SELF, CAP_PRIO_SNIFF, &old);
+	capture = spw_capture_create(CAP_RING_SIZE, CAP_SNAPLEN);
+	if ( !capture || capsrv_init(NULL, CAPSRV_PORT, capture, 2) ) {
+		printf("Failed to set up capture server\n");
+		exit(0);
+	}
+	status = rtems_task_create(rtems_build_name('C', 'S', 'R', 'V'),
+			CAP_PRIO_SERVER, 32 * 1024, RTEMS_DEFAULT_MODES,
+			RTEMS_DEFAULT_ATTRIBUTES, &cap_server_id);
+	if ( (status != RTEMS_SUCCESSFUL) ||
+	     (rtems_task_start(cap_server_id, cap_server, 0) != RTEMS_SUCCESSFUL) ) {
+		printf("Failed to start capture server task\n");
+		exit(0);
+	}
+
+	link = spw_pool_open(GRSPW_DEVICE_NAME2, NODE_ADR_RX, O_RDWR);
+	if ( !link )
+		exit(0);
+	printf("Capturing " GRSPW_DEVICE_NAME2 " as link %d, TCP port %d\n",
+		CAP_LINK, CAPSRV_PORT);
+
+	spw_list_init(&l);
+	next_stats = spw_time_us() + CAP_STATS_SEC * 1000000;
+	while ( 1 ) {
+		spw_link_refill(link, pool, &posted, CAP_RX_POSTED);
+		n = spw_link_recv(link, &l);
+		if ( n < 0 ) {
+			printf("Receive failed\n");
+			exit(0);
+		}
+		if ( n > 0 ) {
+			posted -= n;
+			received += n;
+			spw_capture_pkts(capture, CAP_LINK, &l);
+			spw_pool_put_list(&l);
+		} else {
+			rtems_task_wake_after(1);	/* Let the network run */
+		}
+
+		if ( (int)(spw_time_us() - next_stats) >= 0 ) {
+			next_stats += CAP_STATS_SEC * 1000000;
+			spw_capture_get_stats(capture, &cs);
+			printf("CAP: %u received, %u stored, %u dropped, %u sent\n",
+				received, cs.packets, cs.dropped, cs.taken);
+		}
+	}
+}
+#endif
+#endif
+
 /* ========================================================= 
    event task */
 
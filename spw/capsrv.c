@@ -0,0 +1,206 @@
+/* SpaceWire capture TCP server, see capsrv.h
+ *
+ * Same structure as the 1553 log server 1553/ethsrv.c: capsrv_init()
+ * opens the listening socket, capsrv_wait_client() blocks for a client
+ * and capsrv_loop() answers its commands until it disconnects. The server
+ * only reads the capture ring, a slow client makes the ring drop packets
+ * but never holds up the sniffer.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sched.h>
+
+#include "capsrv.h"
+
+static int ssock = -1, sock = -1;
+static spw_capture_t capture;
+static int capture_links;
+
+/* Response buffer, header, counters and records */
+static unsigned char resp[sizeof(struct cap_hdr) + sizeof(struct cap_resp_get) +
+	CAPSRV_GET_MAX];
+
+static int read_full(int s, void *buf, int len)
+{
+	int n, got = 0;
+
+	while ( got < len ) {
+		n = read(s, (char *)buf + got, len - got);
+		if ( n <= 0 )
+			return -1;
+		got += n;
+	}
+	return 0;
+}
+
+static int write_full(int s, const void *buf, int len)
+{
+	int n, done = 0;
+
+	while ( done < len ) {
+		n = write(s, (const char *)buf + done, len - done);
+		if ( n <= 0 )
+			return -1;
+		done += n;
+	}
+	return 0;
+}
+
+static int cap_respond(int cmdno, int length)
+{
+	struct cap_hdr *hdr = (struct cap_hdr *)resp;
+
+	hdr->length[0] = length >> 8;
+	hdr->length[1] = length;
+	hdr->cmdno = cmdno;
+	hdr->reserved = 0;
+	return write_full(sock, resp, sizeof(struct cap_hdr) + length);
+}
+
+static int cmd_cap_info(void)
+{
+	struct cap_resp_info *info;
+
+	info = (struct cap_resp_info *)(resp + sizeof(struct cap_hdr));
+	cap_put32(info->snaplen, spw_capture_snaplen(capture));
+	cap_put32(info->links, capture_links);
+	return cap_respond(CAP_CMD_INFO, sizeof(*info));
+}
+
+static int cmd_cap_get(void)
+{
+	struct cap_resp_get *get;
+	struct spw_capture_stats stats;
+	int len, cnt;
+
+	get = (struct cap_resp_get *)(resp + sizeof(struct cap_hdr));
+	len = spw_capture_take(capture, (unsigned char *)(get + 1),
+			CAPSRV_GET_MAX, &cnt);
+
+	/* Read after the take, may count packets stored since */
+	spw_capture_get_stats(capture, &stats);
+	cap_put32(get->packets, stats.packets);
+	cap_put32(get->dropped, stats.dropped);
+	cap_put32(get->snapped, stats.snapped);
+	cap_put32(get->cnt, cnt);
+	return cap_respond(CAP_CMD_GET, sizeof(*get) + len);
+}
+
+int capsrv_init(char *host, int port, spw_capture_t cap, int links){
+	struct sockaddr_in addr;
+	int optval;
+
+	if ( !cap || (SPW_CAP_REC_HDR + spw_capture_snaplen(cap) > CAPSRV_GET_MAX) ) {
+		printf("capsrv_init: snaplen must not exceed %d\n",
+			CAPSRV_GET_MAX - SPW_CAP_REC_HDR);
+		return -1;
+	}
+	capture = cap;
+	capture_links = links;
+
+	ssock = socket(AF_INET, SOCK_STREAM, 0);
+	if ( ssock < 0 ) {
+		printf("ERROR CREATING SERVER SOCKET: %d, %d (%s)\n", ssock, errno, strerror(errno));
+		return -1;
+	}
+
+	optval = 1;
+	if ( setsockopt(ssock, SOL_SOCKET, SO_REUSEADDR, &optval, 4) < 0 ) {
+		printf("setsockopt: %d (%s)\n", errno, strerror(errno));
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = host ? inet_addr(host) : htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+
+	if ( bind(ssock, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) < 0 ) {
+		close(ssock);
+		ssock = -1;
+		return -3;
+	}
+
+	if ( listen(ssock, 2) < 0 ) {
+		close(ssock);
+		ssock = -1;
+		return -4;
+	}
+
+	return 0;
+}
+
+int capsrv_wait_client(void){
+	/* Block waiting for new clients */
+	sock = accept(ssock, NULL, NULL);
+	if ( sock < 0 ) {
+		printf("Failed to accept incomming client\n");
+		close(ssock);
+		ssock = -1;
+		return -1;
+	}
+	return 0;
+}
+
+int capsrv_loop(void){
+	struct cap_hdr hdr;
+	unsigned char payload[64];
+	int err = 0, length;
+
+	while ( err == 0 ) {
+
+		/* Let other task have cpu between every request */
+		sched_yield();
+
+		if ( read_full(sock, &hdr, sizeof(hdr)) )
+			break;
+
+		if ( (hdr.cmdno == 0) || (hdr.cmdno > MAX_CAP_COMMAND_NUM) ) {
+			printf("Invalid command number\n");
+			break;
+		}
+
+		/* No command has a payload yet, skip what a newer client sends */
+		length = (hdr.length[0] << 8) | hdr.length[1];
+		if ( length > (int)sizeof(payload) ) {
+			printf("Invalid length of command: %d (MAX: %d) C:%d\n",
+				length, (int)sizeof(payload), hdr.cmdno);
+			break;
+		}
+		if ( (length > 0) && read_full(sock, payload, length) )
+			break;
+
+		switch ( hdr.cmdno ) {
+			case CAP_CMD_INFO:
+				err = cmd_cap_info();
+				break;
+
+			case CAP_CMD_GET:
+				err = cmd_cap_get();
+				break;
+
+			default:
+				err = 1;
+				break;
+		}
+	}
+
+	close(sock);
+	sock = -1;
+
+	return 0;
+}
+
+void capsrv_stop(void){
+	if ( ssock >= 0 )
+		close(ssock);
+	if ( sock >= 0 )
+		close(sock);
+	ssock = sock = -1;
+}
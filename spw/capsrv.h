@@ -0,0 +1,82 @@
+
+#ifndef __CAPSRV_H__
+#define __CAPSRV_H__
+
+/* SpaceWire capture server protocol
+ *
+ * The board runs a TCP server in the style of 1553/ethsrv.c, the host
+ * client sends a command and reads the response. Commands and responses
+ * start with a 4 byte header, the payload length is big endian:
+ *
+ *   0   length   Payload length following the header, 16 bits
+ *   2   cmdno    CAP_CMD_
+ *   3   reserved
+ *
+ * CAP_CMD_INFO has no payload. The response payload is struct
+ * cap_resp_info.
+ *
+ * CAP_CMD_GET has no payload. The response payload is struct
+ * cap_resp_get followed by cnt records in the format of spw_capture.h.
+ * The counters are those of the capture ring since it was created, the
+ * client tells lost packets from the growth of dropped.
+ *
+ * All fields are big endian, use cap_get32() and cap_put32().
+ */
+
+#include "spw_capture.h"
+
+#define CAPSRV_PORT		20335
+#define CAPSRV_GET_MAX		16384	/* Record bytes in one CAP_CMD_GET */
+
+enum {
+	CAP_CMD_INFO = 1,
+	CAP_CMD_GET = 2,
+};
+
+#define MAX_CAP_COMMAND_NUM	CAP_CMD_GET
+
+struct cap_hdr {
+	unsigned char	length[2];
+	unsigned char	cmdno;
+	unsigned char	reserved;
+};
+
+struct cap_resp_info {
+	unsigned char	snaplen[4];
+	unsigned char	links[4];	/* Link numbers are 0..links-1 */
+};
+
+struct cap_resp_get {
+	unsigned char	packets[4];	/* Stored into the ring */
+	unsigned char	dropped[4];	/* Lost, ring full */
+	unsigned char	snapped[4];	/* Cut to snaplen */
+	unsigned char	cnt[4];		/* Records following */
+};
+
+/* Server, capsrv.c. The records of cap are served, sniffed from links
+ * numbered 0..links-1. host NULL listens on all interfaces.
+ */
+int capsrv_init(char *host, int port, spw_capture_t cap, int links);
+
+/* Block until a client connects */
+int capsrv_wait_client(void);
+
+/* Answer the client's commands until it disconnects */
+int capsrv_loop(void);
+
+void capsrv_stop(void);
+
+static inline unsigned int cap_get32(const unsigned char *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void cap_put32(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+#endif
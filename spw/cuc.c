@@ -0,0 +1,225 @@
+/* CCSDS CUC time code and SpaceWire CUC Time-Packet library, see cuc.h */
+
+#include <string.h>
+#include "cuc.h"
+#include "rmap_crc.h"
+
+void cuc_time_from_raw(struct cuc_time *t, const struct cuc_pfield *pf, uint64_t raw)
+{
+	int fbits = pf->fine * 8;
+
+	if ( fbits == 0 ) {
+		t->coarse = raw;
+		t->fine = 0;
+	} else if ( fbits >= 64 ) {
+		t->coarse = 0;
+		t->fine = raw;
+	} else {
+		t->coarse = raw >> fbits;
+		t->fine = raw << (64 - fbits);
+	}
+	if ( pf->coarse < 8 )
+		t->coarse &= ((uint64_t)1 << (pf->coarse * 8)) - 1;
+}
+
+uint64_t cuc_time_to_raw(const struct cuc_time *t, const struct cuc_pfield *pf)
+{
+	int fbits = pf->fine * 8;
+
+	if ( fbits == 0 )
+		return t->coarse;
+	else if ( fbits >= 64 )
+		return t->fine;
+	else
+		return (t->coarse << fbits) | (t->fine >> (64 - fbits));
+}
+
+int cuc_pfield_encode(const struct cuc_pfield *pf, unsigned char *buf)
+{
+	int coarse, fine, ext;
+
+	if ( (pf->coarse < 1) || (pf->coarse > CUC_COARSE_MAX) ||
+	     (pf->fine > CUC_FINE_MAX) )
+		return -1;
+
+	coarse = pf->coarse - 1;
+	fine = pf->fine;
+	ext = pf->ext || pf->init || (coarse > 3) || (fine > 3);
+
+	if ( !ext ) {
+		buf[0] = (pf->tid & 0x7) << 4 | coarse << 2 | fine;
+		return 1;
+	}
+
+	if ( coarse > 3 ) {
+		buf[1] = (coarse - 3) << 5;
+		coarse = 3;
+	} else {
+		buf[1] = 0;
+	}
+	if ( fine > 3 ) {
+		buf[1] |= (fine - 3) << 2;
+		fine = 3;
+	}
+	buf[0] = 0x80 | (pf->tid & 0x7) << 4 | coarse << 2 | fine;
+	buf[1] |= (pf->init & 1) << 7;
+
+	return 2;
+}
+
+int cuc_pfield_decode(const unsigned char *buf, int len, struct cuc_pfield *pf)
+{
+	if ( len < 1 )
+		return -1;
+
+	pf->tid = (buf[0] >> 4) & 0x7;
+	pf->coarse = ((buf[0] >> 2) & 0x3) + 1;
+	pf->fine = buf[0] & 0x3;
+	pf->ext = buf[0] >> 7;
+	pf->init = 0;
+	if ( !pf->ext )
+		return 1;
+
+	if ( len < 2 )
+		return -1;
+	pf->init = buf[1] >> 7;
+	pf->coarse += (buf[1] >> 5) & 0x3;
+	pf->fine += (buf[1] >> 2) & 0x7;
+	if ( pf->fine > CUC_FINE_MAX )
+		return -1;
+
+	return 2;
+}
+
+int cuc_tfield_encode(const struct cuc_pfield *pf, const struct cuc_time *t, unsigned char *buf)
+{
+	int i;
+	uint64_t v;
+
+	/* Coarse time, MSB first */
+	v = t->coarse;
+	for (i=pf->coarse-1; i>=0; i--) {
+		buf[i] = v & 0xff;
+		v >>= 8;
+	}
+	buf += pf->coarse;
+
+	/* Fine time, MSB of fraction first */
+	v = t->fine;
+	for (i=0; i<pf->fine; i++) {
+		buf[i] = v >> 56;
+		v <<= 8;
+	}
+
+	return pf->coarse + pf->fine;
+}
+
+int cuc_tfield_decode(const struct cuc_pfield *pf, const unsigned char *buf, int len, struct cuc_time *t)
+{
+	int i;
+	uint64_t v;
+
+	if ( len < pf->coarse + pf->fine )
+		return -1;
+
+	v = 0;
+	for (i=0; i<pf->coarse; i++)
+		v = (v << 8) | buf[i];
+	t->coarse = v;
+	buf += pf->coarse;
+
+	v = 0;
+	for (i=0; i<pf->fine && i<8; i++)
+		v |= (uint64_t)buf[i] << (56 - 8*i);
+	t->fine = v;
+
+	return pf->coarse + pf->fine;
+}
+
+int cuctp_encode(
+	unsigned char dla,
+	unsigned char pid,
+	const struct cuc_pfield *pf,
+	const struct cuc_time *t,
+	unsigned char *buf,
+	int maxlen)
+{
+	unsigned char tmp[CUCTP_MAX];
+	int len;
+
+	tmp[0] = dla;
+	tmp[1] = pid;
+	len = cuc_pfield_encode(pf, &tmp[2]);
+	if ( len < 0 )
+		return -1;
+	len += 2;
+	len += cuc_tfield_encode(pf, t, &tmp[len]);
+	tmp[len] = rmap_crc(tmp, len);
+	len++;
+
+	if ( len > maxlen )
+		return -1;
+	memcpy(buf, tmp, len);
+
+	return len;
+}
+
+int cuctp_encode_batch(
+	const unsigned char *dlas,
+	int cnt,
+	unsigned char pid,
+	const struct cuc_pfield *pf,
+	const struct cuc_time *t,
+	unsigned char *bufs,
+	int stride)
+{
+	unsigned char tmpl[CUCTP_MAX];
+	int i, len;
+
+	/* Encode template once */
+	len = cuctp_encode(0, pid, pf, t, tmpl, stride);
+	if ( len < 0 )
+		return -1;
+	len--; /* CRC calculated per destination */
+
+	for (i=0; i<cnt; i++) {
+		memcpy(bufs, tmpl, len);
+		bufs[0] = dlas[i];
+		bufs[len] = rmap_crc_update(rmap_crc_table[0][dlas[i]],
+		                            &bufs[1], len-1);
+		bufs += stride;
+	}
+
+	return len + 1;
+}
+
+int cuctp_decode(
+	const unsigned char *buf,
+	int len,
+	unsigned char *dla,
+	unsigned char *pid,
+	struct cuc_pfield *pf,
+	struct cuc_time *t)
+{
+	int plen, tlen;
+
+	if ( len < 4 )
+		return -1;
+
+	plen = cuc_pfield_decode(&buf[2], len - 2, pf);
+	if ( plen < 0 )
+		return -1;
+	tlen = cuc_tfield_decode(pf, &buf[2 + plen], len - 3 - plen, t);
+	if ( tlen < 0 )
+		return -1;
+	len = 2 + plen + tlen;
+	if ( rmap_crc(buf, len) != buf[len] )
+		return -2;
+
+	if ( dla )
+		*dla = buf[0];
+	if ( pid )
+		*pid = buf[1];
+
+	return len + 1;
+}
@@ -0,0 +1,106 @@
+
+#ifndef __CUC_H__
+#define __CUC_H__
+
+#include <stdint.h>
+
+/* CCSDS Unsegmented Time Code (CUC) encoding and decoding, and SpaceWire
+ * CUC Time-Packets (CUCTP) as generated by the SPWCUC core:
+ *
+ *   DLA | PID | P-FIELD (1-2 octets) | T-FIELD (1-17 octets) | CRC
+ *
+ * P-field, first octet:
+ *   7     Extended P-field present
+ *   6..4  Time code identification (1=1958 January 1, 2=Agency defined)
+ *   3..2  Number of coarse time octets - 1
+ *   1..0  Number of fine time octets
+ * P-field, extended octet:
+ *   7     INIT, used by SPWCUC to force initialization of time slaves
+ *   6..5  Additional coarse time octets
+ *   4..2  Additional fine time octets
+ *
+ * All fields are encoded octet by octet, the code is independent of host
+ * endianess and runs both on LEON and on Linux hosts.
+ */
+
+#define CUC_COARSE_MAX	7	/* 4 + 3 additional octets */
+#define CUC_FINE_MAX	10	/* 3 + 7 additional octets */
+#define CUC_PFIELD_MAX	2
+#define CUC_TFIELD_MAX	(CUC_COARSE_MAX + CUC_FINE_MAX)
+#define CUCTP_MAX	(2 + CUC_PFIELD_MAX + CUC_TFIELD_MAX + 1)
+
+struct cuc_pfield {
+	unsigned char tid;	/* Time code identification */
+	unsigned char coarse;	/* Coarse time octets, 1..7 */
+	unsigned char fine;	/* Fine time octets, 0..10 */
+	unsigned char ext;	/* Extended P-field present, set automatically when needed */
+	unsigned char init;	/* INIT flag in extended P-field */
+};
+
+/* Time value. Fine time is a binary fraction of a second aligned to the
+ * MSB of 'fine', so that the same time can be encoded with different fine
+ * octet widths. Fine octets beyond 8 are encoded as zero and ignored when
+ * decoding.
+ */
+struct cuc_time {
+	uint64_t coarse;
+	uint64_t fine;
+};
+
+/* Convert between cuc_time and a raw right-aligned time value as read from
+ * SPWCUC/GRCTM ET registers, where the lowest 8*pf->fine bits are fine time
+ * and the following 8*pf->coarse bits are coarse time.
+ */
+void cuc_time_from_raw(struct cuc_time *t, const struct cuc_pfield *pf, uint64_t raw);
+uint64_t cuc_time_to_raw(const struct cuc_time *t, const struct cuc_pfield *pf);
+
+/* Returns number of P-field octets written, or negative for invalid widths */
+int cuc_pfield_encode(const struct cuc_pfield *pf, unsigned char *buf);
+
+/* Returns number of P-field octets read, or negative if invalid */
+int cuc_pfield_decode(const unsigned char *buf, int len, struct cuc_pfield *pf);
+
+/* Returns number of T-field octets written/read */
+int cuc_tfield_encode(const struct cuc_pfield *pf, const struct cuc_time *t, unsigned char *buf);
+int cuc_tfield_decode(const struct cuc_pfield *pf, const unsigned char *buf, int len, struct cuc_time *t);
+
+/* Create a CUCTP packet including CRC. Returns packet length, or negative
+ * if the P-field is invalid or the packet does not fit into maxlen.
+ */
+int cuctp_encode(
+	unsigned char dla,
+	unsigned char pid,
+	const struct cuc_pfield *pf,
+	const struct cuc_time *t,
+	unsigned char *buf,
+	int maxlen);
+
+/* Create the same CUCTP packet to 'cnt' destinations. Packet i is written to
+ * bufs + i*stride. The P and T fields are encoded once, only DLA and CRC
+ * are calculated per destination. Returns packet length or negative.
+ */
+int cuctp_encode_batch(
+	const unsigned char *dlas,
+	int cnt,
+	unsigned char pid,
+	const struct cuc_pfield *pf,
+	const struct cuc_time *t,
+	unsigned char *bufs,
+	int stride);
+
+/* Decode a CUCTP packet. dla and pid may be NULL.
+ *
+ * Return
+ *  >0  Packet length
+ *  -1  Packet too short or invalid P-field
+ *  -2  CRC error
+ */
+int cuctp_decode(
+	const unsigned char *buf,
+	int len,
+	unsigned char *dla,
+	unsigned char *pid,
+	struct cuc_pfield *pf,
+	struct cuc_time *t);
+
+#endif
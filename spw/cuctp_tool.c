@@ -0,0 +1,363 @@
+/* Linux tool for CUC Time-Packets, see cuc.c
+ *
+ *  cuctp_tool -v [COUNT]   Round-trip verification of all coarse/fine octet
+ *                          widths followed by an encode/decode benchmark
+ *  cuctp_tool FILE         Decode all time packets in a capture file and
+ *                          print them as text, one packet per line
+ *  cuctp_tool -s HOST:PORT [COUNT]
+ *                          Send COUNT time packets, one per millisecond, to
+ *                          the node emulator spwnode.c, which counts them
+ *
+ * The capture file is a sequence of records, each record is a 2-byte big
+ * endian packet length followed by the SpaceWire packet. Packets that are
+ * not CUC Time-Packets (wrong PID or CRC) are counted and skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "cuc.h"
+#include "rmap_crc.h"
+#include "spw_pkt.h"
+#include "spw_link.h"
+
+#define CUCTP_PID 0xfe	/* Same default PID as in ../1553/time.c */
+#define NODE_ADDR 0x20	/* Default address of spwnode */
+#define SEND_PERIOD_US 1000
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+uint64_t rand64(void)
+{
+	return ((uint64_t)rand() << 62) ^ ((uint64_t)rand() << 31) ^ rand();
+}
+
+/* Mask time to what can be represented with the P-field widths */
+void cuc_time_mask(struct cuc_time *t, const struct cuc_pfield *pf)
+{
+	if ( pf->coarse < 8 )
+		t->coarse &= ((uint64_t)1 << (8 * pf->coarse)) - 1;
+	if ( pf->fine == 0 )
+		t->fine = 0;
+	else if ( pf->fine < 8 )
+		t->fine &= ~(((uint64_t)1 << (64 - 8 * pf->fine)) - 1);
+}
+
+int verify_one(struct cuc_pfield *pf, struct cuc_time *t)
+{
+	unsigned char pkt[CUCTP_MAX], dla, pid;
+	unsigned char dlas[3] = {0x20, 0x41, 0xfe};
+	unsigned char bpkt[3][CUCTP_MAX];
+	struct cuc_pfield pf2;
+	struct cuc_time t2;
+	int len, len2, i;
+
+	len = cuctp_encode(0xfe, CUCTP_PID, pf, t, pkt, sizeof(pkt));
+	if ( len < 0 ) {
+		printf("encode failed: coarse=%d fine=%d\n", pf->coarse, pf->fine);
+		return 1;
+	}
+	len2 = cuctp_decode(pkt, len, &dla, &pid, &pf2, &t2);
+	if ( len2 != len || dla != 0xfe || pid != CUCTP_PID ||
+	     pf2.tid != pf->tid || pf2.coarse != pf->coarse ||
+	     pf2.fine != pf->fine || pf2.init != pf->init ||
+	     t2.coarse != t->coarse || t2.fine != t->fine ) {
+		printf("round-trip failed: coarse=%d fine=%d init=%d len=%d/%d\n",
+			pf->coarse, pf->fine, pf->init, len, len2);
+		return 1;
+	}
+
+	/* Raw ET conversion, when the time fits in 64 bits */
+	if ( pf->coarse + pf->fine <= 8 ) {
+		cuc_time_from_raw(&t2, pf, cuc_time_to_raw(t, pf));
+		if ( t2.coarse != t->coarse || t2.fine != t->fine ) {
+			printf("raw conversion failed: coarse=%d fine=%d\n",
+				pf->coarse, pf->fine);
+			return 1;
+		}
+	}
+
+	/* Corrupted packet must be detected */
+	pkt[len-2] ^= 0x10;
+	if ( cuctp_decode(pkt, len, NULL, NULL, &pf2, &t2) != -2 ) {
+		printf("CRC error not detected: coarse=%d fine=%d\n",
+			pf->coarse, pf->fine);
+		return 1;
+	}
+	pkt[len-2] ^= 0x10;
+
+	/* Batch mode must produce the same packets as single encoding */
+	if ( cuctp_encode_batch(dlas, 3, CUCTP_PID, pf, t, bpkt[0], CUCTP_MAX) != len ) {
+		printf("batch encode failed: coarse=%d fine=%d\n", pf->coarse, pf->fine);
+		return 1;
+	}
+	for (i=0; i<3; i++) {
+		cuctp_encode(dlas[i], CUCTP_PID, pf, t, pkt, sizeof(pkt));
+		if ( memcmp(pkt, bpkt[i], len) != 0 ) {
+			printf("batch packet %d differs: coarse=%d fine=%d\n",
+				i, pf->coarse, pf->fine);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int verify(int count)
+{
+	struct cuc_pfield pf;
+	struct cuc_time t;
+	unsigned char pkt[CUCTP_MAX];
+	uint64_t raw;
+	int coarse, fine, i, errs;
+
+	errs = 0;
+	memset(&pf, 0, sizeof(pf));
+	pf.tid = 2;
+	for (coarse=1; coarse<=CUC_COARSE_MAX; coarse++) {
+		for (fine=0; fine<=CUC_FINE_MAX; fine++) {
+			pf.coarse = coarse;
+			pf.fine = fine;
+			for (i=0; i<count; i++) {
+				pf.init = i & 1;
+				pf.ext = (i >> 1) & 1;
+				t.coarse = rand64();
+				t.fine = rand64();
+				if ( i == 0 ) {
+					t.coarse = t.fine = 0;
+				} else if ( i == 1 ) {
+					t.coarse = t.fine = ~(uint64_t)0;
+				}
+				cuc_time_mask(&t, &pf);
+				errs += verify_one(&pf, &t);
+				if ( errs > 10 )
+					return errs;
+			}
+		}
+	}
+
+	/* Must be byte-identical to the SPWCUC default format used by
+	 * spwcuc_create_cuctp_packet(): 4 coarse, 3 fine, extended P-field.
+	 */
+	pf.tid = 1;
+	pf.coarse = 4;
+	pf.fine = 3;
+	pf.ext = 1;
+	pf.init = 1;
+	raw = 0x0123456789abcdefULL;
+	cuc_time_from_raw(&t, &pf, raw);
+	if ( cuctp_encode(254, 254, &pf, &t, pkt, 12) != 12 ||
+	     pkt[2] != 0x9f || pkt[3] != 0x80 ||
+	     memcmp(&pkt[4], "\x23\x45\x67\x89\xab\xcd\xef", 7) != 0 ||
+	     pkt[11] != rmap_crc(pkt, 11) ) {
+		printf("SPWCUC default packet format differs\n");
+		errs++;
+	}
+
+	return errs;
+}
+
+void bench(int count)
+{
+	struct cuc_pfield pf;
+	struct cuc_time t, t2;
+	unsigned char *pkts, dlas[256];
+	int i, n, len, rounds;
+	double tm;
+	volatile int sink = 0;
+
+	pf.tid = 1;
+	pf.coarse = 4;
+	pf.fine = 3;
+	pf.ext = 1;
+	pf.init = 0;
+	t.coarse = 0x12345678;
+	t.fine = 0x9abcde0000000000ULL;
+	for (i=0; i<256; i++)
+		dlas[i] = i;
+	pkts = malloc(256 * 16);
+	rounds = count / 256 + 1;
+
+	tm = now();
+	for (n=0; n<rounds*256; n++) {
+		t.coarse++;
+		sink += cuctp_encode(n, CUCTP_PID, &pf, &t, &pkts[(n & 255) * 16], 16);
+	}
+	tm = now() - tm;
+	printf("encode:       %8.2f Mpkt/s\n", rounds * 256 / tm / 1e6);
+
+	tm = now();
+	for (n=0; n<rounds; n++) {
+		t.coarse++;
+		sink += cuctp_encode_batch(dlas, 256, CUCTP_PID, &pf, &t, pkts, 16);
+	}
+	tm = now() - tm;
+	printf("encode batch: %8.2f Mpkt/s\n", rounds * 256 / tm / 1e6);
+
+	len = cuctp_encode(0xfe, CUCTP_PID, &pf, &t, pkts, 16);
+	tm = now();
+	for (n=0; n<rounds*256; n++) {
+		sink += cuctp_decode(pkts, len, NULL, NULL, &pf, &t2);
+		pkts[4] = t2.coarse;
+	}
+	tm = now() - tm;
+	printf("decode:       %8.2f Mpkt/s\n", rounds * 256 / tm / 1e6);
+
+	free(pkts);
+	(void)sink;
+}
+
+int decode_file(char *filename)
+{
+	FILE *f;
+	unsigned char hdr[2], pkt[65536], dla, pid;
+	struct cuc_pfield pf;
+	struct cuc_time t;
+	unsigned int len, cnt, skipped;
+	int ret;
+
+	f = fopen(filename, "rb");
+	if ( f == NULL ) {
+		perror(filename);
+		return -1;
+	}
+
+	cnt = skipped = 0;
+	while ( fread(hdr, 1, 2, f) == 2 ) {
+		len = hdr[0] << 8 | hdr[1];
+		if ( fread(pkt, 1, len, f) != len ) {
+			printf("Truncated record\n");
+			break;
+		}
+		if ( len < 2 || pkt[1] != CUCTP_PID ) {
+			skipped++;
+			continue;
+		}
+		ret = cuctp_decode(pkt, len, &dla, &pid, &pf, &t);
+		if ( ret < 0 ) {
+			skipped++;
+			continue;
+		}
+		printf("%u: DLA=0x%02x TID=%d INIT=%d C%d F%d %llu.%016llx\n",
+			cnt, dla, pf.tid, pf.init, pf.coarse, pf.fine,
+			(unsigned long long)t.coarse, (unsigned long long)t.fine);
+		cnt++;
+	}
+	fclose(f);
+
+	printf("%u time packets, %u other packets skipped\n", cnt, skipped);
+
+	return 0;
+}
+
+/* Send count time packets of the current time to a node */
+int send_node(char *server, int count)
+{
+	struct cuc_pfield pf;
+	struct cuc_time t;
+	struct spw_list txl, done;
+	struct spw_pkt *pkt;
+	spw_pool_t pool;
+	spw_link_t link;
+	char *port;
+	double tm;
+	int fd, i, sent = 0;
+
+	port = strchr(server, ':');
+	if ( !port ) {
+		printf("Give the node as HOST:PORT\n");
+		return -1;
+	}
+	*port++ = '\0';
+	pool = spw_pool_create(16, CUCTP_MAX);
+	fd = pool ? spw_sock_connect(server, atoi(port)) : -1;
+	link = (fd < 0) ? NULL : spw_link_sock(fd, 16);
+	if ( !link )
+		return -1;
+
+	memset(&pf, 0, sizeof(pf));
+	pf.tid = 1;
+	pf.coarse = 4;
+	pf.fine = 3;
+	spw_list_init(&txl);
+	spw_list_init(&done);
+	for (i=0; i<count; i++) {
+		pkt = spw_pool_get(pool);
+		if ( pkt ) {
+			tm = now();
+			t.coarse = (uint64_t)tm;
+			t.fine = (uint64_t)((tm - (uint64_t)tm) * 4294967296.0) << 32;
+			cuc_time_mask(&t, &pf);
+			pkt->dlen = cuctp_encode(NODE_ADDR, CUCTP_PID, &pf, &t,
+					pkt->data, CUCTP_MAX);
+			spw_list_add(&txl, pkt);
+		}
+		if ( spw_link_send(link, &txl) < 0 )
+			break;
+		spw_link_reclaim(link, &done);
+		sent += done.cnt;
+		spw_pool_put_list(&done);
+		usleep(SEND_PERIOD_US);
+	}
+
+	/* Wait until the socket took the last ones */
+	tm = now();
+	while ( (sent < count) && (now() - tm < 1.0) ) {
+		spw_link_send(link, &txl);
+		spw_link_reclaim(link, &done);
+		sent += done.cnt;
+		spw_pool_put_list(&done);
+		if ( spw_link_sock_wait(link, 10000) < 0 )
+			break;
+	}
+	spw_pool_put_list(&txl);
+	spw_link_close(link);
+	close(fd);
+
+	printf("%d time packets sent to node %s:%s, address 0x%02x\n",
+		sent, server, port, NODE_ADDR);
+	return (sent == count) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+	int count;
+
+	if ( argc < 2 ) {
+		printf("usage: %s -v [COUNT] | -s HOST:PORT [COUNT] | FILE\n", argv[0]);
+		return -1;
+	}
+
+	if ( (strcmp(argv[1], "-s") == 0) && (argc > 2) ) {
+		count = 100;
+		if ( argc > 3 )
+			count = atoi(argv[3]);
+		return send_node(argv[2], count);
+	}
+
+	if ( strcmp(argv[1], "-v") == 0 ) {
+		count = 1000;
+		if ( argc > 2 )
+			count = atoi(argv[2]);
+		if ( count < 4 )
+			count = 4;
+		srand(1);
+		if ( verify(count) ) {
+			printf("VERIFICATION FAILED\n");
+			return -1;
+		}
+		printf("Round-trip verification of all widths: OK\n\n");
+		bench(count * 100);
+		return 0;
+	}
+
+	return decode_file(argv[1]);
+}
@@ -0,0 +1,467 @@
+/* Pipelined RMAP initiator, see rmap.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+
+#include "rmap.h"
+#include "rmap_crc.h"
+
+#define SLOT_NONE	-1
+
+#define SLOT_FREE	0
+#define SLOT_ACTIVE	1	/* Command sent, waiting for reply */
+#define SLOT_DONE	2	/* Completed, not yet returned by rmap_poll() */
+
+/* A request in flight. Active slots are linked in submit order, so the
+ * oldest is the first to time out.
+ */
+struct rmap_slot {
+	struct rmap_req *req;
+	unsigned short tid;
+	unsigned short gen;
+	int state;
+	unsigned int t_submit;
+	short prev, next;
+};
+
+struct rmap_s {
+	spw_link_t link;
+	spw_pool_t pool;
+	struct rmap_cfg cfg;
+	int max_window;		/* max_outstanding at create */
+	int nslots;		/* Power of two */
+	int slot_bits;
+	struct rmap_slot *slots;
+	short *free;		/* Stack of free slots */
+	int nfree;
+	short head, tail;	/* Active slots, oldest first */
+	short *done;		/* Ring of completed slots */
+	int done_head, done_tail, done_cnt;
+	int posted;
+	struct spw_list txl;	/* Commands built, not taken by the link */
+	struct rmap_stats stats;
+};
+
+void rmap_default_cfg(struct rmap_cfg *cfg){
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->src_addr = 0xfe;
+	cfg->max_outstanding = 32;
+	cfg->timeout_us = 100000;
+	cfg->rx_posted = 32;
+}
+
+/* Only window of the slots are used, all of them free */
+static void set_window(rmap_t rmap, int window)
+{
+	int i;
+
+	rmap->cfg.max_outstanding = window;
+	rmap->nfree = 0;
+	for (i=window-1; i>=0; i--)
+		rmap->free[rmap->nfree++] = i;
+}
+
+rmap_t rmap_create(spw_link_t link, spw_pool_t pool, struct rmap_cfg *cfg){
+	rmap_t rmap;
+
+	if ( !link || !pool || (cfg->max_outstanding < 1) ||
+	     (cfg->max_outstanding > 256) || (cfg->rx_posted < 0) )
+		return NULL;
+	rmap = calloc(1, sizeof(*rmap));
+	if ( !rmap )
+		return NULL;
+	rmap->link = link;
+	rmap->pool = pool;
+	rmap->cfg = *cfg;
+	rmap->max_window = cfg->max_outstanding;
+	for (rmap->nslots=1; rmap->nslots<cfg->max_outstanding; rmap->nslots<<=1)
+		rmap->slot_bits++;
+	rmap->slots = calloc(rmap->nslots, sizeof(struct rmap_slot));
+	rmap->free = malloc(rmap->nslots * sizeof(short));
+	rmap->done = malloc(rmap->nslots * sizeof(short));
+	if ( !rmap->slots || !rmap->free || !rmap->done ) {
+		printf("rmap_create: failed to allocate %d slots\n", rmap->nslots);
+		rmap_free(rmap);
+		return NULL;
+	}
+	set_window(rmap, cfg->max_outstanding);
+	rmap->head = rmap->tail = SLOT_NONE;
+	spw_list_init(&rmap->txl);
+	return rmap;
+}
+
+int rmap_set_window(rmap_t rmap, int window){
+	if ( (window < 1) || (window > rmap->max_window) ||
+	     (rmap_inflight(rmap) != 0) )
+		return -1;
+	set_window(rmap, window);
+	return 0;
+}
+
+void rmap_free(rmap_t rmap){
+	if ( !rmap )
+		return;
+	spw_pool_put_list(&rmap->txl);
+	free(rmap->slots);
+	free(rmap->free);
+	free(rmap->done);
+	free(rmap);
+}
+
+int rmap_cmd_build(struct rmap_req *req, unsigned short tid,
+	unsigned char src_addr, unsigned char *buf, int maxlen){
+	unsigned int len = req->write ? req->len : 0;
+
+	if ( (req->len > RMAP_DATA_MAX) ||
+	     (RMAP_CMD_HDR + len + (req->write ? 1 : 0) > (unsigned int)maxlen) )
+		return -1;
+
+	buf[0] = req->dst_addr;
+	buf[1] = RMAP_PID;
+	buf[2] = RMAP_INS_CMD | RMAP_INS_REPLY |
+		(req->flags & (RMAP_INS_VERIFY | RMAP_INS_INC)) |
+		(req->write ? RMAP_INS_WRITE : 0);
+	buf[3] = req->key;
+	buf[4] = src_addr;
+	buf[5] = tid >> 8;
+	buf[6] = tid;
+	buf[7] = req->ext_addr;
+	buf[8] = req->addr >> 24;
+	buf[9] = req->addr >> 16;
+	buf[10] = req->addr >> 8;
+	buf[11] = req->addr;
+	buf[12] = req->len >> 16;
+	buf[13] = req->len >> 8;
+	buf[14] = req->len;
+	buf[15] = rmap_crc(buf, 15);
+	if ( !req->write )
+		return RMAP_CMD_HDR;
+	memcpy(&buf[RMAP_CMD_HDR], req->buf, len);
+	buf[RMAP_CMD_HDR + len] = rmap_crc(&buf[RMAP_CMD_HDR], len);
+	return RMAP_CMD_HDR + len + 1;
+}
+
+static void slot_unlink(rmap_t rmap, int i)
+{
+	struct rmap_slot *s = &rmap->slots[i];
+
+	if ( s->prev == SLOT_NONE )
+		rmap->head = s->next;
+	else
+		rmap->slots[s->prev].next = s->next;
+	if ( s->next == SLOT_NONE )
+		rmap->tail = s->prev;
+	else
+		rmap->slots[s->next].prev = s->prev;
+}
+
+/* Complete an active request, it is returned by the next rmap_poll() */
+static void slot_complete(rmap_t rmap, int i, int result)
+{
+	struct rmap_slot *s = &rmap->slots[i];
+
+	slot_unlink(rmap, i);
+	s->state = SLOT_DONE;
+	s->req->result = result;
+	s->req->rtt_us = spw_time_us() - s->t_submit;
+	rmap->done[rmap->done_head] = i;
+	rmap->done_head = (rmap->done_head + 1) & (rmap->nslots - 1);
+	rmap->done_cnt++;
+}
+
+int rmap_submit(rmap_t rmap, struct rmap_req *reqs, int cnt){
+	struct rmap_req *req;
+	struct rmap_slot *s;
+	struct spw_pkt *pkt;
+	unsigned short tid;
+	int i, n, len, inflight;
+
+	for (n=0; (n<cnt) && rmap->nfree; n++) {
+		req = &reqs[n];
+		/* Read replies must fit into the receive buffers too */
+		if ( !req->write && (RMAP_READ_REPLY_HDR + req->len + 1 >
+		                     (unsigned int)spw_pool_size(rmap->pool)) )
+			return n ? n : RMAP_ERR_INVALID;
+		pkt = spw_pool_get(rmap->pool);
+		if ( !pkt )
+			break;
+		i = rmap->free[rmap->nfree - 1];
+		s = &rmap->slots[i];
+		tid = ((s->gen + 1) << rmap->slot_bits) | i;
+		len = rmap_cmd_build(req, tid, rmap->cfg.src_addr, pkt->data,
+				spw_pool_size(rmap->pool));
+		if ( len < 0 ) {
+			spw_pool_put(pkt);
+			return n ? n : RMAP_ERR_INVALID;
+		}
+		pkt->dlen = len;
+		pkt->hlen = 0;
+		pkt->pkt_id = tid;
+		spw_list_add(&rmap->txl, pkt);
+
+		rmap->nfree--;
+		s->gen++;
+		s->tid = tid;
+		s->req = req;
+		s->state = SLOT_ACTIVE;
+		s->t_submit = spw_time_us();
+		s->prev = rmap->tail;
+		s->next = SLOT_NONE;
+		if ( rmap->tail == SLOT_NONE )
+			rmap->head = i;
+		else
+			rmap->slots[rmap->tail].next = i;
+		rmap->tail = i;
+		req->result = RMAP_PENDING;
+		req->status = 0;
+
+		rmap->stats.cmds++;
+		if ( req->write )
+			rmap->stats.tx_bytes += req->len;
+	}
+
+	inflight = rmap->cfg.max_outstanding - rmap->nfree;
+	if ( inflight > (int)rmap->stats.max_inflight )
+		rmap->stats.max_inflight = inflight;
+	if ( n )
+		spw_link_send(rmap->link, &rmap->txl);
+	return n;
+}
+
+/* Active slot of a transaction ID, negative if none */
+static int tid_slot(rmap_t rmap, unsigned short tid)
+{
+	int i = tid & (rmap->nslots - 1);
+
+	if ( (i >= rmap->cfg.max_outstanding) || (rmap->slots[i].state != SLOT_ACTIVE) ||
+	     (rmap->slots[i].tid != tid) )
+		return -1;
+	return i;
+}
+
+static void rmap_reply(rmap_t rmap, struct spw_pkt *pkt)
+{
+	unsigned char *p = pkt->data;
+	struct rmap_req *req;
+	unsigned int len;
+	int i, write;
+
+	if ( (pkt->dlen < RMAP_WRITE_REPLY_LEN) || (p[0] != rmap->cfg.src_addr) ||
+	     (p[1] != RMAP_PID) || (p[2] & RMAP_INS_CMD) ||
+	     (pkt->flags & (SPW_RXPKT_EEP | SPW_RXPKT_TRUNK)) ) {
+		rmap->stats.bad++;
+		return;
+	}
+	write = p[2] & RMAP_INS_WRITE;
+	len = write ? RMAP_WRITE_REPLY_LEN - 1 : RMAP_READ_REPLY_HDR - 1;
+	if ( write ? (pkt->dlen != RMAP_WRITE_REPLY_LEN) : (pkt->dlen < len + 1) ) {
+		rmap->stats.bad++;
+		return;
+	}
+	/* The transaction ID of a corrupt header is not trusted, the command
+	 * times out.
+	 */
+	if ( rmap_crc(p, len) != p[len] ) {
+		rmap->stats.crc_errs++;
+		return;
+	}
+	i = tid_slot(rmap, (p[5] << 8) | p[6]);
+	if ( i < 0 ) {
+		rmap->stats.late++;
+		return;
+	}
+	/* A reply from another target carrying a reused transaction ID is not
+	 * the reply to this command, which is left to complete or time out.
+	 */
+	req = rmap->slots[i].req;
+	if ( p[4] != req->dst_addr ) {
+		rmap->stats.late++;
+		return;
+	}
+	rmap->stats.replies++;
+	req->status = p[3];
+	if ( !write != !req->write ) {
+		rmap->stats.bad++;
+		slot_complete(rmap, i, RMAP_ERR_REPLY);
+		return;
+	}
+	if ( p[3] != RMAP_ST_OK ) {
+		rmap->stats.errors++;
+		slot_complete(rmap, i, RMAP_ERR_STATUS);
+		return;
+	}
+	if ( write ) {
+		slot_complete(rmap, i, RMAP_OK);
+		return;
+	}
+
+	len = (p[8] << 16) | (p[9] << 8) | p[10];
+	if ( (len != req->len) || (pkt->dlen != RMAP_READ_REPLY_HDR + len + 1) ) {
+		rmap->stats.bad++;
+		slot_complete(rmap, i, RMAP_ERR_REPLY);
+		return;
+	}
+	p += RMAP_READ_REPLY_HDR;
+	if ( rmap_crc(p, len) != p[len] ) {
+		rmap->stats.crc_errs++;
+		slot_complete(rmap, i, RMAP_ERR_CRC);
+		return;
+	}
+	memcpy(req->buf, p, len);
+	rmap->stats.rx_bytes += len;
+	slot_complete(rmap, i, RMAP_OK);
+}
+
+void rmap_input(rmap_t rmap, struct spw_list *pkts){
+	struct spw_pkt *pkt;
+
+	while ( (pkt = spw_list_take(pkts)) ) {
+		rmap_reply(rmap, pkt);
+		spw_pool_put(pkt);
+	}
+}
+
+/* Put back sent commands, those lost to link errors complete at once */
+static void rmap_reclaim(rmap_t rmap)
+{
+	struct spw_list l;
+	struct spw_pkt *pkt;
+	int i;
+
+	spw_list_init(&l);
+	if ( spw_link_reclaim(rmap->link, &l) <= 0 )
+		return;
+	for (pkt=l.head; pkt; pkt=pkt->next) {
+		if ( !(pkt->flags & SPW_TXPKT_LINKERR) )
+			continue;
+		rmap->stats.bad++;
+		i = tid_slot(rmap, pkt->pkt_id);
+		if ( i >= 0 )
+			slot_complete(rmap, i, RMAP_ERR_LINK);
+	}
+	spw_pool_put_list(&l);
+}
+
+static void rmap_receive(rmap_t rmap)
+{
+	struct spw_list l;
+	int n;
+
+	spw_list_init(&l);
+	spw_link_refill(rmap->link, rmap->pool, &rmap->posted, rmap->cfg.rx_posted);
+	n = spw_link_recv(rmap->link, &l);
+	if ( n > 0 ) {
+		rmap->posted -= n;
+		rmap_input(rmap, &l);
+	}
+}
+
+int rmap_poll(rmap_t rmap, struct rmap_req **done, int max){
+	unsigned int now;
+	int i, n;
+
+	if ( rmap->txl.head )
+		spw_link_send(rmap->link, &rmap->txl);
+	rmap_reclaim(rmap);
+	if ( rmap->cfg.rx_posted )
+		rmap_receive(rmap);
+
+	now = spw_time_us();
+	while ( rmap->head != SLOT_NONE ) {
+		i = rmap->head;
+		if ( now - rmap->slots[i].t_submit < rmap->cfg.timeout_us )
+			break;
+		rmap->stats.timeouts++;
+		slot_complete(rmap, i, RMAP_ERR_TIMEOUT);
+	}
+
+	for (n=0; (n<max) && rmap->done_cnt; n++) {
+		i = rmap->done[rmap->done_tail];
+		rmap->done_tail = (rmap->done_tail + 1) & (rmap->nslots - 1);
+		rmap->done_cnt--;
+		done[n] = rmap->slots[i].req;
+		rmap->slots[i].state = SLOT_FREE;
+		rmap->free[rmap->nfree++] = i;
+	}
+	return n;
+}
+
+int rmap_inflight(rmap_t rmap){
+	return rmap->cfg.max_outstanding - rmap->nfree;
+}
+
+int rmap_transfer(rmap_t rmap, struct rmap_req *reqs, int cnt){
+	struct rmap_req *done[32];
+	int submitted = 0, completed = 0, failed = 0, n, i;
+
+	while ( completed < cnt ) {
+		if ( submitted < cnt ) {
+			n = rmap_submit(rmap, &reqs[submitted], cnt - submitted);
+			if ( n == RMAP_ERR_INVALID ) {
+				reqs[submitted++].result = RMAP_ERR_INVALID;
+				completed++;
+				failed++;
+				continue;
+			}
+			submitted += n;
+		}
+		n = rmap_poll(rmap, done, 32);
+		for (i=0; i<n; i++) {
+			if ( (done[i] < reqs) || (done[i] >= reqs + cnt) )
+				continue;
+			completed++;
+			if ( done[i]->result != RMAP_OK )
+				failed++;
+		}
+		if ( n == 0 )
+			sched_yield();
+	}
+	return failed;
+}
+
+int rmap_read(rmap_t rmap, unsigned char dst_addr, unsigned char key,
+	unsigned int addr, void *buf, unsigned int len){
+	struct rmap_req req;
+
+	memset(&req, 0, sizeof(req));
+	req.dst_addr = dst_addr;
+	req.key = key;
+	req.flags = RMAP_INS_INC;
+	req.addr = addr;
+	req.len = len;
+	req.buf = buf;
+	rmap_transfer(rmap, &req, 1);
+	return req.result;
+}
+
+int rmap_write(rmap_t rmap, unsigned char dst_addr, unsigned char key,
+	unsigned int addr, const void *buf, unsigned int len){
+	struct rmap_req req;
+
+	memset(&req, 0, sizeof(req));
+	req.dst_addr = dst_addr;
+	req.key = key;
+	req.write = 1;
+	req.flags = RMAP_INS_INC;
+	req.addr = addr;
+	req.len = len;
+	req.buf = (void *)buf;
+	rmap_transfer(rmap, &req, 1);
+	return req.result;
+}
+
+void rmap_get_stats(rmap_t rmap, struct rmap_stats *stats){
+	*stats = rmap->stats;
+}
+
+void rmap_stats_print(rmap_t rmap){
+	struct rmap_stats *s = &rmap->stats;
+
+	printf("RMAP: %u commands, %u replies, %u timeouts, %u late, %u errors, "
+		"%u CRC errors, %u bad\n", s->cmds, s->replies, s->timeouts,
+		s->late, s->errors, s->crc_errs, s->bad);
+	printf("RMAP: %u bytes written, %u bytes read, max %u in flight\n",
+		s->tx_bytes, s->rx_bytes, s->max_inflight);
+}
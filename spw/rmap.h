@@ -0,0 +1,179 @@
+
+#ifndef __RMAP_H__
+#define __RMAP_H__
+
+/* Pipelined RMAP initiator
+ *
+ * RMAP (ECSS-E-ST-50-52C) reads and writes the memory of a remote
+ * SpaceWire node. Waiting for every reply before sending the next command
+ * limits the throughput to one transfer per round trip, so the initiator
+ * keeps up to max_outstanding commands in flight. Every command gets a
+ * transaction ID, replies are matched by it in whatever order they come.
+ *
+ * A transaction ID is the slot number of the command in the low bits and
+ * a generation count in the high bits, so a reply arriving after its
+ * command timed out and the slot was reused is recognised as late and
+ * dropped.
+ *
+ * Requests are described by struct rmap_req owned by the caller. They are
+ * submitted in batches with rmap_submit() and come back completed from
+ * rmap_poll(), with result 0 or a negative RMAP_ERR_ code. Commands that
+ * are not answered within timeout_us complete with RMAP_ERR_TIMEOUT.
+ * rmap_transfer() does both for a batch and returns when all requests of
+ * it completed, rmap_read() and rmap_write() for a single access.
+ *
+ * Replies are read from the link by the initiator itself when rx_posted
+ * is non-zero. With rx_posted zero the application hands RMAP replies to
+ * rmap_input(), for example from a spw_demux queue of SPW_PID_RMAP, when
+ * the link carries other traffic too.
+ *
+ * Commands use logical addressing, the target replies to src_addr.
+ * Replies addressed elsewhere are counted as bad, replies from another
+ * target than the command went to as late. Write data is copied into the
+ * command packet, read data out of the reply packet, so the pool buffers
+ * must hold the largest access plus the RMAP header. An initiator is used
+ * by one task.
+ */
+
+#include "spw_pkt.h"
+#include "spw_link.h"
+
+#define RMAP_PID		0x01
+
+/* Instruction field */
+#define RMAP_INS_CMD		0x40	/* Packet type command, 0 is reply */
+#define RMAP_INS_WRITE		0x20
+#define RMAP_INS_VERIFY		0x10	/* Write: verify data before writing */
+#define RMAP_INS_REPLY		0x08
+#define RMAP_INS_INC		0x04	/* Incrementing address */
+#define RMAP_INS_RPLEN		0x03	/* Reply address length / 4 */
+
+#define RMAP_CMD_HDR		16	/* Command header incl. header CRC */
+#define RMAP_WRITE_REPLY_LEN	8
+#define RMAP_READ_REPLY_HDR	12
+#define RMAP_DATA_MAX		0xffffff
+
+/* Status codes of replies */
+#define RMAP_ST_OK		0
+#define RMAP_ST_GENERAL		1
+#define RMAP_ST_UNUSED_TYPE	2	/* Unused packet type or command code */
+#define RMAP_ST_INVALID_KEY	3
+#define RMAP_ST_DATA_CRC	4
+#define RMAP_ST_EARLY_EOP	5
+#define RMAP_ST_TOO_MUCH_DATA	6
+#define RMAP_ST_EEP		7
+#define RMAP_ST_VERIFY_OVERRUN	9
+#define RMAP_ST_NOT_AUTH	10	/* Command not implemented or authorised */
+#define RMAP_ST_RMW_LEN		11
+#define RMAP_ST_INVALID_ADDR	12	/* Invalid target logical address */
+
+/* Request results */
+#define RMAP_PENDING		1	/* Submitted, not completed */
+#define RMAP_OK			0
+#define RMAP_ERR_TIMEOUT	-1	/* No reply within timeout_us */
+#define RMAP_ERR_STATUS		-2	/* Target replied with status != 0 */
+#define RMAP_ERR_CRC		-3	/* Reply header or data CRC wrong */
+#define RMAP_ERR_REPLY		-4	/* Reply malformed or of wrong length */
+#define RMAP_ERR_LINK		-5	/* Command reclaimed with link error */
+#define RMAP_ERR_INVALID	-6	/* Request does not fit pool buffers */
+
+/* One read or write */
+struct rmap_req {
+	unsigned char dst_addr;	/* Target logical address */
+	unsigned char key;	/* Destination key */
+	unsigned char write;	/* 1 write, 0 read */
+	unsigned char flags;	/* RMAP_INS_VERIFY, RMAP_INS_INC */
+	unsigned char ext_addr;	/* Extended address, bits 39..32 */
+	unsigned int addr;
+	unsigned int len;
+	void *buf;		/* Data written, or read into */
+	int result;		/* RMAP_PENDING, RMAP_OK or RMAP_ERR_ */
+	unsigned char status;	/* Status of the reply */
+	unsigned int rtt_us;	/* Submit to reply */
+};
+
+struct rmap_cfg {
+	unsigned char src_addr;		/* Logical address replies go to */
+	int max_outstanding;		/* Commands in flight, 1..256 */
+	unsigned int timeout_us;
+	int rx_posted;			/* Receive buffers, 0: rmap_input() */
+};
+
+struct rmap_stats {
+	unsigned int cmds;		/* Commands sent */
+	unsigned int replies;		/* Replies matched */
+	unsigned int timeouts;
+	unsigned int late;		/* Replies to no command in flight */
+	unsigned int errors;		/* Replies with status != 0 */
+	unsigned int crc_errs;
+	unsigned int bad;		/* Malformed replies, link errors */
+	unsigned int tx_bytes;		/* Data bytes written */
+	unsigned int rx_bytes;		/* Data bytes read */
+	unsigned int max_inflight;
+};
+
+typedef struct rmap_s *rmap_t;
+
+/* Defaults: 32 commands in flight, 100 ms timeout, 32 receive buffers */
+void rmap_default_cfg(struct rmap_cfg *cfg);
+
+/* Create initiator on link, buffers from pool. NULL on failure. */
+rmap_t rmap_create(spw_link_t link, spw_pool_t pool, struct rmap_cfg *cfg);
+
+/* Change max_outstanding to window, at most the value the initiator was
+ * created with. The receive buffers posted stay with the initiator, so
+ * one initiator is used for a sweep of windows. Returns -1 while requests
+ * are in flight.
+ */
+int rmap_set_window(rmap_t rmap, int window);
+
+/* Free initiator, requests still in flight are not completed. Buffers
+ * posted at the link stay there, see spw_link.h.
+ */
+void rmap_free(rmap_t rmap);
+
+/* Build the command packet of a request into buf. Returns the packet
+ * length, or negative if it does not fit into maxlen.
+ */
+int rmap_cmd_build(struct rmap_req *req, unsigned short tid,
+	unsigned char src_addr, unsigned char *buf, int maxlen);
+
+/* Submit up to cnt requests. Returns the number submitted, fewer when
+ * max_outstanding requests are in flight or not yet returned by
+ * rmap_poll() or the pool is empty. Stops before an invalid request,
+ * returns RMAP_ERR_INVALID if the first is. Never blocks.
+ */
+int rmap_submit(rmap_t rmap, struct rmap_req *reqs, int cnt);
+
+/* Hand received RMAP replies to the initiator, pkts is empty afterwards */
+void rmap_input(rmap_t rmap, struct spw_list *pkts);
+
+/* Send commands queued, read replies when the initiator owns the receive
+ * side and time out stale commands. Up to max completed requests are
+ * stored in done. Returns the number stored, never blocks.
+ */
+int rmap_poll(rmap_t rmap, struct rmap_req **done, int max);
+
+/* Requests submitted and not yet returned by rmap_poll() */
+int rmap_inflight(rmap_t rmap);
+
+/* Run cnt requests, keeping as many in flight as allowed, and return when
+ * all completed. Returns the number of requests that failed. Requests
+ * submitted earlier and completed meanwhile are lost to rmap_poll().
+ */
+int rmap_transfer(rmap_t rmap, struct rmap_req *reqs, int cnt);
+
+/* Single access with incrementing address, waits for the reply. Returns
+ * RMAP_OK or RMAP_ERR_.
+ */
+int rmap_read(rmap_t rmap, unsigned char dst_addr, unsigned char key,
+	unsigned int addr, void *buf, unsigned int len);
+
+int rmap_write(rmap_t rmap, unsigned char dst_addr, unsigned char key,
+	unsigned int addr, const void *buf, unsigned int len);
+
+void rmap_get_stats(rmap_t rmap, struct rmap_stats *stats);
+
+void rmap_stats_print(rmap_t rmap);
+
+#endif
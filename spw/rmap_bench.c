@@ -0,0 +1,286 @@
+/* Linux benchmark of pipelined RMAP transfers
+ *
+ * An RMAP initiator writes a block of memory to a target in CHUNK sized
+ * commands and reads it back, once for every window of commands in
+ * flight. The target answers each command after a latency with random
+ * jitter, as a remote node behind routers would, so replies come back out
+ * of order. With a window of 1 every command waits for the previous reply,
+ * which bounds the throughput to one chunk per round trip.
+ *
+ * By default the target is an rmap_target on the other end of a
+ * spw_link_loop() pair, run in the same thread. With -l a share of the
+ * commands is dropped before the target to exercise the timeouts. With -s
+ * the initiator connects to spwnode instead, whose options set latency
+ * and memory; it must map MEM_SIZE bytes at MEM_BASE as it does by
+ * default.
+ *
+ * usage: rmap_bench [-l LOSS_PERMILLE] [-t LATENCY_US] [-c CHUNK]
+ *        rmap_bench -s HOST:PORT [-c CHUNK]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "spw_pkt.h"
+#include "spw_link.h"
+#include "rmap.h"
+#include "rmap_target.h"
+
+#define POOL_CNT	1024
+#define POOL_SIZE	2048
+#define RING_DEPTH	128
+#define MEM_BASE	0x40000000
+#define MEM_SIZE	(1024 * 1024)
+#define REQS_MAX	(MEM_SIZE / 16)
+
+static int windows[] = {1, 2, 4, 8, 16, 32, 64, 128};
+#define WINDOW_CNT (sizeof(windows)/sizeof(int))
+
+struct target {
+	spw_link_t link;	/* Target end, NULL with -s */
+	spw_link_t peer;	/* Initiator end */
+	spw_pool_t pool;
+	rmap_target_t rmap;
+	int posted;
+	unsigned int loss;	/* Permille of commands dropped */
+	struct spw_list txl;
+};
+
+static unsigned char mem[MEM_SIZE];
+static unsigned char mem_init[MEM_SIZE];
+static unsigned char mem_read[MEM_SIZE];
+static struct rmap_req reqs[REQS_MAX];
+static unsigned char wr_ok[REQS_MAX];
+
+/* Receive commands, send the replies whose latency is over. With -s wait
+ * a while for the remote node instead.
+ */
+static void target_step(struct target *t, int idle)
+{
+	struct spw_list l, cmds;
+	struct spw_pkt *pkt;
+	int n;
+
+	if ( !t->link ) {
+		if ( idle )
+			spw_link_sock_wait(t->peer, 1000);
+		return;
+	}
+	spw_list_init(&l);
+	spw_list_init(&cmds);
+	spw_link_refill(t->link, t->pool, &t->posted, RING_DEPTH / 2);
+	n = spw_link_recv(t->link, &l);
+	if ( n > 0 )
+		t->posted -= n;
+	while ( (pkt = spw_list_take(&l)) ) {
+		if ( (unsigned int)(rand() % 1000) < t->loss )
+			spw_pool_put(pkt);
+		else
+			spw_list_add(&cmds, pkt);
+	}
+	rmap_target_input(t->rmap, &cmds);
+	rmap_target_output(t->rmap, &t->txl);
+	spw_link_send(t->link, &t->txl);
+	spw_link_reclaim(t->link, &l);
+	spw_pool_put_list(&l);
+}
+
+/* Let the initiator read late replies after a window, it drops them */
+static void drain(rmap_t rmap, struct target *t, unsigned int us)
+{
+	struct rmap_req *done[1];
+	unsigned int t0 = spw_time_us();
+
+	while ( spw_time_us() - t0 < us ) {
+		target_step(t, 1);
+		rmap_poll(rmap, done, 1);
+	}
+}
+
+/* Run requests through the initiator while the target works. Returns the
+ * number of failed requests.
+ */
+static int run_reqs(rmap_t rmap, struct target *t, struct rmap_req *r, int cnt)
+{
+	struct rmap_req *done[64];
+	int submitted = 0, completed = 0, failed = 0, n, i;
+
+	while ( completed < cnt ) {
+		if ( submitted < cnt ) {
+			n = rmap_submit(rmap, &r[submitted], cnt - submitted);
+			if ( n < 0 ) {
+				printf("Invalid request %d\n", submitted);
+				return cnt;
+			}
+			submitted += n;
+		}
+		n = rmap_poll(rmap, done, 64);
+		for (i=0; i<n; i++) {
+			if ( done[i]->result != RMAP_OK )
+				failed++;
+		}
+		completed += n;
+		target_step(t, n == 0);
+	}
+	return failed;
+}
+
+static void setup_reqs(struct rmap_target_cfg *tcfg, int write, int chunk,
+	unsigned char *buf)
+{
+	int i;
+
+	memset(reqs, 0, sizeof(reqs));
+	for (i=0; i<MEM_SIZE/chunk; i++) {
+		reqs[i].dst_addr = tcfg->addr;
+		reqs[i].key = tcfg->key;
+		reqs[i].write = write;
+		reqs[i].flags = RMAP_INS_INC;
+		reqs[i].addr = MEM_BASE + i * chunk;
+		reqs[i].len = chunk;
+		reqs[i].buf = buf + i * chunk;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct rmap_target_cfg tcfg;
+	struct rmap_cfg cfg;
+	struct target *t;
+	spw_pool_t pool;
+	spw_link_t a, b;
+	rmap_t rmap;
+	unsigned int i, t0, t_wr, t_rd, sum;
+	int opt, chunk = 256, cnt, fail_wr, fail_rd, wrong, j, fd, ret = 0;
+	char *server = NULL, *port;
+
+	t = calloc(1, sizeof(*t));
+	if ( !t )
+		return 1;
+	rmap_target_default_cfg(&tcfg);
+	tcfg.latency_us = 20;
+	while ( (opt = getopt(argc, argv, "l:t:c:s:")) != -1 ) {
+		switch ( opt ) {
+		case 'l':
+			t->loss = atoi(optarg);
+			break;
+		case 't':
+			tcfg.latency_us = atoi(optarg);
+			break;
+		case 'c':
+			chunk = atoi(optarg);
+			break;
+		case 's':
+			server = optarg;
+			break;
+		default:
+			printf("usage: %s [-l LOSS_PERMILLE] [-t LATENCY_US] [-c CHUNK]\n"
+				"       %s -s HOST:PORT [-c CHUNK]\n", argv[0], argv[0]);
+			return 1;
+		}
+	}
+	if ( (chunk < 16) || (chunk > 1024) || (MEM_SIZE % chunk) ) {
+		printf("CHUNK must be a power of two from 16 to 1024\n");
+		return 1;
+	}
+	if ( server && t->loss ) {
+		printf("-l is not supported with -s\n");
+		return 1;
+	}
+	cnt = MEM_SIZE / chunk;
+	tcfg.jitter_us = tcfg.latency_us;
+
+	pool = spw_pool_create(POOL_CNT, POOL_SIZE);
+	if ( !pool ) {
+		printf("Failed to create pool\n");
+		return 1;
+	}
+	if ( server ) {
+		port = strchr(server, ':');
+		if ( !port ) {
+			printf("Give the node as HOST:PORT\n");
+			return 1;
+		}
+		*port++ = '\0';
+		fd = spw_sock_connect(server, atoi(port));
+		a = (fd < 0) ? NULL : spw_link_sock(fd, RING_DEPTH);
+		if ( !a )
+			return 1;
+		printf("%d KiB in %d byte commands to node %s:%s\n",
+			MEM_SIZE / 1024, chunk, server, port);
+	} else {
+		if ( spw_link_loop(RING_DEPTH, &a, &b) ) {
+			printf("Failed to create links\n");
+			return 1;
+		}
+		t->link = b;
+		t->rmap = rmap_target_create(pool, &tcfg);
+		if ( !t->rmap ||
+		     rmap_target_map(t->rmap, 0, MEM_BASE, MEM_SIZE, mem, 0) ) {
+			printf("Failed to create target\n");
+			return 1;
+		}
+		printf("%d KiB in %d byte commands, target latency %u-%u us, "
+			"%u/1000 lost\n", MEM_SIZE / 1024, chunk, tcfg.latency_us,
+			tcfg.latency_us + tcfg.jitter_us, t->loss);
+	}
+	t->peer = a;
+	t->pool = pool;
+	spw_list_init(&t->txl);
+	for (i=0; i<MEM_SIZE; i++)
+		mem_init[i] = rand();
+
+	rmap_default_cfg(&cfg);
+	cfg.max_outstanding = windows[WINDOW_CNT - 1];
+	if ( !server )
+		cfg.timeout_us = 10000 + 4 * tcfg.latency_us;
+	rmap = rmap_create(a, pool, &cfg);
+	if ( !rmap ) {
+		printf("Failed to create initiator\n");
+		return 1;
+	}
+
+	printf("window  write MB/s  read MB/s   failed  wrong  avg rtt us\n");
+	for (i=0; i<WINDOW_CNT; i++) {
+		rmap_set_window(rmap, windows[i]);
+		memset(mem_read, 0, MEM_SIZE);
+
+		setup_reqs(&tcfg, 1, chunk, mem_init);
+		t0 = spw_time_us();
+		fail_wr = run_reqs(rmap, t, reqs, cnt);
+		t_wr = spw_time_us() - t0;
+		for (j=0; j<cnt; j++)
+			wr_ok[j] = (reqs[j].result == RMAP_OK);
+
+		setup_reqs(&tcfg, 0, chunk, mem_read);
+		t0 = spw_time_us();
+		fail_rd = run_reqs(rmap, t, reqs, cnt);
+		t_rd = spw_time_us() - t0;
+
+		/* Chunks read must match what was written, failed ones excepted */
+		wrong = 0;
+		sum = 0;
+		for (j=0; j<cnt; j++) {
+			sum += reqs[j].rtt_us;
+			if ( wr_ok[j] && (reqs[j].result == RMAP_OK) &&
+			     memcmp(&mem_read[j * chunk], &mem_init[j * chunk], chunk) )
+				wrong++;
+		}
+		printf("%6d %11.1f %10.1f %8d %6d %11u\n", windows[i],
+			(double)MEM_SIZE / t_wr, (double)MEM_SIZE / t_rd,
+			fail_wr + fail_rd, wrong, sum / cnt);
+		if ( wrong || (!t->loss && (fail_wr || fail_rd)) )
+			ret = 1;
+
+		/* Let late replies arrive before the next window */
+		drain(rmap, t, 4 * tcfg.latency_us + 1000);
+	}
+	rmap_stats_print(rmap);
+	rmap_free(rmap);
+	if ( t->rmap )
+		rmap_target_stats_print(t->rmap);
+	spw_link_stats_print(a);
+	spw_pool_stats_print(pool);
+	return ret;
+}
@@ -0,0 +1,43 @@
+
+#ifndef __RMAP_CRC_H__
+#define __RMAP_CRC_H__
+
+/* RMAP CRC-8 as defined by ECSS-E-ST-50-52C, polynomial x^8+x^2+x+1
+ * processed LSB first (bit reflected) with initial value 0. The same CRC
+ * is used for RMAP headers and data, and for SpaceWire CUC Time-Packets.
+ *
+ * Several implementations are provided, they all produce the same result:
+ *  - bitwise   Table-free, for memory constrained systems
+ *  - bytewise  Classic one byte at a time lookup in a 256 byte table
+ *  - slice4    Word-at-a-time, 4 bytes per iteration, 1kB of tables
+ *  - slice8    8 bytes per iteration, 2kB of tables
+ *
+ * The crc argument is the CRC of the previous data, or 0 for the first
+ * block. It makes it possible to calculate the CRC of a packet in pieces.
+ */
+
+/* Lookup tables, table[0] is the standard RMAP CRC table. table[N] is
+ * the CRC of a byte followed by N zero bytes.
+ */
+extern const unsigned char rmap_crc_table[8][256];
+
+unsigned char rmap_crc_bitwise(unsigned char crc, const void *data, unsigned int len);
+
+unsigned char rmap_crc_bytewise(unsigned char crc, const void *data, unsigned int len);
+
+unsigned char rmap_crc_slice4(unsigned char crc, const void *data, unsigned int len);
+
+unsigned char rmap_crc_slice8(unsigned char crc, const void *data, unsigned int len);
+
+/* Fastest implementation for the CPU, slice4 on LEON and slice8 on 64-bit
+ * hosts. Very short blocks are calculated bytewise.
+ */
+unsigned char rmap_crc_update(unsigned char crc, const void *data, unsigned int len);
+
+/* CRC of a complete block, for example an RMAP header or a Time-Packet */
+static inline unsigned char rmap_crc(const void *data, unsigned int len)
+{
+	return rmap_crc_update(0, data, len);
+}
+
+#endif
@@ -0,0 +1,139 @@
+/* Linux benchmark of the RMAP CRC-8 implementations in rmap_crc.c
+ *
+ * All implementations are first verified against the table-free bitwise
+ * implementation, then the throughput of each implementation is measured
+ * for a number of packet sizes, from CUC Time-Packets (11 bytes) up to
+ * large RMAP data payloads.
+ *
+ * usage: rmap_crc_bench [MBYTES_PER_TEST]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rmap_crc.h"
+
+typedef unsigned char (*crc_func_t)(unsigned char crc, const void *data, unsigned int len);
+
+struct crc_impl {
+	char *name;
+	crc_func_t func;
+} impls[] = {
+	{"bitwise", rmap_crc_bitwise},
+	{"bytewise", rmap_crc_bytewise},
+	{"slice4", rmap_crc_slice4},
+	{"slice8", rmap_crc_slice8},
+	{"update", rmap_crc_update},
+};
+#define IMPL_CNT (sizeof(impls)/sizeof(struct crc_impl))
+
+unsigned int sizes[] = {11, 16, 64, 256, 1024, 4096, 65536};
+#define SIZE_CNT (sizeof(sizes)/sizeof(unsigned int))
+
+#define BUF_SIZE (65536 + 8)
+unsigned char buf[BUF_SIZE];
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Compare all implementations with the bitwise one, for all lengths and
+ * alignments, and in two pieces. Returns number of errors.
+ */
+int verify(void)
+{
+	int i, j, len, ofs, split, errs;
+	unsigned char ref, crc;
+
+	errs = 0;
+
+	/* Table must match polynomial */
+	for (i=0; i<256; i++) {
+		ref = i;
+		if ( rmap_crc_table[0][i] != rmap_crc_bitwise(0, &ref, 1) ) {
+			printf("Table entry %d wrong\n", i);
+			errs++;
+		}
+	}
+
+	for (len=0; len<300; len++) {
+		for (ofs=0; ofs<8; ofs++) {
+			ref = rmap_crc_bitwise(0, &buf[ofs], len);
+			for (j=1; j<IMPL_CNT; j++) {
+				crc = impls[j].func(0, &buf[ofs], len);
+				if ( crc != ref ) {
+					printf("%s: len=%d ofs=%d: 0x%02x != 0x%02x\n",
+						impls[j].name, len, ofs, crc, ref);
+					errs++;
+				}
+				split = len / 3;
+				crc = impls[j].func(0, &buf[ofs], split);
+				crc = impls[j].func(crc, &buf[ofs+split], len-split);
+				if ( crc != ref ) {
+					printf("%s: len=%d ofs=%d split=%d: 0x%02x != 0x%02x\n",
+						impls[j].name, len, ofs, split, crc, ref);
+					errs++;
+				}
+			}
+		}
+	}
+
+	return errs;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int mbytes, size, cnt, n, i, j;
+	volatile unsigned char sink;
+	unsigned char crc;
+	double t, mbps;
+
+	mbytes = 64;
+	if ( argc > 1 )
+		mbytes = atoi(argv[1]);
+	if ( mbytes < 1 )
+		mbytes = 1;
+
+	srand(1);
+	for (i=0; i<BUF_SIZE; i++)
+		buf[i] = rand();
+
+	if ( verify() ) {
+		printf("VERIFICATION FAILED\n");
+		return -1;
+	}
+	printf("Verification against bitwise CRC: OK\n\n");
+
+	printf("%-10s", "SIZE");
+	for (j=0; j<IMPL_CNT; j++)
+		printf(" %12s", impls[j].name);
+	printf("   (MB/s)\n");
+
+	for (i=0; i<SIZE_CNT; i++) {
+		size = sizes[i];
+		cnt = (mbytes * 1024 * 1024) / size;
+		printf("%-10u", size);
+		for (j=0; j<IMPL_CNT; j++) {
+			crc = 0;
+			t = now();
+			for (n=0; n<cnt; n++) {
+				/* Make every CRC depend on previous */
+				buf[0] = crc;
+				crc = impls[j].func(0, buf, size);
+			}
+			t = now() - t;
+			sink = crc;
+			mbps = ((double)cnt * size) / (t * 1024 * 1024);
+			printf(" %12.1f", mbps);
+		}
+		printf("\n");
+	}
+	(void)sink;
+
+	return 0;
+}
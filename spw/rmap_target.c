@@ -0,0 +1,372 @@
+/* RMAP target in software, see rmap_target.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rmap_target.h"
+#include "rmap_crc.h"
+
+/* Command codes, instruction bits 5..2 */
+#define CODE_READ	0x2
+#define CODE_READ_INC	0x3
+#define CODE_RMW	0x7
+
+struct rmap_map {
+	unsigned char ext_addr;
+	unsigned int addr;
+	unsigned int size;
+	unsigned char *mem;
+	int flags;
+};
+
+struct rmap_held {
+	struct spw_pkt *pkt;
+	unsigned int due;
+};
+
+struct rmap_target_s {
+	spw_pool_t pool;
+	struct rmap_target_cfg cfg;
+	struct rmap_map maps[RMAP_TARGET_MAPS];
+	int nmaps;
+	struct rmap_held *held;
+	int nheld;
+	struct rmap_target_stats stats;
+};
+
+/* A decoded command header */
+struct rmap_cmd {
+	unsigned char *pkt;
+	unsigned int len;		/* Packet length */
+	unsigned int hlen;		/* Header length incl. header CRC */
+	unsigned char ins;
+	unsigned char *rpl;		/* Reply address, leading zeros skipped */
+	int rpl_len;
+	unsigned char init_addr;
+	unsigned char ext_addr;
+	unsigned int addr;
+	unsigned int dlen;		/* Data length field */
+};
+
+void rmap_target_default_cfg(struct rmap_target_cfg *cfg){
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->addr = 0x20;
+	cfg->key = 0x20;
+	cfg->max_held = 256;
+}
+
+rmap_target_t rmap_target_create(spw_pool_t pool, struct rmap_target_cfg *cfg){
+	rmap_target_t t;
+
+	if ( !pool || (cfg->max_held < 1) )
+		return NULL;
+	t = calloc(1, sizeof(*t));
+	if ( !t )
+		return NULL;
+	t->pool = pool;
+	t->cfg = *cfg;
+	t->held = malloc(cfg->max_held * sizeof(struct rmap_held));
+	if ( !t->held ) {
+		printf("rmap_target_create: failed to allocate %d replies\n",
+			cfg->max_held);
+		free(t);
+		return NULL;
+	}
+	return t;
+}
+
+void rmap_target_free(rmap_target_t t){
+	int i;
+
+	if ( !t )
+		return;
+	for (i=0; i<t->nheld; i++)
+		spw_pool_put(t->held[i].pkt);
+	free(t->held);
+	free(t);
+}
+
+int rmap_target_map(rmap_target_t t, unsigned char ext_addr,
+	unsigned int addr, unsigned int size, void *mem, int flags){
+	struct rmap_map *m;
+
+	if ( (t->nmaps >= RMAP_TARGET_MAPS) || !mem || (size == 0) ||
+	     (addr + (size - 1) < addr) )
+		return -1;
+	m = &t->maps[t->nmaps++];
+	m->ext_addr = ext_addr;
+	m->addr = addr;
+	m->size = size;
+	m->mem = mem;
+	m->flags = flags;
+	return 0;
+}
+
+/* Memory of len bytes at the command address, NULL if not mapped */
+static unsigned char *target_mem(rmap_target_t t, struct rmap_cmd *c,
+	unsigned int len, int *flags)
+{
+	struct rmap_map *m;
+	int i;
+
+	for (i=0; i<t->nmaps; i++) {
+		m = &t->maps[i];
+		if ( (m->ext_addr == c->ext_addr) && (c->addr >= m->addr) &&
+		     (c->addr - m->addr < m->size) &&
+		     (len <= m->size - (c->addr - m->addr)) ) {
+			*flags = m->flags;
+			return m->mem + (c->addr - m->addr);
+		}
+	}
+	return NULL;
+}
+
+/* Copy between memory and buf. Non-incrementing accesses repeat on the
+ * span bytes at the address.
+ */
+static void target_copy(unsigned char *mem, unsigned int span,
+	unsigned char *buf, unsigned int len, int write)
+{
+	unsigned int i;
+
+	if ( span == len ) {
+		if ( write )
+			memcpy(mem, buf, len);
+		else
+			memcpy(buf, mem, len);
+		return;
+	}
+	for (i=0; i<len; i++) {
+		if ( write )
+			mem[i % span] = buf[i];
+		else
+			buf[i] = mem[i % span];
+	}
+}
+
+/* Decode the header. Returns 0, or -1 when the packet is to be discarded */
+static int target_decode(struct rmap_cmd *c, struct spw_pkt *pkt)
+{
+	unsigned char *p = pkt->data;
+	int o;
+
+	c->pkt = p;
+	c->len = pkt->dlen;
+	if ( (c->len < 3) || (p[1] != RMAP_PID) || !(p[2] & RMAP_INS_CMD) )
+		return -1;
+	c->ins = p[2];
+	c->hlen = RMAP_CMD_HDR + (c->ins & RMAP_INS_RPLEN) * 4;
+	if ( (c->len < c->hlen) || (rmap_crc(p, c->hlen - 1) != p[c->hlen - 1]) )
+		return -1;
+
+	/* Leading zeros of the reply address are padding */
+	c->rpl = &p[4];
+	c->rpl_len = (c->ins & RMAP_INS_RPLEN) * 4;
+	while ( (c->rpl_len > 0) && (c->rpl[0] == 0) ) {
+		c->rpl++;
+		c->rpl_len--;
+	}
+	o = 4 + (c->ins & RMAP_INS_RPLEN) * 4;
+	c->init_addr = p[o];
+	c->ext_addr = p[o + 3];
+	c->addr = (p[o + 4] << 24) | (p[o + 5] << 16) | (p[o + 6] << 8) | p[o + 7];
+	c->dlen = (p[o + 8] << 16) | (p[o + 9] << 8) | p[o + 10];
+	return 0;
+}
+
+/* Status of the data field of a write or read-modify-write command */
+static int target_data_status(struct rmap_cmd *c, struct spw_pkt *pkt)
+{
+	unsigned int need = c->hlen + c->dlen + 1;
+
+	if ( pkt->flags & SPW_RXPKT_EEP )
+		return RMAP_ST_EEP;
+	if ( c->len < need )
+		return RMAP_ST_EARLY_EOP;
+	if ( c->len > need )
+		return RMAP_ST_TOO_MUCH_DATA;
+	if ( rmap_crc(&c->pkt[c->hlen], c->dlen) != c->pkt[c->hlen + c->dlen] )
+		return RMAP_ST_DATA_CRC;
+	return RMAP_ST_OK;
+}
+
+/* Execute one command, returns the reply or NULL */
+static struct spw_pkt *target_execute(rmap_target_t t, struct rmap_cmd *c,
+	struct spw_pkt *pkt)
+{
+	struct rmap_target_stats *s = &t->stats;
+	struct spw_pkt *reply = NULL;
+	unsigned char *q = NULL, *data = NULL, *mem, *cdata;
+	unsigned char old[4];
+	unsigned int code, n, span, i;
+	int status = RMAP_ST_OK, write, flags = 0;
+
+	code = (c->ins >> 2) & 0xf;
+	write = c->ins & RMAP_INS_WRITE;
+	n = c->dlen;
+	if ( code == CODE_RMW )
+		n /= 2;		/* Data and mask */
+	cdata = &c->pkt[c->hlen];
+
+	if ( c->ins & RMAP_INS_REPLY ) {
+		if ( t->nheld < t->cfg.max_held )
+			reply = spw_pool_get(t->pool);
+		if ( !reply )
+			s->dropped++;
+		else
+			q = (unsigned char *)reply->data + c->rpl_len;
+	}
+
+	if ( !write && (code != CODE_READ) && (code != CODE_READ_INC) &&
+	     (code != CODE_RMW) )
+		status = RMAP_ST_UNUSED_TYPE;
+	else if ( c->pkt[0] != t->cfg.addr )
+		status = RMAP_ST_INVALID_ADDR;
+	else if ( c->pkt[3] != t->cfg.key )
+		status = RMAP_ST_INVALID_KEY;
+	else if ( (code == CODE_RMW) && ((c->dlen > 8) || (c->dlen & 1)) )
+		status = RMAP_ST_RMW_LEN;
+	else if ( write || (code == CODE_RMW) )
+		status = target_data_status(c, pkt);
+	else if ( reply && (c->rpl_len + RMAP_READ_REPLY_HDR + n + 1 >
+	                    (unsigned int)spw_pool_size(t->pool)) )
+		status = RMAP_ST_GENERAL;
+
+	span = ((c->ins & RMAP_INS_INC) || (n < 4)) ? n : 4;
+	mem = NULL;
+	if ( (status == RMAP_ST_OK) && (n > 0) ) {
+		mem = target_mem(t, c, span, &flags);
+		if ( !mem || ((write || (code == CODE_RMW)) && (flags & RMAP_MAP_RO)) )
+			status = RMAP_ST_NOT_AUTH;
+	}
+
+	s->cmds++;
+	if ( status != RMAP_ST_OK ) {
+		s->errors++;
+	} else if ( write ) {
+		s->writes++;
+		if ( n > 0 )
+			target_copy(mem, span, cdata, n, 1);
+		s->wr_bytes += n;
+	} else if ( code == CODE_RMW ) {
+		s->rmws++;
+		if ( n > 0 ) {
+			memcpy(old, mem, n);
+			for (i=0; i<n; i++)
+				mem[i] = (cdata[i] & cdata[n + i]) | (old[i] & ~cdata[n + i]);
+			if ( q )
+				data = old;
+		}
+		s->wr_bytes += n;
+		s->rd_bytes += n;
+	} else {
+		s->reads++;
+		if ( q ) {
+			data = q + RMAP_READ_REPLY_HDR;
+			if ( n > 0 )
+				target_copy(mem, span, data, n, 0);
+		}
+		s->rd_bytes += n;
+	}
+	if ( !q )
+		return NULL;
+
+	/* Reply: path of the reply address, then the reply header */
+	memcpy(reply->data, c->rpl, c->rpl_len);
+	q[0] = c->init_addr;
+	q[1] = RMAP_PID;
+	q[2] = c->ins & ~(RMAP_INS_CMD | 0x80);
+	q[3] = status;
+	q[4] = c->pkt[0];
+	q[5] = c->pkt[5 + (c->ins & RMAP_INS_RPLEN) * 4];
+	q[6] = c->pkt[6 + (c->ins & RMAP_INS_RPLEN) * 4];
+	reply->hlen = 0;
+	reply->flags = 0;
+	if ( write ) {
+		q[7] = rmap_crc(q, 7);
+		reply->dlen = c->rpl_len + RMAP_WRITE_REPLY_LEN;
+		return reply;
+	}
+	if ( status != RMAP_ST_OK )
+		n = 0;
+	q[7] = 0;
+	q[8] = n >> 16;
+	q[9] = n >> 8;
+	q[10] = n;
+	q[11] = rmap_crc(q, 11);
+	if ( data && (data != q + RMAP_READ_REPLY_HDR) )
+		memcpy(q + RMAP_READ_REPLY_HDR, data, n);
+	q[RMAP_READ_REPLY_HDR + n] = rmap_crc(q + RMAP_READ_REPLY_HDR, n);
+	reply->dlen = c->rpl_len + RMAP_READ_REPLY_HDR + n + 1;
+	return reply;
+}
+
+void rmap_target_input(rmap_target_t t, struct spw_list *pkts){
+	struct spw_pkt *pkt, *reply;
+	struct rmap_cmd c;
+	unsigned int delay;
+
+	while ( (pkt = spw_list_take(pkts)) ) {
+		if ( target_decode(&c, pkt) ) {
+			t->stats.discarded++;
+			spw_pool_put(pkt);
+			continue;
+		}
+		reply = target_execute(t, &c, pkt);
+		if ( reply ) {
+			delay = t->cfg.latency_us;
+			if ( t->cfg.jitter_us )
+				delay += rand() % (t->cfg.jitter_us + 1);
+			t->held[t->nheld].pkt = reply;
+			t->held[t->nheld].due = (pkt->ts ? pkt->ts : spw_time_us()) + delay;
+			t->nheld++;
+		}
+		spw_pool_put(pkt);
+	}
+}
+
+int rmap_target_output(rmap_target_t t, struct spw_list *pkts){
+	unsigned int now = spw_time_us();
+	int i, n = 0;
+
+	for (i=0; i<t->nheld; ) {
+		if ( (int)(now - t->held[i].due) < 0 ) {
+			i++;
+			continue;
+		}
+		spw_list_add(pkts, t->held[i].pkt);
+		t->held[i] = t->held[--t->nheld];
+		n++;
+	}
+	t->stats.replies += n;
+	return n;
+}
+
+int rmap_target_next_us(rmap_target_t t){
+	unsigned int now = spw_time_us();
+	int i, d, next = -1;
+
+	for (i=0; i<t->nheld; i++) {
+		d = (int)(t->held[i].due - now);
+		if ( d < 0 )
+			d = 0;
+		if ( (next < 0) || (d < next) )
+			next = d;
+	}
+	return next;
+}
+
+void rmap_target_get_stats(rmap_target_t t, struct rmap_target_stats *stats){
+	*stats = t->stats;
+}
+
+void rmap_target_stats_print(rmap_target_t t){
+	struct rmap_target_stats *s = &t->stats;
+
+	printf("RMAP target: %u commands, %u writes, %u reads, %u RMW, "
+		"%u errors\n", s->cmds, s->writes, s->reads, s->rmws, s->errors);
+	printf("RMAP target: %u replies, %u dropped, %u discarded, "
+		"%u bytes written, %u bytes read\n", s->replies, s->dropped,
+		s->discarded, s->wr_bytes, s->rd_bytes);
+}
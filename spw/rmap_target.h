@@ -0,0 +1,97 @@
+
+#ifndef __RMAP_TARGET_H__
+#define __RMAP_TARGET_H__
+
+/* RMAP target in software
+ *
+ * Executes RMAP commands (ECSS-E-ST-50-52C) on memory areas mapped by the
+ * application and builds the replies. It stands in for the RMAP target
+ * of a remote node when no hardware is at hand, see spwnode.c, and serves
+ * the initiator benchmarks.
+ *
+ * Commands are executed when handed to rmap_target_input(). Their replies
+ * are held until latency_us plus a random share of jitter_us passed since
+ * the command was received, then rmap_target_output() returns them, so
+ * replies leave in a different order than the commands came when jitter
+ * is set. Commands are checked as the standard asks: header CRC, command
+ * code, target logical address, key, address range and for writes the
+ * data length and data CRC. Errors are answered with the status code
+ * when a reply is requested. Commands with a wrong header CRC or a
+ * header cut short are discarded without reply.
+ *
+ * The whole command is in memory before it is executed, so unlike a
+ * hardware target the data CRC is checked before memory is written also
+ * for writes without verify. Non-incrementing accesses repeat on the four
+ * bytes at the address.
+ *
+ * Replies are built in buffers of the pool, which must hold the largest
+ * read plus the reply header. Replies go to the path and logical address
+ * of the command. The target is used by one task.
+ */
+
+#include "spw_pkt.h"
+#include "spw_link.h"
+#include "rmap.h"
+
+#define RMAP_TARGET_MAPS	8
+
+/* Map flags */
+#define RMAP_MAP_RO		0x1	/* Writes answered with RMAP_ST_NOT_AUTH */
+
+struct rmap_target_cfg {
+	unsigned char addr;		/* Target logical address */
+	unsigned char key;		/* Destination key */
+	unsigned int latency_us;	/* Command reception to reply */
+	unsigned int jitter_us;		/* Random delay added, 0..jitter_us */
+	int max_held;			/* Replies waiting for their latency */
+};
+
+struct rmap_target_stats {
+	unsigned int cmds;		/* Commands executed or answered */
+	unsigned int writes;
+	unsigned int reads;
+	unsigned int rmws;		/* Read-modify-writes */
+	unsigned int replies;		/* Replies sent */
+	unsigned int errors;		/* Commands failed with status != 0 */
+	unsigned int discarded;		/* Header CRC wrong, header cut or not a command */
+	unsigned int dropped;		/* Replies lost, no buffer or too many held */
+	unsigned int wr_bytes;		/* Bytes written to memory */
+	unsigned int rd_bytes;		/* Bytes read from memory */
+};
+
+typedef struct rmap_target_s *rmap_target_t;
+
+/* Defaults: address 0x20, key 0x20, no latency, 256 replies held */
+void rmap_target_default_cfg(struct rmap_target_cfg *cfg);
+
+/* Create target, replies in buffers of pool. NULL on failure. */
+rmap_target_t rmap_target_create(spw_pool_t pool, struct rmap_target_cfg *cfg);
+
+/* Free target, replies still held are put back into the pool */
+void rmap_target_free(rmap_target_t t);
+
+/* Map size bytes at mem to RMAP address ext_addr:addr. Accesses must lie
+ * within one map. Returns 0 or negative when the table is full or the
+ * area wraps the 32 bit address.
+ */
+int rmap_target_map(rmap_target_t t, unsigned char ext_addr,
+	unsigned int addr, unsigned int size, void *mem, int flags);
+
+/* Execute received commands, pkts is empty afterwards. Packets of other
+ * protocols are discarded.
+ */
+void rmap_target_input(rmap_target_t t, struct spw_list *pkts);
+
+/* Append replies whose time has come to pkts. Returns the number added. */
+int rmap_target_output(rmap_target_t t, struct spw_list *pkts);
+
+/* Microseconds until the next reply is due, 0 if one is due now, -1 if
+ * no reply is held.
+ */
+int rmap_target_next_us(rmap_target_t t);
+
+void rmap_target_get_stats(rmap_target_t t, struct rmap_target_stats *stats);
+
+void rmap_target_stats_print(rmap_target_t t);
+
+#endif
@@ -0,0 +1,426 @@
+/* SpaceWire throughput and latency benchmark, see spw_bench.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+
+#include "spw_bench.h"
+
+#define T_DATA		1
+#define T_END		2
+#define T_RESULT	3
+#define T_PING		4
+#define T_PONG		5
+#define T_QUIT		6
+
+#define CTRL_LEN	32	/* END, RESULT and QUIT packets */
+
+/* One end of the benchmark: packets to send and receive buffers posted */
+struct side {
+	spw_link_t link;
+	spw_pool_t pool;
+	struct spw_list txl;
+	int posted;
+};
+
+static void put_be32(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static unsigned int get_be32(unsigned char *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void put_hdr(unsigned char *p, unsigned char addr, int type, int step, unsigned int seq)
+{
+	p[0] = addr;
+	p[1] = SPW_BENCH_PID;
+	p[2] = type;
+	p[3] = step;
+	put_be32(&p[4], seq);
+}
+
+static void side_init(struct side *s, spw_link_t link, spw_pool_t pool)
+{
+	s->link = link;
+	s->pool = pool;
+	spw_list_init(&s->txl);
+	s->posted = 0;
+}
+
+/* Keep SPW_BENCH_RX_POSTED buffers at the receiver */
+static void side_post(struct side *s)
+{
+	spw_link_refill(s->link, s->pool, &s->posted, SPW_BENCH_RX_POSTED);
+}
+
+static int side_recv(struct side *s, struct spw_list *l)
+{
+	int n;
+
+	n = spw_link_recv(s->link, l);
+	if ( n > 0 )
+		s->posted -= n;
+	return n;
+}
+
+/* Send queued packets and put back those sent, returns packets moved */
+static int side_flush(struct side *s)
+{
+	struct spw_list done;
+	int n, moved = 0;
+
+	spw_list_init(&done);
+	n = spw_link_send(s->link, &s->txl);
+	if ( n > 0 )
+		moved += n;
+	n = spw_link_reclaim(s->link, &done);
+	if ( n > 0 )
+		moved += n;
+	spw_pool_put_list(&done);
+	return moved;
+}
+
+/* Queue a control packet, returns its data or NULL if the pool is empty */
+static unsigned char *side_ctrl(struct side *s, unsigned char addr, int type,
+	int step, unsigned int seq)
+{
+	struct spw_pkt *pkt;
+
+	pkt = spw_pool_get(s->pool);
+	if ( !pkt )
+		return NULL;
+	memset(pkt->data, 0, CTRL_LEN);
+	put_hdr(pkt->data, addr, type, step, seq);
+	pkt->dlen = CTRL_LEN;
+	spw_list_add(&s->txl, pkt);
+	return pkt->data;
+}
+
+static int is_bench(struct spw_pkt *pkt)
+{
+	unsigned char *p = pkt->data;
+
+	return (pkt->dlen >= SPW_BENCH_HDR) && (p[1] == SPW_BENCH_PID);
+}
+
+/* Wait for a packet of type, step and sequence number while sending what
+ * is queued. Other packets are dropped. Returns NULL on timeout.
+ */
+static struct spw_pkt *side_wait(struct side *s, int type, int step,
+	unsigned int seq, unsigned int timeout_us)
+{
+	struct spw_list l;
+	struct spw_pkt *pkt, *found = NULL;
+	unsigned char *p;
+	unsigned int t0 = spw_time_us();
+
+	spw_list_init(&l);
+	while ( !found ) {
+		side_post(s);
+		side_flush(s);
+		if ( side_recv(s, &l) <= 0 ) {
+			if ( spw_time_us() - t0 >= timeout_us )
+				return NULL;
+			sched_yield();
+			continue;
+		}
+		while ( (pkt = spw_list_take(&l)) ) {
+			p = pkt->data;
+			if ( !found && is_bench(pkt) && (p[2] == type) &&
+			     (p[3] == step) && (get_be32(&p[4]) == seq) )
+				found = pkt;
+			else
+				spw_pool_put(pkt);
+		}
+	}
+	return found;
+}
+
+void spw_bench_default_cfg(struct spw_bench_cfg *cfg){
+	static const int sizes[] = {16, 64, 256, 1024, 4096};
+	int i;
+
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->dst_addr = 0xfe;
+	cfg->nsizes = sizeof(sizes) / sizeof(sizes[0]);
+	for (i=0; i<cfg->nsizes; i++)
+		cfg->sizes[i] = sizes[i];
+	cfg->stream_us = 2000000;
+	cfg->pings = 1000;
+}
+
+static unsigned int permille(unsigned int part, unsigned int whole)
+{
+	if ( whole == 0 )
+		return 0;
+	if ( part > whole )
+		part = whole;
+	return ((unsigned long long)part * 1000) / whole;
+}
+
+static int bench_stream(struct side *s, struct spw_bench_cfg *cfg, int step,
+	struct spw_bench_stream *r)
+{
+	struct spw_pkt *pkt;
+	unsigned char *p;
+	unsigned int seq = 0, busy = 0, t_start, t0, elapsed;
+	unsigned int rx_busy, rx_elapsed;
+	int size = cfg->sizes[step];
+
+	memset(r, 0, sizeof(*r));
+	r->size = size;
+
+	t_start = spw_time_us();
+	while ( (t0 = spw_time_us()) - t_start < cfg->stream_us ) {
+		if ( s->txl.cnt == 0 ) {
+			spw_pool_get_list(s->pool, &s->txl, SPW_BENCH_BATCH);
+			for (pkt=s->txl.head; pkt; pkt=pkt->next) {
+				put_hdr(pkt->data, cfg->dst_addr, T_DATA, step, seq++);
+				pkt->dlen = size;
+			}
+		}
+		if ( side_flush(s) )
+			busy += spw_time_us() - t0;
+		else
+			sched_yield();
+	}
+	elapsed = spw_time_us() - t_start;
+
+	/* Packets built but not taken by the link are not sent */
+	r->sent = seq - s->txl.cnt;
+	spw_pool_put_list(&s->txl);
+
+	if ( !side_ctrl(s, cfg->dst_addr, T_END, step, r->sent) )
+		return -1;
+	pkt = side_wait(s, T_RESULT, step, r->sent, SPW_BENCH_TIMEOUT_US);
+	if ( !pkt )
+		return -1;
+	p = pkt->data;
+	r->pkts = get_be32(&p[8]);
+	r->span_us = get_be32(&p[12]);
+	rx_busy = get_be32(&p[16]);
+	rx_elapsed = get_be32(&p[20]);
+	spw_pool_put(pkt);
+
+	if ( r->span_us ) {
+		r->pkts_s = ((unsigned long long)r->pkts * 1000000) / r->span_us;
+		r->kbytes_s = ((unsigned long long)r->pkts * size * 1000) / r->span_us;
+	}
+	r->tx_cpu = permille(busy, elapsed);
+	r->rx_cpu = permille(rx_busy, rx_elapsed);
+	return 0;
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int bench_rtt(struct side *s, struct spw_bench_cfg *cfg, int step,
+	struct spw_bench_rtt *r)
+{
+	struct spw_pkt *pkt;
+	unsigned int *rtts, t;
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	r->size = cfg->sizes[step];
+	rtts = malloc(cfg->pings * sizeof(unsigned int));
+	if ( !rtts )
+		return -1;
+
+	for (i=0; i<cfg->pings; i++) {
+		pkt = spw_pool_get(s->pool);
+		if ( !pkt )
+			break;
+		put_hdr(pkt->data, cfg->dst_addr, T_PING, step, i);
+		pkt->dlen = r->size;
+		spw_list_add(&s->txl, pkt);
+		t = spw_time_us();
+		pkt = side_wait(s, T_PONG, step, i, SPW_BENCH_TIMEOUT_US);
+		if ( !pkt ) {
+			r->lost++;
+			continue;
+		}
+		rtts[r->cnt++] = pkt->ts - t;
+		spw_pool_put(pkt);
+	}
+
+	if ( r->cnt ) {
+		qsort(rtts, r->cnt, sizeof(unsigned int), cmp_uint);
+		r->min_us = rtts[0];
+		r->p50_us = rtts[((r->cnt - 1) * 50) / 100];
+		r->p90_us = rtts[((r->cnt - 1) * 90) / 100];
+		r->p99_us = rtts[((r->cnt - 1) * 99) / 100];
+		r->max_us = rtts[r->cnt - 1];
+	}
+	free(rtts);
+	return 0;
+}
+
+int spw_bench_run(spw_link_t link, spw_pool_t pool, struct spw_bench_cfg *cfg,
+	struct spw_bench_res *res){
+	struct side s;
+	unsigned int t0;
+	int i, ret = 0;
+
+	for (i=0; i<cfg->nsizes; i++) {
+		if ( (cfg->sizes[i] < SPW_BENCH_HDR) || (cfg->sizes[i] > spw_pool_size(pool)) ) {
+			printf("spw_bench_run: size %d not in %d..%d\n", cfg->sizes[i],
+				SPW_BENCH_HDR, spw_pool_size(pool));
+			return -1;
+		}
+	}
+
+	side_init(&s, link, pool);
+	memset(res, 0, sizeof(*res));
+	for (i=0; (i<cfg->nsizes) && !ret; i++) {
+		res->nsizes = i + 1;
+		ret = bench_stream(&s, cfg, i, &res->stream[i]);
+		if ( !ret && (cfg->pings > 0) )
+			ret = bench_rtt(&s, cfg, i, &res->rtt[i]);
+	}
+	if ( ret )
+		printf("spw_bench_run: no answer from target at %d bytes\n", cfg->sizes[i-1]);
+
+	/* Stop the target and wait until the link is done with our packets */
+	side_ctrl(&s, cfg->dst_addr, T_QUIT, 0, 0);
+	t0 = spw_time_us();
+	while ( s.txl.cnt && (spw_time_us() - t0 < SPW_BENCH_TIMEOUT_US) ) {
+		side_flush(&s);
+		sched_yield();
+	}
+	spw_pool_put_list(&s.txl);
+	return ret;
+}
+
+void spw_bench_target_init(struct spw_bench_tgt *t, unsigned char reply_addr){
+	memset(t, 0, sizeof(*t));
+	t->reply_addr = reply_addr;
+	t->step = -1;
+}
+
+int spw_bench_target_input(struct spw_bench_tgt *t, struct spw_list *pkts,
+	struct spw_list *txl){
+	struct spw_pkt *pkt;
+	unsigned char *p;
+	int n = 0;
+
+	while ( (pkt = spw_list_take(pkts)) ) {
+		p = pkt->data;
+		if ( !is_bench(pkt) ) {
+			spw_pool_put(pkt);
+			continue;
+		}
+		switch ( p[2] ) {
+		case T_DATA:
+			if ( p[3] != t->step ) {
+				t->step = p[3];
+				t->pkts = t->busy = 0;
+				t->first = pkt->ts;
+			}
+			t->pkts++;
+			t->last = pkt->ts;
+			spw_pool_put(pkt);
+			break;
+
+		case T_END:
+			/* Answer in the END packet itself */
+			if ( p[3] != t->step )
+				t->pkts = t->busy = 0;
+			p[0] = t->reply_addr;
+			p[2] = T_RESULT;
+			put_be32(&p[8], t->pkts);
+			put_be32(&p[12], t->pkts > 1 ? t->last - t->first : 0);
+			put_be32(&p[16], t->busy);
+			put_be32(&p[20], t->pkts ? pkt->ts - t->first : 0);
+			pkt->dlen = CTRL_LEN;
+			spw_list_add(txl, pkt);
+			n++;
+			t->step = -1;
+			break;
+
+		case T_PING:
+			p[0] = t->reply_addr;
+			p[2] = T_PONG;
+			spw_list_add(txl, pkt);
+			n++;
+			break;
+
+		case T_QUIT:
+			t->quit = 1;
+			/* fall through */
+		default:
+			spw_pool_put(pkt);
+			break;
+		}
+	}
+	return n;
+}
+
+int spw_bench_target(spw_link_t link, spw_pool_t pool, unsigned char reply_addr,
+	unsigned int idle_us){
+	struct spw_bench_tgt tgt;
+	struct side s;
+	struct spw_list l;
+	unsigned int t0, t1, last_rx;
+	int n, moved;
+
+	side_init(&s, link, pool);
+	spw_bench_target_init(&tgt, reply_addr);
+	spw_list_init(&l);
+	last_rx = spw_time_us();
+	while ( !tgt.quit || s.txl.cnt ) {
+		t0 = spw_time_us();
+		side_post(&s);
+		n = side_recv(&s, &l);
+		spw_bench_target_input(&tgt, &l, &s.txl);
+		moved = side_flush(&s) + (n > 0 ? n : 0);
+
+		t1 = spw_time_us();
+		if ( n > 0 )
+			last_rx = t1;
+		if ( moved ) {
+			tgt.busy += t1 - t0;
+		} else {
+			if ( t1 - last_rx >= idle_us ) {
+				spw_pool_put_list(&s.txl);
+				return -1;
+			}
+			sched_yield();
+		}
+	}
+	return 0;
+}
+
+void spw_bench_print(struct spw_bench_res *res){
+	struct spw_bench_stream *st;
+	struct spw_bench_rtt *rt;
+	int i;
+
+	printf("stream,size,sent,received,span_us,pkts_s,mbytes_s,tx_cpu_pct,rx_cpu_pct\n");
+	for (i=0; i<res->nsizes; i++) {
+		st = &res->stream[i];
+		printf("stream,%d,%u,%u,%u,%u,%u.%03u,%u.%u,%u.%u\n",
+			st->size, st->sent, st->pkts, st->span_us, st->pkts_s,
+			st->kbytes_s / 1000, st->kbytes_s % 1000,
+			st->tx_cpu / 10, st->tx_cpu % 10, st->rx_cpu / 10, st->rx_cpu % 10);
+	}
+	printf("rtt,size,count,lost,min_us,p50_us,p90_us,p99_us,max_us\n");
+	for (i=0; i<res->nsizes; i++) {
+		rt = &res->rtt[i];
+		if ( rt->cnt + rt->lost == 0 )
+			continue;
+		printf("rtt,%d,%u,%u,%u,%u,%u,%u,%u\n", rt->size, rt->cnt, rt->lost,
+			rt->min_us, rt->p50_us, rt->p90_us, rt->p99_us, rt->max_us);
+	}
+}
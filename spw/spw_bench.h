@@ -0,0 +1,121 @@
+
+#ifndef __SPW_BENCH_H__
+#define __SPW_BENCH_H__
+
+/* SpaceWire throughput and latency benchmark
+ *
+ * An initiator and a target exchange benchmark packets over a spw_link,
+ * both ends may be in the same program (two links of one board, or a
+ * loopback pair on the host) or on two boards. For every packet size the
+ * initiator runs:
+ *
+ *   stream     Packets are sent back to back for stream_us. The target
+ *              counts them and reports what it received and its own busy
+ *              time in a RESULT packet, the sustained rate is taken over
+ *              the time between the first and last packet received.
+ *   ping-pong  One packet at a time is sent and echoed by the target,
+ *              the round trip times give min, median, 90th and 99th
+ *              percentile and max latency.
+ *
+ * Both sides poll their link without blocking. CPU utilisation of a side
+ * is the time spent in iterations that moved packets against the length of
+ * the step, time spent polling an empty link is not counted.
+ *
+ * Packet layout, multi-byte fields big-endian:
+ *   0  destination logical address
+ *   1  protocol ID SPW_BENCH_PID
+ *   2  type
+ *   3  step, index of the packet size
+ *   4  sequence number (32 bits)
+ *   8  type specific: send time of PING, counters of RESULT
+ * The rest of the packet is not written or read.
+ *
+ * spw_bench_print() writes the results as comma separated tables, one
+ * line per packet size, preceded by a header line naming the columns.
+ */
+
+#include "spw_pkt.h"
+#include "spw_link.h"
+
+#define SPW_BENCH_PID		0xf1	/* Protocol ID, not assigned by ECSS */
+#define SPW_BENCH_HDR		12	/* Smallest packet size */
+#define SPW_BENCH_SIZES_MAX	16
+#define SPW_BENCH_BATCH		16	/* Packets built per send */
+#define SPW_BENCH_RX_POSTED	32	/* Receive buffers kept at the link */
+#define SPW_BENCH_TIMEOUT_US	1000000	/* Waiting for RESULT or PONG */
+
+struct spw_bench_cfg {
+	unsigned char dst_addr;	/* Logical address of the target */
+	int nsizes;
+	int sizes[SPW_BENCH_SIZES_MAX];	/* Packet sizes incl. address */
+	unsigned int stream_us;	/* Length of each stream step */
+	int pings;		/* Round trips per size, 0 skips ping-pong */
+};
+
+struct spw_bench_stream {
+	int size;
+	unsigned int sent;
+	unsigned int pkts;	/* Received by target */
+	unsigned int span_us;	/* First to last packet received */
+	unsigned int pkts_s;
+	unsigned int kbytes_s;	/* 1000 bytes/s */
+	unsigned int tx_cpu;	/* Initiator busy [0.1%] */
+	unsigned int rx_cpu;	/* Target busy [0.1%] */
+};
+
+struct spw_bench_rtt {
+	int size;
+	unsigned int cnt;	/* Round trips completed */
+	unsigned int lost;	/* Timed out */
+	unsigned int min_us, p50_us, p90_us, p99_us, max_us;
+};
+
+struct spw_bench_res {
+	int nsizes;
+	struct spw_bench_stream stream[SPW_BENCH_SIZES_MAX];
+	struct spw_bench_rtt rtt[SPW_BENCH_SIZES_MAX];
+};
+
+/* Default configuration: sizes 16 to 4096 bytes, 2 s per stream step and
+ * 1000 round trips per size.
+ */
+void spw_bench_default_cfg(struct spw_bench_cfg *cfg);
+
+/* Initiator: run all steps against a target, the pool buffers must hold
+ * the largest size. Returns 0, or -1 when the target stopped answering.
+ */
+int spw_bench_run(spw_link_t link, spw_pool_t pool, struct spw_bench_cfg *cfg,
+	struct spw_bench_res *res);
+
+/* Target: count stream packets and echo pings until the initiator is
+ * done, replies go to reply_addr. Returns 0, or -1 when nothing was
+ * received for idle_us.
+ */
+int spw_bench_target(spw_link_t link, spw_pool_t pool, unsigned char reply_addr,
+	unsigned int idle_us);
+
+/* Target state for programs that receive the benchmark packets among
+ * other traffic on a link they serve themselves, e.g. from a spw_demux
+ * queue of SPW_BENCH_PID as in spwnode.c.
+ */
+struct spw_bench_tgt {
+	unsigned char reply_addr;
+	int step;		/* Stream step counted, -1 none */
+	unsigned int pkts;
+	unsigned int first, last;	/* Reception of first and last packet */
+	unsigned int busy;	/* Time the caller spent receiving [us] */
+	int quit;		/* QUIT received, the initiator is done */
+};
+
+void spw_bench_target_init(struct spw_bench_tgt *t, unsigned char reply_addr);
+
+/* Handle received packets, pkts is empty afterwards. RESULT and PONG
+ * answers are appended to txl, other packets are put back. Returns the
+ * number of answers. The caller adds its busy time to t->busy.
+ */
+int spw_bench_target_input(struct spw_bench_tgt *t, struct spw_list *pkts,
+	struct spw_list *txl);
+
+void spw_bench_print(struct spw_bench_res *res);
+
+#endif
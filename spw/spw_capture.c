@@ -0,0 +1,185 @@
+/* SpaceWire packet capture ring, see spw_capture.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spw_capture.h"
+#include "../mem_barrier.h"
+
+/* Records are stored in the format they are taken out in, each starting
+ * on a 4 byte boundary. A record never wraps: when it does not fit before
+ * the end of the ring a wrap marker is written and the record starts at
+ * offset 0. With less than a record header left at the end the consumer
+ * wraps without marker.
+ */
+#define CAP_ALIGN(len)	(((len) + 3) & ~3)
+#define CAP_WRAP	0x80	/* Marker flag, never taken out */
+
+struct spw_capture_s {
+	unsigned char *ring;
+	unsigned int size;		/* Multiple of 4 */
+	unsigned int snaplen;
+	volatile unsigned int head;	/* Moved by producer only */
+	volatile unsigned int tail;	/* Moved by consumer only */
+	struct spw_capture_stats stats;
+};
+
+spw_capture_t spw_capture_create(unsigned int size, unsigned int snaplen){
+	spw_capture_t cap;
+
+	size &= ~3;
+	if ( (snaplen > SPW_CAP_SNAPLEN_MAX) ||
+	     (size < 2 * CAP_ALIGN(SPW_CAP_REC_HDR + snaplen)) )
+		return NULL;
+	cap = calloc(1, sizeof(*cap));
+	if ( !cap )
+		return NULL;
+	cap->ring = malloc(size);
+	if ( !cap->ring ) {
+		printf("spw_capture_create: failed to allocate %u bytes\n", size);
+		free(cap);
+		return NULL;
+	}
+	cap->size = size;
+	cap->snaplen = snaplen;
+	return cap;
+}
+
+void spw_capture_free(spw_capture_t cap){
+	if ( !cap )
+		return;
+	free(cap->ring);
+	free(cap);
+}
+
+static void cap_put32(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+int spw_capture_put(spw_capture_t cap, int link, const void *data,
+	unsigned int len, int flags, unsigned int ts){
+	unsigned int head, tail, need, cap_len, at;
+	unsigned char *p;
+
+	cap_len = len;
+	if ( cap_len > cap->snaplen ) {
+		cap_len = cap->snaplen;
+		flags |= SPW_CAP_SNAP;
+	}
+	need = CAP_ALIGN(SPW_CAP_REC_HDR + cap_len);
+
+	/* One byte of the ring is never used, head == tail is empty */
+	head = cap->head;
+	tail = cap->tail;
+	if ( head >= tail ) {
+		if ( (cap->size - head > need) ||
+		     ((cap->size - head == need) && (tail != 0)) )
+			at = head;
+		else if ( tail > need )
+			at = 0;
+		else
+			goto drop;
+	} else if ( tail - head > need ) {
+		at = head;
+	} else {
+		goto drop;
+	}
+
+	if ( (at == 0) && (head != 0) && (cap->size - head >= SPW_CAP_REC_HDR) )
+		cap->ring[head + 11] = CAP_WRAP;
+	p = &cap->ring[at];
+	cap_put32(&p[0], ts);
+	cap_put32(&p[4], len);
+	p[8] = cap_len >> 8;
+	p[9] = cap_len;
+	p[10] = link;
+	p[11] = flags & (SPW_CAP_EEP | SPW_CAP_TRUNK | SPW_CAP_SNAP);
+	memcpy(&p[SPW_CAP_REC_HDR], data, cap_len);
+	at += need;
+	if ( at == cap->size )
+		at = 0;
+	MEM_BARRIER();
+	cap->head = at;
+
+	cap->stats.packets++;
+	cap->stats.bytes += cap_len;
+	if ( flags & SPW_CAP_SNAP )
+		cap->stats.snapped++;
+	return 0;
+
+drop:
+	cap->stats.dropped++;
+	cap->stats.dropped_bytes += len;
+	return -1;
+}
+
+int spw_capture_pkts(spw_capture_t cap, int link, struct spw_list *pkts){
+	struct spw_pkt *pkt;
+	int flags, n = 0;
+
+	for (pkt=pkts->head; pkt; pkt=pkt->next) {
+		flags = 0;
+		if ( pkt->flags & SPW_RXPKT_EEP )
+			flags |= SPW_CAP_EEP;
+		if ( pkt->flags & SPW_RXPKT_TRUNK )
+			flags |= SPW_CAP_TRUNK;
+		if ( spw_capture_put(cap, link, pkt->data, pkt->dlen, flags,
+		                     pkt->ts ? pkt->ts : spw_time_us()) == 0 )
+			n++;
+	}
+	return n;
+}
+
+int spw_capture_take(spw_capture_t cap, unsigned char *buf, int maxlen,
+	int *cnt){
+	unsigned int head, tail, len;
+	unsigned char *p;
+	int n = 0, i = 0;
+
+	tail = cap->tail;
+	head = cap->head;
+	MEM_BARRIER();
+	while ( tail != head ) {
+		p = &cap->ring[tail];
+		if ( (cap->size - tail < SPW_CAP_REC_HDR) || (p[11] & CAP_WRAP) ) {
+			tail = 0;
+			continue;
+		}
+		len = SPW_CAP_REC_HDR + ((p[8] << 8) | p[9]);
+		if ( (int)len > maxlen - n )
+			break;
+		memcpy(&buf[n], p, len);
+		n += len;
+		i++;
+		tail += CAP_ALIGN(len);
+		if ( tail == cap->size )
+			tail = 0;
+	}
+	MEM_BARRIER();
+	cap->tail = tail;
+	cap->stats.taken += i;
+	if ( cnt )
+		*cnt = i;
+	return n;
+}
+
+unsigned int spw_capture_snaplen(spw_capture_t cap){
+	return cap->snaplen;
+}
+
+void spw_capture_get_stats(spw_capture_t cap, struct spw_capture_stats *stats){
+	*stats = cap->stats;
+}
+
+void spw_capture_stats_print(spw_capture_t cap){
+	struct spw_capture_stats *s = &cap->stats;
+
+	printf("SpW capture: %u packets %u bytes stored, %u dropped (%u bytes), "
+		"%u cut to %u bytes, %u taken\n", s->packets, s->bytes,
+		s->dropped, s->dropped_bytes, s->snapped, cap->snaplen, s->taken);
+}
@@ -0,0 +1,82 @@
+
+#ifndef __SPW_CAPTURE_H__
+#define __SPW_CAPTURE_H__
+
+/* SpaceWire packet capture ring
+ *
+ * A sniffer task copies received packets into a byte ring together with
+ * link number, length, EEP/truncation flags and reception time. Another
+ * task takes the records out, for example the TCP server in capsrv.c that
+ * moves them to a host.
+ *
+ * The copy is bounded: at most snaplen bytes of a packet are stored, and
+ * a packet that does not fit into the free part of the ring is dropped and
+ * counted, the sniffer never waits for the consumer. The counters tell
+ * the consumer how much was lost.
+ *
+ * The ring has one producer and one consumer and no lock, the two may run
+ * in different tasks.
+ *
+ * Records are taken out in a byte order independent format, all fields
+ * big endian:
+ *
+ *   0   ts       Time received [us], wraps at 32 bits
+ *   4   len      Packet length as received
+ *   8   cap_len  Bytes of the packet that follow, 16 bits
+ *   10  link     Link number given by the sniffer
+ *   11  flags    SPW_CAP_ flags
+ *   12  data     cap_len bytes
+ */
+
+#include "spw_pkt.h"
+
+#define SPW_CAP_REC_HDR		12
+#define SPW_CAP_SNAPLEN_MAX	0xffff
+
+/* Record flags */
+#define SPW_CAP_EEP		0x01	/* Packet ended with EEP */
+#define SPW_CAP_TRUNK		0x02	/* Truncated by the receiver */
+#define SPW_CAP_SNAP		0x04	/* Cut to snaplen by the capture */
+
+struct spw_capture_stats {
+	unsigned int packets;		/* Packets stored */
+	unsigned int bytes;		/* Packet bytes stored */
+	unsigned int dropped;		/* Packets lost, ring full */
+	unsigned int dropped_bytes;
+	unsigned int snapped;		/* Packets cut to snaplen */
+	unsigned int taken;		/* Records taken out */
+};
+
+typedef struct spw_capture_s *spw_capture_t;
+
+/* Create ring of size bytes storing up to snaplen bytes of each packet.
+ * Returns NULL on failure.
+ */
+spw_capture_t spw_capture_create(unsigned int size, unsigned int snaplen);
+
+void spw_capture_free(spw_capture_t cap);
+
+/* Store one packet. flags are SPW_CAP_EEP and SPW_CAP_TRUNK. Returns 0, or
+ * -1 if the packet was dropped.
+ */
+int spw_capture_put(spw_capture_t cap, int link, const void *data,
+	unsigned int len, int flags, unsigned int ts);
+
+/* Store all packets of a received list, the list is not changed. Returns
+ * the number of packets stored.
+ */
+int spw_capture_pkts(spw_capture_t cap, int link, struct spw_list *pkts);
+
+/* Take whole records in the format above into buf, at most maxlen bytes.
+ * Returns the number of bytes, the number of records in *cnt.
+ */
+int spw_capture_take(spw_capture_t cap, unsigned char *buf, int maxlen,
+	int *cnt);
+
+unsigned int spw_capture_snaplen(spw_capture_t cap);
+
+void spw_capture_get_stats(spw_capture_t cap, struct spw_capture_stats *stats);
+
+void spw_capture_stats_print(spw_capture_t cap);
+
+#endif
@@ -0,0 +1,272 @@
+/* SpaceWire receive demultiplexer, see spw_demux.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spw_demux.h"
+#include "../mem_barrier.h"
+
+#define RULE_NONE	0xff
+
+/* Ring of packet pointers, one slot is kept free to tell full from empty */
+struct demux_queue {
+	struct spw_pkt **ring;
+	unsigned int size;
+	volatile unsigned int head;	/* Moved by dispatcher only */
+	volatile unsigned int tail;	/* Moved by consumer only */
+	int flags;
+	int pending;			/* Queued to since last notify */
+	spw_demux_notify_t notify;
+	void *arg;
+	struct spw_demux_queue_stats stats;
+};
+
+struct demux_rule {
+	unsigned char addr_first;
+	unsigned char addr_last;
+	unsigned char q;
+	unsigned char next;		/* Next rule of same PID */
+};
+
+struct spw_demux_s {
+	spw_link_t link;
+	spw_pool_t pool;
+	int rx_posted;
+	int posted;			/* Buffers at the receiver */
+	int nqueues;
+	struct demux_queue queues[SPW_DEMUX_QUEUES_MAX];
+	int nrules;
+	struct demux_rule rules[SPW_DEMUX_RULES_MAX];
+	unsigned char pid_rule[256];	/* First rule of each PID */
+	int def_q;
+	struct spw_demux_stats stats;
+};
+
+spw_demux_t spw_demux_create(spw_link_t link, spw_pool_t pool, int rx_posted){
+	spw_demux_t dmx;
+
+	if ( !link || !pool || (rx_posted < 1) )
+		return NULL;
+	dmx = calloc(1, sizeof(*dmx));
+	if ( !dmx )
+		return NULL;
+	dmx->link = link;
+	dmx->pool = pool;
+	dmx->rx_posted = rx_posted;
+	memset(dmx->pid_rule, RULE_NONE, sizeof(dmx->pid_rule));
+	dmx->def_q = -1;
+	return dmx;
+}
+
+void spw_demux_free(spw_demux_t dmx){
+	struct spw_list l;
+	int i;
+
+	if ( !dmx )
+		return;
+	for (i=0; i<dmx->nqueues; i++) {
+		spw_list_init(&l);
+		while ( spw_demux_take(dmx, i, &l, 64) > 0 )
+			spw_pool_put_list(&l);
+		free(dmx->queues[i].ring);
+	}
+	free(dmx);
+}
+
+int spw_demux_queue(spw_demux_t dmx, int depth, int flags,
+	spw_demux_notify_t notify, void *arg){
+	struct demux_queue *q;
+
+	if ( (dmx->nqueues >= SPW_DEMUX_QUEUES_MAX) || (depth < 1) )
+		return -1;
+	q = &dmx->queues[dmx->nqueues];
+	q->ring = malloc((depth + 1) * sizeof(struct spw_pkt *));
+	if ( !q->ring ) {
+		printf("spw_demux_queue: failed to allocate queue of %d\n", depth);
+		return -1;
+	}
+	q->size = depth + 1;
+	q->head = q->tail = 0;
+	q->flags = flags;
+	q->notify = notify;
+	q->arg = arg;
+	memset(&q->stats, 0, sizeof(q->stats));
+	return dmx->nqueues++;
+}
+
+int spw_demux_add(spw_demux_t dmx, int pid, int addr_first, int addr_last, int q){
+	struct demux_rule *r;
+	unsigned char *link;
+
+	if ( (pid < 0) || (pid > 255) || (addr_first < 0) || (addr_last > 255) ||
+	     (addr_first > addr_last) || (q < 0) || (q >= dmx->nqueues) ||
+	     (dmx->nrules >= SPW_DEMUX_RULES_MAX) )
+		return -1;
+
+	r = &dmx->rules[dmx->nrules];
+	r->addr_first = addr_first;
+	r->addr_last = addr_last;
+	r->q = q;
+	r->next = RULE_NONE;
+
+	/* Append to the rules of the PID, the first added matches first */
+	link = &dmx->pid_rule[pid];
+	while ( *link != RULE_NONE )
+		link = &dmx->rules[*link].next;
+	*link = dmx->nrules++;
+	return 0;
+}
+
+int spw_demux_set_default(spw_demux_t dmx, int q){
+	if ( (q < -1) || (q >= dmx->nqueues) )
+		return -1;
+	dmx->def_q = q;
+	return 0;
+}
+
+int spw_demux_match(spw_demux_t dmx, struct spw_pkt *pkt){
+	unsigned char *p = pkt->data;
+	struct demux_rule *r;
+	unsigned int i;
+
+	for (i=dmx->pid_rule[p[1]]; i!=RULE_NONE; i=r->next) {
+		r = &dmx->rules[i];
+		if ( (p[0] >= r->addr_first) && (p[0] <= r->addr_last) )
+			return r->q;
+	}
+	return dmx->def_q;
+}
+
+/* Put packet into queue, returns 0 or -1 when full */
+static int demux_put(struct demux_queue *q, struct spw_pkt *pkt)
+{
+	unsigned int head = q->head, next, fill;
+
+	next = head + 1;
+	if ( next >= q->size )
+		next = 0;
+	if ( next == q->tail ) {
+		q->stats.dropped++;
+		return -1;
+	}
+	q->ring[head] = pkt;
+	MEM_BARRIER();
+	q->head = next;
+
+	q->stats.rx++;
+	fill = (next + q->size - q->tail) % q->size;
+	if ( fill > q->stats.max_fill )
+		q->stats.max_fill = fill;
+	return 0;
+}
+
+int spw_demux_dispatch(spw_demux_t dmx, struct spw_list *pkts){
+	struct spw_pkt *pkt;
+	struct demux_queue *q;
+	int qi, i, cnt = 0;
+
+	while ( (pkt = spw_list_take(pkts)) ) {
+		dmx->stats.rx++;
+		if ( (pkt->dlen < 2) || (pkt->flags & (SPW_RXPKT_EEP | SPW_RXPKT_TRUNK)) ) {
+			dmx->stats.bad++;
+			spw_pool_put(pkt);
+			continue;
+		}
+		qi = spw_demux_match(dmx, pkt);
+		if ( qi < 0 ) {
+			dmx->stats.unmatched++;
+			spw_pool_put(pkt);
+			continue;
+		}
+		q = &dmx->queues[qi];
+		if ( demux_put(q, pkt) ) {
+			spw_pool_put(pkt);
+			continue;
+		}
+		cnt++;
+		if ( !q->notify )
+			continue;
+		if ( q->flags & SPW_DEMUX_URGENT ) {
+			q->stats.notified++;
+			q->notify(q->arg);
+		} else {
+			q->pending = 1;
+		}
+	}
+
+	for (i=0; i<dmx->nqueues; i++) {
+		q = &dmx->queues[i];
+		if ( q->pending ) {
+			q->pending = 0;
+			q->stats.notified++;
+			q->notify(q->arg);
+		}
+	}
+	return cnt;
+}
+
+int spw_demux_recv(spw_demux_t dmx){
+	struct spw_list l;
+	int n;
+
+	spw_list_init(&l);
+	spw_link_refill(dmx->link, dmx->pool, &dmx->posted, dmx->rx_posted);
+
+	n = spw_link_recv(dmx->link, &l);
+	if ( n <= 0 )
+		return n;
+	dmx->posted -= n;
+	dmx->stats.batches++;
+	spw_demux_dispatch(dmx, &l);
+	return n;
+}
+
+int spw_demux_take(spw_demux_t dmx, int qi, struct spw_list *pkts, int max){
+	struct demux_queue *q;
+	unsigned int tail, head;
+	int i;
+
+	if ( (qi < 0) || (qi >= dmx->nqueues) )
+		return -1;
+	q = &dmx->queues[qi];
+
+	tail = q->tail;
+	head = q->head;
+	MEM_BARRIER();
+	for (i=0; (i<max) && (tail != head); i++) {
+		spw_list_add(pkts, q->ring[tail]);
+		tail++;
+		if ( tail >= q->size )
+			tail = 0;
+	}
+	MEM_BARRIER();
+	q->tail = tail;
+	return i;
+}
+
+void spw_demux_get_stats(spw_demux_t dmx, struct spw_demux_stats *stats){
+	*stats = dmx->stats;
+}
+
+int spw_demux_get_queue_stats(spw_demux_t dmx, int q,
+	struct spw_demux_queue_stats *stats){
+	if ( (q < 0) || (q >= dmx->nqueues) )
+		return -1;
+	*stats = dmx->queues[q].stats;
+	return 0;
+}
+
+void spw_demux_stats_print(spw_demux_t dmx){
+	struct spw_demux_queue_stats *qs;
+	int i;
+
+	printf("SpW demux: %u packets in %u batches, %u unmatched, %u bad\n",
+		dmx->stats.rx, dmx->stats.batches, dmx->stats.unmatched, dmx->stats.bad);
+	for (i=0; i<dmx->nqueues; i++) {
+		qs = &dmx->queues[i].stats;
+		printf("  queue %d: %u queued, %u dropped, %u notified, max fill %u/%u\n",
+			i, qs->rx, qs->dropped, qs->notified, qs->max_fill,
+			dmx->queues[i].size - 1);
+	}
+}
@@ -0,0 +1,322 @@
+/* Linux benchmark of time packet latency behind bulk traffic
+ *
+ * Bulk packets of 1024 bytes are sent through a spw_link_loop() pair as fast
+ * as the link takes them, and a CUCTP time packet every TIME_PERIOD_US. The
+ * bulk consumer is slower than the link, it spends BULK_COST_US on each
+ * packet and handles BULK_PER_ROUND packets per round. Two setups are
+ * measured:
+ *
+ *   fifo   All packets go to one queue, the consumer sees the time packets
+ *          in arrival order between the bulk packets.
+ *   demux  Time packets get their own urgent queue. Its consumer stands for
+ *          a task of higher priority than the dispatcher and is run from
+ *          the notify function, as an RTEMS event would make it run.
+ *
+ * All work is done in one thread in rounds, so the result does not depend
+ * on the host scheduler. The latency of a time packet is the time from its
+ * reception at the link to its decoding by the consumer.
+ *
+ * With -s the packets go to the node emulator spwnode.c over a
+ * spw_link_sock() link and are received as the node echoes them, the time
+ * packets are not addressed to the node so it does not consume them.
+ *
+ * usage: spw_demux_bench [-s HOST:PORT] [SECONDS]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "spw_pkt.h"
+#include "spw_link.h"
+#include "spw_demux.h"
+#include "cuc.h"
+
+#define POOL_CNT	512
+#define POOL_SIZE	1024
+#define RING_DEPTH	64
+#define RX_POSTED	32
+#define BULK_DEPTH	256
+#define TIME_DEPTH	16
+#define BULK_PID	0xf0
+#define BULK_ADDR	0x20
+#define TIME_ADDR	0xfe
+#define TIME_PERIOD_US	1000
+#define BULK_COST_US	10
+#define BULK_PER_ROUND	8
+#define LAT_MAX		100000
+#define SETTLE_US	200000
+
+struct result {
+	unsigned int time_sent;
+	unsigned int time_rx;
+	unsigned int time_bad;		/* CRC or format error */
+	unsigned int bulk_sent;
+	unsigned int bulk_rx;
+	unsigned int lat_cnt;
+	unsigned int lat[LAT_MAX];
+};
+
+struct bench {
+	spw_pool_t pool;
+	spw_link_t a, b;	/* The same link with -s */
+	int sock;
+	spw_demux_t dmx;
+	int bulk_q;
+	int time_q;
+	struct cuc_pfield pf;
+	struct result *res;
+};
+
+static void handle_time(struct bench *bn, struct spw_pkt *pkt)
+{
+	struct result *res = bn->res;
+	struct cuc_pfield pf;
+	struct cuc_time t;
+
+	if ( cuctp_decode(pkt->data, pkt->dlen, NULL, NULL, &pf, &t) < 0 ) {
+		res->time_bad++;
+		return;
+	}
+	res->time_rx++;
+	if ( res->lat_cnt < LAT_MAX )
+		res->lat[res->lat_cnt++] = spw_time_us() - pkt->ts;
+}
+
+/* Time consumer, run at once when its queue is notified */
+static void time_notify(void *arg)
+{
+	struct bench *bn = arg;
+	struct spw_list l;
+	struct spw_pkt *pkt;
+
+	spw_list_init(&l);
+	spw_demux_take(bn->dmx, bn->time_q, &l, TIME_DEPTH);
+	for (pkt=l.head; pkt; pkt=pkt->next)
+		handle_time(bn, pkt);
+	spw_pool_put_list(&l);
+}
+
+/* Slow bulk consumer, also gets the time packets in fifo setup */
+static void bulk_consume(struct bench *bn)
+{
+	struct spw_list l;
+	struct spw_pkt *pkt;
+	unsigned int start;
+
+	spw_list_init(&l);
+	spw_demux_take(bn->dmx, bn->bulk_q, &l, BULK_PER_ROUND);
+	for (pkt=l.head; pkt; pkt=pkt->next) {
+		if ( ((unsigned char *)pkt->data)[1] == SPW_PID_CUCTP ) {
+			handle_time(bn, pkt);
+			continue;
+		}
+		bn->res->bulk_rx++;
+		start = spw_time_us();
+		while ( spw_time_us() - start < BULK_COST_US )
+			;
+	}
+	spw_pool_put_list(&l);
+}
+
+/* Keep the link busy with bulk packets, a time packet every period */
+static void produce(struct bench *bn, struct spw_list *txl, unsigned int *next_time)
+{
+	struct spw_list l;
+	struct spw_pkt *pkt;
+	struct cuc_time t;
+	unsigned char *p;
+	unsigned int now = spw_time_us();
+
+	if ( (int)(now - *next_time) >= 0 ) {
+		*next_time += TIME_PERIOD_US;
+		pkt = spw_pool_get(bn->pool);
+		if ( pkt ) {
+			t.coarse = now / 1000000;
+			t.fine = (uint64_t)(now % 1000000) * 65536 / 1000000;
+			pkt->dlen = cuctp_encode(TIME_ADDR, SPW_PID_CUCTP, &bn->pf, &t,
+						pkt->data, POOL_SIZE);
+			spw_list_add(txl, pkt);
+			bn->res->time_sent++;
+		}
+	}
+
+	/* Packets the link had no room for are sent again next round */
+	spw_list_init(&l);
+	if ( txl->cnt < RING_DEPTH ) {
+		spw_pool_get_list(bn->pool, &l, RING_DEPTH - txl->cnt);
+		for (pkt=l.head; pkt; pkt=pkt->next) {
+			p = pkt->data;
+			p[0] = BULK_ADDR;
+			p[1] = BULK_PID;
+			pkt->dlen = POOL_SIZE;
+		}
+		bn->res->bulk_sent += l.cnt;
+		spw_list_join(txl, &l);
+	}
+	spw_link_send(bn->a, txl);
+
+	spw_link_reclaim(bn->a, &l);
+	spw_pool_put_list(&l);
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Drop the echoes still on their way from the node, until it is quiet */
+static void settle(struct bench *bn)
+{
+	struct spw_list l;
+	unsigned int t0 = spw_time_us();
+
+	spw_list_init(&l);
+	while ( spw_time_us() - t0 < 5 * SETTLE_US ) {
+		if ( spw_demux_recv(bn->dmx) <= 0 ) {
+			if ( spw_link_sock_wait(bn->b, SETTLE_US) <= 0 )
+				break;
+			continue;
+		}
+		spw_demux_take(bn->dmx, bn->bulk_q, &l, BULK_DEPTH);
+		if ( bn->time_q >= 0 )
+			spw_demux_take(bn->dmx, bn->time_q, &l, TIME_DEPTH);
+		spw_pool_put_list(&l);
+	}
+}
+
+int run(struct bench *bn, int demux, unsigned int seconds)
+{
+	struct spw_list txl;
+	struct spw_pkt *pkt;
+	unsigned int end, next_time;
+
+	memset(bn->res, 0, sizeof(*bn->res));
+	bn->dmx = spw_demux_create(bn->b, bn->pool, RX_POSTED);
+	if ( !bn->dmx )
+		return -1;
+	bn->bulk_q = spw_demux_queue(bn->dmx, BULK_DEPTH, 0, NULL, NULL);
+	spw_demux_set_default(bn->dmx, bn->bulk_q);
+	bn->time_q = -1;
+	if ( demux ) {
+		bn->time_q = spw_demux_queue(bn->dmx, TIME_DEPTH, SPW_DEMUX_URGENT,
+					time_notify, bn);
+		spw_demux_add(bn->dmx, SPW_PID_CUCTP, 0, 255, bn->time_q);
+	}
+
+	spw_list_init(&txl);
+	next_time = spw_time_us();
+	end = next_time + seconds * 1000000;
+	while ( (int)(spw_time_us() - end) < 0 ) {
+		produce(bn, &txl, &next_time);
+		spw_demux_recv(bn->dmx);
+		bulk_consume(bn);
+	}
+
+	/* Not sent */
+	for (pkt=txl.head; pkt; pkt=pkt->next) {
+		if ( ((unsigned char *)pkt->data)[1] == SPW_PID_CUCTP )
+			bn->res->time_sent--;
+		else
+			bn->res->bulk_sent--;
+	}
+	spw_pool_put_list(&txl);
+	if ( bn->sock )
+		settle(bn);
+	spw_demux_stats_print(bn->dmx);
+	spw_demux_free(bn->dmx);
+	return 0;
+}
+
+void print_result(const char *name, struct result *res)
+{
+	unsigned int *lat = res->lat, n = res->lat_cnt;
+
+	qsort(lat, n, sizeof(unsigned int), cmp_uint);
+	printf("%-5s time %6u sent %6u received %4u bad", name,
+		res->time_sent, res->time_rx, res->time_bad);
+	if ( n )
+		printf(", latency [us] p50 %u p99 %u max %u",
+			lat[n / 2], lat[n * 99 / 100], lat[n - 1]);
+	printf("\n      bulk %6u sent %6u received\n",
+		res->bulk_sent, res->bulk_rx);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench bn;
+	struct result *res_fifo, *res_demux;
+	struct spw_list l;
+	unsigned int seconds = 2;
+	char *server = NULL, *port = NULL;
+	int opt, fd;
+
+	while ( (opt = getopt(argc, argv, "s:")) != -1 ) {
+		switch ( opt ) {
+		case 's':
+			server = optarg;
+			port = strchr(server, ':');
+			if ( port )
+				*port++ = '\0';
+			break;
+		default:
+			seconds = 0;
+			break;
+		}
+	}
+	if ( seconds && (optind < argc) )
+		seconds = atoi(argv[optind]);
+	if ( (seconds < 1) || (server && !port) ) {
+		printf("usage: %s [-s HOST:PORT] [SECONDS]\n", argv[0]);
+		return 1;
+	}
+
+	memset(&bn, 0, sizeof(bn));
+	bn.pf.tid = 1;
+	bn.pf.coarse = 4;
+	bn.pf.fine = 2;
+	res_fifo = malloc(sizeof(struct result));
+	res_demux = malloc(sizeof(struct result));
+	bn.pool = spw_pool_create(POOL_CNT, POOL_SIZE);
+	if ( !res_fifo || !res_demux || !bn.pool ) {
+		printf("Failed to create pool\n");
+		return 1;
+	}
+	if ( server ) {
+		fd = spw_sock_connect(server, atoi(port));
+		bn.a = bn.b = (fd < 0) ? NULL : spw_link_sock(fd, RING_DEPTH);
+		if ( !bn.a )
+			return 1;
+		bn.sock = 1;
+	} else if ( spw_link_loop(RING_DEPTH, &bn.a, &bn.b) ) {
+		printf("Failed to create links\n");
+		return 1;
+	}
+
+	bn.res = res_fifo;
+	if ( run(&bn, 0, seconds) )
+		return 1;
+	bn.res = res_demux;
+	if ( run(&bn, 1, seconds) )
+		return 1;
+
+	printf("%u s per setup, bulk consumer %u us per packet%s%s\n",
+		seconds, BULK_COST_US, server ? ", echoed by node " : "",
+		server ? server : "");
+	print_result("fifo", res_fifo);
+	print_result("demux", res_demux);
+
+	/* Buffers left in the link rings */
+	spw_list_init(&l);
+	spw_link_reclaim(bn.a, &l);
+	spw_pool_put_list(&l);
+	spw_link_stats_print(bn.b);
+	spw_pool_stats_print(bn.pool);
+	if ( bn.sock && !(res_fifo->time_rx && res_demux->time_rx) ) {
+		printf("No time packets came back from the node\n");
+		return 1;
+	}
+	return (res_fifo->time_bad || res_demux->time_bad) ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+/* Zero-copy SpaceWire packet transfer and loopback backend, see spw_link.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __rtems__
+#include <rtems.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "spw_link.h"
+
+spw_link_t spw_link_create(const struct spw_link_ops *ops, void *priv){
+	spw_link_t link;
+
+	link = calloc(1, sizeof(*link));
+	if ( !link )
+		return NULL;
+	link->ops = ops;
+	link->priv = priv;
+	return link;
+}
+
+void spw_link_close(spw_link_t link){
+	if ( !link )
+		return;
+	if ( link->ops->close )
+		link->ops->close(link->priv);
+	free(link);
+}
+
+int spw_link_send(spw_link_t link, struct spw_list *pkts){
+	if ( !pkts->head )
+		return 0;
+	return link->ops->send(link->priv, pkts);
+}
+
+/* The backends fill a local list so that only new packets are counted */
+int spw_link_reclaim(spw_link_t link, struct spw_list *pkts){
+	struct spw_list done;
+	struct spw_pkt *pkt;
+	int ret;
+
+	spw_list_init(&done);
+	ret = link->ops->reclaim(link->priv, &done);
+	for (pkt=done.head; pkt; pkt=pkt->next) {
+		if ( pkt->flags & SPW_TXPKT_LINKERR ) {
+			link->stats.tx_errs++;
+		} else {
+			link->stats.tx_pkts++;
+			link->stats.tx_bytes += pkt->hlen + pkt->dlen;
+		}
+	}
+	spw_list_join(pkts, &done);
+	return ret;
+}
+
+int spw_link_prepare(spw_link_t link, struct spw_list *pkts){
+	if ( !pkts->head )
+		return 0;
+	return link->ops->prepare(link->priv, pkts);
+}
+
+int spw_link_refill(spw_link_t link, spw_pool_t pool, int *posted, int want){
+	struct spw_list l;
+	int n;
+
+	if ( *posted >= want )
+		return 0;
+	spw_list_init(&l);
+	spw_pool_get_list(pool, &l, want - *posted);
+	n = spw_link_prepare(link, &l);
+	if ( n > 0 )
+		*posted += n;
+	spw_pool_put_list(&l);
+	return n;
+}
+
+int spw_link_recv(spw_link_t link, struct spw_list *pkts){
+	struct spw_list done;
+	struct spw_pkt *pkt;
+	int ret;
+
+	spw_list_init(&done);
+	ret = link->ops->recv(link->priv, &done);
+	for (pkt=done.head; pkt; pkt=pkt->next) {
+		link->stats.rx_pkts++;
+		link->stats.rx_bytes += pkt->dlen;
+		if ( pkt->flags & SPW_RXPKT_EEP )
+			link->stats.rx_eep++;
+		if ( pkt->flags & SPW_RXPKT_TRUNK )
+			link->stats.rx_trunk++;
+	}
+	spw_list_join(pkts, &done);
+	return ret;
+}
+
+void spw_link_get_stats(spw_link_t link, struct spw_link_stats *stats){
+	*stats = link->stats;
+}
+
+void spw_link_stats_print(spw_link_t link){
+	struct spw_link_stats *s = &link->stats;
+
+	printf("SpW link: tx %u pkts %u bytes, %u errors, rx %u pkts %u bytes, "
+		"%u EEP, %u truncated\n",
+		s->tx_pkts, s->tx_bytes, s->tx_errs, s->rx_pkts, s->rx_bytes,
+		s->rx_eep, s->rx_trunk);
+}
+
+/*** Loopback backend ***/
+
+/* One end of the loop. Sent packets wait in txq until the other end has a
+ * prepared buffer, then the data is copied into it as the DMA engines would
+ * and both packets are moved to the done lists. The ring of an end is full
+ * when packets queued plus done but not yet taken back reach depth.
+ */
+struct loop_end {
+	struct spw_loop *loop;
+	struct loop_end *peer;
+	struct spw_list txq;
+	struct spw_list txdone;
+	struct spw_list rxfree;
+	struct spw_list rxdone;
+};
+
+struct spw_loop {
+	int depth;
+	int open;		/* Ends not closed */
+	struct loop_end end[2];
+#ifdef __rtems__
+	rtems_id lock;
+#else
+	pthread_mutex_t lock;
+#endif
+};
+
+#ifdef __rtems__
+#define LOOP_LOCK(l) rtems_semaphore_obtain((l)->lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT)
+#define LOOP_UNLOCK(l) rtems_semaphore_release((l)->lock)
+#else
+#define LOOP_LOCK(l) pthread_mutex_lock(&(l)->lock)
+#define LOOP_UNLOCK(l) pthread_mutex_unlock(&(l)->lock)
+#endif
+
+/* Transfer packets from src to dst while both sides have descriptors */
+static void loop_wire(struct loop_end *src, struct loop_end *dst)
+{
+	struct spw_pkt *tx, *rx;
+	unsigned int size, len, n;
+	unsigned char *p;
+
+	while ( src->txq.head && dst->rxfree.head ) {
+		tx = spw_list_take(&src->txq);
+		rx = spw_list_take(&dst->rxfree);
+
+		size = rx->dlen;
+		p = rx->data;
+		n = tx->hlen < size ? tx->hlen : size;
+		if ( n )
+			memcpy(p, tx->hdr, n);
+		len = n;
+		n = tx->dlen < size - len ? tx->dlen : size - len;
+		memcpy(p + len, tx->data, n);
+		len += n;
+
+		rx->dlen = len;
+		rx->flags = SPW_RXPKT_RX;
+		if ( (unsigned int)tx->hlen + tx->dlen > size )
+			rx->flags |= SPW_RXPKT_TRUNK;
+		rx->ts = spw_time_us();
+		spw_list_add(&dst->rxdone, rx);
+
+		tx->flags |= SPW_TXPKT_TX;
+		spw_list_add(&src->txdone, tx);
+	}
+}
+
+static int loop_send(void *priv, struct spw_list *pkts)
+{
+	struct loop_end *end = priv;
+	struct spw_loop *loop = end->loop;
+	struct spw_pkt *pkt;
+	int n = 0;
+
+	LOOP_LOCK(loop);
+	while ( (end->txq.cnt + end->txdone.cnt < loop->depth) &&
+	        (pkt = spw_list_take(pkts)) ) {
+		pkt->flags &= ~(SPW_TXPKT_TX | SPW_TXPKT_LINKERR);
+		spw_list_add(&end->txq, pkt);
+		n++;
+	}
+	loop_wire(end, end->peer);
+	LOOP_UNLOCK(loop);
+	return n;
+}
+
+static int loop_reclaim(void *priv, struct spw_list *pkts)
+{
+	struct loop_end *end = priv;
+	int n;
+
+	LOOP_LOCK(end->loop);
+	n = end->txdone.cnt;
+	spw_list_join(pkts, &end->txdone);
+	LOOP_UNLOCK(end->loop);
+	return n;
+}
+
+static int loop_prepare(void *priv, struct spw_list *pkts)
+{
+	struct loop_end *end = priv;
+	struct spw_loop *loop = end->loop;
+	struct spw_pkt *pkt;
+	int n = 0;
+
+	LOOP_LOCK(loop);
+	while ( (end->rxfree.cnt + end->rxdone.cnt < loop->depth) &&
+	        (pkt = spw_list_take(pkts)) ) {
+		pkt->flags = 0;
+		spw_list_add(&end->rxfree, pkt);
+		n++;
+	}
+	loop_wire(end->peer, end);
+	LOOP_UNLOCK(loop);
+	return n;
+}
+
+static int loop_recv(void *priv, struct spw_list *pkts)
+{
+	struct loop_end *end = priv;
+	int n;
+
+	LOOP_LOCK(end->loop);
+	n = end->rxdone.cnt;
+	spw_list_join(pkts, &end->rxdone);
+	LOOP_UNLOCK(end->loop);
+	return n;
+}
+
+static void loop_close(void *priv)
+{
+	struct loop_end *end = priv;
+	struct spw_loop *loop = end->loop;
+	int last;
+
+	LOOP_LOCK(loop);
+	last = --loop->open == 0;
+	LOOP_UNLOCK(loop);
+	if ( !last )
+		return;
+#ifdef __rtems__
+	rtems_semaphore_delete(loop->lock);
+#else
+	pthread_mutex_destroy(&loop->lock);
+#endif
+	free(loop);
+}
+
+static const struct spw_link_ops loop_ops = {
+	loop_send, loop_reclaim, loop_prepare, loop_recv, loop_close
+};
+
+int spw_link_loop(int depth, spw_link_t *a, spw_link_t *b){
+	struct spw_loop *loop;
+	int i;
+
+	if ( depth < 1 )
+		return -1;
+	loop = calloc(1, sizeof(*loop));
+	if ( !loop )
+		return -1;
+#ifdef __rtems__
+	if ( rtems_semaphore_create(rtems_build_name('S','L','O','P'), 1,
+	     RTEMS_BINARY_SEMAPHORE | RTEMS_PRIORITY | RTEMS_INHERIT_PRIORITY,
+	     0, &loop->lock) != RTEMS_SUCCESSFUL ) {
+		printf("spw_link_loop: failed to create semaphore\n");
+		free(loop);
+		return -1;
+	}
+#else
+	pthread_mutex_init(&loop->lock, NULL);
+#endif
+	loop->depth = depth;
+	loop->open = 2;
+	for (i=0; i<2; i++) {
+		loop->end[i].loop = loop;
+		loop->end[i].peer = &loop->end[i ^ 1];
+		spw_list_init(&loop->end[i].txq);
+		spw_list_init(&loop->end[i].txdone);
+		spw_list_init(&loop->end[i].rxfree);
+		spw_list_init(&loop->end[i].rxdone);
+	}
+
+	*a = spw_link_create(&loop_ops, &loop->end[0]);
+	*b = spw_link_create(&loop_ops, &loop->end[1]);
+	if ( !*a || !*b ) {
+		free(*a);
+		free(*b);
+#ifdef __rtems__
+		rtems_semaphore_delete(loop->lock);
+#else
+		pthread_mutex_destroy(&loop->lock);
+#endif
+		free(loop);
+		return -1;
+	}
+	return 0;
+}
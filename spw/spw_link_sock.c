@@ -0,0 +1,370 @@
+/* Linux: SpaceWire link over a stream socket, see spw_link.h
+ *
+ * Two processes connected with a TCP socket stand for two nodes connected
+ * with a SpaceWire cable. Every packet is sent as a frame of a 4 byte
+ * header and the packet:
+ *
+ *   0     flags, bit 0 set when the packet ended with EEP
+ *   1..3  packet length, big endian
+ *
+ * The socket is non-blocking. Packets are written from their buffers with
+ * writev() and read into the prepared buffers, a frame longer than the
+ * buffer is truncated. A frame that could only be written in part is
+ * continued on the next call of any link function.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "spw_link.h"
+
+#define FRAME_HDR	4
+#define FRAME_EEP	0x01
+
+struct sock_link {
+	int fd;
+	int depth;
+	int error;
+	struct spw_list txq;		/* Head is being written */
+	unsigned int tx_off;		/* Bytes of head frame written */
+	struct spw_list txdone;
+	struct spw_list rxfree;
+	struct spw_list rxdone;
+	unsigned char rx_hdr[FRAME_HDR];
+	unsigned int rx_hdr_got;
+	struct spw_pkt *rx_pkt;		/* Buffer of the frame being read */
+	unsigned int rx_len;		/* Packet length of the frame */
+	unsigned int rx_got;
+	unsigned int rx_size;		/* Size of rx_pkt buffer */
+};
+
+/* Write queued frames until the socket is full. Returns -1 on errors */
+static int sock_tx_pump(struct sock_link *sl)
+{
+	struct spw_pkt *pkt;
+	struct iovec iov[3];
+	unsigned char hdr[FRAME_HDR];
+	unsigned int len, off;
+	int i, n;
+	ssize_t ret;
+
+	while ( (pkt = sl->txq.head) && !sl->error ) {
+		len = pkt->hlen + pkt->dlen;
+		hdr[0] = 0;
+		hdr[1] = len >> 16;
+		hdr[2] = len >> 8;
+		hdr[3] = len;
+		iov[0].iov_base = hdr;
+		iov[0].iov_len = FRAME_HDR;
+		iov[1].iov_base = pkt->hdr;
+		iov[1].iov_len = pkt->hlen;
+		iov[2].iov_base = pkt->data;
+		iov[2].iov_len = pkt->dlen;
+
+		/* Skip what was written before */
+		off = sl->tx_off;
+		for (i=0; (i<3) && (off >= iov[i].iov_len); i++)
+			off -= iov[i].iov_len;
+		iov[i].iov_base = (char *)iov[i].iov_base + off;
+		iov[i].iov_len -= off;
+		n = 3 - i;
+
+		ret = writev(sl->fd, &iov[i], n);
+		if ( ret < 0 ) {
+			if ( (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR) )
+				return 0;
+			sl->error = 1;
+			break;
+		}
+		sl->tx_off += ret;
+		if ( sl->tx_off < FRAME_HDR + len )
+			return 0;
+		sl->tx_off = 0;
+		spw_list_take(&sl->txq);
+		pkt->flags |= SPW_TXPKT_TX;
+		spw_list_add(&sl->txdone, pkt);
+	}
+	if ( !sl->error )
+		return 0;
+
+	/* Connection lost, nothing more is sent */
+	while ( (pkt = spw_list_take(&sl->txq)) ) {
+		pkt->flags |= SPW_TXPKT_LINKERR;
+		spw_list_add(&sl->txdone, pkt);
+	}
+	return -1;
+}
+
+/* Result of a read() that returned ret <= 0 */
+static int sock_rx_end(struct sock_link *sl, ssize_t ret)
+{
+	if ( (ret == 0) ||
+	     ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) )
+		sl->error = 1;
+	return sl->error ? -1 : 0;
+}
+
+/* Read frames into prepared buffers until the socket is empty */
+static int sock_rx_pump(struct sock_link *sl)
+{
+	static unsigned char discard[1024];
+	struct spw_pkt *pkt;
+	unsigned int want;
+	ssize_t ret;
+	void *dst;
+
+	while ( !sl->error ) {
+		if ( sl->rx_hdr_got < FRAME_HDR ) {
+			ret = read(sl->fd, &sl->rx_hdr[sl->rx_hdr_got], FRAME_HDR - sl->rx_hdr_got);
+			if ( ret <= 0 )
+				return sock_rx_end(sl, ret);
+			sl->rx_hdr_got += ret;
+			continue;
+		}
+		if ( !sl->rx_pkt ) {
+			pkt = spw_list_take(&sl->rxfree);
+			if ( !pkt )
+				return 0;	/* Wait for buffers, TCP holds the rest */
+			sl->rx_pkt = pkt;
+			sl->rx_size = pkt->dlen;
+			sl->rx_len = (sl->rx_hdr[1] << 16) | (sl->rx_hdr[2] << 8) | sl->rx_hdr[3];
+			sl->rx_got = 0;
+		}
+		pkt = sl->rx_pkt;
+		if ( sl->rx_got < sl->rx_len ) {
+			if ( sl->rx_got < sl->rx_size ) {
+				dst = (unsigned char *)pkt->data + sl->rx_got;
+				want = sl->rx_size - sl->rx_got;
+			} else {
+				dst = discard;
+				want = sizeof(discard);
+			}
+			if ( want > sl->rx_len - sl->rx_got )
+				want = sl->rx_len - sl->rx_got;
+			ret = read(sl->fd, dst, want);
+			if ( ret <= 0 )
+				return sock_rx_end(sl, ret);
+			sl->rx_got += ret;
+			if ( sl->rx_got < sl->rx_len )
+				continue;
+		}
+
+		pkt->flags = SPW_RXPKT_RX;
+		if ( sl->rx_hdr[0] & FRAME_EEP )
+			pkt->flags |= SPW_RXPKT_EEP;
+		if ( sl->rx_len > sl->rx_size ) {
+			pkt->flags |= SPW_RXPKT_TRUNK;
+			pkt->dlen = sl->rx_size;
+		} else {
+			pkt->dlen = sl->rx_len;
+		}
+		pkt->ts = spw_time_us();
+		spw_list_add(&sl->rxdone, pkt);
+		sl->rx_pkt = NULL;
+		sl->rx_hdr_got = 0;
+	}
+	return -1;
+}
+
+static int sock_send(void *priv, struct spw_list *pkts)
+{
+	struct sock_link *sl = priv;
+	struct spw_pkt *pkt;
+	int n = 0;
+
+	while ( (sl->txq.cnt + sl->txdone.cnt < sl->depth) &&
+	        (pkt = spw_list_take(pkts)) ) {
+		pkt->flags &= ~(SPW_TXPKT_TX | SPW_TXPKT_LINKERR);
+		spw_list_add(&sl->txq, pkt);
+		n++;
+	}
+	if ( sock_tx_pump(sl) && !n )
+		return -1;
+	return n;
+}
+
+static int sock_reclaim(void *priv, struct spw_list *pkts)
+{
+	struct sock_link *sl = priv;
+	int n;
+
+	sock_tx_pump(sl);
+	n = sl->txdone.cnt;
+	spw_list_join(pkts, &sl->txdone);
+	return n;
+}
+
+static int sock_prepare(void *priv, struct spw_list *pkts)
+{
+	struct sock_link *sl = priv;
+	struct spw_pkt *pkt;
+	int n = 0;
+
+	while ( (sl->rxfree.cnt + sl->rxdone.cnt < sl->depth) &&
+	        (pkt = spw_list_take(pkts)) ) {
+		pkt->flags = 0;
+		spw_list_add(&sl->rxfree, pkt);
+		n++;
+	}
+	return n;
+}
+
+static int sock_recv(void *priv, struct spw_list *pkts)
+{
+	struct sock_link *sl = priv;
+	int n, ret;
+
+	sock_tx_pump(sl);
+	ret = sock_rx_pump(sl);
+	n = sl->rxdone.cnt;
+	spw_list_join(pkts, &sl->rxdone);
+	if ( (n == 0) && ret )
+		return -1;
+	return n;
+}
+
+static void sock_close(void *priv)
+{
+	struct sock_link *sl = priv;
+
+	/* Packets still owned by the link go back to their pools */
+	spw_pool_put_list(&sl->txq);
+	spw_pool_put_list(&sl->txdone);
+	spw_pool_put_list(&sl->rxfree);
+	spw_pool_put_list(&sl->rxdone);
+	if ( sl->rx_pkt )
+		spw_pool_put(sl->rx_pkt);
+	free(sl);
+}
+
+static const struct spw_link_ops sock_ops = {
+	sock_send, sock_reclaim, sock_prepare, sock_recv, sock_close
+};
+
+spw_link_t spw_link_sock(int fd, int depth){
+	struct sock_link *sl;
+	spw_link_t link;
+
+	if ( depth < 1 )
+		return NULL;
+	if ( fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0 ) {
+		printf("spw_link_sock: failed to set non-blocking mode\n");
+		return NULL;
+	}
+	sl = calloc(1, sizeof(*sl));
+	if ( !sl )
+		return NULL;
+	sl->fd = fd;
+	sl->depth = depth;
+	spw_list_init(&sl->txq);
+	spw_list_init(&sl->txdone);
+	spw_list_init(&sl->rxfree);
+	spw_list_init(&sl->rxdone);
+	link = spw_link_create(&sock_ops, sl);
+	if ( !link )
+		free(sl);
+	return link;
+}
+
+int spw_link_sock_wait(spw_link_t link, unsigned int timeout_us){
+	struct sock_link *sl = link->priv;
+	struct timeval tv;
+	fd_set rd, wr;
+
+	if ( sl->error )
+		return -1;
+	FD_ZERO(&rd);
+	FD_ZERO(&wr);
+	FD_SET(sl->fd, &rd);
+	if ( sl->txq.head )
+		FD_SET(sl->fd, &wr);
+	tv.tv_sec = timeout_us / 1000000;
+	tv.tv_usec = timeout_us % 1000000;
+	return select(sl->fd + 1, &rd, &wr, NULL, &tv);
+}
+
+static void sock_nodelay(int fd)
+{
+	int one = 1;
+
+	/* Packets are small and latency matters more than the segment count */
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int spw_sock_connect(const char *host, int port){
+	struct addrinfo hints, *res, *ai;
+	char service[16];
+	int fd = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", port);
+	if ( getaddrinfo(host, service, &hints, &res) ) {
+		printf("spw_sock_connect: unknown host %s\n", host);
+		return -1;
+	}
+	for (ai=res; ai; ai=ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if ( fd < 0 )
+			continue;
+		if ( connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 )
+			break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if ( fd < 0 ) {
+		printf("spw_sock_connect: failed to connect to %s:%d (%s)\n",
+			host, port, strerror(errno));
+		return -1;
+	}
+	sock_nodelay(fd);
+	return fd;
+}
+
+int spw_sock_listen(int port){
+	struct sockaddr_in addr;
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if ( fd < 0 ) {
+		printf("spw_sock_listen: socket: %s\n", strerror(errno));
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if ( (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+	     (listen(fd, 2) < 0) ) {
+		printf("spw_sock_listen: port %d: %s\n", port, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int spw_sock_accept(int lfd){
+	int fd;
+
+	fd = accept(lfd, NULL, NULL);
+	if ( fd < 0 ) {
+		printf("spw_sock_accept: %s\n", strerror(errno));
+		return -1;
+	}
+	sock_nodelay(fd);
+	return fd;
+}
@@ -0,0 +1,223 @@
+/* SpaceWire packet buffer pool, see spw_pkt.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __rtems__
+#include <rtems.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "spw_pkt.h"
+
+struct spw_pool_s {
+	int size;
+	int cnt;
+	struct spw_pkt *pkts;
+	void *mem;		/* Unaligned buffer memory */
+	struct spw_pkt *free;	/* Stack of free packets */
+	int nfree;
+	int min_free;
+	unsigned int empty;
+#ifdef __rtems__
+	rtems_id lock;
+#else
+	pthread_mutex_t lock;
+#endif
+};
+
+#ifdef __rtems__
+#define POOL_LOCK(p) rtems_semaphore_obtain((p)->lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT)
+#define POOL_UNLOCK(p) rtems_semaphore_release((p)->lock)
+#else
+#define POOL_LOCK(p) pthread_mutex_lock(&(p)->lock)
+#define POOL_UNLOCK(p) pthread_mutex_unlock(&(p)->lock)
+#endif
+
+spw_pool_t spw_pool_create(int cnt, int size){
+	spw_pool_t pool;
+	unsigned char *buf;
+	int i;
+
+	if ( (cnt < 1) || (size < 1) )
+		return NULL;
+
+	pool = calloc(1, sizeof(*pool));
+	if ( !pool )
+		return NULL;
+	size = (size + SPW_POOL_ALIGN - 1) & ~(SPW_POOL_ALIGN - 1);
+	pool->pkts = calloc(cnt, sizeof(struct spw_pkt));
+	pool->mem = malloc(cnt * size + SPW_POOL_ALIGN - 1);
+	if ( !pool->pkts || !pool->mem ) {
+		printf("spw_pool_create: failed to allocate %d buffers of %d bytes\n", cnt, size);
+		goto fail;
+	}
+#ifdef __rtems__
+	if ( rtems_semaphore_create(rtems_build_name('S','P','O','L'), 1,
+	     RTEMS_BINARY_SEMAPHORE | RTEMS_PRIORITY | RTEMS_INHERIT_PRIORITY,
+	     0, &pool->lock) != RTEMS_SUCCESSFUL ) {
+		printf("spw_pool_create: failed to create semaphore\n");
+		goto fail;
+	}
+#else
+	pthread_mutex_init(&pool->lock, NULL);
+#endif
+	pool->size = size;
+	pool->cnt = cnt;
+
+	buf = (unsigned char *)(((unsigned long)pool->mem + SPW_POOL_ALIGN - 1) &
+		~(unsigned long)(SPW_POOL_ALIGN - 1));
+	for (i=cnt-1; i>=0; i--) {
+		pool->pkts[i].data = buf + i * size;
+		pool->pkts[i].pool = pool;
+		pool->pkts[i].next = pool->free;
+		pool->free = &pool->pkts[i];
+	}
+	pool->nfree = pool->min_free = cnt;
+
+	return pool;
+
+fail:
+	free(pool->pkts);
+	free(pool->mem);
+	free(pool);
+	return NULL;
+}
+
+void spw_pool_free(spw_pool_t pool){
+	if ( !pool )
+		return;
+	if ( pool->nfree != pool->cnt )
+		printf("spw_pool_free: %d packets not put back\n", pool->cnt - pool->nfree);
+#ifdef __rtems__
+	rtems_semaphore_delete(pool->lock);
+#else
+	pthread_mutex_destroy(&pool->lock);
+#endif
+	free(pool->pkts);
+	free(pool->mem);
+	free(pool);
+}
+
+int spw_pool_size(spw_pool_t pool){
+	return pool->size;
+}
+
+static void pool_reset(spw_pool_t pool, struct spw_pkt *pkt)
+{
+	pkt->next = NULL;
+	pkt->flags = 0;
+	pkt->reserved = 0;
+	pkt->hlen = 0;
+	pkt->hdr = NULL;
+	pkt->dlen = pool->size;
+}
+
+struct spw_pkt *spw_pool_get(spw_pool_t pool){
+	struct spw_pkt *pkt;
+
+	POOL_LOCK(pool);
+	pkt = pool->free;
+	if ( pkt ) {
+		pool->free = pkt->next;
+		if ( --pool->nfree < pool->min_free )
+			pool->min_free = pool->nfree;
+	} else {
+		pool->empty++;
+	}
+	POOL_UNLOCK(pool);
+
+	if ( pkt )
+		pool_reset(pool, pkt);
+	return pkt;
+}
+
+int spw_pool_get_list(spw_pool_t pool, struct spw_list *list, int cnt){
+	struct spw_pkt *first, *last = NULL;
+	int i;
+
+	if ( cnt < 1 )
+		return 0;
+
+	/* Unlink a chain from the stack, reset it outside the lock */
+	POOL_LOCK(pool);
+	first = pool->free;
+	for (i=0; (i<cnt) && pool->free; i++) {
+		last = pool->free;
+		pool->free = last->next;
+	}
+	pool->nfree -= i;
+	if ( pool->nfree < pool->min_free )
+		pool->min_free = pool->nfree;
+	if ( i < cnt )
+		pool->empty++;
+	POOL_UNLOCK(pool);
+
+	if ( i == 0 )
+		return 0;
+	last->next = NULL;
+	while ( first ) {
+		struct spw_pkt *next = first->next;
+
+		pool_reset(pool, first);
+		spw_list_add(list, first);
+		first = next;
+	}
+	return i;
+}
+
+void spw_pool_put(struct spw_pkt *pkt){
+	spw_pool_t pool = pkt->pool;
+
+	POOL_LOCK(pool);
+	pkt->next = pool->free;
+	pool->free = pkt;
+	pool->nfree++;
+	POOL_UNLOCK(pool);
+}
+
+void spw_pool_put_list(struct spw_list *list){
+	struct spw_pkt *pkt, *first, *last;
+	spw_pool_t pool;
+	int n;
+
+	/* Put back runs of packets from the same pool under one lock */
+	pkt = list->head;
+	while ( pkt ) {
+		pool = pkt->pool;
+		first = last = pkt;
+		n = 1;
+		while ( last->next && (last->next->pool == pool) ) {
+			last = last->next;
+			n++;
+		}
+		pkt = last->next;
+
+		POOL_LOCK(pool);
+		last->next = pool->free;
+		pool->free = first;
+		pool->nfree += n;
+		POOL_UNLOCK(pool);
+	}
+	spw_list_init(list);
+}
+
+void spw_pool_get_stats(spw_pool_t pool, struct spw_pool_stats *stats){
+	POOL_LOCK(pool);
+	stats->size = pool->size;
+	stats->cnt = pool->cnt;
+	stats->free = pool->nfree;
+	stats->min_free = pool->min_free;
+	stats->empty = pool->empty;
+	POOL_UNLOCK(pool);
+}
+
+void spw_pool_stats_print(spw_pool_t pool){
+	struct spw_pool_stats stats;
+
+	spw_pool_get_stats(pool, &stats);
+	printf("SpW pool: %d x %d bytes, free %d, min free %d, empty %u\n",
+		stats.cnt, stats.size, stats.free, stats.min_free, stats.empty);
+}
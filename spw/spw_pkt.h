@@ -0,0 +1,167 @@
+
+#ifndef __SPW_PKT_H__
+#define __SPW_PKT_H__
+
+/* SpaceWire packet buffer pool
+ *
+ * A pool is a fixed number of buffers of the same size, allocated once
+ * when the pool is created. Buffers are aligned to SPW_POOL_ALIGN, the
+ * LEON cache line size, so that DMA into one buffer and cache invalidation
+ * of it never touch a neighbouring buffer, and the buffer size is rounded
+ * up to a multiple of it.
+ *
+ * Each buffer is described by a struct spw_pkt. Its first fields have the
+ * layout of the GRSPW packet driver's struct grspw_pkt, so lists of pool
+ * packets are given to the DMA rings of that driver and come back from
+ * them without conversion or copying, see spw_link.h. The fields after
+ * those are not seen by drivers.
+ *
+ * Packets are passed around in singly linked lists. A packet belongs to
+ * whoever has it in a list: the pool, the application or a link. Getting
+ * and putting packets is O(1) and may be done from any task.
+ */
+
+#include <stddef.h>
+
+#define SPW_POOL_ALIGN	32
+
+/* Free running microsecond clock, wraps after 71 minutes */
+#ifdef __rtems__
+#include <rtems.h>
+static inline unsigned int spw_time_us(void)
+{
+	struct timespec ts;
+
+	rtems_clock_get_uptime(&ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+#else
+#include <time.h>
+static inline unsigned int spw_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned int)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+#endif
+
+/* Packet flags, bit positions as in the GRSPW packet driver */
+#define SPW_PKT_IE		0x0040	/* Interrupt when done (driver) */
+#define SPW_RXPKT_TRUNK		0x0080	/* Truncated, longer than buffer */
+#define SPW_RXPKT_EEP		0x0100	/* Ended with error end of packet */
+#define SPW_RXPKT_DCRC		0x0200	/* RMAP data CRC error */
+#define SPW_RXPKT_HCRC		0x0400	/* RMAP header CRC error */
+#define SPW_RXPKT_RX		0x8000	/* Received */
+#define SPW_TXPKT_HCRC		0x0100	/* Hardware appends header CRC */
+#define SPW_TXPKT_DCRC		0x0200	/* Hardware appends data CRC */
+#define SPW_TXPKT_LINKERR	0x4000	/* Link error while sending */
+#define SPW_TXPKT_TX		0x8000	/* Sent */
+
+struct spw_pkt {
+	/* Layout of struct grspw_pkt */
+	struct spw_pkt *next;
+	unsigned int pkt_id;	/* Free for the application */
+	unsigned short flags;	/* SPW_PKT_ flags */
+	unsigned char reserved;	/* Must be zero */
+	unsigned char hlen;	/* TX: length of hdr, sent before data */
+	unsigned int dlen;	/* TX: length to send, RX: length received */
+	void *data;		/* The pool buffer */
+	void *hdr;		/* TX: optional header, NULL if hlen is 0 */
+
+	/* Not seen by drivers */
+	unsigned int ts;	/* RX: time received [us] */
+	struct spw_pool_s *pool;	/* Owner of data */
+};
+
+struct spw_list {
+	struct spw_pkt *head;
+	struct spw_pkt *tail;
+	int cnt;
+};
+
+typedef struct spw_pool_s *spw_pool_t;
+
+struct spw_pool_stats {
+	int size;		/* Buffer size after rounding */
+	int cnt;		/* Buffers in pool */
+	int free;		/* Buffers in pool now */
+	int min_free;		/* Fewest buffers in pool since created */
+	unsigned int empty;	/* Gets that returned less than asked for */
+};
+
+static inline void spw_list_init(struct spw_list *l)
+{
+	l->head = l->tail = NULL;
+	l->cnt = 0;
+}
+
+static inline void spw_list_add(struct spw_list *l, struct spw_pkt *pkt)
+{
+	pkt->next = NULL;
+	if ( l->tail )
+		l->tail->next = pkt;
+	else
+		l->head = pkt;
+	l->tail = pkt;
+	l->cnt++;
+}
+
+/* Remove first packet, NULL if list is empty */
+static inline struct spw_pkt *spw_list_take(struct spw_list *l)
+{
+	struct spw_pkt *pkt = l->head;
+
+	if ( pkt ) {
+		l->head = pkt->next;
+		if ( !l->head )
+			l->tail = NULL;
+		l->cnt--;
+		pkt->next = NULL;
+	}
+	return pkt;
+}
+
+/* Move all packets of src to the end of dst */
+static inline void spw_list_join(struct spw_list *dst, struct spw_list *src)
+{
+	if ( !src->head )
+		return;
+	if ( dst->tail )
+		dst->tail->next = src->head;
+	else
+		dst->head = src->head;
+	dst->tail = src->tail;
+	dst->cnt += src->cnt;
+	spw_list_init(src);
+}
+
+/* Create pool of cnt buffers of at least size bytes. NULL on failure. */
+spw_pool_t spw_pool_create(int cnt, int size);
+
+/* Free pool, all packets must have been put back */
+void spw_pool_free(spw_pool_t pool);
+
+/* Buffer size of the pool, a multiple of SPW_POOL_ALIGN */
+int spw_pool_size(spw_pool_t pool);
+
+/* Get one packet, NULL if the pool is empty. The packet is reset: dlen
+ * is the buffer size, no header and no flags.
+ */
+struct spw_pkt *spw_pool_get(spw_pool_t pool);
+
+/* Get up to cnt packets appended to list, returns number of packets got */
+int spw_pool_get_list(spw_pool_t pool, struct spw_list *list, int cnt);
+
+void spw_pool_put(struct spw_pkt *pkt);
+
+/* Put back all packets of a list, they may be from different pools. The
+ * list is empty afterwards.
+ */
+void spw_pool_put_list(struct spw_list *list);
+
+void spw_pool_get_stats(spw_pool_t pool, struct spw_pool_stats *stats);
+
+void spw_pool_stats_print(spw_pool_t pool);
+
+#endif
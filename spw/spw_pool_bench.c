@@ -0,0 +1,165 @@
+/* Linux benchmark of zero-copy packet transfer against the copy path
+ *
+ * Packets are sent through a spw_link_loop() pair, the wire copy between
+ * the two ends stands for the DMA of the hardware. Two paths are measured
+ * for a number of packet sizes:
+ *
+ *   copy   The application builds the packet in its own buffer which is
+ *          copied into a driver buffer, and the received packet is copied
+ *          out of the driver buffer into an application buffer. This is
+ *          what write() and read() of the GRSPW character driver do.
+ *   zero   The application builds the packet in a pool buffer and reads
+ *          the received packet where it was received, buffers go to the
+ *          link and back in lists.
+ *
+ * In both paths only a sequence number is written and checked by the
+ * application, so the difference is the cost of the two copies.
+ *
+ * usage: spw_pool_bench [MBYTES_PER_TEST]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "spw_pkt.h"
+#include "spw_link.h"
+
+#define POOL_CNT	256
+#define POOL_SIZE	4096
+#define RING_DEPTH	64
+#define BATCH		32
+
+unsigned int sizes[] = {16, 64, 256, 1024, 4096};
+#define SIZE_CNT (sizeof(sizes)/sizeof(unsigned int))
+
+unsigned char app_tx[POOL_SIZE];
+unsigned char app_rx[POOL_SIZE];
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void put_seq(unsigned char *p, unsigned int seq)
+{
+	p[0] = seq >> 24;
+	p[1] = seq >> 16;
+	p[2] = seq >> 8;
+	p[3] = seq;
+}
+
+static unsigned int get_seq(unsigned char *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* Send cnt packets of size bytes from a to b. Returns number of errors,
+ * time taken in *t.
+ */
+int run(spw_pool_t pool, spw_link_t a, spw_link_t b, unsigned int size,
+	unsigned int cnt, int copy, double *t)
+{
+	struct spw_list txl, rxl, done;
+	struct spw_pkt *pkt;
+	unsigned int tx_seq = 0, rx_seq = 0;
+	int errs = 0, n;
+	double start;
+
+	spw_list_init(&txl);
+	spw_list_init(&rxl);
+	spw_list_init(&done);
+	start = now();
+	while ( rx_seq < cnt ) {
+		/* Keep the receiver supplied with buffers */
+		spw_pool_get_list(pool, &rxl, RING_DEPTH);
+		spw_link_prepare(b, &rxl);
+		spw_pool_put_list(&rxl);
+
+		/* Build a batch, packets the ring had no room for are sent again */
+		if ( txl.cnt == 0 ) {
+			n = cnt - tx_seq < BATCH ? cnt - tx_seq : BATCH;
+			spw_pool_get_list(pool, &txl, n);
+			for (pkt=txl.head; pkt; pkt=pkt->next) {
+				if ( copy ) {
+					put_seq(app_tx, tx_seq);
+					memcpy(pkt->data, app_tx, size);
+				} else {
+					put_seq(pkt->data, tx_seq);
+				}
+				pkt->dlen = size;
+				tx_seq++;
+			}
+		}
+		spw_link_send(a, &txl);
+
+		spw_link_reclaim(a, &done);
+		spw_pool_put_list(&done);
+
+		/* Check received packets */
+		spw_link_recv(b, &done);
+		for (pkt=done.head; pkt; pkt=pkt->next) {
+			unsigned char *p = pkt->data;
+
+			if ( copy ) {
+				memcpy(app_rx, pkt->data, pkt->dlen);
+				p = app_rx;
+			}
+			if ( (pkt->dlen != size) || (get_seq(p) != rx_seq) )
+				errs++;
+			rx_seq++;
+		}
+		spw_pool_put_list(&done);
+	}
+	*t = now() - start;
+
+	spw_link_reclaim(a, &done);
+	spw_pool_put_list(&done);
+	return errs;
+}
+
+int main(int argc, char *argv[])
+{
+	spw_pool_t pool;
+	spw_link_t a, b;
+	unsigned int mbytes = 256, cnt, i;
+	double t_copy, t_zero;
+	int errs = 0;
+
+	if ( argc > 1 )
+		mbytes = atoi(argv[1]);
+	if ( mbytes < 1 ) {
+		printf("usage: %s [MBYTES_PER_TEST]\n", argv[0]);
+		return 1;
+	}
+
+	pool = spw_pool_create(POOL_CNT, POOL_SIZE);
+	if ( !pool || spw_link_loop(RING_DEPTH, &a, &b) ) {
+		printf("Failed to create pool or links\n");
+		return 1;
+	}
+	printf("%u MB per test, %d packets per batch, ring depth %d\n",
+		mbytes, BATCH, RING_DEPTH);
+	printf("  size      copy pkts/s    MB/s      zero pkts/s    MB/s   speedup\n");
+	for (i=0; i<SIZE_CNT; i++) {
+		cnt = ((unsigned long long)mbytes << 20) / sizes[i];
+		errs += run(pool, a, b, sizes[i], cnt, 1, &t_copy);
+		errs += run(pool, a, b, sizes[i], cnt, 0, &t_zero);
+		printf("%6u %16.0f %7.1f %16.0f %7.1f %8.2fx\n", sizes[i],
+			cnt / t_copy, cnt * sizes[i] / t_copy / 1e6,
+			cnt / t_zero, cnt * sizes[i] / t_zero / 1e6,
+			t_copy / t_zero);
+	}
+
+	spw_link_stats_print(a);
+	spw_link_stats_print(b);
+	spw_pool_stats_print(pool);
+	if ( errs ) {
+		printf("%d packets with wrong length or sequence\n", errs);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,135 @@
+/* Linux: SpaceWire benchmark suite over a loopback link pair
+ *
+ * Runs spw_bench_run() against spw_bench_target() in a second thread, the
+ * two are connected with spw_link_loop(). With -s the target is the node
+ * emulator spwnode.c instead, over a spw_link_sock() link. The results are
+ * printed as comma separated tables, see spw_bench.h.
+ *
+ * usage: spwbench [-z SIZE,SIZE,...] [-t STREAM_MS] [-n PINGS] [-d DEPTH]
+ *                 [-s HOST:PORT]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "spw_pkt.h"
+#include "spw_link.h"
+#include "spw_bench.h"
+
+#define POOL_CNT	256
+#define TARGET_IDLE_US	5000000
+
+struct target_arg {
+	spw_link_t link;
+	spw_pool_t pool;
+	int ret;
+};
+
+void *target_thread(void *arg)
+{
+	struct target_arg *ta = arg;
+
+	ta->ret = spw_bench_target(ta->link, ta->pool, 0xfe, TARGET_IDLE_US);
+	return NULL;
+}
+
+int parse_sizes(char *arg, struct spw_bench_cfg *cfg)
+{
+	char *tok;
+
+	cfg->nsizes = 0;
+	for (tok=strtok(arg, ","); tok; tok=strtok(NULL, ",")) {
+		if ( cfg->nsizes >= SPW_BENCH_SIZES_MAX )
+			return -1;
+		cfg->sizes[cfg->nsizes++] = atoi(tok);
+	}
+	return cfg->nsizes ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+	struct spw_bench_cfg cfg;
+	struct spw_bench_res res;
+	struct target_arg ta;
+	spw_pool_t pool_i, pool_t;
+	spw_link_t a, b;
+	pthread_t thread;
+	char *server = NULL, *port;
+	int opt, depth = 64, i, max, fd, ret;
+
+	spw_bench_default_cfg(&cfg);
+	while ( (opt = getopt(argc, argv, "z:t:n:d:s:")) != -1 ) {
+		switch ( opt ) {
+		case 'z':
+			if ( parse_sizes(optarg, &cfg) )
+				goto usage;
+			break;
+		case 's': server = optarg; break;
+		case 't': cfg.stream_us = atoi(optarg) * 1000; break;
+		case 'n': cfg.pings = atoi(optarg); break;
+		case 'd': depth = atoi(optarg); break;
+		default:
+			goto usage;
+		}
+	}
+	if ( (cfg.stream_us == 0) || (cfg.pings < 0) || (depth < 1) )
+		goto usage;
+
+	max = 0;
+	for (i=0; i<cfg.nsizes; i++) {
+		if ( cfg.sizes[i] > max )
+			max = cfg.sizes[i];
+	}
+	if ( server ) {
+		port = strchr(server, ':');
+		if ( !port )
+			goto usage;
+		*port++ = '\0';
+		pool_i = spw_pool_create(POOL_CNT, max);
+		if ( !pool_i ) {
+			printf("Failed to create pool\n");
+			return 1;
+		}
+		fd = spw_sock_connect(server, atoi(port));
+		a = (fd < 0) ? NULL : spw_link_sock(fd, depth);
+		if ( !a )
+			return 1;
+		ret = spw_bench_run(a, pool_i, &cfg, &res);
+		spw_link_close(a);
+		close(fd);
+
+		printf("# node %s:%s, queue depth %d, %u ms per stream step, %d pings\n",
+			server, port, depth, cfg.stream_us / 1000, cfg.pings);
+		spw_bench_print(&res);
+		return ret ? 1 : 0;
+	}
+
+	/* One pool per side as on two boards */
+	pool_i = spw_pool_create(POOL_CNT, max);
+	pool_t = spw_pool_create(POOL_CNT, max);
+	if ( !pool_i || !pool_t || spw_link_loop(depth, &a, &b) ) {
+		printf("Failed to create pools or links\n");
+		return 1;
+	}
+
+	ta.link = b;
+	ta.pool = pool_t;
+	if ( pthread_create(&thread, NULL, target_thread, &ta) ) {
+		printf("Failed to create target thread\n");
+		return 1;
+	}
+	ret = spw_bench_run(a, pool_i, &cfg, &res);
+	pthread_join(thread, NULL);
+
+	printf("# loopback link, ring depth %d, %u ms per stream step, %d pings\n",
+		depth, cfg.stream_us / 1000, cfg.pings);
+	spw_bench_print(&res);
+	return (ret || ta.ret) ? 1 : 0;
+
+usage:
+	printf("usage: %s [-z SIZE,SIZE,...] [-t STREAM_MS] [-n PINGS] [-d DEPTH]\n"
+		"       [-s HOST:PORT]\n", argv[0]);
+	return 1;
+}
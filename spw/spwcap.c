@@ -0,0 +1,249 @@
+/* Linux client of the SpaceWire capture server, writes a pcap file
+ *
+ * Connects to capsrv.c on the board, polls it for captured packets and
+ * writes them to FILE in the classic pcap format, readable by tcpdump and
+ * Wireshark. There is no link type for SpaceWire, the file uses
+ * LINKTYPE_USER0 (147) and every packet is preceded by a 4 byte
+ * pseudo-header:
+ *
+ *   0   link     Link number of the sniffer
+ *   1   flags    SPW_CAP_EEP 0x01, SPW_CAP_TRUNK 0x02, SPW_CAP_SNAP 0x04
+ *   2   reserved
+ *   3   reserved
+ *
+ * In Wireshark set DLT User 147 to header size 4 and a dissector for the
+ * payload. Packet times are the board clock, placed so that the first
+ * packet carries the time of the host when it was received. Packets the
+ * board had to drop are reported, pcap has no record for them.
+ *
+ * usage: spwcap [-p PORT] [-n COUNT] HOST FILE
+ *
+ * Runs until COUNT packets are written, the server disconnects or ^C.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
+#include "spw_link.h"
+#include "capsrv.h"
+
+#define PCAP_MAGIC		0xa1b2c3d4
+#define LINKTYPE_USER0		147
+#define PSEUDO_HDR		4
+#define POLL_IDLE_US		100000
+
+struct pcap_file_hdr {
+	unsigned int magic;
+	unsigned short version_major;
+	unsigned short version_minor;
+	int thiszone;
+	unsigned int sigfigs;
+	unsigned int snaplen;
+	unsigned int linktype;
+};
+
+struct pcap_rec_hdr {
+	unsigned int ts_sec;
+	unsigned int ts_usec;
+	unsigned int incl_len;
+	unsigned int orig_len;
+};
+
+static volatile int stop;
+static unsigned char resp[sizeof(struct cap_hdr) + sizeof(struct cap_resp_get) +
+	CAPSRV_GET_MAX];
+
+/* Board time of the first packet and host time it stands for */
+static int time_set;
+static unsigned int ts_last;
+static unsigned long long board_us, host_us;
+
+static void sig_stop(int sig)
+{
+	stop = 1;
+}
+
+static int read_full(int s, void *buf, int len)
+{
+	int n, got = 0;
+
+	while ( got < len ) {
+		n = read(s, (char *)buf + got, len - got);
+		if ( n <= 0 )
+			return -1;
+		got += n;
+	}
+	return 0;
+}
+
+/* Send a command and read the response into resp, returns payload length */
+static int cap_command(int s, int cmdno)
+{
+	struct cap_hdr hdr;
+	int length;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.cmdno = cmdno;
+	if ( write(s, &hdr, sizeof(hdr)) != sizeof(hdr) )
+		return -1;
+	if ( read_full(s, resp, sizeof(hdr)) )
+		return -1;
+	memcpy(&hdr, resp, sizeof(hdr));
+	length = (hdr.length[0] << 8) | hdr.length[1];
+	if ( (hdr.cmdno != cmdno) ||
+	     (length > (int)(sizeof(resp) - sizeof(hdr))) ||
+	     read_full(s, resp + sizeof(hdr), length) )
+		return -1;
+	return length;
+}
+
+/* Write the records of a CAP_CMD_GET response */
+static int write_records(FILE *fp, unsigned char *p, int len, int cnt)
+{
+	struct pcap_rec_hdr rec;
+	struct timeval tv;
+	unsigned char pseudo[PSEUDO_HDR];
+	unsigned int ts, cap_len;
+	unsigned long long t;
+	int i;
+
+	for (i=0; i<cnt; i++) {
+		if ( len < SPW_CAP_REC_HDR )
+			return -1;
+		ts = cap_get32(&p[0]);
+		cap_len = (p[8] << 8) | p[9];
+		if ( (int)(SPW_CAP_REC_HDR + cap_len) > len )
+			return -1;
+
+		/* Board time wraps at 32 bits, count it up in 64 */
+		if ( !time_set ) {
+			gettimeofday(&tv, NULL);
+			host_us = tv.tv_sec * 1000000ULL + tv.tv_usec;
+			board_us = 0;
+			time_set = 1;
+		} else {
+			board_us += ts - ts_last;
+		}
+		ts_last = ts;
+		t = host_us + board_us;
+
+		rec.ts_sec = t / 1000000;
+		rec.ts_usec = t % 1000000;
+		rec.incl_len = PSEUDO_HDR + cap_len;
+		rec.orig_len = PSEUDO_HDR + cap_get32(&p[4]);
+		pseudo[0] = p[10];
+		pseudo[1] = p[11];
+		pseudo[2] = 0;
+		pseudo[3] = 0;
+		if ( (fwrite(&rec, sizeof(rec), 1, fp) != 1) ||
+		     (fwrite(pseudo, PSEUDO_HDR, 1, fp) != 1) ||
+		     (cap_len && (fwrite(&p[SPW_CAP_REC_HDR], cap_len, 1, fp) != 1)) )
+			return -1;
+		p += SPW_CAP_REC_HDR + cap_len;
+		len -= SPW_CAP_REC_HDR + cap_len;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct pcap_file_hdr fh;
+	struct cap_resp_info *info;
+	struct cap_resp_get *get;
+	FILE *fp;
+	int opt, port = CAPSRV_PORT, s, len, cnt;
+	unsigned int count = 0, total = 0, dropped, dropped0 = 0, dropped_last = 0;
+	int first = 1;
+
+	while ( (opt = getopt(argc, argv, "p:n:")) != -1 ) {
+		switch ( opt ) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+	if ( argc - optind != 2 ) {
+		printf("usage: %s [-p PORT] [-n COUNT] HOST FILE\n", argv[0]);
+		return 1;
+	}
+
+	s = spw_sock_connect(argv[optind], port);
+	if ( s < 0 )
+		return 1;
+	len = cap_command(s, CAP_CMD_INFO);
+	if ( len < (int)sizeof(*info) ) {
+		printf("Failed to get capture info\n");
+		return 1;
+	}
+	info = (struct cap_resp_info *)(resp + sizeof(struct cap_hdr));
+	printf("Capturing %u link(s), snaplen %u, to %s\n",
+		cap_get32(info->links), cap_get32(info->snaplen), argv[optind + 1]);
+
+	fp = fopen(argv[optind + 1], "wb");
+	if ( !fp ) {
+		printf("Failed to open %s (%s)\n", argv[optind + 1], strerror(errno));
+		return 1;
+	}
+	memset(&fh, 0, sizeof(fh));
+	fh.magic = PCAP_MAGIC;
+	fh.version_major = 2;
+	fh.version_minor = 4;
+	fh.snaplen = PSEUDO_HDR + cap_get32(info->snaplen);
+	fh.linktype = LINKTYPE_USER0;
+	if ( fwrite(&fh, sizeof(fh), 1, fp) != 1 ) {
+		printf("Failed to write %s\n", argv[optind + 1]);
+		return 1;
+	}
+
+	signal(SIGINT, sig_stop);
+	signal(SIGTERM, sig_stop);
+	get = (struct cap_resp_get *)(resp + sizeof(struct cap_hdr));
+	while ( !stop && (!count || (total < count)) ) {
+		len = cap_command(s, CAP_CMD_GET);
+		if ( len < (int)sizeof(*get) ) {
+			printf("Server disconnected\n");
+			break;
+		}
+		cnt = cap_get32(get->cnt);
+		if ( count && (total + cnt > count) )
+			cnt = count - total;
+		if ( write_records(fp, (unsigned char *)(get + 1),
+		                   len - sizeof(*get), cnt) ) {
+			printf("Malformed response or write error\n");
+			break;
+		}
+		total += cnt;
+
+		/* Drops before the client connected are not counted */
+		dropped = cap_get32(get->dropped);
+		if ( first ) {
+			dropped0 = dropped_last = dropped;
+			first = 0;
+		}
+		if ( dropped != dropped_last ) {
+			printf("LOST %u packets, board capture ring full\n",
+				dropped - dropped_last);
+			dropped_last = dropped;
+		}
+		if ( cnt == 0 ) {
+			fflush(fp);
+			usleep(POLL_IDLE_US);
+		}
+	}
+
+	fclose(fp);
+	close(s);
+	printf("%u packets written, %u lost on the board\n", total,
+		dropped_last - dropped0);
+	return 0;
+}
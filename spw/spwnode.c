@@ -0,0 +1,301 @@
+/* Linux: SpaceWire node emulator
+ *
+ * Stands in for a remote SpaceWire node so that initiator and time code
+ * software can be run and measured on a Linux host without hardware. The
+ * node listens on a TCP port, a connection is the cable, see
+ * spw_link_sock.c. Received packets are sorted by spw_demux:
+ *
+ *   RMAP   Executed by an RMAP target (rmap_target.c) on the mapped
+ *          memory, replies leave after the configured latency.
+ *   CUCTP  Addressed to the node: decoded and counted, printed with -v.
+ *          Time packets to other addresses are echoed, see spw_demux_bench
+ *          -s.
+ *   bench  Answered by the target of spw_bench.c, see spwbench -s.
+ *   other  Sent back unchanged, in the buffer they were received into.
+ *
+ * One connection is served at a time, the memory keeps its content from
+ * one connection to the next. Statistics are printed when the peer
+ * disconnects.
+ *
+ * With -c every received packet is also captured, as link 0, and served
+ * by the capture server of capsrv.c on CAP_PORT in a thread of its own,
+ * see spwcap.c.
+ *
+ * usage: spwnode [-p PORT] [-a ADDR] [-k KEY] [-m BASE:KBYTES[:ro]]...
+ *                [-l LATENCY_US] [-j JITTER_US] [-c CAP_PORT] [-v]
+ *
+ * Without -m 1 MiB is mapped at 0x40000000. Try with
+ *   ./spwnode -p 5000 &
+ *   ./rmap_bench -s localhost:5000
+ * or make check, which runs all host tools that talk to a node.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "spw_pkt.h"
+#include "spw_link.h"
+#include "spw_demux.h"
+#include "spw_bench.h"
+#include "rmap_target.h"
+#include "cuc.h"
+#include "capsrv.h"
+
+#define POOL_CNT	1024
+#define POOL_SIZE	(16 * 1024)
+#define RING_DEPTH	128
+#define RX_POSTED	64
+#define RMAP_DEPTH	256
+#define TIME_DEPTH	16
+#define ECHO_DEPTH	128
+#define BENCH_DEPTH	256
+#define IDLE_WAIT_US	100000
+#define CAP_RING_SIZE	(4 * 1024 * 1024)
+#define CAP_SNAPLEN	4096
+
+struct node_map {
+	unsigned int base;
+	unsigned int size;
+	int flags;
+	unsigned char *mem;
+};
+
+static struct node_map maps[RMAP_TARGET_MAPS];
+static int nmaps;
+static int verbose;
+static spw_capture_t capture;
+
+/* Parse BASE:KBYTES[:ro] */
+static int map_parse(char *arg)
+{
+	struct node_map *m;
+	char *end;
+
+	if ( nmaps >= RMAP_TARGET_MAPS )
+		return -1;
+	m = &maps[nmaps];
+	m->base = strtoul(arg, &end, 0);
+	if ( *end != ':' )
+		return -1;
+	m->size = strtoul(end + 1, &end, 0) * 1024;
+	if ( (m->size == 0) || (*end && strcmp(end, ":ro")) )
+		return -1;
+	m->flags = *end ? RMAP_MAP_RO : 0;
+	m->mem = calloc(1, m->size);
+	if ( !m->mem )
+		return -1;
+	nmaps++;
+	return 0;
+}
+
+static void time_input(struct spw_list *pkts, unsigned int *cnt,
+	unsigned int *bad)
+{
+	struct spw_pkt *pkt;
+	struct cuc_pfield pf;
+	struct cuc_time t;
+	unsigned char dla;
+
+	while ( (pkt = spw_list_take(pkts)) ) {
+		if ( cuctp_decode(pkt->data, pkt->dlen, &dla, NULL, &pf, &t) < 0 ) {
+			(*bad)++;
+		} else {
+			(*cnt)++;
+			if ( verbose )
+				printf("CUCTP to %d: %llu.%016llx\n", dla,
+					(unsigned long long)t.coarse,
+					(unsigned long long)t.fine);
+		}
+		spw_pool_put(pkt);
+	}
+}
+
+/* Capture server thread, one client at a time */
+static void *capture_server(void *arg)
+{
+	while ( capsrv_wait_client() == 0 ) {
+		printf("Capture client connected\n");
+		capsrv_loop();
+		printf("Capture client disconnected\n");
+	}
+	capsrv_stop();
+	return NULL;
+}
+
+/* Serve one connection until the peer closes it */
+static void node_serve(int fd, spw_pool_t pool, struct rmap_target_cfg *cfg)
+{
+	struct spw_bench_tgt bench;
+	struct spw_list l, txl;
+	spw_link_t link;
+	spw_demux_t dmx;
+	rmap_target_t t;
+	int q_rmap, q_time, q_bench, q_echo, i, n, wait, posted = 0;
+	unsigned int echoed = 0, time_cnt = 0, time_bad = 0, t0;
+
+	link = spw_link_sock(fd, RING_DEPTH);
+	dmx = link ? spw_demux_create(link, pool, RX_POSTED) : NULL;
+	t = rmap_target_create(pool, cfg);
+	if ( !link || !dmx || !t ) {
+		printf("Failed to set up node\n");
+		goto out;
+	}
+	for (i=0; i<nmaps; i++)
+		rmap_target_map(t, 0, maps[i].base, maps[i].size, maps[i].mem,
+			maps[i].flags);
+	q_rmap = spw_demux_queue(dmx, RMAP_DEPTH, 0, NULL, NULL);
+	q_time = spw_demux_queue(dmx, TIME_DEPTH, 0, NULL, NULL);
+	q_bench = spw_demux_queue(dmx, BENCH_DEPTH, 0, NULL, NULL);
+	q_echo = spw_demux_queue(dmx, ECHO_DEPTH, 0, NULL, NULL);
+	if ( (q_rmap < 0) || (q_time < 0) || (q_bench < 0) || (q_echo < 0) ||
+	     spw_demux_add(dmx, SPW_PID_RMAP, 0, 255, q_rmap) ||
+	     spw_demux_add(dmx, SPW_PID_CUCTP, cfg->addr, cfg->addr, q_time) ||
+	     spw_demux_add(dmx, SPW_BENCH_PID, 0, 255, q_bench) ||
+	     spw_demux_set_default(dmx, q_echo) ) {
+		printf("Failed to set up demux\n");
+		goto out;
+	}
+	spw_bench_target_init(&bench, 0xfe);
+
+	spw_list_init(&l);
+	spw_list_init(&txl);
+	while ( 1 ) {
+		/* Received packets are captured before they are sorted, so
+		 * the receive side is fed here instead of spw_demux_recv().
+		 */
+		t0 = spw_time_us();
+		spw_link_refill(link, pool, &posted, RX_POSTED);
+		n = spw_link_recv(link, &l);
+		if ( n < 0 )
+			break;
+		posted -= n;
+		if ( capture )
+			spw_capture_pkts(capture, 0, &l);
+		spw_demux_dispatch(dmx, &l);
+
+		spw_demux_take(dmx, q_time, &l, TIME_DEPTH);
+		time_input(&l, &time_cnt, &time_bad);
+		spw_demux_take(dmx, q_rmap, &l, RMAP_DEPTH);
+		rmap_target_input(t, &l);
+		spw_demux_take(dmx, q_bench, &l, BENCH_DEPTH);
+		spw_bench_target_input(&bench, &l, &txl);
+		echoed += spw_demux_take(dmx, q_echo, &txl, ECHO_DEPTH);
+		rmap_target_output(t, &txl);
+		if ( spw_link_send(link, &txl) < 0 )
+			break;
+		spw_link_reclaim(link, &l);
+		spw_pool_put_list(&l);
+		if ( n > 0 )
+			bench.busy += spw_time_us() - t0;
+
+		/* Sleep until data arrives or the next reply is due */
+		wait = rmap_target_next_us(t);
+		if ( (wait < 0) || (wait > IDLE_WAIT_US) )
+			wait = IDLE_WAIT_US;
+		if ( wait && (spw_link_sock_wait(link, wait) < 0) )
+			break;
+	}
+	spw_pool_put_list(&txl);
+
+	printf("Connection closed\n");
+	rmap_target_stats_print(t);
+	printf("CUCTP: %u received, %u bad\n", time_cnt, time_bad);
+	printf("Echo: %u packets\n", echoed);
+	spw_demux_stats_print(dmx);
+	spw_link_stats_print(link);
+	if ( capture )
+		spw_capture_stats_print(capture);
+out:
+	rmap_target_free(t);
+	spw_demux_free(dmx);
+	if ( link )
+		spw_link_close(link);
+}
+
+int main(int argc, char *argv[])
+{
+	struct rmap_target_cfg cfg;
+	spw_pool_t pool;
+	pthread_t cap_thread;
+	int opt, port = 5000, cap_port = 0, lfd, fd, i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);	/* Usually run in the background */
+	rmap_target_default_cfg(&cfg);
+	while ( (opt = getopt(argc, argv, "p:a:k:m:l:j:c:v")) != -1 ) {
+		switch ( opt ) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'a':
+			cfg.addr = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			cfg.key = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			if ( map_parse(optarg) ) {
+				printf("Invalid or too many maps: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'l':
+			cfg.latency_us = atoi(optarg);
+			break;
+		case 'j':
+			cfg.jitter_us = atoi(optarg);
+			break;
+		case 'c':
+			cap_port = atoi(optarg);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			printf("usage: %s [-p PORT] [-a ADDR] [-k KEY] "
+				"[-m BASE:KBYTES[:ro]]... [-l LATENCY_US] "
+				"[-j JITTER_US] [-c CAP_PORT] [-v]\n", argv[0]);
+			return 1;
+		}
+	}
+	if ( (nmaps == 0) && map_parse("0x40000000:1024") ) {
+		printf("Failed to allocate memory\n");
+		return 1;
+	}
+
+	pool = spw_pool_create(POOL_CNT, POOL_SIZE);
+	if ( !pool ) {
+		printf("Failed to create pool\n");
+		return 1;
+	}
+	lfd = spw_sock_listen(port);
+	if ( lfd < 0 )
+		return 1;
+	if ( cap_port ) {
+		capture = spw_capture_create(CAP_RING_SIZE, CAP_SNAPLEN);
+		if ( !capture || capsrv_init(NULL, cap_port, capture, 1) ||
+		     pthread_create(&cap_thread, NULL, capture_server, NULL) ) {
+			printf("Failed to start capture server on port %d\n", cap_port);
+			return 1;
+		}
+		printf("Capture server on port %d\n", cap_port);
+	}
+
+	printf("SpW node on port %d: RMAP address 0x%02x key 0x%02x, "
+		"latency %u+%u us\n", port, cfg.addr, cfg.key, cfg.latency_us,
+		cfg.jitter_us);
+	for (i=0; i<nmaps; i++)
+		printf("  0x%08x %u KiB%s\n", maps[i].base, maps[i].size / 1024,
+			(maps[i].flags & RMAP_MAP_RO) ? " read-only" : "");
+	while ( 1 ) {
+		fd = spw_sock_accept(lfd);
+		if ( fd < 0 )
+			continue;
+		printf("Connected\n");
+		node_serve(fd, pool, &cfg);
+		close(fd);
+		spw_pool_stats_print(pool);
+	}
+	return 0;
+}